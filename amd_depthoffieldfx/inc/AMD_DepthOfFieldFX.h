@@ -24,7 +24,7 @@
 #define AMD_DEPTHOFFIELDFX_H
 
 #define AMD_DEPTHOFFIELDFX_VERSION_MAJOR 1
-#define AMD_DEPTHOFFIELDFX_VERSION_MINOR 0
+#define AMD_DEPTHOFFIELDFX_VERSION_MINOR 1
 #define AMD_DEPTHOFFIELDFX_VERSION_PATCH 0
 
 // default to static lib
@@ -44,6 +44,12 @@
 
 #include "AMD_Types.h"
 
+// forward declare the D3D11 interfaces so the CPU backend can use this header without d3d11.h
+struct ID3D11Device;
+struct ID3D11DeviceContext;
+struct ID3D11ShaderResourceView;
+struct ID3D11UnorderedAccessView;
+
 namespace AMD {
 enum DEPTHOFFIELDFX_RETURN_CODE
 {
@@ -55,6 +61,137 @@ enum DEPTHOFFIELDFX_RETURN_CODE
     DEPTHOFFIELDFX_RETURN_CODE_INVALID_SURFACE,
 };
 
+enum DEPTHOFFIELDFX_MODE
+{
+    DEPTHOFFIELDFX_MODE_RENDER,
+    DEPTHOFFIELDFX_MODE_RENDER_QUARTER_RES,
+    DEPTHOFFIELDFX_MODE_RENDER_BOX,
+    DEPTHOFFIELDFX_MODE_COUNT,
+};
+
+enum DEPTHOFFIELDFX_PASS
+{
+    DEPTHOFFIELDFX_PASS_CLEAR,
+    DEPTHOFFIELDFX_PASS_FAST_FILTER_SETUP,
+    DEPTHOFFIELDFX_PASS_VERTICAL_INTEGRATE,
+    DEPTHOFFIELDFX_PASS_HORIZONTAL_INTEGRATE,
+    DEPTHOFFIELDFX_PASS_READ_FINAL_RESULT,
+    DEPTHOFFIELDFX_PASS_COUNT,
+};
+
+/**
+Memory traffic of a single pass.
+Buffer bytes count the accesses to the intermediate buffers and any mode specific surfaces,
+atomic adds count as both a read and a write. The setup pass of the D3D11 RenderQuarterRes
+reports the worst case where no 2x2 quad is collapsed into a single splat, the CPU backend
+always scatters one splat per quad into its half resolution buffer.
+Texels count the accesses to the color, circle of confusion and result surfaces,
+multiply them by the texel size of the formats in use.
+*/
+struct DEPTHOFFIELDFX_PASS_TRAFFIC
+{
+    uint64 m_bufferBytesRead;
+    uint64 m_bufferBytesWritten;
+    uint64 m_texelsRead;
+    uint64 m_texelsWritten;
+};
+
+/**
+Memory allocated by DepthOfFieldFX_Resize and DepthOfFieldFX_Initialize for a given
+m_screenSize and m_maxBlurRadius, and the traffic of every pass of every render mode.
+m_totalBytes includes the surfaces only needed by the given mode.
+*/
+struct DEPTHOFFIELDFX_MEMORY_REQUIREMENTS
+{
+    uint64 m_intermediateBufferBytes;
+    uint64 m_transposedBufferBytes;
+    uint64 m_constantBufferBytes;
+    uint64 m_modeSurfaceBytes[DEPTHOFFIELDFX_MODE_COUNT];
+    uint64 m_totalBytes[DEPTHOFFIELDFX_MODE_COUNT];
+
+    DEPTHOFFIELDFX_PASS_TRAFFIC m_passTraffic[DEPTHOFFIELDFX_MODE_COUNT][DEPTHOFFIELDFX_PASS_COUNT];
+};
+
+/**
+Fixed point headroom of the integer intermediate buffers for a given maximum blur radius.
+The splats are scaled by 1 << m_scaleFactor before they are rounded, integrated pixels must
+fit in 31 bits while the deltas may wrap. The bound assumes every neighbour of a pixel uses
+the radius that puts the most weight on it and is rarely reached by real images.
+m_scaleFactor is the largest scale factor that cannot overflow for the given peak color.
+m_headroomBits is the number of bits to spare at the scale factor of the descriptor,
+a negative value means the result may overflow.
+m_precisionBits is the number of fractional bits a splat of the widest kernel keeps,
+colors lose precision and banding shows as it approaches zero.
+m_errorBound is the largest error the rounding of the splats adds to a linear result channel
+at the scale factor of the descriptor, float rounding aside.
+*/
+struct DEPTHOFFIELDFX_SCALE_FACTOR_INFO
+{
+    uint  m_scaleFactor;
+    float m_headroomBits;
+    float m_precisionBits;
+    float m_errorBound;
+};
+
+/**
+Thin lens the CPU backend computes the circle of confusion with when it is given a depth image
+instead of a circle of confusion image, see DEPTHOFFIELDFX_CPU_DESC::m_depth, like CalcDOF of the
+sample does in a pass of its own.
+The D3D11 path does not take depth yet, the COC_FROM_DEPTH variant of its setup shaders is not
+compiled into the library.
+m_focalLength, m_focusDistance and the planes share one unit, the scene's.
+m_nearPlane and m_farPlane are the planes of the projection that wrote the depth buffer,
+m_reversedZ is set if it maps the near plane to 1 and the far plane to 0.
+m_farPlane may be INFINITY for an infinite far projection.
+The circle of confusion is scaled to pixels by half the screen width and clamped to m_maxBlurRadius.
+m_forceCoc replaces it by -m_forceCoc everywhere when its magnitude is above 0.25, unclamped,
+like the Force CoC slider of the sample. 0 leaves it alone.
+*/
+struct DEPTHOFFIELDFX_LENS
+{
+    float m_focalLength;
+    float m_fStop;
+    float m_focusDistance;
+    float m_nearPlane;
+    float m_farPlane;
+    bool  m_reversedZ;
+    float m_forceCoc;
+};
+
+/**
+Picks the render mode of every frame under a time budget, see DepthOfFieldFX_SelectMode.
+The modes rank Render, RenderBox and RenderQuarterRes from the best looking down. The time of a mode
+is predicted from the bytes of memory traffic of its passes for the frame, the DEPTHOFFIELDFX_PASS_TRAFFIC
+of DepthOfFieldFX_GetMemoryRequirements with every texel counted as m_texelBytes, times its
+m_millisecondsPerByte. DepthOfFieldFX_CalibrateModeSelector measures those from the timings of rendered
+frames. The first timing of a mode sets its cost, later ones move the costs of all modes by
+m_calibrationWeight of the change, as load on the device slows every mode down alike. Modes that were
+never timed borrow the average cost per byte of the others, before the first timing the selector
+stays at m_mode.
+The selector steps down to the best mode predicted to meet m_budgetMilliseconds as soon as the current
+one is predicted to miss it, or to the cheapest one if none fits. It only steps up once a better mode
+has been predicted to fit with a margin of m_hysteresis, a fraction of the budget, for
+m_hysteresisFrames frames in a row, so it does not flicker between modes near the budget.
+m_predictedMilliseconds holds the predictions of the last selection, 0 for modes that cannot render.
+*/
+struct DEPTHOFFIELDFX_MODE_SELECTOR
+{
+    AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_MODE_SELECTOR();
+
+    float m_budgetMilliseconds;
+    float m_hysteresis;
+    uint  m_hysteresisFrames;
+    float m_calibrationWeight;
+    uint  m_texelBytes;
+
+    double m_millisecondsPerByte[DEPTHOFFIELDFX_MODE_COUNT];
+    float  m_predictedMilliseconds[DEPTHOFFIELDFX_MODE_COUNT];
+
+    DEPTHOFFIELDFX_MODE m_mode;
+    DEPTHOFFIELDFX_MODE m_pendingMode;
+    uint                m_pendingFrames;
+};
+
 struct DEPTHOFFIELDFX_OPAQUE_DESC;
 
 struct DEPTHOFFIELDFX_DESC
@@ -71,6 +208,7 @@ in order to avoid any collisions between different modules or app types.
     AMD_DECLARE_CAMERA_TYPE;
 
     AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_DESC();
+    AMD_DEPTHOFFIELDFX_DLL_API ~DEPTHOFFIELDFX_DESC();
 
     uint2 m_screenSize;
     uint  m_scaleFactor;
@@ -85,23 +223,108 @@ in order to avoid any collisions between different modules or app types.
 
     DEPTHOFFIELDFX_OPAQUE_DESC* m_pOpaque;
 
+    /**
+    DepthOfFieldFX_Resize and DepthOfFieldFX_ResizeViews keep the intermediate buffers whenever the
+    new layout fits in them and only allocate when it grows, so the buffers stay at the largest
+    layout seen. With m_trimResizeCount set they are allocated again at the current layout after
+    that many resizes in a row leave more than half of them unused. 0 keeps them until
+    DepthOfFieldFX_Trim or DepthOfFieldFX_Release.
+    */
+    uint m_trimResizeCount;
+
 private:
     AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_DESC(const DEPTHOFFIELDFX_DESC&);
     AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_DESC& operator=(const DEPTHOFFIELDFX_DESC&);
 };
 
+/**
+A single view of a batched render, such as one eye of a stereo pair.
+Views may differ in size. The scale factor, maximum blur radius, device and context
+are taken from the DEPTHOFFIELDFX_DESC the views are rendered with.
+*/
+struct DEPTHOFFIELDFX_VIEW
+{
+    AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_VIEW();
+
+    DEPTHOFFIELDFX_DESC::uint2 m_screenSize;
+
+    ID3D11ShaderResourceView*  m_pCircleOfConfusionSRV;
+    ID3D11ShaderResourceView*  m_pColorSRV;
+    ID3D11UnorderedAccessView* m_pResultUAV;
+};
+
 
 /**
 Get DepthOfFieldFX library version number
 This can be called before DEPTHOFFIELDFX_Initialize
 */
 AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_GetVersion(uint* major, uint* minor, uint* patch);
+
+/**
+Get the memory footprint of DepthOfFieldFX for the screen size and blur radius in desc
+This can be called before DEPTHOFFIELDFX_Initialize, no device is needed
+*/
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_GetMemoryRequirements(const DEPTHOFFIELDFX_DESC& desc, DEPTHOFFIELDFX_MEMORY_REQUIREMENTS* pInfo);
+
+/**
+Get the scale factor headroom of the given mode for m_scaleFactor and m_maxBlurRadius in desc
+peakColor is the largest absolute color channel value of the input, values below 1 count as 1
+This can be called before DEPTHOFFIELDFX_Initialize, no device is needed
+*/
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_GetScaleFactorInfo(const DEPTHOFFIELDFX_DESC& desc, DEPTHOFFIELDFX_MODE mode, float peakColor, DEPTHOFFIELDFX_SCALE_FACTOR_INFO* pInfo);
+
+/**
+DepthOfFieldFX_SelectMode predicts the time of every mode for the m_screenSize and m_maxBlurRadius
+of the frame in desc and returns the one the selector picks in pMode, it also becomes selector.m_mode.
+DepthOfFieldFX_CalibrateModeSelector takes the milliseconds a frame rendered with desc took in mode,
+timed with queries around the render call.
+This can be called before DEPTHOFFIELDFX_Initialize, no device is needed
+*/
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_SelectMode(const DEPTHOFFIELDFX_DESC& desc, DEPTHOFFIELDFX_MODE_SELECTOR& selector, DEPTHOFFIELDFX_MODE* pMode);
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_CalibrateModeSelector(const DEPTHOFFIELDFX_DESC& desc, DEPTHOFFIELDFX_MODE_SELECTOR& selector, DEPTHOFFIELDFX_MODE mode, float milliseconds);
+
+/**
+A context owns the intermediate buffers, the constant buffer and the size they were resized for.
+Every DEPTHOFFIELDFX_DESC starts out on a default context shared by all descriptors.
+DepthOfFieldFX_CreateContext gives desc a context of its own, so several views can each keep
+their resolution without calling DepthOfFieldFX_Resize before every render.
+DepthOfFieldFX_DestroyContext releases it and puts desc back on the default context, a desc
+destroyed with a context of its own destroys it, so the device has to outlive it. A desc cannot be
+copied, as the copy would share its context.
+The compiled shaders are shared by all contexts on the same device.
+DepthOfFieldFX_Resize sizes the buffers for m_screenSize and m_maxBlurRadius, the render calls
+lay them out for the m_screenSize and m_maxBlurRadius of each frame and only scatter and
+integrate that layout. For dynamic resolution resize once for the largest screen size and blur
+radius, then render any smaller ones without resizing. A frame that does not fit fails with
+INVALID_SURFACE.
+*/
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_CreateContext(DEPTHOFFIELDFX_DESC& desc);
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_DestroyContext(DEPTHOFFIELDFX_DESC& desc);
 AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_Initialize(const DEPTHOFFIELDFX_DESC& desc);
 AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_Resize(const DEPTHOFFIELDFX_DESC& desc);
 AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_Render(const DEPTHOFFIELDFX_DESC& desc);
 AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_RenderQuarterRes(const DEPTHOFFIELDFX_DESC& desc);
 AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_RenderBox(const DEPTHOFFIELDFX_DESC& desc);
 AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_Release(const DEPTHOFFIELDFX_DESC& desc);
+
+/**
+Allocates the intermediate buffers again at the layout of the last resize if they are larger,
+returning the memory a larger screen size or blur radius left behind. Nothing happens if they fit.
+*/
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_Trim(const DEPTHOFFIELDFX_DESC& desc);
+
+/**
+Batched rendering of several views with one context.
+DepthOfFieldFX_ResizeViews stacks an intermediate buffer region for every view into a single
+pair of buffers, it replaces the buffers of DepthOfFieldFX_Resize and vice versa.
+DepthOfFieldFX_RenderViews clears all regions at once and integrates all of them in a single
+dispatch per direction. The setup and the final read run once per view, as they read and write
+the textures of the view. The constants of a view are only written when its screen size, the blur
+radius or the scale factor change. Every view must fit the region it was resized for, a view may
+shrink but not grow.
+*/
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_ResizeViews(const DEPTHOFFIELDFX_DESC& desc, const DEPTHOFFIELDFX_VIEW* pViews, uint viewCount);
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_RenderViews(const DEPTHOFFIELDFX_DESC& desc, DEPTHOFFIELDFX_MODE mode, const DEPTHOFFIELDFX_VIEW* pViews, uint viewCount);
 }
 
 #endif  // AMD_DEPTHOFFIELD_H
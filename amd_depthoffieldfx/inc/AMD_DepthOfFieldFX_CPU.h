@@ -0,0 +1,428 @@
+//
+// Copyright (c) 2017 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#ifndef AMD_DEPTHOFFIELDFX_CPU_H
+#define AMD_DEPTHOFFIELDFX_CPU_H
+
+#include "AMD_DepthOfFieldFX.h"
+
+namespace AMD {
+enum DEPTHOFFIELDFX_CPU_FORMAT
+{
+    DEPTHOFFIELDFX_CPU_FORMAT_R32G32B32A32_FLOAT,
+    DEPTHOFFIELDFX_CPU_FORMAT_R16G16B16A16_FLOAT,
+    DEPTHOFFIELDFX_CPU_FORMAT_R32_FLOAT,
+    DEPTHOFFIELDFX_CPU_FORMAT_R16_FLOAT,
+    DEPTHOFFIELDFX_CPU_FORMAT_D24_UNORM_S8_UINT,
+};
+
+/**
+Instruction set used by the integration kernels.
+AUTO picks the best one supported by the CPU, the others force a kernel
+and make DepthOfFieldFX_Initialize fail if it is not available.
+*/
+enum DEPTHOFFIELDFX_CPU_INSTRUCTION_SET
+{
+    DEPTHOFFIELDFX_CPU_INSTRUCTION_SET_AUTO,
+    DEPTHOFFIELDFX_CPU_INSTRUCTION_SET_SCALAR,
+    DEPTHOFFIELDFX_CPU_INSTRUCTION_SET_SSE2,
+    DEPTHOFFIELDFX_CPU_INSTRUCTION_SET_AVX2,
+    DEPTHOFFIELDFX_CPU_INSTRUCTION_SET_NEON,
+};
+
+/**
+How the second integration pass gets to the columns of the image.
+IN_PLACE skips the transpose and the transposed buffer entirely: the second pass integrates
+strips of rows horizontally in the intermediate buffer. This is the default, it halves the
+memory footprint and is the fastest mode on the machines we measured.
+TILED integrates 64x64 tiles in L2 and writes them out transposed a tile at a time,
+TILED_NON_TEMPORAL does the same with streaming stores.
+DIRECT writes every integrated element straight to its transposed location, like the shader.
+Call DepthOfFieldFX_Resize after switching to or away from IN_PLACE.
+*/
+enum DEPTHOFFIELDFX_CPU_TRANSPOSE_MODE
+{
+    DEPTHOFFIELDFX_CPU_TRANSPOSE_MODE_IN_PLACE,
+    DEPTHOFFIELDFX_CPU_TRANSPOSE_MODE_TILED,
+    DEPTHOFFIELDFX_CPU_TRANSPOSE_MODE_TILED_NON_TEMPORAL,
+    DEPTHOFFIELDFX_CPU_TRANSPOSE_MODE_DIRECT,
+};
+
+/**
+How the setup pass scatters the kernel deltas of many threads into one buffer.
+The deltas are integers, so every mode produces the same bits for any thread count.
+PRIVATE_PLANES gives each thread a band of rows and a private delta plane covering the band
+plus its halo, the planes are then summed by a parallel reduction. It scales with the number
+of threads at the cost of one plane per thread.
+SHARDED_ATOMICS splits the rows into shards and adds with atomics, contention is limited to the
+halo rows shared by neighbouring shards.
+BANDED scatters bands at least 2 * maxBlurRadius + 4 rows high, even bands first then odd ones.
+It needs no extra memory, but large radii leave few bands to run in parallel.
+Call DepthOfFieldFX_Resize after switching to or away from PRIVATE_PLANES.
+*/
+enum DEPTHOFFIELDFX_CPU_SCATTER_MODE
+{
+    DEPTHOFFIELDFX_CPU_SCATTER_MODE_PRIVATE_PLANES,
+    DEPTHOFFIELDFX_CPU_SCATTER_MODE_SHARDED_ATOMICS,
+    DEPTHOFFIELDFX_CPU_SCATTER_MODE_BANDED,
+};
+
+/**
+Lanes of the intermediate buffer elements.
+INT32 stores four 32 bit lanes, the int4 of the shader.
+INT16 stores four 16 bit lanes, halving the bytes every pass reads and writes. Each tile picks the
+largest scale factor its 16 bit results cannot overflow for its peak color and largest blur radius,
+the scale cancels out when the colors are divided by the weight. A tile is rendered exactly like an
+INT32 tile at that scale factor, since the lanes wrap like the 32 bit ones. Tiles that would keep
+less than 8 bits of precision, like large Bartlett radii, fall back to 32 bit lanes at m_scaleFactor.
+INT16 needs DEPTHOFFIELDFX_CPU_TRANSPOSE_MODE_IN_PLACE. The buffers are still sized for 32 bit lanes
+and DepthOfFieldFX_GetMemoryRequirements reports the traffic of 32 bit tiles.
+*/
+enum DEPTHOFFIELDFX_CPU_INTERMEDIATE_FORMAT
+{
+    DEPTHOFFIELDFX_CPU_INTERMEDIATE_FORMAT_INT32,
+    DEPTHOFFIELDFX_CPU_INTERMEDIATE_FORMAT_INT16,
+};
+
+/**
+Which part of the frame the passes cover.
+FULL_FRAME clears, scatters and integrates the whole frame.
+MEASURED reduces the circle of confusion of every frame to the bounding rectangle of the pixels
+that are blurred, CALLER takes that rectangle from DEPTHOFFIELDFX_CPU_DESC::m_defocusBounds.
+Only the rectangle plus the halo its kernels reach is cleared, scattered and integrated, in tiles
+under a memory budget. The pixels outside are in focus and written straight from the color with the
+value the passes would give them, so the result matches FULL_FRAME bit for bit with INT32 lanes.
+A pixel is blurred when its blur radius is at least 1, for RenderQuarterRes when the absolute
+circle of confusion is above 1. With CALLER, blurred pixels outside the rectangle come out sharp.
+*/
+enum DEPTHOFFIELDFX_CPU_DEFOCUS_MODE
+{
+    DEPTHOFFIELDFX_CPU_DEFOCUS_MODE_FULL_FRAME,
+    DEPTHOFFIELDFX_CPU_DEFOCUS_MODE_MEASURED,
+    DEPTHOFFIELDFX_CPU_DEFOCUS_MODE_CALLER,
+};
+
+/**
+Kernel DepthOfFieldFX_Render spreads every pixel with.
+BARTLETT is the tent of the D3D11 path, two box filters integrated twice from 9 deltas per pixel.
+QUADRATIC_BSPLINE convolves three boxes of 2 * ceil(r / 3) + 1 pixels, which gives the tent a smooth
+edge for 16 deltas per pixel and a third integration. The odd boxes keep it centered on the pixel and
+reach r to r + 2 pixels from it. The unnormalized kernel grows with the sixth power of the box width,
+so to keep the precision of the Bartlett at a blur radius of 64 it takes an m_maxBlurRadius of up to
+DEPTHOFFIELDFX_CPU_QUADRATIC_BSPLINE_MAX_BLUR_RADIUS. RenderQuarterRes, RenderBox and RenderPyramid
+keep their own kernels.
+*/
+enum DEPTHOFFIELDFX_CPU_KERNEL
+{
+    DEPTHOFFIELDFX_CPU_KERNEL_BARTLETT,
+    DEPTHOFFIELDFX_CPU_KERNEL_QUADRATIC_BSPLINE,
+};
+
+/**
+Orientation of the oval bokeh of DEPTHOFFIELDFX_CPU_DESC::m_anamorphicSqueeze. The kernels stay separable,
+so the axes of the ovals are the ones of the image. VERTICAL squeezes the horizontal radius into the tall
+ovals of an anamorphic lens, HORIZONTAL squeezes the vertical radius. TANGENTIAL squeezes, per pixel, the
+axis nearer the direction to the center of the screen, the cat's eye bokeh toward the edges of a frame.
+*/
+enum DEPTHOFFIELDFX_CPU_BOKEH_ORIENTATION
+{
+    DEPTHOFFIELDFX_CPU_BOKEH_ORIENTATION_VERTICAL,
+    DEPTHOFFIELDFX_CPU_BOKEH_ORIENTATION_HORIZONTAL,
+    DEPTHOFFIELDFX_CPU_BOKEH_ORIENTATION_TANGENTIAL,
+};
+
+/**
+Classes of the DEPTHOFFIELDFX_CPU_COC_TILE_SIZE pixel square tiles of DepthOfFieldFX_ComputeCocStatistics,
+by the largest blur radius of their pixels. SHARP tiles are in focus, SMALL_BLUR tiles blur by at most
+DEPTHOFFIELDFX_CPU_COC_SMALL_BLUR_RADIUS pixels and LARGE_BLUR tiles by more.
+*/
+enum DEPTHOFFIELDFX_CPU_COC_TILE_CLASS
+{
+    DEPTHOFFIELDFX_CPU_COC_TILE_CLASS_SHARP,
+    DEPTHOFFIELDFX_CPU_COC_TILE_CLASS_SMALL_BLUR,
+    DEPTHOFFIELDFX_CPU_COC_TILE_CLASS_LARGE_BLUR,
+    DEPTHOFFIELDFX_CPU_COC_TILE_CLASS_COUNT,
+};
+
+static const uint DEPTHOFFIELDFX_CPU_COC_TILE_SIZE                     = 16;
+static const uint DEPTHOFFIELDFX_CPU_COC_SMALL_BLUR_RADIUS             = 8;
+static const uint DEPTHOFFIELDFX_CPU_COC_RADIUS_HISTOGRAM_SIZE         = 65;
+static const uint DEPTHOFFIELDFX_CPU_REUSE_TILE_SIZE                   = 32;
+static const uint DEPTHOFFIELDFX_CPU_PYRAMID_LEVEL_RADIUS              = 32;
+static const uint DEPTHOFFIELDFX_CPU_PYRAMID_MAX_BLUR_RADIUS           = 1024;
+static const uint DEPTHOFFIELDFX_CPU_QUADRATIC_BSPLINE_MAX_BLUR_RADIUS = 21;
+
+/**
+A plain image in system memory. 16 bit formats are IEEE half floats.
+D24_UNORM_S8_UINT is a depth format, the depth is the low 24 bits of each 32 bit texel.
+m_pitch is the distance in bytes between two rows.
+*/
+struct DEPTHOFFIELDFX_CPU_IMAGE
+{
+    void*                     m_pData;
+    uint                      m_pitch;
+    DEPTHOFFIELDFX_CPU_FORMAT m_format;
+};
+
+struct DEPTHOFFIELDFX_CPU_OPAQUE_DESC;
+
+/**
+Device independent version of DEPTHOFFIELDFX_DESC. The CPU backend runs the same fast filter spread
+passes as the D3D11 path on a pool of worker threads, the render calls take the layout of every frame
+from m_screenSize and m_maxBlurRadius.
+*/
+struct DEPTHOFFIELDFX_CPU_DESC
+{
+#pragma warning(push)
+#pragma warning(disable : 4201)  // suppress nameless struct/union level 4 warnings
+    AMD_DECLARE_BASIC_VECTOR_TYPE;
+#pragma warning(pop)
+
+    AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_CPU_DESC();
+    AMD_DEPTHOFFIELDFX_DLL_API ~DEPTHOFFIELDFX_CPU_DESC();
+
+    uint2 m_screenSize;
+    uint  m_scaleFactor;
+    uint  m_maxBlurRadius;
+
+    // worker threads, 0 uses every hardware thread
+    uint m_numThreads;
+
+    // like DEPTHOFFIELDFX_DESC::m_trimResizeCount, with a budget the kept memory never exceeds m_memoryBudget
+    uint m_trimResizeCount;
+
+    bool m_convertToSRGB;
+
+    // RenderQuarterRes scatters every 2x2 quad at half resolution and composites it with the full resolution
+    // color by circle of confusion. This sizes the buffers for it alone, a quarter of the memory, Render and
+    // RenderBox then fail.
+    bool m_quarterResOnly;
+
+    // ignores m_scaleFactor and renders every frame with the largest one its peak color cannot overflow,
+    // see DepthOfFieldFX_GetScaleFactorInfo
+    bool m_autoScaleFactor;
+
+    // Takes the blur radius of the frame from the last DepthOfFieldFX_ComputeCocStatistics instead of
+    // m_maxBlurRadius, which shrinks the padding of every tile, and DEPTHOFFIELDFX_CPU_DEFOCUS_MODE_MEASURED
+    // takes its bounds from there. With INT32 lanes the result does not change as long as the statistics
+    // were computed from the circle of confusion being rendered.
+    bool m_useCocStatistics;
+
+    // Recomputes only the DEPTHOFFIELDFX_CPU_REUSE_TILE_SIZE pixel tiles with a changed source within the
+    // reach of their kernels since the last render, m_result has to hold that render untouched, see
+    // DepthOfFieldFX_ResetReuse. A change of mode, screen size, blur radius, scale factor, lens or result
+    // surface recomputes the whole frame. Tiles are compared by a 64 bit hash of their sources, so a change
+    // is missed with a probability of about 2^-64 per tile, otherwise with INT32 lanes the result is the
+    // one of a full render. DepthOfFieldFX_GetReuseStatistics counts the reused tiles.
+    bool m_reuseUnchangedTiles;
+
+    // allocates the levels of DepthOfFieldFX_RenderPyramid, which then takes an m_maxBlurRadius of up to
+    // DEPTHOFFIELDFX_CPU_PYRAMID_MAX_BLUR_RADIUS, the other render calls still take at most 64
+    bool m_pyramid;
+
+    // Render and RenderBox scatter the pixels with a negative circle of confusion into a near field layer
+    // and the rest into a far field one, composited with the coverage of the near field as its alpha so it
+    // blurs over the pixels behind it. The buffers are twice as wide, call DepthOfFieldFX_Resize after
+    // setting it. Layers are CPU only, the D3D11 path has no shaders for them. RenderQuarterRes and
+    // RenderPyramid have no layers and return DEPTHOFFIELDFX_RETURN_CODE_INVALID_PARAMS while it is set.
+    bool m_layered;
+
+    // Caps the bytes DepthOfFieldFX_Resize allocates. The frame is then rendered in the largest square
+    // tiles that fit, each with a halo of the pixels its kernels reach, and the result matches the untiled
+    // one bit for bit. The render calls keep the tile size DepthOfFieldFX_Resize chose. 0 renders the whole
+    // frame at once.
+    uint64 m_memoryBudget;
+
+    DEPTHOFFIELDFX_CPU_INSTRUCTION_SET     m_instructionSet;
+    DEPTHOFFIELDFX_CPU_TRANSPOSE_MODE      m_transposeMode;
+    DEPTHOFFIELDFX_CPU_SCATTER_MODE        m_scatterMode;
+    DEPTHOFFIELDFX_CPU_INTERMEDIATE_FORMAT m_intermediateFormat;
+    DEPTHOFFIELDFX_CPU_DEFOCUS_MODE        m_defocusMode;
+    DEPTHOFFIELDFX_CPU_KERNEL              m_kernel;
+
+    // the axis m_anamorphicSqueeze shortens
+    DEPTHOFFIELDFX_CPU_BOKEH_ORIENTATION m_bokehOrientation;
+
+    // Divides one radius of every kernel by it, rounded to the nearest pixel, for oval bokeh. The layout,
+    // taps and integration stay those of the blur radius, each splat is normalized by the sum of its own
+    // kernel. 1 keeps them round.
+    float m_anamorphicSqueeze;
+
+    // x, y, width and height of the pixels that may be blurred, for DEPTHOFFIELDFX_CPU_DEFOCUS_MODE_CALLER
+    uint4 m_defocusBounds;
+
+    DEPTHOFFIELDFX_CPU_IMAGE m_circleOfConfusion;
+    DEPTHOFFIELDFX_CPU_IMAGE m_color;
+    DEPTHOFFIELDFX_CPU_IMAGE m_result;
+
+    // When set the passes compute the circle of confusion from it with m_lens and ignore
+    // m_circleOfConfusion. It takes the formats of m_circleOfConfusion, reading the first channel, and
+    // D24_UNORM_S8_UINT.
+    DEPTHOFFIELDFX_CPU_IMAGE m_depth;
+    DEPTHOFFIELDFX_LENS      m_lens;
+
+    DEPTHOFFIELDFX_CPU_OPAQUE_DESC* m_pOpaque;
+
+private:
+    AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_CPU_DESC(const DEPTHOFFIELDFX_CPU_DESC&);
+    AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_CPU_DESC& operator=(const DEPTHOFFIELDFX_CPU_DESC&);
+};
+
+/**
+Circle of confusion statistics of a frame, see DepthOfFieldFX_ComputeCocStatistics.
+m_maxCoc is the largest absolute circle of confusion, m_maxBlurRadius the blur radius it gives
+clamped to DEPTHOFFIELDFX_CPU_DESC::m_maxBlurRadius. m_radiusHistogram counts the pixels of every
+blur radius. m_defocusBounds is the x, y, width and height of the pixels with an absolute circle of
+confusion of at least 1, empty if the frame is in focus. m_tileCount is the number of
+DEPTHOFFIELDFX_CPU_COC_TILE_SIZE pixel tiles the frame is split into, m_tileClassCounts counts the
+tiles of every DEPTHOFFIELDFX_CPU_COC_TILE_CLASS.
+*/
+struct DEPTHOFFIELDFX_CPU_COC_STATISTICS
+{
+    float                          m_maxCoc;
+    uint                           m_maxBlurRadius;
+    DEPTHOFFIELDFX_CPU_DESC::uint4 m_defocusBounds;
+    DEPTHOFFIELDFX_CPU_DESC::uint2 m_tileCount;
+
+    uint64 m_radiusHistogram[DEPTHOFFIELDFX_CPU_COC_RADIUS_HISTOGRAM_SIZE];
+    uint   m_tileClassCounts[DEPTHOFFIELDFX_CPU_COC_TILE_CLASS_COUNT];
+};
+
+/**
+Hit rate counters of DEPTHOFFIELDFX_CPU_DESC::m_reuseUnchangedTiles, see DepthOfFieldFX_GetReuseStatistics.
+m_tileCount is the number of DEPTHOFFIELDFX_CPU_REUSE_TILE_SIZE pixel tiles the frame is split into,
+m_changedTiles the tiles with a changed source at the last render, every tile when the whole frame was
+recomputed, and m_reusedTiles the tiles it kept the previous result of. The totals add them up over
+the renders with m_reuseUnchangedTiles since the context was created or DepthOfFieldFX_ResetReuse,
+the hit rate is m_totalReusedTiles / m_totalTiles.
+*/
+struct DEPTHOFFIELDFX_CPU_REUSE_STATISTICS
+{
+    DEPTHOFFIELDFX_CPU_DESC::uint2 m_tileCount;
+    uint                           m_changedTiles;
+    uint                           m_reusedTiles;
+
+    uint64 m_frameCount;
+    uint64 m_totalTiles;
+    uint64 m_totalChangedTiles;
+    uint64 m_totalReusedTiles;
+};
+
+/**
+Wall clock time of every pass of the last DepthOfFieldFX_Render* call on a context, summed over
+the tiles. With DEPTHOFFIELDFX_CPU_SCATTER_MODE_PRIVATE_PLANES the clear is the reduction of the
+planes into the intermediate buffer, clearing the planes themselves is part of the setup.
+DEPTHOFFIELDFX_PASS_HORIZONTAL_INTEGRATE is the second integration, transpose included.
+*/
+struct DEPTHOFFIELDFX_CPU_PASS_TIMINGS
+{
+    double m_milliseconds[DEPTHOFFIELDFX_PASS_COUNT];
+};
+
+/**
+The footprint DepthOfFieldFX_Resize allocates for desc, including the tiling under m_memoryBudget.
+The mode surfaces are the private planes of DEPTHOFFIELDFX_CPU_SCATTER_MODE_PRIVATE_PLANES.
+With m_pyramid the intermediate buffer bytes include the levels of DepthOfFieldFX_RenderPyramid,
+the pass traffic is left 0 for an m_maxBlurRadius above 64 the modes cannot render.
+All sizes are 0 if no tile fits in the budget.
+*/
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_GetMemoryRequirements(const DEPTHOFFIELDFX_CPU_DESC& desc, DEPTHOFFIELDFX_MEMORY_REQUIREMENTS* pInfo);
+/**
+The scale factor headroom of desc, see the D3D11 version. The quarter res mode scatters with
+half the radius into its half resolution buffer and has more headroom than the D3D11 one.
+With DEPTHOFFIELDFX_CPU_INTERMEDIATE_FORMAT_INT16 the headroom is the one of the 16 bit lanes.
+DepthOfFieldFX_MeasurePeakColor gets the peakColor of m_color on the worker threads of the context.
+*/
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_GetScaleFactorInfo(const DEPTHOFFIELDFX_CPU_DESC& desc, DEPTHOFFIELDFX_MODE mode, float peakColor, DEPTHOFFIELDFX_SCALE_FACTOR_INFO* pInfo);
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_MeasurePeakColor(const DEPTHOFFIELDFX_CPU_DESC& desc, float* pPeakColor);
+/**
+Converts m_depth to m_circleOfConfusion with m_lens on the worker threads of the context, with the
+vector kernels of m_instructionSet, for pipelines that keep the circle of confusion or render
+a frame several times. m_depth can be R32_FLOAT, R16_FLOAT or D24_UNORM_S8_UINT and
+m_circleOfConfusion R32_FLOAT or R16_FLOAT, other formats fail with INVALID_SURFACE.
+An R32_FLOAT result holds the values the passes compute from m_depth.
+Needs DepthOfFieldFX_Initialize but no DepthOfFieldFX_Resize.
+*/
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_ComputeCoc(const DEPTHOFFIELDFX_CPU_DESC& desc);
+/**
+Reduces the circle of confusion of the frame, read like the render calls do from m_circleOfConfusion
+or m_depth, to DEPTHOFFIELDFX_CPU_COC_STATISTICS and the class of every tile on the worker threads of
+the context. The context keeps them for the render calls with m_useCocStatistics, so they never leave
+the context. DepthOfFieldFX_GetCocStatistics copies them out to pick a mode or a blur radius,
+pTileClasses receives a DEPTHOFFIELDFX_CPU_COC_TILE_CLASS byte per tile in rows of m_tileCount.x tiles
+and can be null. It fails with INVALID_PARAMS if no statistics were computed.
+Needs DepthOfFieldFX_Initialize but no DepthOfFieldFX_Resize.
+*/
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_ComputeCocStatistics(const DEPTHOFFIELDFX_CPU_DESC& desc);
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_GetCocStatistics(const DEPTHOFFIELDFX_CPU_DESC& desc, DEPTHOFFIELDFX_CPU_COC_STATISTICS* pStatistics, uint8* pTileClasses);
+/**
+DepthOfFieldFX_GetReuseStatistics copies the hit rate counters of m_reuseUnchangedTiles of the context.
+DepthOfFieldFX_ResetReuse forgets the sources of the last render and zeroes the counters, the next
+render with m_reuseUnchangedTiles recomputes the whole frame. Call it after anything but the render
+calls wrote to m_result.
+*/
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_GetReuseStatistics(const DEPTHOFFIELDFX_CPU_DESC& desc, DEPTHOFFIELDFX_CPU_REUSE_STATISTICS* pStatistics);
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_ResetReuse(const DEPTHOFFIELDFX_CPU_DESC& desc);
+/**
+Mode selection under a time budget, see DEPTHOFFIELDFX_MODE_SELECTOR in the D3D11 version. Time the
+render calls on the CPU, or use the DepthOfFieldFX_GetPassTimings total. The traffic is the one of the
+frame rather than of the layout: the blur radius and defocus bounds of the statistics with
+m_useCocStatistics, the caller bounds with DEPTHOFFIELDFX_CPU_DEFOCUS_MODE_CALLER, only the quarter
+resolution mode with m_quarterResOnly. Needs DepthOfFieldFX_Resize.
+*/
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_SelectMode(const DEPTHOFFIELDFX_CPU_DESC& desc, DEPTHOFFIELDFX_MODE_SELECTOR& selector, DEPTHOFFIELDFX_MODE* pMode);
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_CalibrateModeSelector(const DEPTHOFFIELDFX_CPU_DESC& desc, DEPTHOFFIELDFX_MODE_SELECTOR& selector, DEPTHOFFIELDFX_MODE mode, float milliseconds);
+/**
+Per descriptor contexts, see the D3D11 version. A CPU context also owns its pool of worker threads,
+so contexts can render from different threads at the same time. Like there a desc destroys the
+context it owns with it and cannot be copied.
+*/
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_CreateContext(DEPTHOFFIELDFX_CPU_DESC& desc);
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_DestroyContext(DEPTHOFFIELDFX_CPU_DESC& desc);
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_Initialize(const DEPTHOFFIELDFX_CPU_DESC& desc);
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_Resize(const DEPTHOFFIELDFX_CPU_DESC& desc);
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_Render(const DEPTHOFFIELDFX_CPU_DESC& desc);
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_RenderQuarterRes(const DEPTHOFFIELDFX_CPU_DESC& desc);
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_RenderBox(const DEPTHOFFIELDFX_CPU_DESC& desc);
+/**
+Renders the Bartlett blur of DepthOfFieldFX_Render for blur radii beyond the padding of the intermediate
+buffer, up to DEPTHOFFIELDFX_CPU_PYRAMID_MAX_BLUR_RADIUS. Needs m_pyramid at DepthOfFieldFX_Resize.
+A pixel with a blur radius of at most DEPTHOFFIELDFX_CPU_PYRAMID_LEVEL_RADIUS is scattered at full
+resolution, the others go to the first level of a pyramid at 1 / 2^level of the resolution their radius
+scaled down by 2^level fits in. Every level pixel scatters the average color and radius of the pixels of
+its 2^level square that belong to the level, weighted by the fraction of the square they cover. Each
+level is scattered and integrated with the padding of DEPTHOFFIELDFX_CPU_PYRAMID_LEVEL_RADIUS, coarsest
+first, and adds the bilinear upsample of the unnormalized sums of the level below before the full
+resolution result is normalized. The cost is about the one of DepthOfFieldFX_Render at a radius of
+DEPTHOFFIELDFX_CPU_PYRAMID_LEVEL_RADIUS for any m_maxBlurRadius, and up to that radius the result is
+the one of DepthOfFieldFX_Render. The levels are rendered over the whole frame with 32 bit lanes in
+tiles under m_memoryBudget, the defocus modes, the statistics, m_reuseUnchangedTiles and 16 bit lanes
+only apply to the other render calls.
+*/
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_RenderPyramid(const DEPTHOFFIELDFX_CPU_DESC& desc);
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_Release(const DEPTHOFFIELDFX_CPU_DESC& desc);
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_Trim(const DEPTHOFFIELDFX_CPU_DESC& desc);
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_GetPassTimings(const DEPTHOFFIELDFX_CPU_DESC& desc, DEPTHOFFIELDFX_CPU_PASS_TIMINGS* pTimings);
+}
+
+#endif  // AMD_DEPTHOFFIELDFX_CPU_H
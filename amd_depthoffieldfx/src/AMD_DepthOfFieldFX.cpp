@@ -29,15 +29,36 @@
 #include <d3d11.h>
 
 #include "AMD_DepthOfFieldFX.h"
+#include "AMD_DepthOfFieldFX_ModeSelector.h"
 #include "AMD_DepthOfFieldFX_Opaque.h"
+#include "AMD_DepthOfFieldFX_ScaleFactor.h"
 
 #pragma warning(disable : 4100)  // disable unreference formal parameter warnings for /W4 builds
 
 namespace AMD {
-AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_DESC::DEPTHOFFIELDFX_DESC() : m_pDevice(nullptr), m_pDeviceContext(nullptr), m_pCircleOfConfusionSRV(nullptr)
+static DEPTHOFFIELDFX_OPAQUE_DESC* GetDefaultContext(const DEPTHOFFIELDFX_DESC& desc)
 {
-    static DEPTHOFFIELDFX_OPAQUE_DESC opaque(*this);
-    m_pOpaque = &opaque;
+    static DEPTHOFFIELDFX_OPAQUE_DESC opaque(desc);
+    return &opaque;
+}
+
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_DESC::DEPTHOFFIELDFX_DESC() : m_pDevice(nullptr), m_pDeviceContext(nullptr), m_pCircleOfConfusionSRV(nullptr), m_trimResizeCount(0)
+{
+    m_pOpaque = GetDefaultContext(*this);
+}
+
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_DESC::~DEPTHOFFIELDFX_DESC()
+{
+    if (m_pOpaque != GetDefaultContext(*this))
+    {
+        DepthOfFieldFX_DestroyContext(*this);
+    }
+}
+
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_VIEW::DEPTHOFFIELDFX_VIEW() : m_pCircleOfConfusionSRV(nullptr), m_pColorSRV(nullptr), m_pResultUAV(nullptr)
+{
+    m_screenSize.x = 0;
+    m_screenSize.y = 0;
 }
 
 AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_GetVersion(uint* major, uint* minor, uint* patch)
@@ -48,6 +69,99 @@ AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_GetVersion(
     return DEPTHOFFIELDFX_RETURN_CODE_SUCCESS;
 }
 
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_GetMemoryRequirements(const DEPTHOFFIELDFX_DESC& desc, DEPTHOFFIELDFX_MEMORY_REQUIREMENTS* pInfo)
+{
+    DEPTHOFFIELDFX_RETURN_CODE result = DEPTHOFFIELDFX_RETURN_CODE_SUCCESS;
+    if ((pInfo == nullptr)
+        || (desc.m_screenSize.x > 16384)
+        || (desc.m_screenSize.y > 16384)
+        || (desc.m_maxBlurRadius > 64))
+    {
+        result = DEPTHOFFIELDFX_RETURN_CODE_INVALID_PARAMS;
+    }
+    else
+    {
+        DEPTHOFFIELDFX_OPAQUE_DESC::get_memory_requirements(desc, *pInfo);
+    }
+    return result;
+}
+
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_GetScaleFactorInfo(const DEPTHOFFIELDFX_DESC& desc, DEPTHOFFIELDFX_MODE mode, float peakColor, DEPTHOFFIELDFX_SCALE_FACTOR_INFO* pInfo)
+{
+    DEPTHOFFIELDFX_RETURN_CODE result = DEPTHOFFIELDFX_RETURN_CODE_SUCCESS;
+    if ((pInfo == nullptr)
+        || (mode >= DEPTHOFFIELDFX_MODE_COUNT)
+        || (desc.m_maxBlurRadius > 64))
+    {
+        result = DEPTHOFFIELDFX_RETURN_CODE_INVALID_PARAMS;
+    }
+    else
+    {
+        // RenderQuarterRes scatters at full resolution, its bound is the one of Render
+        GetScaleFactorInfo(desc.m_scaleFactor, desc.m_maxBlurRadius, (mode == DEPTHOFFIELDFX_MODE_RENDER_BOX) ? DEPTHOFFIELDFX_KERNEL_TYPE_BOX : DEPTHOFFIELDFX_KERNEL_TYPE_BARTLETT, false, peakColor, 32, *pInfo);
+    }
+    return result;
+}
+
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_SelectMode(const DEPTHOFFIELDFX_DESC& desc, DEPTHOFFIELDFX_MODE_SELECTOR& selector, DEPTHOFFIELDFX_MODE* pMode)
+{
+    DEPTHOFFIELDFX_MEMORY_REQUIREMENTS info;
+    if ((pMode == nullptr) || (selector.m_mode >= DEPTHOFFIELDFX_MODE_COUNT) || (DepthOfFieldFX_GetMemoryRequirements(desc, &info) != DEPTHOFFIELDFX_RETURN_CODE_SUCCESS))
+    {
+        return DEPTHOFFIELDFX_RETURN_CODE_INVALID_PARAMS;
+    }
+
+    uint64 work[DEPTHOFFIELDFX_MODE_COUNT];
+    GetModeWork(info, selector.m_texelBytes, work);
+    *pMode = SelectMode(selector, work);
+    return DEPTHOFFIELDFX_RETURN_CODE_SUCCESS;
+}
+
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_CalibrateModeSelector(const DEPTHOFFIELDFX_DESC& desc, DEPTHOFFIELDFX_MODE_SELECTOR& selector, DEPTHOFFIELDFX_MODE mode, float milliseconds)
+{
+    DEPTHOFFIELDFX_MEMORY_REQUIREMENTS info;
+    if ((mode >= DEPTHOFFIELDFX_MODE_COUNT) || !(milliseconds >= 0.0f) || (DepthOfFieldFX_GetMemoryRequirements(desc, &info) != DEPTHOFFIELDFX_RETURN_CODE_SUCCESS))
+    {
+        return DEPTHOFFIELDFX_RETURN_CODE_INVALID_PARAMS;
+    }
+
+    uint64 work[DEPTHOFFIELDFX_MODE_COUNT];
+    GetModeWork(info, selector.m_texelBytes, work);
+    if (work[mode] == 0)
+    {
+        return DEPTHOFFIELDFX_RETURN_CODE_INVALID_PARAMS;
+    }
+
+    CalibrateModeSelector(selector, mode, work[mode], milliseconds);
+    return DEPTHOFFIELDFX_RETURN_CODE_SUCCESS;
+}
+
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_CreateContext(DEPTHOFFIELDFX_DESC& desc)
+{
+    if (desc.m_pOpaque != GetDefaultContext(desc))
+    {
+        return DEPTHOFFIELDFX_RETURN_CODE_INVALID_PARAMS;
+    }
+
+    desc.m_pOpaque = new DEPTHOFFIELDFX_OPAQUE_DESC(desc);
+
+    return DEPTHOFFIELDFX_RETURN_CODE_SUCCESS;
+}
+
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_DestroyContext(DEPTHOFFIELDFX_DESC& desc)
+{
+    if (desc.m_pOpaque == GetDefaultContext(desc))
+    {
+        return DEPTHOFFIELDFX_RETURN_CODE_INVALID_PARAMS;
+    }
+
+    desc.m_pOpaque->release();
+    delete desc.m_pOpaque;
+    desc.m_pOpaque = GetDefaultContext(desc);
+
+    return DEPTHOFFIELDFX_RETURN_CODE_SUCCESS;
+}
+
 AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_Initialize(const DEPTHOFFIELDFX_DESC& desc)
 {
     if (nullptr == desc.m_pDevice)
@@ -59,9 +173,7 @@ AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_Initialize(
         return DEPTHOFFIELDFX_RETURN_CODE_INVALID_DEVICE_CONTEXT;
     }
 
-    desc.m_pOpaque->initalize(desc);
-
-    return DEPTHOFFIELDFX_RETURN_CODE_SUCCESS;
+    return desc.m_pOpaque->initalize(desc);
 }
 
 AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_Resize(const DEPTHOFFIELDFX_DESC& desc)
@@ -103,4 +215,44 @@ AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_Release(con
     DEPTHOFFIELDFX_RETURN_CODE result = desc.m_pOpaque->release();
     return result;
 }
+
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_Trim(const DEPTHOFFIELDFX_DESC& desc)
+{
+    if (nullptr == desc.m_pDevice)
+    {
+        return DEPTHOFFIELDFX_RETURN_CODE_INVALID_DEVICE;
+    }
+
+    DEPTHOFFIELDFX_RETURN_CODE result = desc.m_pOpaque->trim(desc);
+    return result;
+}
+
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_ResizeViews(const DEPTHOFFIELDFX_DESC& desc, const DEPTHOFFIELDFX_VIEW* pViews, uint viewCount)
+{
+    if ((pViews == nullptr) || (viewCount == 0) || (desc.m_maxBlurRadius > 64))
+    {
+        return DEPTHOFFIELDFX_RETURN_CODE_INVALID_PARAMS;
+    }
+    for (uint i = 0; i < viewCount; ++i)
+    {
+        if ((pViews[i].m_screenSize.x > 16384) || (pViews[i].m_screenSize.y > 16384))
+        {
+            return DEPTHOFFIELDFX_RETURN_CODE_INVALID_PARAMS;
+        }
+    }
+
+    DEPTHOFFIELDFX_RETURN_CODE result = desc.m_pOpaque->resize_views(desc, pViews, viewCount);
+    return result;
+}
+
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_RenderViews(const DEPTHOFFIELDFX_DESC& desc, DEPTHOFFIELDFX_MODE mode, const DEPTHOFFIELDFX_VIEW* pViews, uint viewCount)
+{
+    if ((pViews == nullptr) || (viewCount == 0) || (mode >= DEPTHOFFIELDFX_MODE_COUNT))
+    {
+        return DEPTHOFFIELDFX_RETURN_CODE_INVALID_PARAMS;
+    }
+
+    DEPTHOFFIELDFX_RETURN_CODE result = desc.m_pOpaque->render_views(desc, mode, pViews, viewCount);
+    return result;
+}
 }
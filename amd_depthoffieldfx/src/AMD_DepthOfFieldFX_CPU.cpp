@@ -0,0 +1,325 @@
+//
+// Copyright (c) 2017 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+// if the library is being compiled with "DYNAMIC_LIB" option
+// it should do dclspec(dllexport)
+#if AMD_DEPTHOFFIELDFX_COMPILE_DYNAMIC_LIB
+#define AMD_DLL_EXPORT
+#endif
+
+#include <string.h>
+
+#include "AMD_DepthOfFieldFX_CPU.h"
+#include "AMD_DepthOfFieldFX_CPU_Opaque.h"
+#include "AMD_DepthOfFieldFX_ModeSelector.h"
+
+#pragma warning(disable : 4100)  // disable unreference formal parameter warnings for /W4 builds
+
+namespace AMD {
+static DEPTHOFFIELDFX_CPU_OPAQUE_DESC* GetDefaultContext(const DEPTHOFFIELDFX_CPU_DESC& desc)
+{
+    static DEPTHOFFIELDFX_CPU_OPAQUE_DESC opaque(desc);
+    return &opaque;
+}
+
+// the largest blur radius the buffers of desc can be sized for
+static uint MaxBlurRadiusLimit(const DEPTHOFFIELDFX_CPU_DESC& desc) { return desc.m_pyramid ? DEPTHOFFIELDFX_CPU_PYRAMID_MAX_BLUR_RADIUS : 64; }
+
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_CPU_DESC::DEPTHOFFIELDFX_CPU_DESC()
+    : m_scaleFactor(0)
+    , m_maxBlurRadius(0)
+    , m_numThreads(0)
+    , m_trimResizeCount(0)
+    , m_convertToSRGB(true)
+    , m_quarterResOnly(false)
+    , m_autoScaleFactor(false)
+    , m_useCocStatistics(false)
+    , m_reuseUnchangedTiles(false)
+    , m_pyramid(false)
+    , m_layered(false)
+    , m_memoryBudget(0)
+    , m_instructionSet(DEPTHOFFIELDFX_CPU_INSTRUCTION_SET_AUTO)
+    , m_transposeMode(DEPTHOFFIELDFX_CPU_TRANSPOSE_MODE_IN_PLACE)
+    , m_scatterMode(DEPTHOFFIELDFX_CPU_SCATTER_MODE_PRIVATE_PLANES)
+    , m_intermediateFormat(DEPTHOFFIELDFX_CPU_INTERMEDIATE_FORMAT_INT32)
+    , m_defocusMode(DEPTHOFFIELDFX_CPU_DEFOCUS_MODE_FULL_FRAME)
+    , m_kernel(DEPTHOFFIELDFX_CPU_KERNEL_BARTLETT)
+    , m_bokehOrientation(DEPTHOFFIELDFX_CPU_BOKEH_ORIENTATION_VERTICAL)
+    , m_anamorphicSqueeze(1.0f)
+{
+    m_screenSize.x = 0;
+    m_screenSize.y = 0;
+    memset(&m_defocusBounds, 0, sizeof(m_defocusBounds));
+    memset(&m_circleOfConfusion, 0, sizeof(m_circleOfConfusion));
+    memset(&m_color, 0, sizeof(m_color));
+    memset(&m_result, 0, sizeof(m_result));
+    memset(&m_depth, 0, sizeof(m_depth));
+    memset(&m_lens, 0, sizeof(m_lens));
+
+    m_pOpaque = GetDefaultContext(*this);
+}
+
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_CPU_DESC::~DEPTHOFFIELDFX_CPU_DESC()
+{
+    if (m_pOpaque != GetDefaultContext(*this))
+    {
+        DepthOfFieldFX_DestroyContext(*this);
+    }
+}
+
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_GetMemoryRequirements(const DEPTHOFFIELDFX_CPU_DESC& desc, DEPTHOFFIELDFX_MEMORY_REQUIREMENTS* pInfo)
+{
+    DEPTHOFFIELDFX_RETURN_CODE result = DEPTHOFFIELDFX_RETURN_CODE_SUCCESS;
+    if ((pInfo == nullptr)
+        || (desc.m_screenSize.x > 16384)
+        || (desc.m_screenSize.y > 16384)
+        || (desc.m_maxBlurRadius > MaxBlurRadiusLimit(desc)))
+    {
+        result = DEPTHOFFIELDFX_RETURN_CODE_INVALID_PARAMS;
+    }
+    else
+    {
+        DEPTHOFFIELDFX_CPU_OPAQUE_DESC::get_memory_requirements(desc, *pInfo);
+    }
+    return result;
+}
+
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_GetScaleFactorInfo(const DEPTHOFFIELDFX_CPU_DESC& desc, DEPTHOFFIELDFX_MODE mode, float peakColor, DEPTHOFFIELDFX_SCALE_FACTOR_INFO* pInfo)
+{
+    static const DEPTHOFFIELDFX_CPU_OPAQUE_DESC::SETUP_MODE s_setupModes[DEPTHOFFIELDFX_MODE_COUNT] = {
+        DEPTHOFFIELDFX_CPU_OPAQUE_DESC::SETUP_MODE_BARTLETT, DEPTHOFFIELDFX_CPU_OPAQUE_DESC::SETUP_MODE_BARTLETT_QUARTER_RES, DEPTHOFFIELDFX_CPU_OPAQUE_DESC::SETUP_MODE_BOX,
+    };
+
+    DEPTHOFFIELDFX_RETURN_CODE result = DEPTHOFFIELDFX_RETURN_CODE_SUCCESS;
+    if ((pInfo == nullptr)
+        || (mode >= DEPTHOFFIELDFX_MODE_COUNT)
+        || (desc.m_maxBlurRadius > 64))
+    {
+        result = DEPTHOFFIELDFX_RETURN_CODE_INVALID_PARAMS;
+    }
+    else
+    {
+        const uint laneBits = (desc.m_intermediateFormat == DEPTHOFFIELDFX_CPU_INTERMEDIATE_FORMAT_INT16) ? 16 : 32;
+        DEPTHOFFIELDFX_CPU_OPAQUE_DESC::get_scale_factor_info(desc, s_setupModes[mode], peakColor, laneBits, *pInfo);
+    }
+    return result;
+}
+
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_MeasurePeakColor(const DEPTHOFFIELDFX_CPU_DESC& desc, float* pPeakColor)
+{
+    if (pPeakColor == nullptr)
+    {
+        return DEPTHOFFIELDFX_RETURN_CODE_INVALID_PARAMS;
+    }
+    if ((desc.m_color.m_pData == nullptr) || ((desc.m_color.m_format != DEPTHOFFIELDFX_CPU_FORMAT_R32G32B32A32_FLOAT) && (desc.m_color.m_format != DEPTHOFFIELDFX_CPU_FORMAT_R16G16B16A16_FLOAT)))
+    {
+        return DEPTHOFFIELDFX_RETURN_CODE_INVALID_SURFACE;
+    }
+
+    *pPeakColor = desc.m_pOpaque->measure_peak_color(desc);
+    return DEPTHOFFIELDFX_RETURN_CODE_SUCCESS;
+}
+
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_ComputeCoc(const DEPTHOFFIELDFX_CPU_DESC& desc)
+{
+    DEPTHOFFIELDFX_RETURN_CODE result = desc.m_pOpaque->compute_coc(desc);
+    return result;
+}
+
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_ComputeCocStatistics(const DEPTHOFFIELDFX_CPU_DESC& desc)
+{
+    DEPTHOFFIELDFX_RETURN_CODE result = desc.m_pOpaque->compute_coc_statistics(desc);
+    return result;
+}
+
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_GetCocStatistics(const DEPTHOFFIELDFX_CPU_DESC& desc, DEPTHOFFIELDFX_CPU_COC_STATISTICS* pStatistics, uint8* pTileClasses)
+{
+    if ((pStatistics == nullptr) || desc.m_pOpaque->m_cocTileClasses.empty())
+    {
+        return DEPTHOFFIELDFX_RETURN_CODE_INVALID_PARAMS;
+    }
+
+    *pStatistics = desc.m_pOpaque->m_cocStatistics;
+    if (pTileClasses != nullptr)
+    {
+        memcpy(pTileClasses, &desc.m_pOpaque->m_cocTileClasses[0], desc.m_pOpaque->m_cocTileClasses.size());
+    }
+    return DEPTHOFFIELDFX_RETURN_CODE_SUCCESS;
+}
+
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_GetReuseStatistics(const DEPTHOFFIELDFX_CPU_DESC& desc, DEPTHOFFIELDFX_CPU_REUSE_STATISTICS* pStatistics)
+{
+    if (pStatistics == nullptr)
+    {
+        return DEPTHOFFIELDFX_RETURN_CODE_INVALID_PARAMS;
+    }
+
+    *pStatistics = desc.m_pOpaque->m_reuseStatistics;
+    return DEPTHOFFIELDFX_RETURN_CODE_SUCCESS;
+}
+
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_ResetReuse(const DEPTHOFFIELDFX_CPU_DESC& desc)
+{
+    desc.m_pOpaque->reset_reuse();
+    return DEPTHOFFIELDFX_RETURN_CODE_SUCCESS;
+}
+
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_SelectMode(const DEPTHOFFIELDFX_CPU_DESC& desc, DEPTHOFFIELDFX_MODE_SELECTOR& selector, DEPTHOFFIELDFX_MODE* pMode)
+{
+    if ((pMode == nullptr) || (selector.m_mode >= DEPTHOFFIELDFX_MODE_COUNT))
+    {
+        return DEPTHOFFIELDFX_RETURN_CODE_INVALID_PARAMS;
+    }
+
+    DEPTHOFFIELDFX_MEMORY_REQUIREMENTS info;
+    DEPTHOFFIELDFX_RETURN_CODE         result = desc.m_pOpaque->get_frame_traffic(desc, info);
+    if (result != DEPTHOFFIELDFX_RETURN_CODE_SUCCESS)
+    {
+        return result;
+    }
+
+    uint64 work[DEPTHOFFIELDFX_MODE_COUNT];
+    GetModeWork(info, selector.m_texelBytes, work);
+    *pMode = SelectMode(selector, work);
+    return DEPTHOFFIELDFX_RETURN_CODE_SUCCESS;
+}
+
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_CalibrateModeSelector(const DEPTHOFFIELDFX_CPU_DESC& desc, DEPTHOFFIELDFX_MODE_SELECTOR& selector, DEPTHOFFIELDFX_MODE mode, float milliseconds)
+{
+    if ((mode >= DEPTHOFFIELDFX_MODE_COUNT) || !(milliseconds >= 0.0f))
+    {
+        return DEPTHOFFIELDFX_RETURN_CODE_INVALID_PARAMS;
+    }
+
+    DEPTHOFFIELDFX_MEMORY_REQUIREMENTS info;
+    DEPTHOFFIELDFX_RETURN_CODE         result = desc.m_pOpaque->get_frame_traffic(desc, info);
+    if (result != DEPTHOFFIELDFX_RETURN_CODE_SUCCESS)
+    {
+        return result;
+    }
+
+    uint64 work[DEPTHOFFIELDFX_MODE_COUNT];
+    GetModeWork(info, selector.m_texelBytes, work);
+    if (work[mode] == 0)
+    {
+        return DEPTHOFFIELDFX_RETURN_CODE_INVALID_PARAMS;
+    }
+
+    CalibrateModeSelector(selector, mode, work[mode], milliseconds);
+    return DEPTHOFFIELDFX_RETURN_CODE_SUCCESS;
+}
+
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_CreateContext(DEPTHOFFIELDFX_CPU_DESC& desc)
+{
+    if (desc.m_pOpaque != GetDefaultContext(desc))
+    {
+        return DEPTHOFFIELDFX_RETURN_CODE_INVALID_PARAMS;
+    }
+
+    desc.m_pOpaque = new DEPTHOFFIELDFX_CPU_OPAQUE_DESC(desc);
+
+    return DEPTHOFFIELDFX_RETURN_CODE_SUCCESS;
+}
+
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_DestroyContext(DEPTHOFFIELDFX_CPU_DESC& desc)
+{
+    if (desc.m_pOpaque == GetDefaultContext(desc))
+    {
+        return DEPTHOFFIELDFX_RETURN_CODE_INVALID_PARAMS;
+    }
+
+    desc.m_pOpaque->release();
+    delete desc.m_pOpaque;
+    desc.m_pOpaque = GetDefaultContext(desc);
+
+    return DEPTHOFFIELDFX_RETURN_CODE_SUCCESS;
+}
+
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_Initialize(const DEPTHOFFIELDFX_CPU_DESC& desc)
+{
+    return desc.m_pOpaque->initalize(desc);
+}
+
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_Resize(const DEPTHOFFIELDFX_CPU_DESC& desc)
+{
+    DEPTHOFFIELDFX_RETURN_CODE result = DEPTHOFFIELDFX_RETURN_CODE_SUCCESS;
+    if ((desc.m_screenSize.x > 16384)
+        || (desc.m_screenSize.y > 16384)
+        || (desc.m_maxBlurRadius > MaxBlurRadiusLimit(desc)))
+    {
+        result = DEPTHOFFIELDFX_RETURN_CODE_INVALID_PARAMS;
+    }
+    else
+    {
+        result = desc.m_pOpaque->resize(desc);
+    }
+    return result;
+}
+
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_Render(const DEPTHOFFIELDFX_CPU_DESC& desc)
+{
+    DEPTHOFFIELDFX_RETURN_CODE result = desc.m_pOpaque->render(desc);
+    return result;
+}
+
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_RenderQuarterRes(const DEPTHOFFIELDFX_CPU_DESC& desc)
+{
+    DEPTHOFFIELDFX_RETURN_CODE result = desc.m_pOpaque->render_quarter_res(desc);
+    return result;
+}
+
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_RenderBox(const DEPTHOFFIELDFX_CPU_DESC& desc)
+{
+    DEPTHOFFIELDFX_RETURN_CODE result = desc.m_pOpaque->render_box(desc);
+    return result;
+}
+
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_RenderPyramid(const DEPTHOFFIELDFX_CPU_DESC& desc)
+{
+    DEPTHOFFIELDFX_RETURN_CODE result = desc.m_pOpaque->render_pyramid(desc);
+    return result;
+}
+
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_Release(const DEPTHOFFIELDFX_CPU_DESC& desc)
+{
+    DEPTHOFFIELDFX_RETURN_CODE result = desc.m_pOpaque->release();
+    return result;
+}
+
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_Trim(const DEPTHOFFIELDFX_CPU_DESC& desc)
+{
+    DEPTHOFFIELDFX_RETURN_CODE result = desc.m_pOpaque->trim();
+    return result;
+}
+
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_RETURN_CODE DepthOfFieldFX_GetPassTimings(const DEPTHOFFIELDFX_CPU_DESC& desc, DEPTHOFFIELDFX_CPU_PASS_TIMINGS* pTimings)
+{
+    if (pTimings == nullptr)
+    {
+        return DEPTHOFFIELDFX_RETURN_CODE_INVALID_PARAMS;
+    }
+
+    memcpy(pTimings->m_milliseconds, desc.m_pOpaque->m_passMilliseconds, sizeof(pTimings->m_milliseconds));
+    return DEPTHOFFIELDFX_RETURN_CODE_SUCCESS;
+}
+}
@@ -0,0 +1,535 @@
+//
+// Copyright (c) 2017 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include <string.h>
+
+#include "AMD_DepthOfFieldFX_CPU_Coc.h"
+#include "AMD_DepthOfFieldFX_CPU_Integrate.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define AMD_DEPTHOFFIELDFX_CPU_X86 1
+#include <immintrin.h>
+#elif defined(_M_ARM64) || defined(__aarch64__)
+// the vector divide and half conversions are AArch64 only, 32 bit NEON runs the scalar kernel
+#define AMD_DEPTHOFFIELDFX_CPU_NEON 1
+#include <arm_neon.h>
+#endif
+
+// MSVC allows any intrinsic in any function, gcc and clang need the target enabled per function
+#if defined(AMD_DEPTHOFFIELDFX_CPU_X86) && !defined(_MSC_VER)
+#define AMD_DEPTHOFFIELDFX_TARGET_SSE2 __attribute__((target("sse2")))
+#define AMD_DEPTHOFFIELDFX_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define AMD_DEPTHOFFIELDFX_TARGET_SSE2
+#define AMD_DEPTHOFFIELDFX_TARGET_AVX2
+#endif
+
+#pragma warning(disable : 4127)  // disable conditional expression is constant warnings
+
+namespace AMD {
+// D24_UNORM_S8_UINT keeps the depth in the low 24 bits
+static const uint  s_d24DepthMask  = 0xffffffu;
+static const float s_d24DepthScale = 1.0f / 16777215.0f;
+
+// Half conversion constants, the bit patterns of the floats they are named after.
+// A half exponent shifted into a float is rebiased by s_halfExponentBias. Denormal halves are
+// renormalized by subtracting 2^-14, float denormals are rounded by adding 0.5, both in float math.
+static const uint s_halfExponentMask = 0x0f800000u;  // 0x7c00 << 13
+static const uint s_halfExponentBias = 0x38000000u;  // (127 - 15) << 23
+static const uint s_floatExponentOne = 0x00800000u;
+static const uint s_halfSmallest     = 0x38800000u;  // 2^-14, the smallest normal half
+static const uint s_halfOverflow     = 0x47800000u;  // 2^16, rounds to infinity
+static const uint s_floatInfinity    = 0x7f800000u;
+static const uint s_denormalMagic    = 0x3f000000u;  // 0.5, its ulp is the smallest denormal half
+static const uint s_normalRebias     = 0xc8000fffu;  // (15 - 127) << 23 plus the rounding bias
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Scalar reference, the vector kernels convert halves with the same steps
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static float AsFloat(uint bits)
+{
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static uint AsUint(float value)
+{
+    uint bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static float HalfToFloat(uint16 half)
+{
+    uint       bits     = (half & 0x7fffu) << 13;
+    const uint exponent = bits & s_halfExponentMask;
+
+    bits += s_halfExponentBias;
+    if (exponent == s_halfExponentMask)
+    {
+        // inf or nan
+        bits += s_halfExponentBias;
+    }
+    else if (exponent == 0)
+    {
+        bits = AsUint(AsFloat(bits + s_floatExponentOne) - AsFloat(s_halfSmallest));
+    }
+    return AsFloat(bits | ((half & 0x8000u) << 16));
+}
+
+// rounds to nearest even like the hardware conversions
+static uint16 FloatToHalf(float value)
+{
+    const uint sign = AsUint(value) & 0x80000000u;
+    const uint bits = AsUint(value) ^ sign;
+
+    uint half;
+    if (bits >= s_halfOverflow)
+    {
+        half = (bits > s_floatInfinity) ? 0x7e00u : 0x7c00u;
+    }
+    else if (bits < s_halfSmallest)
+    {
+        half = AsUint(AsFloat(bits) + AsFloat(s_denormalMagic)) - s_denormalMagic;
+    }
+    else
+    {
+        half = (bits + s_normalRebias + ((bits >> 13) & 1u)) >> 13;
+    }
+    return static_cast<uint16>(half | (sign >> 16));
+}
+
+template <DEPTHOFFIELDFX_CPU_FORMAT FORMAT> static float LoadDepth(const void* pDepth, uint i)
+{
+    if (FORMAT == DEPTHOFFIELDFX_CPU_FORMAT_R16_FLOAT)
+    {
+        return HalfToFloat(static_cast<const uint16*>(pDepth)[i]);
+    }
+    if (FORMAT == DEPTHOFFIELDFX_CPU_FORMAT_D24_UNORM_S8_UINT)
+    {
+        return static_cast<float>(static_cast<const uint*>(pDepth)[i] & s_d24DepthMask) * s_d24DepthScale;
+    }
+    return static_cast<const float*>(pDepth)[i];
+}
+
+template <DEPTHOFFIELDFX_CPU_FORMAT FORMAT> static void StoreCoc(void* pCoc, uint i, float coc)
+{
+    if (FORMAT == DEPTHOFFIELDFX_CPU_FORMAT_R16_FLOAT)
+    {
+        static_cast<uint16*>(pCoc)[i] = FloatToHalf(coc);
+    }
+    else
+    {
+        static_cast<float*>(pCoc)[i] = coc;
+    }
+}
+
+// converts the texels from first on, the vector kernels finish their rows with it
+template <DEPTHOFFIELDFX_CPU_FORMAT DEPTH_FORMAT, DEPTHOFFIELDFX_CPU_FORMAT COC_FORMAT>
+static void CocRowScalar(const DEPTHOFFIELDFX_COC_PARAMS& params, const void* pDepth, void* pCoc, uint first, uint count)
+{
+    const DEPTHOFFIELDFX_COC_PARAMS constants = params;
+    for (uint i = first; i < count; ++i)
+    {
+        StoreCoc<COC_FORMAT>(pCoc, i, CocFromDepth(constants, LoadDepth<DEPTH_FORMAT>(pDepth, i)));
+    }
+}
+
+struct COC_KERNELS_SCALAR
+{
+    template <DEPTHOFFIELDFX_CPU_FORMAT DEPTH_FORMAT, DEPTHOFFIELDFX_CPU_FORMAT COC_FORMAT>
+    static void Row(const DEPTHOFFIELDFX_COC_PARAMS& params, const void* pDepth, void* pCoc, uint count)
+    {
+        CocRowScalar<DEPTH_FORMAT, COC_FORMAT>(params, pDepth, pCoc, 0, count);
+    }
+};
+
+#if AMD_DEPTHOFFIELDFX_CPU_X86
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// SSE2: four texels per register
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// the lens constants in registers, loaded once per row since the stores may alias params
+struct COC_CONSTANTS_SSE2
+{
+    __m128 cocScale;
+    __m128 focalLength;
+    __m128 focusDistance;
+    __m128 minCoc;
+    __m128 maxCoc;
+    __m128 nearPlane;
+    __m128 depthBias;
+    __m128 depthScale;
+};
+
+AMD_DEPTHOFFIELDFX_TARGET_SSE2 static COC_CONSTANTS_SSE2 LoadConstantsSSE2(const DEPTHOFFIELDFX_COC_PARAMS& params)
+{
+    const COC_CONSTANTS_SSE2 constants = {
+        _mm_set1_ps(params.cocScale), _mm_set1_ps(params.focalLength), _mm_set1_ps(params.focusDistance), _mm_set1_ps(params.minCoc),
+        _mm_set1_ps(params.maxCoc),   _mm_set1_ps(params.nearPlane),   _mm_set1_ps(params.depthBias),     _mm_set1_ps(params.depthScale),
+    };
+    return constants;
+}
+
+AMD_DEPTHOFFIELDFX_TARGET_SSE2 static __m128i SelectSSE2(__m128i mask, __m128i a, __m128i b) { return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b)); }
+
+// halves in the low 16 bits of every lane
+AMD_DEPTHOFFIELDFX_TARGET_SSE2 static __m128 HalfToFloatSSE2(__m128i half)
+{
+    const __m128i exponentMask = _mm_set1_epi32(static_cast<int>(s_halfExponentMask));
+    const __m128i exponentBias = _mm_set1_epi32(static_cast<int>(s_halfExponentBias));
+    const __m128i shifted      = _mm_slli_epi32(_mm_and_si128(half, _mm_set1_epi32(0x7fff)), 13);
+    const __m128i exponent     = _mm_and_si128(shifted, exponentMask);
+
+    __m128i bits = _mm_add_epi32(shifted, exponentBias);
+    bits         = _mm_add_epi32(bits, _mm_and_si128(_mm_cmpeq_epi32(exponent, exponentMask), exponentBias));
+
+    const __m128 renormalized = _mm_sub_ps(_mm_castsi128_ps(_mm_add_epi32(bits, _mm_set1_epi32(static_cast<int>(s_floatExponentOne)))), _mm_castsi128_ps(_mm_set1_epi32(static_cast<int>(s_halfSmallest))));
+    bits                      = SelectSSE2(_mm_cmpeq_epi32(exponent, _mm_setzero_si128()), _mm_castps_si128(renormalized), bits);
+    return _mm_castsi128_ps(_mm_or_si128(bits, _mm_slli_epi32(_mm_and_si128(half, _mm_set1_epi32(0x8000)), 16)));
+}
+
+// returns the halves in the low 16 bits of every lane
+AMD_DEPTHOFFIELDFX_TARGET_SSE2 static __m128i FloatToHalfSSE2(__m128 value)
+{
+    const __m128i sign = _mm_and_si128(_mm_castps_si128(value), _mm_set1_epi32(static_cast<int>(0x80000000u)));
+    const __m128i bits = _mm_xor_si128(_mm_castps_si128(value), sign);
+
+    // the sign is cleared, so signed compares order the bits like the floats
+    const __m128i overflow = _mm_cmpgt_epi32(bits, _mm_set1_epi32(static_cast<int>(s_halfOverflow - 1)));
+    const __m128i denormal = _mm_cmplt_epi32(bits, _mm_set1_epi32(static_cast<int>(s_halfSmallest)));
+    const __m128i infNan   = _mm_or_si128(_mm_set1_epi32(0x7c00), _mm_and_si128(_mm_cmpgt_epi32(bits, _mm_set1_epi32(static_cast<int>(s_floatInfinity))), _mm_set1_epi32(0x0200)));
+
+    const __m128i magic        = _mm_set1_epi32(static_cast<int>(s_denormalMagic));
+    const __m128i denormalHalf = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(_mm_castsi128_ps(bits), _mm_castsi128_ps(magic))), magic);
+    const __m128i odd          = _mm_and_si128(_mm_srli_epi32(bits, 13), _mm_set1_epi32(1));
+    const __m128i normalHalf   = _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(bits, _mm_set1_epi32(static_cast<int>(s_normalRebias))), odd), 13);
+
+    const __m128i half = SelectSSE2(overflow, infNan, SelectSSE2(denormal, denormalHalf, normalHalf));
+    return _mm_or_si128(half, _mm_srli_epi32(sign, 16));
+}
+
+template <DEPTHOFFIELDFX_CPU_FORMAT FORMAT> AMD_DEPTHOFFIELDFX_TARGET_SSE2 static __m128 LoadDepthSSE2(const void* pDepth, uint i)
+{
+    if (FORMAT == DEPTHOFFIELDFX_CPU_FORMAT_R16_FLOAT)
+    {
+        const __m128i halves = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(static_cast<const uint16*>(pDepth) + i));
+        return HalfToFloatSSE2(_mm_unpacklo_epi16(halves, _mm_setzero_si128()));
+    }
+    if (FORMAT == DEPTHOFFIELDFX_CPU_FORMAT_D24_UNORM_S8_UINT)
+    {
+        const __m128i texels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(static_cast<const uint*>(pDepth) + i));
+        return _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(texels, _mm_set1_epi32(static_cast<int>(s_d24DepthMask)))), _mm_set1_ps(s_d24DepthScale));
+    }
+    return _mm_loadu_ps(static_cast<const float*>(pDepth) + i);
+}
+
+template <DEPTHOFFIELDFX_CPU_FORMAT FORMAT> AMD_DEPTHOFFIELDFX_TARGET_SSE2 static void StoreCocSSE2(void* pCoc, uint i, __m128 coc)
+{
+    if (FORMAT == DEPTHOFFIELDFX_CPU_FORMAT_R16_FLOAT)
+    {
+        // sign extend the halves so the saturating pack keeps their bits
+        const __m128i half = _mm_srai_epi32(_mm_slli_epi32(FloatToHalfSSE2(coc), 16), 16);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(static_cast<uint16*>(pCoc) + i), _mm_packs_epi32(half, half));
+    }
+    else
+    {
+        _mm_storeu_ps(static_cast<float*>(pCoc) + i, coc);
+    }
+}
+
+// CocFromDepth, the divisions of texels behind the lens are masked out
+AMD_DEPTHOFFIELDFX_TARGET_SSE2 static __m128 CocFromDepthSSE2(const COC_CONSTANTS_SSE2& constants, __m128 depth)
+{
+    const __m128 sceneDepth      = _mm_div_ps(constants.nearPlane, _mm_add_ps(constants.depthBias, _mm_mul_ps(constants.depthScale, depth)));
+    const __m128 distanceToLense = _mm_sub_ps(sceneDepth, constants.focalLength);
+    const __m128 coc             = _mm_mul_ps(constants.cocScale, _mm_sub_ps(_mm_set1_ps(1.0f), _mm_div_ps(constants.focusDistance, distanceToLense)));
+    const __m128 inFront         = _mm_and_ps(_mm_cmpgt_ps(distanceToLense, _mm_setzero_ps()), coc);
+    return _mm_min_ps(_mm_max_ps(inFront, constants.minCoc), constants.maxCoc);
+}
+
+struct COC_KERNELS_SSE2
+{
+    template <DEPTHOFFIELDFX_CPU_FORMAT DEPTH_FORMAT, DEPTHOFFIELDFX_CPU_FORMAT COC_FORMAT>
+    AMD_DEPTHOFFIELDFX_TARGET_SSE2 static void Row(const DEPTHOFFIELDFX_COC_PARAMS& params, const void* pDepth, void* pCoc, uint count)
+    {
+        const COC_CONSTANTS_SSE2 constants = LoadConstantsSSE2(params);
+
+        uint i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            StoreCocSSE2<COC_FORMAT>(pCoc, i, CocFromDepthSSE2(constants, LoadDepthSSE2<DEPTH_FORMAT>(pDepth, i)));
+        }
+        CocRowScalar<DEPTH_FORMAT, COC_FORMAT>(params, pDepth, pCoc, i, count);
+    }
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// AVX2: eight texels per register
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct COC_CONSTANTS_AVX2
+{
+    __m256 cocScale;
+    __m256 focalLength;
+    __m256 focusDistance;
+    __m256 minCoc;
+    __m256 maxCoc;
+    __m256 nearPlane;
+    __m256 depthBias;
+    __m256 depthScale;
+};
+
+AMD_DEPTHOFFIELDFX_TARGET_AVX2 static COC_CONSTANTS_AVX2 LoadConstantsAVX2(const DEPTHOFFIELDFX_COC_PARAMS& params)
+{
+    const COC_CONSTANTS_AVX2 constants = {
+        _mm256_set1_ps(params.cocScale), _mm256_set1_ps(params.focalLength), _mm256_set1_ps(params.focusDistance), _mm256_set1_ps(params.minCoc),
+        _mm256_set1_ps(params.maxCoc),   _mm256_set1_ps(params.nearPlane),   _mm256_set1_ps(params.depthBias),     _mm256_set1_ps(params.depthScale),
+    };
+    return constants;
+}
+
+AMD_DEPTHOFFIELDFX_TARGET_AVX2 static __m256i SelectAVX2(__m256i mask, __m256i a, __m256i b) { return _mm256_blendv_epi8(b, a, mask); }
+
+AMD_DEPTHOFFIELDFX_TARGET_AVX2 static __m256 HalfToFloatAVX2(__m256i half)
+{
+    const __m256i exponentMask = _mm256_set1_epi32(static_cast<int>(s_halfExponentMask));
+    const __m256i exponentBias = _mm256_set1_epi32(static_cast<int>(s_halfExponentBias));
+    const __m256i shifted      = _mm256_slli_epi32(_mm256_and_si256(half, _mm256_set1_epi32(0x7fff)), 13);
+    const __m256i exponent     = _mm256_and_si256(shifted, exponentMask);
+
+    __m256i bits = _mm256_add_epi32(shifted, exponentBias);
+    bits         = _mm256_add_epi32(bits, _mm256_and_si256(_mm256_cmpeq_epi32(exponent, exponentMask), exponentBias));
+
+    const __m256 renormalized = _mm256_sub_ps(_mm256_castsi256_ps(_mm256_add_epi32(bits, _mm256_set1_epi32(static_cast<int>(s_floatExponentOne)))), _mm256_castsi256_ps(_mm256_set1_epi32(static_cast<int>(s_halfSmallest))));
+    bits                      = SelectAVX2(_mm256_cmpeq_epi32(exponent, _mm256_setzero_si256()), _mm256_castps_si256(renormalized), bits);
+    return _mm256_castsi256_ps(_mm256_or_si256(bits, _mm256_slli_epi32(_mm256_and_si256(half, _mm256_set1_epi32(0x8000)), 16)));
+}
+
+AMD_DEPTHOFFIELDFX_TARGET_AVX2 static __m256i FloatToHalfAVX2(__m256 value)
+{
+    const __m256i sign = _mm256_and_si256(_mm256_castps_si256(value), _mm256_set1_epi32(static_cast<int>(0x80000000u)));
+    const __m256i bits = _mm256_xor_si256(_mm256_castps_si256(value), sign);
+
+    const __m256i overflow = _mm256_cmpgt_epi32(bits, _mm256_set1_epi32(static_cast<int>(s_halfOverflow - 1)));
+    const __m256i denormal = _mm256_cmpgt_epi32(_mm256_set1_epi32(static_cast<int>(s_halfSmallest)), bits);
+    const __m256i infNan   = _mm256_or_si256(_mm256_set1_epi32(0x7c00), _mm256_and_si256(_mm256_cmpgt_epi32(bits, _mm256_set1_epi32(static_cast<int>(s_floatInfinity))), _mm256_set1_epi32(0x0200)));
+
+    const __m256i magic        = _mm256_set1_epi32(static_cast<int>(s_denormalMagic));
+    const __m256i denormalHalf = _mm256_sub_epi32(_mm256_castps_si256(_mm256_add_ps(_mm256_castsi256_ps(bits), _mm256_castsi256_ps(magic))), magic);
+    const __m256i odd          = _mm256_and_si256(_mm256_srli_epi32(bits, 13), _mm256_set1_epi32(1));
+    const __m256i normalHalf   = _mm256_srli_epi32(_mm256_add_epi32(_mm256_add_epi32(bits, _mm256_set1_epi32(static_cast<int>(s_normalRebias))), odd), 13);
+
+    const __m256i half = SelectAVX2(overflow, infNan, SelectAVX2(denormal, denormalHalf, normalHalf));
+    return _mm256_or_si256(half, _mm256_srli_epi32(sign, 16));
+}
+
+template <DEPTHOFFIELDFX_CPU_FORMAT FORMAT> AMD_DEPTHOFFIELDFX_TARGET_AVX2 static __m256 LoadDepthAVX2(const void* pDepth, uint i)
+{
+    if (FORMAT == DEPTHOFFIELDFX_CPU_FORMAT_R16_FLOAT)
+    {
+        const __m128i halves = _mm_loadu_si128(reinterpret_cast<const __m128i*>(static_cast<const uint16*>(pDepth) + i));
+        return HalfToFloatAVX2(_mm256_cvtepu16_epi32(halves));
+    }
+    if (FORMAT == DEPTHOFFIELDFX_CPU_FORMAT_D24_UNORM_S8_UINT)
+    {
+        const __m256i texels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(static_cast<const uint*>(pDepth) + i));
+        return _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(texels, _mm256_set1_epi32(static_cast<int>(s_d24DepthMask)))), _mm256_set1_ps(s_d24DepthScale));
+    }
+    return _mm256_loadu_ps(static_cast<const float*>(pDepth) + i);
+}
+
+template <DEPTHOFFIELDFX_CPU_FORMAT FORMAT> AMD_DEPTHOFFIELDFX_TARGET_AVX2 static void StoreCocAVX2(void* pCoc, uint i, __m256 coc)
+{
+    if (FORMAT == DEPTHOFFIELDFX_CPU_FORMAT_R16_FLOAT)
+    {
+        const __m256i half = FloatToHalfAVX2(coc);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(static_cast<uint16*>(pCoc) + i), _mm_packus_epi32(_mm256_castsi256_si128(half), _mm256_extracti128_si256(half, 1)));
+    }
+    else
+    {
+        _mm256_storeu_ps(static_cast<float*>(pCoc) + i, coc);
+    }
+}
+
+AMD_DEPTHOFFIELDFX_TARGET_AVX2 static __m256 CocFromDepthAVX2(const COC_CONSTANTS_AVX2& constants, __m256 depth)
+{
+    const __m256 sceneDepth      = _mm256_div_ps(constants.nearPlane, _mm256_add_ps(constants.depthBias, _mm256_mul_ps(constants.depthScale, depth)));
+    const __m256 distanceToLense = _mm256_sub_ps(sceneDepth, constants.focalLength);
+    const __m256 coc             = _mm256_mul_ps(constants.cocScale, _mm256_sub_ps(_mm256_set1_ps(1.0f), _mm256_div_ps(constants.focusDistance, distanceToLense)));
+    const __m256 inFront         = _mm256_and_ps(_mm256_cmp_ps(distanceToLense, _mm256_setzero_ps(), _CMP_GT_OQ), coc);
+    return _mm256_min_ps(_mm256_max_ps(inFront, constants.minCoc), constants.maxCoc);
+}
+
+struct COC_KERNELS_AVX2
+{
+    template <DEPTHOFFIELDFX_CPU_FORMAT DEPTH_FORMAT, DEPTHOFFIELDFX_CPU_FORMAT COC_FORMAT>
+    AMD_DEPTHOFFIELDFX_TARGET_AVX2 static void Row(const DEPTHOFFIELDFX_COC_PARAMS& params, const void* pDepth, void* pCoc, uint count)
+    {
+        const COC_CONSTANTS_AVX2 constants = LoadConstantsAVX2(params);
+
+        uint i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            StoreCocAVX2<COC_FORMAT>(pCoc, i, CocFromDepthAVX2(constants, LoadDepthAVX2<DEPTH_FORMAT>(pDepth, i)));
+        }
+        CocRowScalar<DEPTH_FORMAT, COC_FORMAT>(params, pDepth, pCoc, i, count);
+    }
+};
+#endif
+
+#if AMD_DEPTHOFFIELDFX_CPU_NEON
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// NEON: four texels per register, halves are converted in hardware
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct COC_CONSTANTS_NEON
+{
+    float32x4_t cocScale;
+    float32x4_t focalLength;
+    float32x4_t focusDistance;
+    float32x4_t minCoc;
+    float32x4_t maxCoc;
+    float32x4_t nearPlane;
+    float32x4_t depthBias;
+    float32x4_t depthScale;
+};
+
+static COC_CONSTANTS_NEON LoadConstantsNEON(const DEPTHOFFIELDFX_COC_PARAMS& params)
+{
+    const COC_CONSTANTS_NEON constants = {
+        vdupq_n_f32(params.cocScale), vdupq_n_f32(params.focalLength), vdupq_n_f32(params.focusDistance), vdupq_n_f32(params.minCoc),
+        vdupq_n_f32(params.maxCoc),   vdupq_n_f32(params.nearPlane),   vdupq_n_f32(params.depthBias),     vdupq_n_f32(params.depthScale),
+    };
+    return constants;
+}
+
+template <DEPTHOFFIELDFX_CPU_FORMAT FORMAT> static float32x4_t LoadDepthNEON(const void* pDepth, uint i)
+{
+    if (FORMAT == DEPTHOFFIELDFX_CPU_FORMAT_R16_FLOAT)
+    {
+        return vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(static_cast<const uint16*>(pDepth) + i)));
+    }
+    if (FORMAT == DEPTHOFFIELDFX_CPU_FORMAT_D24_UNORM_S8_UINT)
+    {
+        const uint32x4_t texels = vandq_u32(vld1q_u32(static_cast<const uint*>(pDepth) + i), vdupq_n_u32(s_d24DepthMask));
+        return vmulq_f32(vcvtq_f32_u32(texels), vdupq_n_f32(s_d24DepthScale));
+    }
+    return vld1q_f32(static_cast<const float*>(pDepth) + i);
+}
+
+template <DEPTHOFFIELDFX_CPU_FORMAT FORMAT> static void StoreCocNEON(void* pCoc, uint i, float32x4_t coc)
+{
+    if (FORMAT == DEPTHOFFIELDFX_CPU_FORMAT_R16_FLOAT)
+    {
+        vst1_u16(static_cast<uint16*>(pCoc) + i, vreinterpret_u16_f16(vcvt_f16_f32(coc)));
+    }
+    else
+    {
+        vst1q_f32(static_cast<float*>(pCoc) + i, coc);
+    }
+}
+
+static float32x4_t CocFromDepthNEON(const COC_CONSTANTS_NEON& constants, float32x4_t depth)
+{
+    const float32x4_t sceneDepth      = vdivq_f32(constants.nearPlane, vaddq_f32(constants.depthBias, vmulq_f32(constants.depthScale, depth)));
+    const float32x4_t distanceToLense = vsubq_f32(sceneDepth, constants.focalLength);
+    const float32x4_t coc             = vmulq_f32(constants.cocScale, vsubq_f32(vdupq_n_f32(1.0f), vdivq_f32(constants.focusDistance, distanceToLense)));
+    const float32x4_t inFront         = vreinterpretq_f32_u32(vandq_u32(vcgtq_f32(distanceToLense, vdupq_n_f32(0.0f)), vreinterpretq_u32_f32(coc)));
+    return vminq_f32(vmaxq_f32(inFront, constants.minCoc), constants.maxCoc);
+}
+
+struct COC_KERNELS_NEON
+{
+    template <DEPTHOFFIELDFX_CPU_FORMAT DEPTH_FORMAT, DEPTHOFFIELDFX_CPU_FORMAT COC_FORMAT>
+    static void Row(const DEPTHOFFIELDFX_COC_PARAMS& params, const void* pDepth, void* pCoc, uint count)
+    {
+        const COC_CONSTANTS_NEON constants = LoadConstantsNEON(params);
+
+        uint i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            StoreCocNEON<COC_FORMAT>(pCoc, i, CocFromDepthNEON(constants, LoadDepthNEON<DEPTH_FORMAT>(pDepth, i)));
+        }
+        CocRowScalar<DEPTH_FORMAT, COC_FORMAT>(params, pDepth, pCoc, i, count);
+    }
+};
+#endif
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Kernel selection
+///////////////////////////////////////////////////////////////////////////////////////////////////
+template <class KERNELS, DEPTHOFFIELDFX_CPU_FORMAT DEPTH_FORMAT> static DEPTHOFFIELDFX_CPU_COC_FN SelectCocFormat(DEPTHOFFIELDFX_CPU_FORMAT cocFormat)
+{
+    switch (cocFormat)
+    {
+    case DEPTHOFFIELDFX_CPU_FORMAT_R32_FLOAT:
+        return KERNELS::template Row<DEPTH_FORMAT, DEPTHOFFIELDFX_CPU_FORMAT_R32_FLOAT>;
+    case DEPTHOFFIELDFX_CPU_FORMAT_R16_FLOAT:
+        return KERNELS::template Row<DEPTH_FORMAT, DEPTHOFFIELDFX_CPU_FORMAT_R16_FLOAT>;
+    default:
+        return nullptr;
+    }
+}
+
+template <class KERNELS> static DEPTHOFFIELDFX_CPU_COC_FN SelectCocKernel(DEPTHOFFIELDFX_CPU_FORMAT depthFormat, DEPTHOFFIELDFX_CPU_FORMAT cocFormat)
+{
+    switch (depthFormat)
+    {
+    case DEPTHOFFIELDFX_CPU_FORMAT_R32_FLOAT:
+        return SelectCocFormat<KERNELS, DEPTHOFFIELDFX_CPU_FORMAT_R32_FLOAT>(cocFormat);
+    case DEPTHOFFIELDFX_CPU_FORMAT_R16_FLOAT:
+        return SelectCocFormat<KERNELS, DEPTHOFFIELDFX_CPU_FORMAT_R16_FLOAT>(cocFormat);
+    case DEPTHOFFIELDFX_CPU_FORMAT_D24_UNORM_S8_UINT:
+        return SelectCocFormat<KERNELS, DEPTHOFFIELDFX_CPU_FORMAT_D24_UNORM_S8_UINT>(cocFormat);
+    default:
+        return nullptr;
+    }
+}
+
+DEPTHOFFIELDFX_CPU_COC_FN GetCocKernel(DEPTHOFFIELDFX_CPU_INSTRUCTION_SET instructionSet, DEPTHOFFIELDFX_CPU_FORMAT depthFormat, DEPTHOFFIELDFX_CPU_FORMAT cocFormat)
+{
+    if (GetIntegrateKernel(instructionSet) == nullptr)
+    {
+        return nullptr;
+    }
+    if (instructionSet == DEPTHOFFIELDFX_CPU_INSTRUCTION_SET_AUTO)
+    {
+        instructionSet = DetectInstructionSet();
+    }
+
+    switch (instructionSet)
+    {
+#if AMD_DEPTHOFFIELDFX_CPU_X86
+    case DEPTHOFFIELDFX_CPU_INSTRUCTION_SET_SSE2:
+        return SelectCocKernel<COC_KERNELS_SSE2>(depthFormat, cocFormat);
+    case DEPTHOFFIELDFX_CPU_INSTRUCTION_SET_AVX2:
+        return SelectCocKernel<COC_KERNELS_AVX2>(depthFormat, cocFormat);
+#endif
+#if AMD_DEPTHOFFIELDFX_CPU_NEON
+    case DEPTHOFFIELDFX_CPU_INSTRUCTION_SET_NEON:
+        return SelectCocKernel<COC_KERNELS_NEON>(depthFormat, cocFormat);
+#endif
+    default:
+        return SelectCocKernel<COC_KERNELS_SCALAR>(depthFormat, cocFormat);
+    }
+}
+}
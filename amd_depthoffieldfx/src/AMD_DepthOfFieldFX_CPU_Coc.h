@@ -0,0 +1,44 @@
+//
+// Copyright (c) 2017 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#ifndef AMD_DEPTHOFFIELDFX_CPU_COC_H
+#define AMD_DEPTHOFFIELDFX_CPU_COC_H
+
+#include "AMD_DepthOfFieldFX_CPU.h"
+#include "AMD_DepthOfFieldFX_Lens.h"
+
+namespace AMD {
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Converts count depth texels at pDepth to circles of confusion at pCoc with CocFromDepth.
+// A kernel is specialized for one depth and one circle of confusion format, the vector kernels
+// compute every texel with the same float operations as CocFromDepth and give the same bits.
+///////////////////////////////////////////////////////////////////////////////////////////////////
+typedef void (*DEPTHOFFIELDFX_CPU_COC_FN)(const DEPTHOFFIELDFX_COC_PARAMS& params, const void* pDepth, void* pCoc, uint count);
+
+// Returns nullptr if the instruction set is not available on this machine or the formats are not
+// supported: depth is R32_FLOAT, R16_FLOAT or D24_UNORM_S8_UINT, the circle of confusion R32_FLOAT
+// or R16_FLOAT.
+DEPTHOFFIELDFX_CPU_COC_FN GetCocKernel(DEPTHOFFIELDFX_CPU_INSTRUCTION_SET instructionSet, DEPTHOFFIELDFX_CPU_FORMAT depthFormat, DEPTHOFFIELDFX_CPU_FORMAT cocFormat);
+}
+
+#endif  // AMD_DEPTHOFFIELDFX_CPU_COC_H
@@ -0,0 +1,716 @@
+//
+// Copyright (c) 2017 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include <string.h>
+
+#include "AMD_DepthOfFieldFX_CPU_Integrate.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define AMD_DEPTHOFFIELDFX_CPU_X86 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#include <immintrin.h>
+#elif defined(_M_ARM64) || defined(__aarch64__) || defined(__ARM_NEON)
+#define AMD_DEPTHOFFIELDFX_CPU_NEON 1
+#include <arm_neon.h>
+#endif
+
+// MSVC allows any intrinsic in any function, gcc and clang need the target enabled per function
+#if defined(AMD_DEPTHOFFIELDFX_CPU_X86) && !defined(_MSC_VER)
+#define AMD_DEPTHOFFIELDFX_TARGET_SSE2 __attribute__((target("sse2")))
+#define AMD_DEPTHOFFIELDFX_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define AMD_DEPTHOFFIELDFX_TARGET_SSE2
+#define AMD_DEPTHOFFIELDFX_TARGET_AVX2
+#endif
+
+namespace AMD {
+static const uint s_stateColorOffset = DEPTHOFFIELDFX_CPU_INTEGRATE_MAX_STRIP_WIDTH;
+static const uint s_stateSlopeOffset = 2 * DEPTHOFFIELDFX_CPU_INTEGRATE_MAX_STRIP_WIDTH;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Scalar reference
+///////////////////////////////////////////////////////////////////////////////////////////////////
+template <uint ORDER> static void IntegrateStripScalar(const DEPTHOFFIELDFX_CPU_INTEGRATE_STRIP& strip)
+{
+    uint delta[DEPTHOFFIELDFX_CPU_INTEGRATE_MAX_STRIP_WIDTH][4];
+    uint color[DEPTHOFFIELDFX_CPU_INTEGRATE_MAX_STRIP_WIDTH][4];
+    uint slope[DEPTHOFFIELDFX_CPU_INTEGRATE_MAX_STRIP_WIDTH][4];
+
+    const bool resume = (strip.pState != nullptr) && strip.resume;
+    if (resume)
+    {
+        memcpy(delta, strip.pState, strip.columnCount * sizeof(delta[0]));
+        memcpy(color, strip.pState + s_stateColorOffset * 4, strip.columnCount * sizeof(color[0]));
+        memcpy(slope, strip.pState + s_stateSlopeOffset * 4, strip.columnCount * sizeof(slope[0]));
+    }
+
+    for (uint y = 0; y < strip.rowCount; ++y)
+    {
+        // the first element of a column initializes every running sum
+        const bool first = (y == 0) && !resume;
+        for (uint i = 0; i < strip.columnCount; ++i)
+        {
+            const uint* pRead  = strip.pSrc + (i * strip.srcColumnPitch + y * strip.srcRowPitch) * 4;
+            uint*       pWrite = strip.pDst + (i * strip.dstColumnPitch + y * strip.dstRowPitch) * 4;
+            for (uint lane = 0; lane < 4; ++lane)
+            {
+                delta[i][lane] = first ? pRead[lane] : delta[i][lane] + pRead[lane];
+                slope[i][lane] = ((ORDER == 3) && !first) ? slope[i][lane] + delta[i][lane] : delta[i][lane];
+                color[i][lane] = ((ORDER > 1) && !first) ? color[i][lane] + slope[i][lane] : slope[i][lane];
+                pWrite[lane]   = color[i][lane];
+            }
+        }
+    }
+
+    if (strip.pState != nullptr)
+    {
+        memcpy(strip.pState, delta, strip.columnCount * sizeof(delta[0]));
+        memcpy(strip.pState + s_stateColorOffset * 4, color, strip.columnCount * sizeof(color[0]));
+        memcpy(strip.pState + s_stateSlopeOffset * 4, slope, strip.columnCount * sizeof(slope[0]));
+    }
+}
+
+static void IntegrateScalar(const DEPTHOFFIELDFX_CPU_INTEGRATE_STRIP& strip)
+{
+    switch (strip.order)
+    {
+    case 1:
+        IntegrateStripScalar<1>(strip);
+        break;
+    case 2:
+        IntegrateStripScalar<2>(strip);
+        break;
+    default:
+        IntegrateStripScalar<3>(strip);
+        break;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Compact scalar reference: the four 16 bit lanes of an element are added in one 64 bit register,
+// the top bit of every lane is summed separately so no carry crosses into the next lane
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static uint64 AddLanes16(uint64 a, uint64 b)
+{
+    const uint64 topBits = 0x8000800080008000ull;
+    return ((a & ~topBits) + (b & ~topBits)) ^ ((a ^ b) & topBits);
+}
+
+template <uint ORDER> static void IntegrateStripCompact(const DEPTHOFFIELDFX_CPU_INTEGRATE_STRIP& strip)
+{
+    uint64 delta[DEPTHOFFIELDFX_CPU_INTEGRATE_MAX_STRIP_WIDTH];
+    uint64 color[DEPTHOFFIELDFX_CPU_INTEGRATE_MAX_STRIP_WIDTH];
+    uint64 slope[DEPTHOFFIELDFX_CPU_INTEGRATE_MAX_STRIP_WIDTH];
+
+    const uint8* pSrc   = reinterpret_cast<const uint8*>(strip.pSrc);
+    uint8*       pDst   = reinterpret_cast<uint8*>(strip.pDst);
+    uint8*       pState = reinterpret_cast<uint8*>(strip.pState);
+
+    const bool resume = (pState != nullptr) && strip.resume;
+    if (resume)
+    {
+        memcpy(delta, pState, strip.columnCount * sizeof(uint64));
+        memcpy(color, pState + s_stateColorOffset * sizeof(uint64), strip.columnCount * sizeof(uint64));
+        memcpy(slope, pState + s_stateSlopeOffset * sizeof(uint64), strip.columnCount * sizeof(uint64));
+    }
+
+    for (uint y = 0; y < strip.rowCount; ++y)
+    {
+        const bool first = (y == 0) && !resume;
+        for (uint i = 0; i < strip.columnCount; ++i)
+        {
+            uint64 value;
+            memcpy(&value, pSrc + (i * strip.srcColumnPitch + y * strip.srcRowPitch) * sizeof(uint64), sizeof(uint64));
+            delta[i] = first ? value : AddLanes16(delta[i], value);
+            slope[i] = ((ORDER == 3) && !first) ? AddLanes16(slope[i], delta[i]) : delta[i];
+            color[i] = ((ORDER > 1) && !first) ? AddLanes16(color[i], slope[i]) : slope[i];
+            memcpy(pDst + (i * strip.dstColumnPitch + y * strip.dstRowPitch) * sizeof(uint64), &color[i], sizeof(uint64));
+        }
+    }
+
+    if (pState != nullptr)
+    {
+        memcpy(pState, delta, strip.columnCount * sizeof(uint64));
+        memcpy(pState + s_stateColorOffset * sizeof(uint64), color, strip.columnCount * sizeof(uint64));
+        memcpy(pState + s_stateSlopeOffset * sizeof(uint64), slope, strip.columnCount * sizeof(uint64));
+    }
+}
+
+static void IntegrateCompactScalar(const DEPTHOFFIELDFX_CPU_INTEGRATE_STRIP& strip)
+{
+    switch (strip.order)
+    {
+    case 1:
+        IntegrateStripCompact<1>(strip);
+        break;
+    case 2:
+        IntegrateStripCompact<2>(strip);
+        break;
+    default:
+        IntegrateStripCompact<3>(strip);
+        break;
+    }
+}
+
+#if AMD_DEPTHOFFIELDFX_CPU_X86
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// SSE2: one int4 per register, 8 columns per unrolled block
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static const uint s_sse2BlockRegisters = 8;
+
+template <uint ORDER> AMD_DEPTHOFFIELDFX_TARGET_SSE2 static void IntegrateStripSSE2(const DEPTHOFFIELDFX_CPU_INTEGRATE_STRIP& strip)
+{
+    __m128i delta[DEPTHOFFIELDFX_CPU_INTEGRATE_MAX_STRIP_WIDTH];
+    __m128i color[DEPTHOFFIELDFX_CPU_INTEGRATE_MAX_STRIP_WIDTH];
+    __m128i slope[DEPTHOFFIELDFX_CPU_INTEGRATE_MAX_STRIP_WIDTH];
+
+    const __m128i* pSrc   = reinterpret_cast<const __m128i*>(strip.pSrc);
+    __m128i*       pDst   = reinterpret_cast<__m128i*>(strip.pDst);
+    __m128i*       pState = reinterpret_cast<__m128i*>(strip.pState);
+
+    const bool resume = (pState != nullptr) && strip.resume;
+    for (uint i = 0; resume && (i < strip.columnCount); ++i)
+    {
+        delta[i] = _mm_loadu_si128(pState + i);
+        color[i] = _mm_loadu_si128(pState + s_stateColorOffset + i);
+        slope[i] = _mm_loadu_si128(pState + s_stateSlopeOffset + i);
+    }
+
+    for (uint y = 0; y < strip.rowCount; ++y)
+    {
+        const bool     first   = (y == 0) && !resume;
+        const __m128i* pRow    = pSrc + y * strip.srcRowPitch;
+        __m128i*       pDstRow = pDst + y * strip.dstRowPitch;
+        for (uint block = 0; block < strip.columnCount; block += s_sse2BlockRegisters)
+        {
+            // keep the loads and the strided stores of a block apart so they can overlap
+            const uint blockEnd = MIN(block + s_sse2BlockRegisters, strip.columnCount);
+            for (uint i = block; i < blockEnd; ++i)
+            {
+                const __m128i read = _mm_loadu_si128(pRow + i * strip.srcColumnPitch);
+                delta[i]           = first ? read : _mm_add_epi32(delta[i], read);
+                slope[i]           = ((ORDER == 3) && !first) ? _mm_add_epi32(slope[i], delta[i]) : delta[i];
+                color[i]           = ((ORDER > 1) && !first) ? _mm_add_epi32(color[i], slope[i]) : slope[i];
+            }
+            for (uint i = block; i < blockEnd; ++i)
+            {
+                _mm_storeu_si128(pDstRow + i * strip.dstColumnPitch, color[i]);
+            }
+        }
+    }
+
+    for (uint i = 0; (pState != nullptr) && (i < strip.columnCount); ++i)
+    {
+        _mm_storeu_si128(pState + i, delta[i]);
+        _mm_storeu_si128(pState + s_stateColorOffset + i, color[i]);
+        _mm_storeu_si128(pState + s_stateSlopeOffset + i, slope[i]);
+    }
+}
+
+AMD_DEPTHOFFIELDFX_TARGET_SSE2 static void IntegrateSSE2(const DEPTHOFFIELDFX_CPU_INTEGRATE_STRIP& strip)
+{
+    switch (strip.order)
+    {
+    case 1:
+        IntegrateStripSSE2<1>(strip);
+        break;
+    case 2:
+        IntegrateStripSSE2<2>(strip);
+        break;
+    default:
+        IntegrateStripSSE2<3>(strip);
+        break;
+    }
+}
+
+// compact elements in the low half of a register, the wider kernels have nothing to add
+template <uint ORDER> AMD_DEPTHOFFIELDFX_TARGET_SSE2 static void IntegrateStripCompactSSE2(const DEPTHOFFIELDFX_CPU_INTEGRATE_STRIP& strip)
+{
+    __m128i delta[DEPTHOFFIELDFX_CPU_INTEGRATE_MAX_STRIP_WIDTH];
+    __m128i color[DEPTHOFFIELDFX_CPU_INTEGRATE_MAX_STRIP_WIDTH];
+    __m128i slope[DEPTHOFFIELDFX_CPU_INTEGRATE_MAX_STRIP_WIDTH];
+
+    const uint64* pSrc   = reinterpret_cast<const uint64*>(strip.pSrc);
+    uint64*       pDst   = reinterpret_cast<uint64*>(strip.pDst);
+    uint64*       pState = reinterpret_cast<uint64*>(strip.pState);
+
+    const bool resume = (pState != nullptr) && strip.resume;
+    for (uint i = 0; resume && (i < strip.columnCount); ++i)
+    {
+        delta[i] = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(pState + i));
+        color[i] = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(pState + s_stateColorOffset + i));
+        slope[i] = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(pState + s_stateSlopeOffset + i));
+    }
+
+    for (uint y = 0; y < strip.rowCount; ++y)
+    {
+        const bool    first   = (y == 0) && !resume;
+        const uint64* pRow    = pSrc + y * strip.srcRowPitch;
+        uint64*       pDstRow = pDst + y * strip.dstRowPitch;
+        for (uint block = 0; block < strip.columnCount; block += s_sse2BlockRegisters)
+        {
+            const uint blockEnd = MIN(block + s_sse2BlockRegisters, strip.columnCount);
+            for (uint i = block; i < blockEnd; ++i)
+            {
+                const __m128i read = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(pRow + i * strip.srcColumnPitch));
+                delta[i]           = first ? read : _mm_add_epi16(delta[i], read);
+                slope[i]           = ((ORDER == 3) && !first) ? _mm_add_epi16(slope[i], delta[i]) : delta[i];
+                color[i]           = ((ORDER > 1) && !first) ? _mm_add_epi16(color[i], slope[i]) : slope[i];
+            }
+            for (uint i = block; i < blockEnd; ++i)
+            {
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(pDstRow + i * strip.dstColumnPitch), color[i]);
+            }
+        }
+    }
+
+    for (uint i = 0; (pState != nullptr) && (i < strip.columnCount); ++i)
+    {
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(pState + i), delta[i]);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(pState + s_stateColorOffset + i), color[i]);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(pState + s_stateSlopeOffset + i), slope[i]);
+    }
+}
+
+// Adjacent columns without saved sums, like the vertical pass, share a register two at a time.
+// pairCount pairs of columns start at pSrc and pDst, the pitches are in compact elements.
+template <uint ORDER> AMD_DEPTHOFFIELDFX_TARGET_SSE2 static void IntegrateStripCompactPairsSSE2(const DEPTHOFFIELDFX_CPU_INTEGRATE_STRIP& strip, uint pairCount)
+{
+    __m128i delta[DEPTHOFFIELDFX_CPU_INTEGRATE_MAX_STRIP_WIDTH / 2];
+    __m128i color[DEPTHOFFIELDFX_CPU_INTEGRATE_MAX_STRIP_WIDTH / 2];
+    __m128i slope[DEPTHOFFIELDFX_CPU_INTEGRATE_MAX_STRIP_WIDTH / 2];
+
+    const uint64* pSrc = reinterpret_cast<const uint64*>(strip.pSrc);
+    uint64*       pDst = reinterpret_cast<uint64*>(strip.pDst);
+
+    for (uint y = 0; y < strip.rowCount; ++y)
+    {
+        const bool     first   = (y == 0);
+        const __m128i* pRow    = reinterpret_cast<const __m128i*>(pSrc + y * strip.srcRowPitch);
+        __m128i*       pDstRow = reinterpret_cast<__m128i*>(pDst + y * strip.dstRowPitch);
+        for (uint i = 0; i < pairCount; ++i)
+        {
+            const __m128i read = _mm_loadu_si128(pRow + i);
+            delta[i]           = first ? read : _mm_add_epi16(delta[i], read);
+            slope[i]           = ((ORDER == 3) && !first) ? _mm_add_epi16(slope[i], delta[i]) : delta[i];
+            color[i]           = ((ORDER > 1) && !first) ? _mm_add_epi16(color[i], slope[i]) : slope[i];
+            _mm_storeu_si128(pDstRow + i, color[i]);
+        }
+    }
+}
+
+AMD_DEPTHOFFIELDFX_TARGET_SSE2 static void IntegrateCompactSSE2(const DEPTHOFFIELDFX_CPU_INTEGRATE_STRIP& strip)
+{
+    if ((strip.srcColumnPitch == 1) && (strip.dstColumnPitch == 1) && (strip.pState == nullptr))
+    {
+        const uint pairCount = strip.columnCount / 2;
+        switch (strip.order)
+        {
+        case 1:
+            IntegrateStripCompactPairsSSE2<1>(strip, pairCount);
+            break;
+        case 2:
+            IntegrateStripCompactPairsSSE2<2>(strip, pairCount);
+            break;
+        default:
+            IntegrateStripCompactPairsSSE2<3>(strip, pairCount);
+            break;
+        }
+        if ((strip.columnCount & 1) == 0)
+        {
+            return;
+        }
+
+        // the odd column left over
+        DEPTHOFFIELDFX_CPU_INTEGRATE_STRIP last = strip;
+        last.pSrc                               = strip.pSrc + pairCount * 4;
+        last.pDst                               = strip.pDst + pairCount * 4;
+        last.columnCount                        = 1;
+        switch (last.order)
+        {
+        case 1:
+            IntegrateStripCompactSSE2<1>(last);
+            break;
+        case 2:
+            IntegrateStripCompactSSE2<2>(last);
+            break;
+        default:
+            IntegrateStripCompactSSE2<3>(last);
+            break;
+        }
+        return;
+    }
+
+    switch (strip.order)
+    {
+    case 1:
+        IntegrateStripCompactSSE2<1>(strip);
+        break;
+    case 2:
+        IntegrateStripCompactSSE2<2>(strip);
+        break;
+    default:
+        IntegrateStripCompactSSE2<3>(strip);
+        break;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// AVX2: two neighbouring columns per register, 16 columns per unrolled block
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static const uint s_avx2BlockRegisters = 8;
+
+AMD_DEPTHOFFIELDFX_TARGET_AVX2 static __m256i LoadPair(const __m128i* pFirst, size_t pitch)
+{
+    if (pitch == 1)
+    {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pFirst));
+    }
+    return _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128(pFirst)), _mm_loadu_si128(pFirst + pitch), 1);
+}
+
+AMD_DEPTHOFFIELDFX_TARGET_AVX2 static void StorePair(__m128i* pFirst, size_t pitch, __m256i value)
+{
+    if (pitch == 1)
+    {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(pFirst), value);
+    }
+    else
+    {
+        _mm_storeu_si128(pFirst, _mm256_castsi256_si128(value));
+        _mm_storeu_si128(pFirst + pitch, _mm256_extracti128_si256(value, 1));
+    }
+}
+
+template <uint ORDER> AMD_DEPTHOFFIELDFX_TARGET_AVX2 static void IntegrateStripAVX2(const DEPTHOFFIELDFX_CPU_INTEGRATE_STRIP& strip)
+{
+    __m256i delta[DEPTHOFFIELDFX_CPU_INTEGRATE_MAX_STRIP_WIDTH / 2];
+    __m256i color[DEPTHOFFIELDFX_CPU_INTEGRATE_MAX_STRIP_WIDTH / 2];
+    __m256i slope[DEPTHOFFIELDFX_CPU_INTEGRATE_MAX_STRIP_WIDTH / 2];
+
+    const __m128i* pSrc      = reinterpret_cast<const __m128i*>(strip.pSrc);
+    __m128i*       pDst      = reinterpret_cast<__m128i*>(strip.pDst);
+    __m128i*       pState    = reinterpret_cast<__m128i*>(strip.pState);
+    const uint     pairCount = strip.columnCount / 2;
+
+    const bool resume = (pState != nullptr) && strip.resume;
+    for (uint i = 0; resume && (i < pairCount); ++i)
+    {
+        delta[i] = LoadPair(pState + 2 * i, 1);
+        color[i] = LoadPair(pState + s_stateColorOffset + 2 * i, 1);
+        slope[i] = LoadPair(pState + s_stateSlopeOffset + 2 * i, 1);
+    }
+
+    for (uint y = 0; y < strip.rowCount; ++y)
+    {
+        const bool     first   = (y == 0) && !resume;
+        const __m128i* pRow    = pSrc + y * strip.srcRowPitch;
+        __m128i*       pDstRow = pDst + y * strip.dstRowPitch;
+
+        for (uint block = 0; block < pairCount; block += s_avx2BlockRegisters)
+        {
+            const uint blockEnd = MIN(block + s_avx2BlockRegisters, pairCount);
+            for (uint i = block; i < blockEnd; ++i)
+            {
+                const __m256i read = LoadPair(pRow + 2 * i * strip.srcColumnPitch, strip.srcColumnPitch);
+                delta[i]           = first ? read : _mm256_add_epi32(delta[i], read);
+                slope[i]           = ((ORDER == 3) && !first) ? _mm256_add_epi32(slope[i], delta[i]) : delta[i];
+                color[i]           = ((ORDER > 1) && !first) ? _mm256_add_epi32(color[i], slope[i]) : slope[i];
+            }
+            for (uint i = block; i < blockEnd; ++i)
+            {
+                StorePair(pDstRow + 2 * i * strip.dstColumnPitch, strip.dstColumnPitch, color[i]);
+            }
+        }
+    }
+
+    for (uint i = 0; (pState != nullptr) && (i < pairCount); ++i)
+    {
+        StorePair(pState + 2 * i, 1, delta[i]);
+        StorePair(pState + s_stateColorOffset + 2 * i, 1, color[i]);
+        StorePair(pState + s_stateSlopeOffset + 2 * i, 1, slope[i]);
+    }
+
+    // odd column count, integrate the last column on its own
+    if (strip.columnCount & 1)
+    {
+        const uint                         last = strip.columnCount - 1;
+        DEPTHOFFIELDFX_CPU_INTEGRATE_STRIP tail = strip;
+        tail.pSrc += last * strip.srcColumnPitch * 4;
+        tail.pDst += last * strip.dstColumnPitch * 4;
+        tail.pState      = (strip.pState != nullptr) ? strip.pState + last * 4 : nullptr;
+        tail.columnCount = 1;
+        IntegrateStripSSE2<ORDER>(tail);
+    }
+}
+
+AMD_DEPTHOFFIELDFX_TARGET_AVX2 static void IntegrateAVX2(const DEPTHOFFIELDFX_CPU_INTEGRATE_STRIP& strip)
+{
+    switch (strip.order)
+    {
+    case 1:
+        IntegrateStripAVX2<1>(strip);
+        break;
+    case 2:
+        IntegrateStripAVX2<2>(strip);
+        break;
+    default:
+        IntegrateStripAVX2<3>(strip);
+        break;
+    }
+}
+
+static void Cpuid(int info[4], int leaf, int subleaf)
+{
+#if defined(_MSC_VER)
+    __cpuidex(info, leaf, subleaf);
+#else
+    unsigned int regs[4] = { 0, 0, 0, 0 };
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+    for (int i = 0; i < 4; ++i)
+    {
+        info[i] = static_cast<int>(regs[i]);
+    }
+#endif
+}
+
+static uint64 ReadXCR0()
+{
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    uint lo, hi;
+    __asm__ __volatile__("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return (static_cast<uint64>(hi) << 32) | lo;
+#endif
+}
+#endif  // AMD_DEPTHOFFIELDFX_CPU_X86
+
+#if AMD_DEPTHOFFIELDFX_CPU_NEON
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// NEON: one int4 per register
+///////////////////////////////////////////////////////////////////////////////////////////////////
+template <uint ORDER> static void IntegrateStripNEON(const DEPTHOFFIELDFX_CPU_INTEGRATE_STRIP& strip)
+{
+    uint32x4_t delta[DEPTHOFFIELDFX_CPU_INTEGRATE_MAX_STRIP_WIDTH];
+    uint32x4_t color[DEPTHOFFIELDFX_CPU_INTEGRATE_MAX_STRIP_WIDTH];
+    uint32x4_t slope[DEPTHOFFIELDFX_CPU_INTEGRATE_MAX_STRIP_WIDTH];
+
+    const bool resume = (strip.pState != nullptr) && strip.resume;
+    for (uint i = 0; resume && (i < strip.columnCount); ++i)
+    {
+        delta[i] = vld1q_u32(strip.pState + i * 4);
+        color[i] = vld1q_u32(strip.pState + (s_stateColorOffset + i) * 4);
+        slope[i] = vld1q_u32(strip.pState + (s_stateSlopeOffset + i) * 4);
+    }
+
+    for (uint y = 0; y < strip.rowCount; ++y)
+    {
+        const bool  first   = (y == 0) && !resume;
+        const uint* pRow    = strip.pSrc + y * strip.srcRowPitch * 4;
+        uint*       pDstRow = strip.pDst + y * strip.dstRowPitch * 4;
+        for (uint i = 0; i < strip.columnCount; ++i)
+        {
+            const uint32x4_t read = vld1q_u32(pRow + i * strip.srcColumnPitch * 4);
+            delta[i]              = first ? read : vaddq_u32(delta[i], read);
+            slope[i]              = ((ORDER == 3) && !first) ? vaddq_u32(slope[i], delta[i]) : delta[i];
+            color[i]              = ((ORDER > 1) && !first) ? vaddq_u32(color[i], slope[i]) : slope[i];
+            vst1q_u32(pDstRow + i * strip.dstColumnPitch * 4, color[i]);
+        }
+    }
+
+    for (uint i = 0; (strip.pState != nullptr) && (i < strip.columnCount); ++i)
+    {
+        vst1q_u32(strip.pState + i * 4, delta[i]);
+        vst1q_u32(strip.pState + (s_stateColorOffset + i) * 4, color[i]);
+        vst1q_u32(strip.pState + (s_stateSlopeOffset + i) * 4, slope[i]);
+    }
+}
+
+static void IntegrateNEON(const DEPTHOFFIELDFX_CPU_INTEGRATE_STRIP& strip)
+{
+    switch (strip.order)
+    {
+    case 1:
+        IntegrateStripNEON<1>(strip);
+        break;
+    case 2:
+        IntegrateStripNEON<2>(strip);
+        break;
+    default:
+        IntegrateStripNEON<3>(strip);
+        break;
+    }
+}
+
+// one compact element per 64 bit register
+template <uint ORDER> static void IntegrateStripCompactNEON(const DEPTHOFFIELDFX_CPU_INTEGRATE_STRIP& strip)
+{
+    uint16x4_t delta[DEPTHOFFIELDFX_CPU_INTEGRATE_MAX_STRIP_WIDTH];
+    uint16x4_t color[DEPTHOFFIELDFX_CPU_INTEGRATE_MAX_STRIP_WIDTH];
+    uint16x4_t slope[DEPTHOFFIELDFX_CPU_INTEGRATE_MAX_STRIP_WIDTH];
+
+    const uint16* pSrc   = reinterpret_cast<const uint16*>(strip.pSrc);
+    uint16*       pDst   = reinterpret_cast<uint16*>(strip.pDst);
+    uint16*       pState = reinterpret_cast<uint16*>(strip.pState);
+
+    const bool resume = (pState != nullptr) && strip.resume;
+    for (uint i = 0; resume && (i < strip.columnCount); ++i)
+    {
+        delta[i] = vld1_u16(pState + i * 4);
+        color[i] = vld1_u16(pState + (s_stateColorOffset + i) * 4);
+        slope[i] = vld1_u16(pState + (s_stateSlopeOffset + i) * 4);
+    }
+
+    for (uint y = 0; y < strip.rowCount; ++y)
+    {
+        const bool    first   = (y == 0) && !resume;
+        const uint16* pRow    = pSrc + y * strip.srcRowPitch * 4;
+        uint16*       pDstRow = pDst + y * strip.dstRowPitch * 4;
+        for (uint i = 0; i < strip.columnCount; ++i)
+        {
+            const uint16x4_t read = vld1_u16(pRow + i * strip.srcColumnPitch * 4);
+            delta[i]              = first ? read : vadd_u16(delta[i], read);
+            slope[i]              = ((ORDER == 3) && !first) ? vadd_u16(slope[i], delta[i]) : delta[i];
+            color[i]              = ((ORDER > 1) && !first) ? vadd_u16(color[i], slope[i]) : slope[i];
+            vst1_u16(pDstRow + i * strip.dstColumnPitch * 4, color[i]);
+        }
+    }
+
+    for (uint i = 0; (pState != nullptr) && (i < strip.columnCount); ++i)
+    {
+        vst1_u16(pState + i * 4, delta[i]);
+        vst1_u16(pState + (s_stateColorOffset + i) * 4, color[i]);
+        vst1_u16(pState + (s_stateSlopeOffset + i) * 4, slope[i]);
+    }
+}
+
+static void IntegrateCompactNEON(const DEPTHOFFIELDFX_CPU_INTEGRATE_STRIP& strip)
+{
+    switch (strip.order)
+    {
+    case 1:
+        IntegrateStripCompactNEON<1>(strip);
+        break;
+    case 2:
+        IntegrateStripCompactNEON<2>(strip);
+        break;
+    default:
+        IntegrateStripCompactNEON<3>(strip);
+        break;
+    }
+}
+#endif  // AMD_DEPTHOFFIELDFX_CPU_NEON
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+DEPTHOFFIELDFX_CPU_INSTRUCTION_SET DetectInstructionSet()
+{
+#if AMD_DEPTHOFFIELDFX_CPU_X86
+    int info[4];
+    Cpuid(info, 0, 0);
+    const int maxLeaf = info[0];
+
+    Cpuid(info, 1, 0);
+    const bool sse2    = (info[3] & (1 << 26)) != 0;
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx     = (info[2] & (1 << 28)) != 0;
+
+    // AVX2 also needs the OS to save the ymm registers
+    if (osxsave && avx && (maxLeaf >= 7) && ((ReadXCR0() & 0x6) == 0x6))
+    {
+        Cpuid(info, 7, 0);
+        if (info[1] & (1 << 5))
+        {
+            return DEPTHOFFIELDFX_CPU_INSTRUCTION_SET_AVX2;
+        }
+    }
+    if (sse2)
+    {
+        return DEPTHOFFIELDFX_CPU_INSTRUCTION_SET_SSE2;
+    }
+#elif AMD_DEPTHOFFIELDFX_CPU_NEON
+    return DEPTHOFFIELDFX_CPU_INSTRUCTION_SET_NEON;
+#endif
+    return DEPTHOFFIELDFX_CPU_INSTRUCTION_SET_SCALAR;
+}
+
+DEPTHOFFIELDFX_CPU_INTEGRATE_FN GetIntegrateKernel(DEPTHOFFIELDFX_CPU_INSTRUCTION_SET instructionSet)
+{
+    const DEPTHOFFIELDFX_CPU_INSTRUCTION_SET supported = DetectInstructionSet();
+    if (instructionSet == DEPTHOFFIELDFX_CPU_INSTRUCTION_SET_AUTO)
+    {
+        instructionSet = supported;
+    }
+
+    switch (instructionSet)
+    {
+    case DEPTHOFFIELDFX_CPU_INSTRUCTION_SET_SCALAR:
+        return IntegrateScalar;
+#if AMD_DEPTHOFFIELDFX_CPU_X86
+    case DEPTHOFFIELDFX_CPU_INSTRUCTION_SET_SSE2:
+        return (supported != DEPTHOFFIELDFX_CPU_INSTRUCTION_SET_SCALAR) ? IntegrateSSE2 : nullptr;
+    case DEPTHOFFIELDFX_CPU_INSTRUCTION_SET_AVX2:
+        return (supported == DEPTHOFFIELDFX_CPU_INSTRUCTION_SET_AVX2) ? IntegrateAVX2 : nullptr;
+#endif
+#if AMD_DEPTHOFFIELDFX_CPU_NEON
+    case DEPTHOFFIELDFX_CPU_INSTRUCTION_SET_NEON:
+        return IntegrateNEON;
+#endif
+    default:
+        return nullptr;
+    }
+}
+
+// a compact element only fills half an SSE2 register, AVX2 runs the SSE2 kernel
+DEPTHOFFIELDFX_CPU_INTEGRATE_FN GetCompactIntegrateKernel(DEPTHOFFIELDFX_CPU_INSTRUCTION_SET instructionSet)
+{
+    if (GetIntegrateKernel(instructionSet) == nullptr)
+    {
+        return nullptr;
+    }
+    if (instructionSet == DEPTHOFFIELDFX_CPU_INSTRUCTION_SET_AUTO)
+    {
+        instructionSet = DetectInstructionSet();
+    }
+
+    switch (instructionSet)
+    {
+#if AMD_DEPTHOFFIELDFX_CPU_X86
+    case DEPTHOFFIELDFX_CPU_INSTRUCTION_SET_SSE2:
+    case DEPTHOFFIELDFX_CPU_INSTRUCTION_SET_AVX2:
+        return IntegrateCompactSSE2;
+#endif
+#if AMD_DEPTHOFFIELDFX_CPU_NEON
+    case DEPTHOFFIELDFX_CPU_INSTRUCTION_SET_NEON:
+        return IntegrateCompactNEON;
+#endif
+    default:
+        return IntegrateCompactScalar;
+    }
+}
+}
@@ -0,0 +1,80 @@
+//
+// Copyright (c) 2017 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#ifndef AMD_DEPTHOFFIELDFX_CPU_INTEGRATE_H
+#define AMD_DEPTHOFFIELDFX_CPU_INTEGRATE_H
+
+#include <stddef.h>
+
+#include "AMD_DepthOfFieldFX_CPU.h"
+
+namespace AMD {
+// largest number of columns integrated by one call, the running sums of a strip stay in L1
+static const uint DEPTHOFFIELDFX_CPU_INTEGRATE_MAX_STRIP_WIDTH = 64;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// A strip of columns to integrate from top to bottom.
+// Elements are four 32 bit lanes (the int4 of the shader) and all pitches are in elements.
+// Column i of row y is read from pSrc[i * srcColumnPitch + y * srcRowPitch] and its integrated
+// value is written to pDst[i * dstColumnPitch + y * dstRowPitch], so a dstColumnPitch of the image
+// height and a dstRowPitch of 1 writes the result transposed like VerticalIntegrate does, and
+// swapping the pitches integrates rows instead of columns.
+//
+// order is the number of running sums per column, 1 to 3: the delta sum, the sum of the delta sums
+// and the color sum. Only the last is written, the others may wrap modulo 2^32 like it.
+//
+// pState is optional and lets a column be integrated in several calls. It holds
+// 3 * DEPTHOFFIELDFX_CPU_INTEGRATE_MAX_STRIP_WIDTH elements: the delta sum of column i at i,
+// the color sum at DEPTHOFFIELDFX_CPU_INTEGRATE_MAX_STRIP_WIDTH + i and the sum of the delta sums
+// at 2 * DEPTHOFFIELDFX_CPU_INTEGRATE_MAX_STRIP_WIDTH + i. The sums are stored there when the call
+// returns and, if resume is set, read from there instead of starting a new column.
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct DEPTHOFFIELDFX_CPU_INTEGRATE_STRIP
+{
+    const uint* pSrc;
+    uint*       pDst;
+    uint*       pState;
+    size_t      srcRowPitch;
+    size_t      srcColumnPitch;
+    size_t      dstRowPitch;
+    size_t      dstColumnPitch;
+    uint        columnCount;
+    uint        rowCount;
+    uint        order;
+    bool        resume;
+};
+
+typedef void (*DEPTHOFFIELDFX_CPU_INTEGRATE_FN)(const DEPTHOFFIELDFX_CPU_INTEGRATE_STRIP& strip);
+
+// best instruction set supported by the CPU and the OS
+DEPTHOFFIELDFX_CPU_INSTRUCTION_SET DetectInstructionSet();
+
+// returns nullptr if the instruction set is not available on this machine
+DEPTHOFFIELDFX_CPU_INTEGRATE_FN GetIntegrateKernel(DEPTHOFFIELDFX_CPU_INSTRUCTION_SET instructionSet);
+
+// Same for strips of compact elements, four 16 bit lanes in 64 bits summed modulo 2^16.
+// pSrc, pDst and pState point to compact elements and all pitches are in compact elements.
+DEPTHOFFIELDFX_CPU_INTEGRATE_FN GetCompactIntegrateKernel(DEPTHOFFIELDFX_CPU_INSTRUCTION_SET instructionSet);
+}
+
+#endif  // AMD_DEPTHOFFIELDFX_CPU_INTEGRATE_H
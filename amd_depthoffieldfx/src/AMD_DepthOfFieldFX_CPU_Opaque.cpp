@@ -0,0 +1,2687 @@
+//
+// Copyright (c) 2017 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include <math.h>
+#include <string.h>
+
+#include <chrono>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "AMD_DepthOfFieldFX_CPU_Opaque.h"
+#include "AMD_DepthOfFieldFX_CPU_Transpose.h"
+#include "AMD_DepthOfFieldFX_Kernel.h"
+#include "AMD_DepthOfFieldFX_ScaleFactor.h"
+
+#pragma warning(disable : 4100)  // disable unreference formal parameter warnings for /W4 builds
+
+namespace AMD {
+typedef DEPTHOFFIELDFX_CPU_OPAQUE_DESC::uint4 uint4;
+
+// rows of the final result read by a single task
+static const uint s_readResultRows = 8;
+
+// rows integrated together by the in place horizontal pass, one prefetch stream each
+static const uint s_horizontalIntegrateRows = 16;
+
+// adds the wall clock time of its scope to a pass
+struct PASS_TIMER
+{
+    explicit PASS_TIMER(double& milliseconds)
+        : m_milliseconds(milliseconds)
+        , m_start(std::chrono::steady_clock::now())
+    {
+    }
+
+    ~PASS_TIMER() { m_milliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_start).count(); }
+
+    double&                               m_milliseconds;
+    std::chrono::steady_clock::time_point m_start;
+
+private:
+    PASS_TIMER& operator=(const PASS_TIMER&);
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Half float conversion
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static float HalfToFloat(uint16 h)
+{
+    const uint sign     = (h & 0x8000u) << 16;
+    const uint exponent = (h >> 10) & 0x1fu;
+    const uint mantissa = h & 0x3ffu;
+    uint       bits;
+
+    if (exponent == 0)
+    {
+        // zero or denormal
+        float value = ldexpf(static_cast<float>(mantissa), -24);
+        return sign ? -value : value;
+    }
+    else if (exponent == 31)
+    {
+        bits = sign | 0x7f800000u | (mantissa << 13);
+    }
+    else
+    {
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    }
+
+    float result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+static uint16 FloatToHalf(float f)
+{
+    uint bits;
+    memcpy(&bits, &f, sizeof(bits));
+
+    const uint sign     = (bits >> 16) & 0x8000u;
+    const int  exponent = static_cast<int>((bits >> 23) & 0xffu) - 127 + 15;
+    uint       mantissa = bits & 0x7fffffu;
+
+    if (((bits >> 23) & 0xffu) == 0xffu)
+    {
+        // inf or nan
+        return static_cast<uint16>(sign | 0x7c00u | (mantissa ? 0x200u : 0u));
+    }
+    if (exponent >= 31)
+    {
+        return static_cast<uint16>(sign | 0x7c00u);
+    }
+    if (exponent <= 0)
+    {
+        if (exponent < -10)
+        {
+            return static_cast<uint16>(sign);
+        }
+        // denormal, round to nearest even
+        mantissa |= 0x800000u;
+        const uint shift   = static_cast<uint>(14 - exponent);
+        const uint half    = 1u << (shift - 1);
+        const uint rounded = (mantissa + half - 1 + ((mantissa >> shift) & 1u)) >> shift;
+        return static_cast<uint16>(sign | rounded);
+    }
+
+    // round to nearest even, a carry into the exponent is the correct result
+    const uint value = (static_cast<uint>(exponent) << 10) | (mantissa >> 13);
+    const uint round = mantissa & 0x1fffu;
+    return static_cast<uint16>(sign | (value + ((round > 0x1000u || (round == 0x1000u && (value & 1u))) ? 1u : 0u)));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Image access
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static const void* GetTexel(const DEPTHOFFIELDFX_CPU_IMAGE& image, int x, int y, uint texelSize)
+{
+    return static_cast<const uint8*>(image.m_pData) + static_cast<size_t>(y) * image.m_pitch + static_cast<size_t>(x) * texelSize;
+}
+
+static float LoadCoc(const DEPTHOFFIELDFX_CPU_IMAGE& image, int x, int y)
+{
+    switch (image.m_format)
+    {
+    case DEPTHOFFIELDFX_CPU_FORMAT_R32G32B32A32_FLOAT:
+        return *static_cast<const float*>(GetTexel(image, x, y, 16));
+    case DEPTHOFFIELDFX_CPU_FORMAT_R16G16B16A16_FLOAT:
+        return HalfToFloat(*static_cast<const uint16*>(GetTexel(image, x, y, 8)));
+    case DEPTHOFFIELDFX_CPU_FORMAT_R32_FLOAT:
+        return *static_cast<const float*>(GetTexel(image, x, y, 4));
+    case DEPTHOFFIELDFX_CPU_FORMAT_R16_FLOAT:
+        return HalfToFloat(*static_cast<const uint16*>(GetTexel(image, x, y, 2)));
+    case DEPTHOFFIELDFX_CPU_FORMAT_D24_UNORM_S8_UINT:
+        return static_cast<float>(*static_cast<const uint*>(GetTexel(image, x, y, 4)) & 0xffffffu) * (1.0f / 16777215.0f);
+    }
+    return 0.0f;
+}
+
+// circle of confusion of a pixel, computed from m_depth if there are lens constants
+static float SampleCoc(const DEPTHOFFIELDFX_CPU_DESC& desc, const DEPTHOFFIELDFX_COC_PARAMS* pCocParams, int x, int y)
+{
+    if (pCocParams != nullptr)
+    {
+        return CocFromDepth(*pCocParams, LoadCoc(desc.m_depth, x, y));
+    }
+    return LoadCoc(desc.m_circleOfConfusion, x, y);
+}
+
+static void LoadColor(const DEPTHOFFIELDFX_CPU_IMAGE& image, int x, int y, float color[3])
+{
+    if (image.m_format == DEPTHOFFIELDFX_CPU_FORMAT_R16G16B16A16_FLOAT)
+    {
+        const uint16* pTexel = static_cast<const uint16*>(GetTexel(image, x, y, 8));
+        color[0]             = HalfToFloat(pTexel[0]);
+        color[1]             = HalfToFloat(pTexel[1]);
+        color[2]             = HalfToFloat(pTexel[2]);
+    }
+    else
+    {
+        const float* pTexel = static_cast<const float*>(GetTexel(image, x, y, 16));
+        color[0]            = pTexel[0];
+        color[1]            = pTexel[1];
+        color[2]            = pTexel[2];
+    }
+}
+
+static void StoreColor(const DEPTHOFFIELDFX_CPU_IMAGE& image, int x, int y, const float color[4])
+{
+    if (image.m_format == DEPTHOFFIELDFX_CPU_FORMAT_R16G16B16A16_FLOAT)
+    {
+        uint16* pTexel = static_cast<uint16*>(const_cast<void*>(GetTexel(image, x, y, 8)));
+        pTexel[0]      = FloatToHalf(color[0]);
+        pTexel[1]      = FloatToHalf(color[1]);
+        pTexel[2]      = FloatToHalf(color[2]);
+        pTexel[3]      = FloatToHalf(color[3]);
+    }
+    else
+    {
+        float* pTexel = static_cast<float*>(const_cast<void*>(GetTexel(image, x, y, 16)));
+        memcpy(pTexel, color, 4 * sizeof(float));
+    }
+}
+
+static bool IsColorFormat(DEPTHOFFIELDFX_CPU_FORMAT format)
+{
+    return (format == DEPTHOFFIELDFX_CPU_FORMAT_R32G32B32A32_FLOAT) || (format == DEPTHOFFIELDFX_CPU_FORMAT_R16G16B16A16_FLOAT);
+}
+
+static uint TexelSize(DEPTHOFFIELDFX_CPU_FORMAT format)
+{
+    switch (format)
+    {
+    case DEPTHOFFIELDFX_CPU_FORMAT_R32G32B32A32_FLOAT:
+        return 16;
+    case DEPTHOFFIELDFX_CPU_FORMAT_R16G16B16A16_FLOAT:
+        return 8;
+    case DEPTHOFFIELDFX_CPU_FORMAT_R16_FLOAT:
+        return 2;
+    default:
+        return 4;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// CPU versions of the helpers in DepthOfFieldFX_FastFilterDOF.hlsl
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// pBuffer holds the buffer rows starting at firstRow, either the whole intermediate buffer or a private plane.
+// The buffer covers the pixels of the region plus padding, in the resolution of the buffer.
+// pQuadCoc receives the circle of confusion of every pixel of the region in the quarter res mode.
+// pCocParams computes the circle of confusion from depth when set.
+// pPyramidLevel is the level of the pyramid mode scattered, null for the full resolution one, which
+// leaves the pixels with a blur radius above maxBlurRadius, clamped to frameBlurRadius, to the levels.
+// nearLayerColumn is where the near field starts in a layered buffer, 0 when both fields share the buffer.
+struct SETUP_TARGET
+{
+    uint4* pBuffer;
+    int    firstRow;
+    DEPTHOFFIELDFX_CPU_OPAQUE_DESC::REGION region;
+    int    bufferWidth;
+    int    padding;
+    int    maxBlurRadius;
+    float  scaleFactor;
+    bool   atomic;
+    bool   compact;
+    float* pQuadCoc;
+    int    frameBlurRadius;
+    int    nearLayerColumn;
+
+    // the squeezed radius of every blur radius and the axis it applies to, for oval bokeh
+    bool                                 anamorphic;
+    DEPTHOFFIELDFX_CPU_BOKEH_ORIENTATION orientation;
+    int                                  squeezedRadii[s_maxKernelTableRadius + 1];
+    int                                  gridWidth;
+    int                                  gridHeight;
+
+    const DEPTHOFFIELDFX_KERNEL*                         pKernel;
+    const DEPTHOFFIELDFX_COC_PARAMS*                     pCocParams;
+    const DEPTHOFFIELDFX_CPU_OPAQUE_DESC::PYRAMID_LEVEL* pPyramidLevel;
+};
+
+// float to int conversion following the D3D rules: NaN becomes 0, out of range values saturate
+static int FloatToInt(float value)
+{
+    if (value != value)
+    {
+        return 0;
+    }
+    if (value >= 2147483648.0f)
+    {
+        return 0x7fffffff;
+    }
+    if (value <= -2147483648.0f)
+    {
+        return static_cast<int>(0x80000000u);
+    }
+    return static_cast<int>(nearbyintf(value));
+}
+
+// The shader clamps to padding and relies on out of bounds UAV writes being discarded.
+// Clamping to the max blur radius keeps every delta inside the buffer.
+static int CocToBlurRadius(float fCoc, int maxBlurRadius)
+{
+    const int radius = abs(static_cast<int>(fCoc));
+    return MIN(radius, maxBlurRadius);
+}
+
+static void InterlockedAdd(uint* pDst, uint value)
+{
+#if defined(_MSC_VER)
+    _InterlockedExchangeAdd(reinterpret_cast<volatile long*>(pDst), static_cast<long>(value));
+#else
+    __atomic_fetch_add(pDst, value, __ATOMIC_RELAXED);
+#endif
+}
+
+static void InterlockedAdd16(uint16* pDst, uint16 value)
+{
+#if defined(_MSC_VER)
+    _InterlockedExchangeAdd16(reinterpret_cast<volatile short*>(pDst), static_cast<short>(value));
+#else
+    __atomic_fetch_add(pDst, value, __ATOMIC_RELAXED);
+#endif
+}
+
+// the 16 bit lanes wrap modulo 2^16 the same way
+static void AddToCompactBuffer(const SETUP_TARGET& target, int x, int y, const int color[4], uint delta)
+{
+    uint16* pDst = reinterpret_cast<uint16*>(target.pBuffer) + (static_cast<size_t>(y - target.firstRow) * target.bufferWidth + x) * 4;
+    for (int i = 0; i < 4; ++i)
+    {
+        const uint16 value = static_cast<uint16>(static_cast<uint>(color[i]) * delta);
+        if (target.atomic)
+        {
+            InterlockedAdd16(pDst + i, value);
+        }
+        else
+        {
+            pDst[i] = static_cast<uint16>(pDst[i] + value);
+        }
+    }
+}
+
+static void AddToBuffer(const SETUP_TARGET& target, int x, int y, const int color[4], int deltaValue)
+{
+    const uint delta = static_cast<uint>(deltaValue);
+    if (target.compact)
+    {
+        AddToCompactBuffer(target, x, y, color, delta);
+        return;
+    }
+
+    uint4& dst = target.pBuffer[(y - target.firstRow) * target.bufferWidth + x];
+
+    // deltas are accumulated modulo 2^32 exactly like the InterlockedAdd on the GPU,
+    // so the sum does not depend on the order in which the threads add them
+    if (target.atomic)
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            InterlockedAdd(&dst.v[i], static_cast<uint>(color[i]) * delta);
+        }
+    }
+    else
+    {
+        dst.x += static_cast<uint>(color[0]) * delta;
+        dst.y += static_cast<uint>(color[1]) * delta;
+        dst.z += static_cast<uint>(color[2]) * delta;
+        dst.w += static_cast<uint>(color[3]) * delta;
+    }
+}
+
+// Tall ovals squeeze the x axis. Tangential ones squeeze the axis along which the pixel is farther
+// from the center of the grid it is scattered in.
+static bool SqueezesX(const SETUP_TARGET& target, int x, int y)
+{
+    switch (target.orientation)
+    {
+    case DEPTHOFFIELDFX_CPU_BOKEH_ORIENTATION_HORIZONTAL:
+        return false;
+    case DEPTHOFFIELDFX_CPU_BOKEH_ORIENTATION_TANGENTIAL:
+        return abs(2 * x + 1 - target.gridWidth) >= abs(2 * y + 1 - target.gridHeight);
+    default:
+        return true;
+    }
+}
+
+// coverage scales the weight of the kernel, the fraction of a pyramid level pixel its pixels cover,
+// layerColumn offsets the deltas into the layer of the buffer they belong to
+static void WriteDelta(const SETUP_TARGET& target, const float color[3], float coverage, int blur_radius, int layerColumn, int x, int y)
+{
+    const DEPTHOFFIELDFX_KERNEL& kernel   = *target.pKernel;
+    const int*                   offsetsX = kernel.m_offsets[blur_radius];
+    const int*                   offsetsY = offsetsX;
+    float                        weight   = kernel.m_weights[blur_radius];
+    if (target.anamorphic)
+    {
+        // the integer sum of the oval is the product of the sums of its axes, the box keeps the weight of its larger radius
+        const int squeezed = target.squeezedRadii[blur_radius];
+        if (SqueezesX(target, x, y))
+        {
+            offsetsX = kernel.m_offsets[squeezed];
+        }
+        else
+        {
+            offsetsY = kernel.m_offsets[squeezed];
+        }
+        if (kernel.m_desc.m_normalizedAxes == 2)
+        {
+            weight = kernel.m_axisWeights[blur_radius] * kernel.m_axisWeights[squeezed];
+        }
+    }
+    const float normalization = target.scaleFactor * coverage / weight;
+
+    const int intColor[4] = { FloatToInt(color[0] * normalization), FloatToInt(color[1] * normalization), FloatToInt(color[2] * normalization), FloatToInt(normalization) };
+
+    const int bufX = x - target.region.x + target.padding + layerColumn;
+    const int bufY = y - target.region.y + target.padding;
+    for (uint i = 0; i < kernel.m_tapCount; ++i)
+    {
+        const DEPTHOFFIELDFX_KERNEL_TAP& tap = kernel.m_taps[i];
+        AddToBuffer(target, bufX + offsetsX[tap.m_x], bufY + offsetsY[tap.m_y], intColor, tap.m_weight);
+    }
+}
+
+static void FastFilterSetup(const DEPTHOFFIELDFX_CPU_DESC& desc, const SETUP_TARGET& target, int x, int y)
+{
+    float color[3];
+    LoadColor(desc.m_color, x, y, color);
+    const float coc         = SampleCoc(desc, target.pCocParams, x, y);
+    const int   blur_radius = CocToBlurRadius(coc, target.maxBlurRadius);
+
+    // the circle of confusion is negative in front of the focus plane
+    WriteDelta(target, color, 1.0f, blur_radius, (coc < 0.0f) ? target.nearLayerColumn : 0, x, y);
+}
+
+// (x, y) is a pixel of the half resolution buffer, it gathers the 2x2 quad at (2x, 2y) of the source.
+// The texel order matches Gather: (0,1), (1,1), (1,0), (0,0).
+static void QuarterResFastFilterSetup(const DEPTHOFFIELDFX_CPU_DESC& desc, const SETUP_TARGET& target, int x, int y)
+{
+    static const int s_gatherOffsets[4][2] = { { 0, 1 }, { 1, 1 }, { 1, 0 }, { 0, 0 } };
+
+    const int width  = static_cast<int>(desc.m_screenSize.x);
+    const int height = static_cast<int>(desc.m_screenSize.y);
+
+    float coc[4];
+    float color[4][3];
+    float weight = 0.0f;
+    for (int i = 0; i < 4; ++i)
+    {
+        // clamp addressing, like the point sampler
+        const int texelX = MIN(2 * x + s_gatherOffsets[i][0], width - 1);
+        const int texelY = MIN(2 * y + s_gatherOffsets[i][1], height - 1);
+        coc[i]           = fabsf(SampleCoc(desc, target.pCocParams, texelX, texelY));
+        LoadColor(desc.m_color, texelX, texelY, color[i]);
+        weight += (2.0f < coc[i]) ? 1.0f : 0.0f;
+    }
+
+    // The in focus texels of a partly blurred quad are left to the composite at full resolution,
+    // they would otherwise bleed into the blur. A quad in focus is scattered as a whole.
+    const float inFocus = (weight > 0.0f) ? 0.0f : 1.0f;
+    weight              = MAX(weight, 4.0f * inFocus);
+
+    float fcoc       = 0.0f;
+    float average[3] = { 0.0f, 0.0f, 0.0f };
+    for (int i = 0; i < 4; ++i)
+    {
+        const float mask = ((2.0f < coc[i]) ? 1.0f : 0.0f) + inFocus;
+        fcoc             = MAX(fcoc, coc[i] * mask);
+        average[0] += color[i][0] * mask;
+        average[1] += color[i][1] * mask;
+        average[2] += color[i][2] * mask;
+    }
+    average[0] /= weight;
+    average[1] /= weight;
+    average[2] /= weight;
+
+    // the circle of confusion is in full resolution pixels
+    WriteDelta(target, average, 1.0f, CocToBlurRadius(0.5f * fcoc, target.maxBlurRadius), 0, x, y);
+    target.pQuadCoc[(y - target.region.y) * target.region.width + (x - target.region.x)] = fcoc;
+}
+
+// (x, y) is a pixel of the pyramid level of the target. The full resolution level scatters the pixels
+// FastFilterSetup would with a blur radius up to the level radius, the coarser levels the squares they built.
+static void PyramidFastFilterSetup(const DEPTHOFFIELDFX_CPU_DESC& desc, const SETUP_TARGET& target, int x, int y)
+{
+    const DEPTHOFFIELDFX_CPU_OPAQUE_DESC::PYRAMID_LEVEL* pLevel = target.pPyramidLevel;
+    if (pLevel == nullptr)
+    {
+        const int blur_radius = CocToBlurRadius(SampleCoc(desc, target.pCocParams, x, y), target.frameBlurRadius);
+        if (blur_radius <= target.maxBlurRadius)
+        {
+            float color[3];
+            LoadColor(desc.m_color, x, y, color);
+            WriteDelta(target, color, 1.0f, blur_radius, 0, x, y);
+        }
+        return;
+    }
+
+    // squares without a pixel of the level have no coverage and would only scatter zeros
+    const size_t texel   = static_cast<size_t>(y) * pLevel->width + x;
+    const float* pSource = &pLevel->source[texel * 4];
+    if (pSource[3] > 0.0f)
+    {
+        WriteDelta(target, pSource, pSource[3], pLevel->blurRadius[texel], 0, x, y);
+    }
+}
+
+static float LinearToSRGB(float linColor) { return powf(fabsf(linColor), 1.0f / 2.2f); }
+
+// first lane of element index of a buffer holding 32 bit or compact 16 bit elements
+static uint* ElementAt(const uint4* pBuffer, size_t index, bool compact) { return const_cast<uint*>(pBuffer[0].v) + index * (compact ? 2 : 4); }
+
+static size_t ElementBytes(bool compact) { return compact ? 4 * sizeof(uint16) : sizeof(uint4); }
+
+// the integrated lanes are signed
+static void LoadElement(const uint4* pBuffer, size_t index, bool compact, float value[4])
+{
+    if (compact)
+    {
+        const uint16* pLanes = reinterpret_cast<const uint16*>(ElementAt(pBuffer, index, true));
+        for (int i = 0; i < 4; ++i)
+        {
+            value[i] = static_cast<float>(static_cast<int16>(pLanes[i]));
+        }
+    }
+    else
+    {
+        const uint* pLanes = ElementAt(pBuffer, index, false);
+        for (int i = 0; i < 4; ++i)
+        {
+            value[i] = static_cast<float>(static_cast<int>(pLanes[i]));
+        }
+    }
+}
+
+// Adds the bilinear sample of the accumulation of a pyramid level at pixel (x, y) of the level below.
+// The level pixel centers sit between two pixels below, like the half resolution ones of the quarter res mode.
+static void AddPyramidUpsample(const DEPTHOFFIELDFX_CPU_OPAQUE_DESC::PYRAMID_LEVEL& level, int x, int y, float value[4])
+{
+    const int   x0      = (x + 1) / 2 - 1;
+    const int   y0      = (y + 1) / 2 - 1;
+    const float weightX = (x & 1) ? 0.25f : 0.75f;
+    const float weightY = (y & 1) ? 0.25f : 0.75f;
+    for (int i = 0; i < 4; ++i)
+    {
+        const int    texelX = MIN(MAX(x0 + (i & 1), 0), level.width - 1);
+        const int    texelY = MIN(MAX(y0 + (i >> 1), 0), level.height - 1);
+        const float  weight = ((i & 1) ? weightX : 1.0f - weightX) * ((i >> 1) ? weightY : 1.0f - weightY);
+        const float* pTexel = &level.accumulation[(static_cast<size_t>(texelY) * level.width + texelX) * 4];
+        value[0] += pTexel[0] * weight;
+        value[1] += pTexel[1] * weight;
+        value[2] += pTexel[2] * weight;
+        value[3] += pTexel[3] * weight;
+    }
+}
+
+// kernels with a squeezed radius on one axis
+static bool IsAnamorphic(const DEPTHOFFIELDFX_CPU_DESC& desc) { return desc.m_anamorphicSqueeze > 1.0f; }
+
+// the full resolution modes scatter the near and far field into the two layers of the buffer
+static bool IsLayered(const DEPTHOFFIELDFX_CPU_DESC& desc, DEPTHOFFIELDFX_CPU_OPAQUE_DESC::SETUP_MODE mode)
+{
+    return desc.m_layered && ((mode == DEPTHOFFIELDFX_CPU_OPAQUE_DESC::SETUP_MODE_BARTLETT) || (mode == DEPTHOFFIELDFX_CPU_OPAQUE_DESC::SETUP_MODE_BOX));
+}
+
+// the kernel DepthOfFieldFX_Render scatters
+static DEPTHOFFIELDFX_KERNEL_TYPE RenderKernelType(const DEPTHOFFIELDFX_CPU_DESC& desc)
+{
+    return (desc.m_kernel == DEPTHOFFIELDFX_CPU_KERNEL_QUADRATIC_BSPLINE) ? DEPTHOFFIELDFX_KERNEL_TYPE_QUADRATIC_BSPLINE : DEPTHOFFIELDFX_KERNEL_TYPE_BARTLETT;
+}
+
+// the box mode scatters the box, the full resolution Bartlett mode the kernel of desc and every other mode the Bartlett
+static DEPTHOFFIELDFX_KERNEL_TYPE SetupKernelType(const DEPTHOFFIELDFX_CPU_DESC& desc, DEPTHOFFIELDFX_CPU_OPAQUE_DESC::SETUP_MODE mode)
+{
+    switch (mode)
+    {
+    case DEPTHOFFIELDFX_CPU_OPAQUE_DESC::SETUP_MODE_BARTLETT:
+        return RenderKernelType(desc);
+    case DEPTHOFFIELDFX_CPU_OPAQUE_DESC::SETUP_MODE_BOX:
+        return DEPTHOFFIELDFX_KERNEL_TYPE_BOX;
+    default:
+        return DEPTHOFFIELDFX_KERNEL_TYPE_BARTLETT;
+    }
+}
+
+static const DEPTHOFFIELDFX_KERNEL& SetupKernel(const DEPTHOFFIELDFX_CPU_DESC& desc, DEPTHOFFIELDFX_CPU_OPAQUE_DESC::SETUP_MODE mode) { return GetKernel(SetupKernelType(desc, mode)); }
+
+// scatter the rows [y0, y1) of the target region, relative to its top
+static void ScatterRows(const DEPTHOFFIELDFX_CPU_DESC& desc, const SETUP_TARGET& target, DEPTHOFFIELDFX_CPU_OPAQUE_DESC::SETUP_MODE mode, int y0, int y1)
+{
+    const int x0 = target.region.x;
+    const int x1 = target.region.x + target.region.width;
+
+    for (int y = target.region.y + y0; y < target.region.y + y1; ++y)
+    {
+        for (int x = x0; x < x1; ++x)
+        {
+            switch (mode)
+            {
+            case DEPTHOFFIELDFX_CPU_OPAQUE_DESC::SETUP_MODE_BARTLETT:
+            case DEPTHOFFIELDFX_CPU_OPAQUE_DESC::SETUP_MODE_BOX:
+                FastFilterSetup(desc, target, x, y);
+                break;
+            case DEPTHOFFIELDFX_CPU_OPAQUE_DESC::SETUP_MODE_BARTLETT_QUARTER_RES:
+                QuarterResFastFilterSetup(desc, target, x, y);
+                break;
+            case DEPTHOFFIELDFX_CPU_OPAQUE_DESC::SETUP_MODE_PYRAMID:
+                PyramidFastFilterSetup(desc, target, x, y);
+                break;
+            }
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Tiling
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// smallest tile DepthOfFieldFX_Resize falls back to before giving up on the memory budget
+static const int s_minTileSize = 16;
+
+// Source row y scatters into buffer rows [y + 2, y + 2 * padding], one more for the quarter res quads.
+static int ScatterHaloRows(int padding) { return 2 * padding; }
+static const int s_scatterFirstRow = 2;
+
+// band heights have to be even so the quarter res quads do not straddle two bands
+static int EvenBandHeight(int height, int bandCount) { return ((height + bandCount - 1) / bandCount + 1) & ~1; }
+
+// one band per thread for the tallest source region, smaller regions use fewer bands of the same height
+static int PlaneBandHeight(int sourceHeight, uint threadCount) { return EvenBandHeight(sourceHeight, MIN(static_cast<int>(threadCount), MAX(sourceHeight / 2, 1))); }
+
+// Every kernel reaches no farther from its source than the padding, so the sources within that
+// halo of a tile are all that contribute to it. The deltas of the others cancel out exactly once
+// integrated, which keeps the tiled result bit exact. The region is aligned to the 2x2 quads of the
+// quarter res setup.
+static DEPTHOFFIELDFX_CPU_OPAQUE_DESC::REGION SourceRegion(const DEPTHOFFIELDFX_CPU_OPAQUE_DESC::REGION& tile, int width, int height, int halo)
+{
+    const int x0 = MAX(tile.x - halo, 0) & ~1;
+    const int y0 = MAX(tile.y - halo, 0) & ~1;
+    const int x1 = MIN((tile.x + tile.width + halo + 1) & ~1, width);
+    const int y1 = MIN((tile.y + tile.height + halo + 1) & ~1, height);
+
+    DEPTHOFFIELDFX_CPU_OPAQUE_DESC::REGION region = { x0, y0, x1 - x0, y1 - y0 };
+    return region;
+}
+
+// largest source region of any tile, in one dimension
+static int MaxSourceExtent(int size, int tileSize, int halo) { return MIN(tileSize + 2 * halo + 2, size); }
+
+// the quarter res mode scatters with half the blur radius into a half resolution buffer
+static int LayoutBlurRadius(int maxBlurRadius, bool halfRes) { return halfRes ? (maxBlurRadius + 1) / 2 : maxBlurRadius; }
+
+// The padding holds the taps from padding - 2 pixels before a pixel to padding pixels after it, the blur
+// radius plus 2 for the Bartlett and the box. The last taps of the quadratic B-spline land up to 3 pixels
+// farther, the full resolution layouts pad for the kernel of desc.
+static int LayoutPadding(const DEPTHOFFIELDFX_CPU_DESC& desc, int maxBlurRadius, bool halfRes)
+{
+    const int                    blurRadius = LayoutBlurRadius(maxBlurRadius, halfRes);
+    const DEPTHOFFIELDFX_KERNEL& kernel     = GetKernel(halfRes ? DEPTHOFFIELDFX_KERNEL_TYPE_BARTLETT : RenderKernelType(desc));
+    return MAX(blurRadius + 2, kernel.m_reach[blurRadius]);
+}
+
+// A full resolution pixel of the quarter res mode is upsampled from the half resolution pixels next to it,
+// so the halo also covers the quads that reach those.
+static int TileHalo(const DEPTHOFFIELDFX_CPU_DESC& desc, int maxBlurRadius, bool halfRes)
+{
+    const int padding = LayoutPadding(desc, maxBlurRadius, halfRes);
+    return halfRes ? 2 * padding + 4 : padding;
+}
+
+static DEPTHOFFIELDFX_CPU_OPAQUE_DESC::TILE_LAYOUT MakeTileLayout(const DEPTHOFFIELDFX_CPU_DESC& desc, const DEPTHOFFIELDFX_CPU_OPAQUE_DESC::REGION& source, int maxBlurRadius, bool halfRes, bool layered)
+{
+    DEPTHOFFIELDFX_CPU_OPAQUE_DESC::TILE_LAYOUT layout;
+    layout.source        = source;
+    layout.bufferRegion  = source;
+    layout.maxBlurRadius = LayoutBlurRadius(maxBlurRadius, halfRes);
+    layout.padding       = LayoutPadding(desc, maxBlurRadius, halfRes);
+    layout.halfRes       = halfRes;
+    layout.layered       = layered;
+    if (halfRes)
+    {
+        // the source region starts on a quad, an odd edge of the image ends in a partial one
+        layout.bufferRegion.x      = source.x / 2;
+        layout.bufferRegion.y      = source.y / 2;
+        layout.bufferRegion.width  = (source.width + 1) / 2;
+        layout.bufferRegion.height = (source.height + 1) / 2;
+    }
+    return layout;
+}
+
+static DEPTHOFFIELDFX_CPU_OPAQUE_DESC::TILE_LAYOUT GetTileLayout(const DEPTHOFFIELDFX_CPU_DESC& desc, const DEPTHOFFIELDFX_CPU_OPAQUE_DESC::REGION& tile, int width, int height, int maxBlurRadius, bool halfRes, bool layered)
+{
+    return MakeTileLayout(desc, SourceRegion(tile, width, height, TileHalo(desc, maxBlurRadius, halfRes)), maxBlurRadius, halfRes, layered);
+}
+
+// the layout of a tile with the largest source extent in both dimensions
+static DEPTHOFFIELDFX_CPU_OPAQUE_DESC::TILE_LAYOUT GetMaxTileLayout(const DEPTHOFFIELDFX_CPU_DESC& desc, int width, int height, int maxBlurRadius, int tileSize, bool halfRes, bool layered)
+{
+    const int                                    halo   = TileHalo(desc, maxBlurRadius, halfRes);
+    const DEPTHOFFIELDFX_CPU_OPAQUE_DESC::REGION source = { 0, 0, MaxSourceExtent(width, tileSize, halo), MaxSourceExtent(height, tileSize, halo) };
+    return MakeTileLayout(desc, source, maxBlurRadius, halfRes, layered);
+}
+
+// levels of DepthOfFieldFX_RenderPyramid at DEPTHOFFIELDFX_CPU_PYRAMID_MAX_BLUR_RADIUS, the full resolution one included
+static const int s_maxPyramidLevels = 6;
+
+// the blur radius every level of the pyramid is scattered with
+static int PyramidLevelRadius(int maxBlurRadius) { return MIN(maxBlurRadius, static_cast<int>(DEPTHOFFIELDFX_CPU_PYRAMID_LEVEL_RADIUS)); }
+
+// the first level a blur radius scaled down by 2^level fits the level radius at
+static int PyramidLevel(int blurRadius)
+{
+    int level = 0;
+    while (blurRadius > (static_cast<int>(DEPTHOFFIELDFX_CPU_PYRAMID_LEVEL_RADIUS) << level))
+    {
+        ++level;
+    }
+    return level;
+}
+
+static int PyramidLevelCount(int maxBlurRadius) { return PyramidLevel(maxBlurRadius) + 1; }
+
+// a pixel of a level covers a 2^level square of the frame, the squares on the right and bottom edge may be partial
+static int PyramidLevelSize(int size, int level) { return (size + (1 << level) - 1) >> level; }
+
+// Without m_pyramid the buffers hold the layout of m_maxBlurRadius. The pyramid needs the one of the level
+// radius, which fits in it, so the buffers only shrink for blur radii the other render calls cannot take.
+static int AllocationBlurRadius(const DEPTHOFFIELDFX_CPU_DESC& desc)
+{
+    const int maxBlurRadius = static_cast<int>(desc.m_maxBlurRadius);
+    return (maxBlurRadius > 64) ? PyramidLevelRadius(maxBlurRadius) : maxBlurRadius;
+}
+
+// A pixel is blurred with a blur radius of at least 1. In focus pixels scatter to themselves alone.
+// The quarter res upsample blends a full resolution pixel with the blur from a circle of confusion of 1 up.
+static bool IsDefocused(float coc, int maxBlurRadius, bool halfRes) { return halfRes ? (fabsf(coc) > 1.0f) : (CocToBlurRadius(coc, maxBlurRadius) > 0); }
+
+// x, y, width and height bounds clamped to the frame
+static DEPTHOFFIELDFX_CPU_OPAQUE_DESC::REGION ClampBounds(const DEPTHOFFIELDFX_CPU_DESC& desc, const DEPTHOFFIELDFX_CPU_DESC::uint4& bounds)
+{
+    const uint64 x0 = MIN(static_cast<uint64>(bounds.x), static_cast<uint64>(desc.m_screenSize.x));
+    const uint64 y0 = MIN(static_cast<uint64>(bounds.y), static_cast<uint64>(desc.m_screenSize.y));
+    const uint64 x1 = MIN(static_cast<uint64>(bounds.x) + bounds.z, static_cast<uint64>(desc.m_screenSize.x));
+    const uint64 y1 = MIN(static_cast<uint64>(bounds.y) + bounds.w, static_cast<uint64>(desc.m_screenSize.y));
+
+    DEPTHOFFIELDFX_CPU_OPAQUE_DESC::REGION region = { static_cast<int>(x0), static_cast<int>(y0), static_cast<int>(x1 - x0), static_cast<int>(y1 - y0) };
+    return region;
+}
+
+// bounds of the blurred pixels plus the halo of pixels their kernels reach, empty if there are none
+static DEPTHOFFIELDFX_CPU_OPAQUE_DESC::REGION DilateBounds(const DEPTHOFFIELDFX_CPU_DESC& desc, const DEPTHOFFIELDFX_CPU_OPAQUE_DESC::REGION& bounds, int maxBlurRadius, bool halfRes)
+{
+    const DEPTHOFFIELDFX_CPU_OPAQUE_DESC::REGION empty = { 0, 0, 0, 0 };
+    if ((bounds.width <= 0) || (bounds.height <= 0))
+    {
+        return empty;
+    }
+
+    const int halo = TileHalo(desc, maxBlurRadius, halfRes);
+    const int x0   = MAX(bounds.x - halo, 0);
+    const int y0   = MAX(bounds.y - halo, 0);
+    const int x1   = MIN(bounds.x + bounds.width + halo, static_cast<int>(desc.m_screenSize.x));
+    const int y1   = MIN(bounds.y + bounds.height + halo, static_cast<int>(desc.m_screenSize.y));
+
+    const DEPTHOFFIELDFX_CPU_OPAQUE_DESC::REGION region = { x0, y0, x1 - x0, y1 - y0 };
+    return region;
+}
+
+// Blur radius of a circle of confusion for the statistics. NaNs and values too large to convert
+// count as the largest radius, like the padding the passes would need without statistics.
+static int StatisticsBlurRadius(float coc, int maxBlurRadius) { return (fabsf(coc) < 65.0f) ? CocToBlurRadius(coc, maxBlurRadius) : maxBlurRadius; }
+
+static DEPTHOFFIELDFX_CPU_COC_TILE_CLASS CocTileClass(int blurRadius)
+{
+    if (blurRadius == 0)
+    {
+        return DEPTHOFFIELDFX_CPU_COC_TILE_CLASS_SHARP;
+    }
+    return (blurRadius <= static_cast<int>(DEPTHOFFIELDFX_CPU_COC_SMALL_BLUR_RADIUS)) ? DEPTHOFFIELDFX_CPU_COC_TILE_CLASS_SMALL_BLUR : DEPTHOFFIELDFX_CPU_COC_TILE_CLASS_LARGE_BLUR;
+}
+
+// The deltas of a kernel integrate to exactly 0 past its reach, which the padding covers, so the
+// integration sweeps across both layers of a layered buffer without mixing them.
+static uint LayerWidth(const DEPTHOFFIELDFX_CPU_OPAQUE_DESC::TILE_LAYOUT& layout) { return static_cast<uint>(layout.bufferRegion.width + 2 * layout.padding); }
+static uint BufferWidth(const DEPTHOFFIELDFX_CPU_OPAQUE_DESC::TILE_LAYOUT& layout) { return LayerWidth(layout) * (layout.layered ? 2 : 1); }
+static uint BufferHeight(const DEPTHOFFIELDFX_CPU_OPAQUE_DESC::TILE_LAYOUT& layout) { return static_cast<uint>(layout.bufferRegion.height + 2 * layout.padding); }
+
+// the private planes keep the band height of the largest tile, smaller tiles use fewer bands
+static int    PlaneCount(const DEPTHOFFIELDFX_CPU_OPAQUE_DESC::TILE_LAYOUT& layout, int bandHeight) { return (layout.bufferRegion.height + bandHeight - 1) / bandHeight; }
+static size_t PlaneElements(const DEPTHOFFIELDFX_CPU_OPAQUE_DESC::TILE_LAYOUT& layout, int bandHeight)
+{
+    return static_cast<size_t>(bandHeight + ScatterHaloRows(layout.padding)) * BufferWidth(layout);
+}
+
+// What resize() allocates for a tile size. Without m_quarterResOnly the buffers have to hold the
+// full resolution layout of Render and RenderBox as well as the half resolution one.
+struct DEPTHOFFIELDFX_CPU_ALLOCATION
+{
+    size_t bufferElements;
+    size_t transposedElements;
+    size_t planeCount;
+    size_t planeElements;
+    size_t quadCocElements;
+    int    pyramidWidth[s_maxPyramidLevels];
+    int    pyramidHeight[s_maxPyramidLevels];
+};
+
+static size_t PyramidTexels(const DEPTHOFFIELDFX_CPU_ALLOCATION& allocation, int level) { return static_cast<size_t>(allocation.pyramidWidth[level]) * allocation.pyramidHeight[level]; }
+
+// bytes of a texel of a pyramid level, the source and accumulation are four floats
+static size_t PyramidTexelBytes() { return 8 * sizeof(float) + sizeof(uint8); }
+
+static DEPTHOFFIELDFX_CPU_ALLOCATION GetAllocation(const DEPTHOFFIELDFX_CPU_DESC& desc, uint threadCount, int tileSize)
+{
+    const int width         = static_cast<int>(desc.m_screenSize.x);
+    const int height        = static_cast<int>(desc.m_screenSize.y);
+    const int maxBlurRadius = AllocationBlurRadius(desc);
+
+    DEPTHOFFIELDFX_CPU_ALLOCATION allocation;
+    memset(&allocation, 0, sizeof(allocation));
+
+    // the pyramid renders its full resolution level with the layout of Render, without the near layer
+    for (int halfRes = (desc.m_quarterResOnly && !desc.m_pyramid) ? 1 : 0; halfRes < 2; ++halfRes)
+    {
+        const DEPTHOFFIELDFX_CPU_OPAQUE_DESC::TILE_LAYOUT layout = GetMaxTileLayout(desc, width, height, maxBlurRadius, tileSize, halfRes != 0, desc.m_layered && (halfRes == 0));
+
+        allocation.bufferElements = MAX(allocation.bufferElements, static_cast<size_t>(BufferWidth(layout)) * BufferHeight(layout));
+        if (desc.m_scatterMode == DEPTHOFFIELDFX_CPU_SCATTER_MODE_PRIVATE_PLANES)
+        {
+            const int bandHeight     = PlaneBandHeight(layout.bufferRegion.height, threadCount);
+            allocation.planeCount    = MAX(allocation.planeCount, static_cast<size_t>(PlaneCount(layout, bandHeight)));
+            allocation.planeElements = MAX(allocation.planeElements, PlaneElements(layout, bandHeight));
+        }
+        if (layout.halfRes)
+        {
+            allocation.quadCocElements = static_cast<size_t>(layout.bufferRegion.width) * layout.bufferRegion.height;
+        }
+    }
+
+    if (desc.m_transposeMode != DEPTHOFFIELDFX_CPU_TRANSPOSE_MODE_IN_PLACE)
+    {
+        allocation.transposedElements = allocation.bufferElements;
+    }
+
+    // the full resolution level is the frame
+    const int levelCount = desc.m_pyramid ? PyramidLevelCount(static_cast<int>(desc.m_maxBlurRadius)) : 0;
+    for (int level = 1; level < levelCount; ++level)
+    {
+        allocation.pyramidWidth[level]  = PyramidLevelSize(width, level);
+        allocation.pyramidHeight[level] = PyramidLevelSize(height, level);
+    }
+    return allocation;
+}
+
+static uint64 PyramidBytes(const DEPTHOFFIELDFX_CPU_ALLOCATION& allocation)
+{
+    uint64 bytes = 0;
+    for (int level = 0; level < s_maxPyramidLevels; ++level)
+    {
+        bytes += static_cast<uint64>(PyramidTexels(allocation, level)) * PyramidTexelBytes();
+    }
+    return bytes;
+}
+
+static uint64 AllocationBytes(const DEPTHOFFIELDFX_CPU_ALLOCATION& allocation)
+{
+    return static_cast<uint64>(allocation.bufferElements + allocation.transposedElements + allocation.planeCount * allocation.planeElements) * sizeof(uint4)
+           + static_cast<uint64>(allocation.quadCocElements) * sizeof(float) + PyramidBytes(allocation);
+}
+
+template <class T> static uint64 KeptBytes(const std::vector<T>& buffer, size_t count) { return static_cast<uint64>(MAX(buffer.capacity(), count)) * sizeof(T); }
+
+// bytes the buffers hold after a resize to allocation that keeps them, their capacity for an empty allocation
+static uint64 KeptBytes(const DEPTHOFFIELDFX_CPU_OPAQUE_DESC& opaque, const DEPTHOFFIELDFX_CPU_ALLOCATION& allocation)
+{
+    uint64 bytes = KeptBytes(opaque.m_intermediateBuffer, allocation.bufferElements) + KeptBytes(opaque.m_intermediateBufferTransposed, allocation.transposedElements)
+                   + KeptBytes(opaque.m_quadCoc, allocation.quadCocElements);
+    for (size_t i = 0; i < MAX(opaque.m_scatterPlanes.size(), allocation.planeCount); ++i)
+    {
+        const size_t planeElements = (i < allocation.planeCount) ? allocation.planeElements : 0;
+        bytes += (i < opaque.m_scatterPlanes.size()) ? KeptBytes(opaque.m_scatterPlanes[i], planeElements) : planeElements * sizeof(uint4);
+    }
+    for (int level = 0; level < s_maxPyramidLevels; ++level)
+    {
+        const size_t texels = PyramidTexels(allocation, level);
+        if (static_cast<size_t>(level) < opaque.m_pyramidLevels.size())
+        {
+            const DEPTHOFFIELDFX_CPU_OPAQUE_DESC::PYRAMID_LEVEL& pyramidLevel = opaque.m_pyramidLevels[level];
+            bytes += KeptBytes(pyramidLevel.source, texels * 4) + KeptBytes(pyramidLevel.blurRadius, texels) + KeptBytes(pyramidLevel.accumulation, texels * 4);
+        }
+        else
+        {
+            bytes += texels * PyramidTexelBytes();
+        }
+    }
+    return bytes;
+}
+
+// keeps the allocation of buffer if count elements fit in it, unless it is trimmed
+template <class T> static void ReserveElements(std::vector<T>& buffer, size_t count, bool trim)
+{
+    if ((count > buffer.capacity()) || (trim && (count < buffer.capacity())))
+    {
+        // release the old buffer first so the peak footprint does not double
+        std::vector<T>().swap(buffer);
+    }
+    buffer.resize(count);
+}
+
+// planes past the ones in use are emptied but keep their memory like the other buffers
+static void ReserveBuffers(DEPTHOFFIELDFX_CPU_OPAQUE_DESC& opaque, const DEPTHOFFIELDFX_CPU_ALLOCATION& allocation, bool trim)
+{
+    ReserveElements(opaque.m_intermediateBuffer, allocation.bufferElements, trim);
+    ReserveElements(opaque.m_intermediateBufferTransposed, allocation.transposedElements, trim);
+    ReserveElements(opaque.m_quadCoc, allocation.quadCocElements, trim);
+
+    opaque.m_scatterPlanes.resize(MAX(opaque.m_scatterPlanes.size(), allocation.planeCount));
+    for (size_t i = 0; i < opaque.m_scatterPlanes.size(); ++i)
+    {
+        ReserveElements(opaque.m_scatterPlanes[i], (i < allocation.planeCount) ? allocation.planeElements : 0, trim);
+    }
+
+    opaque.m_pyramidLevels.resize(s_maxPyramidLevels);
+    for (int level = 0; level < s_maxPyramidLevels; ++level)
+    {
+        DEPTHOFFIELDFX_CPU_OPAQUE_DESC::PYRAMID_LEVEL& pyramidLevel = opaque.m_pyramidLevels[level];
+        const size_t                                   texels       = PyramidTexels(allocation, level);
+
+        pyramidLevel.width  = allocation.pyramidWidth[level];
+        pyramidLevel.height = allocation.pyramidHeight[level];
+        ReserveElements(pyramidLevel.source, texels * 4, trim);
+        ReserveElements(pyramidLevel.blurRadius, texels, trim);
+        ReserveElements(pyramidLevel.accumulation, texels * 4, trim);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Incremental rendering
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Multiplicative hash of 8 bytes at a time with a final avalanche, only compared against the hash
+// of the same tile in the previous frame.
+static uint64 HashBytes(uint64 hash, const void* pData, size_t size)
+{
+    const uint64 prime = 0x9e3779b97f4a7c15ull;
+    const uint8* pByte = static_cast<const uint8*>(pData);
+    for (; size >= 8; size -= 8, pByte += 8)
+    {
+        uint64 word;
+        memcpy(&word, pByte, 8);
+        hash = (((hash << 5) | (hash >> 59)) ^ word) * prime;
+    }
+    for (; size > 0; --size, ++pByte)
+    {
+        hash = (((hash << 5) | (hash >> 59)) ^ *pByte) * prime;
+    }
+    return hash;
+}
+
+static uint64 FinishHash(uint64 hash)
+{
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ull;
+    return hash ^ (hash >> 33);
+}
+
+// hash of the rows of an image under a region
+static uint64 HashImage(uint64 hash, const DEPTHOFFIELDFX_CPU_IMAGE& image, const DEPTHOFFIELDFX_CPU_OPAQUE_DESC::REGION& region)
+{
+    const uint texelSize = TexelSize(image.m_format);
+    for (int y = region.y; y < region.y + region.height; ++y)
+    {
+        hash = HashBytes(hash, GetTexel(image, region.x, y, texelSize), static_cast<size_t>(region.width) * texelSize);
+    }
+    return hash;
+}
+
+// the pixels of both regions, normalized to { 0, 0, 0, 0 } if there are none
+static DEPTHOFFIELDFX_CPU_OPAQUE_DESC::REGION IntersectRegions(const DEPTHOFFIELDFX_CPU_OPAQUE_DESC::REGION& a, const DEPTHOFFIELDFX_CPU_OPAQUE_DESC::REGION& b)
+{
+    const int x0 = MAX(a.x, b.x);
+    const int y0 = MAX(a.y, b.y);
+    const int x1 = MIN(a.x + a.width, b.x + b.width);
+    const int y1 = MIN(a.y + a.height, b.y + b.height);
+
+    const DEPTHOFFIELDFX_CPU_OPAQUE_DESC::REGION empty  = { 0, 0, 0, 0 };
+    const DEPTHOFFIELDFX_CPU_OPAQUE_DESC::REGION region = { x0, y0, x1 - x0, y1 - y0 };
+    return ((x1 > x0) && (y1 > y0)) ? region : empty;
+}
+
+// bounding rectangle of two regions, an empty one is ignored
+static DEPTHOFFIELDFX_CPU_OPAQUE_DESC::REGION UniteRegions(const DEPTHOFFIELDFX_CPU_OPAQUE_DESC::REGION& a, const DEPTHOFFIELDFX_CPU_OPAQUE_DESC::REGION& b)
+{
+    if ((a.width <= 0) || (a.height <= 0))
+    {
+        return b;
+    }
+    if ((b.width <= 0) || (b.height <= 0))
+    {
+        return a;
+    }
+
+    const int x0 = MIN(a.x, b.x);
+    const int y0 = MIN(a.y, b.y);
+
+    const DEPTHOFFIELDFX_CPU_OPAQUE_DESC::REGION region = { x0, y0, MAX(a.x + a.width, b.x + b.width) - x0, MAX(a.y + a.height, b.y + b.height) - y0 };
+    return region;
+}
+
+static bool SameRegion(const DEPTHOFFIELDFX_CPU_OPAQUE_DESC::REGION& a, const DEPTHOFFIELDFX_CPU_OPAQUE_DESC::REGION& b)
+{
+    return (a.x == b.x) && (a.y == b.y) && (a.width == b.width) && (a.height == b.height);
+}
+
+// pixels the setup of a tile reads, the tile plus its halo
+static uint64 RenderCost(const DEPTHOFFIELDFX_CPU_OPAQUE_DESC::REGION& tile, int halo)
+{
+    return static_cast<uint64>(tile.width + 2 * halo) * static_cast<uint64>(tile.height + 2 * halo);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+DEPTHOFFIELDFX_CPU_OPAQUE_DESC::DEPTHOFFIELDFX_CPU_OPAQUE_DESC(const DEPTHOFFIELDFX_CPU_DESC&)
+    : m_tileSize(0)
+    , m_bufferWidth(0)
+    , m_bufferHeight(0)
+    , m_planeBandHeight(0)
+    , m_smallResizeCount(0)
+    , m_frameScaleFactor(0)
+    , m_pCocParams(nullptr)
+    , m_reuseKey(0)
+    , m_pyramidLevel(0)
+    , m_tileScaleFactor(0)
+    , m_compactTile(false)
+    , m_pIntegrateKernel(nullptr)
+    , m_pCompactIntegrateKernel(nullptr)
+{
+    memset(m_passMilliseconds, 0, sizeof(m_passMilliseconds));
+    memset(&m_cocStatistics, 0, sizeof(m_cocStatistics));
+    memset(&m_reuseActive, 0, sizeof(m_reuseActive));
+    memset(&m_reuseStatistics, 0, sizeof(m_reuseStatistics));
+    m_cocStatisticsScreenSize.x = 0;
+    m_cocStatisticsScreenSize.y = 0;
+}
+
+DEPTHOFFIELDFX_RETURN_CODE DEPTHOFFIELDFX_CPU_OPAQUE_DESC::initalize(const DEPTHOFFIELDFX_CPU_DESC& desc)
+{
+    m_pIntegrateKernel        = GetIntegrateKernel(desc.m_instructionSet);
+    m_pCompactIntegrateKernel = GetCompactIntegrateKernel(desc.m_instructionSet);
+    if (m_pIntegrateKernel == nullptr)
+    {
+        return DEPTHOFFIELDFX_RETURN_CODE_INVALID_PARAMS;
+    }
+
+    m_threadPool.initialize(desc.m_numThreads);
+    return DEPTHOFFIELDFX_RETURN_CODE_SUCCESS;
+}
+
+DEPTHOFFIELDFX_RETURN_CODE DEPTHOFFIELDFX_CPU_OPAQUE_DESC::resize(const DEPTHOFFIELDFX_CPU_DESC& desc)
+{
+    const int width  = static_cast<int>(desc.m_screenSize.x);
+    const int height = static_cast<int>(desc.m_screenSize.y);
+
+    m_tileSize = MAX(width, height);
+    if (desc.m_memoryBudget != 0)
+    {
+        m_tileSize = choose_tile_size(desc, m_threadPool.thread_count());
+        if (m_tileSize == 0)
+        {
+            return DEPTHOFFIELDFX_RETURN_CODE_INVALID_PARAMS;
+        }
+    }
+
+    const DEPTHOFFIELDFX_CPU_ALLOCATION allocation = GetAllocation(desc, m_threadPool.thread_count(), m_tileSize);
+
+    // the buffers are kept while the new footprint fits, see m_trimResizeCount
+    DEPTHOFFIELDFX_CPU_ALLOCATION capacity;
+    memset(&capacity, 0, sizeof(capacity));
+    m_smallResizeCount = (AllocationBytes(allocation) < KeptBytes(*this, capacity) / 2) ? m_smallResizeCount + 1 : 0;
+
+    // the memory budget caps the memory kept as well
+    const bool trim = ((desc.m_trimResizeCount != 0) && (m_smallResizeCount >= desc.m_trimResizeCount))
+                      || ((desc.m_memoryBudget != 0) && (KeptBytes(*this, allocation) > desc.m_memoryBudget));
+    if (trim)
+    {
+        m_smallResizeCount = 0;
+    }
+
+    ReserveBuffers(*this, allocation, trim);
+    return DEPTHOFFIELDFX_RETURN_CODE_SUCCESS;
+}
+
+DEPTHOFFIELDFX_RETURN_CODE DEPTHOFFIELDFX_CPU_OPAQUE_DESC::trim()
+{
+    DEPTHOFFIELDFX_CPU_ALLOCATION allocation;
+    allocation.bufferElements     = m_intermediateBuffer.size();
+    allocation.transposedElements = m_intermediateBufferTransposed.size();
+    allocation.quadCocElements    = m_quadCoc.size();
+    allocation.planeCount         = 0;
+    allocation.planeElements      = 0;
+    for (size_t i = 0; i < m_scatterPlanes.size(); ++i)
+    {
+        allocation.planeCount    = m_scatterPlanes[i].empty() ? allocation.planeCount : i + 1;
+        allocation.planeElements = MAX(allocation.planeElements, m_scatterPlanes[i].size());
+    }
+    for (int level = 0; level < s_maxPyramidLevels; ++level)
+    {
+        const bool allocated             = (static_cast<size_t>(level) < m_pyramidLevels.size()) && !m_pyramidLevels[level].source.empty();
+        allocation.pyramidWidth[level]  = allocated ? m_pyramidLevels[level].width : 0;
+        allocation.pyramidHeight[level] = allocated ? m_pyramidLevels[level].height : 0;
+    }
+
+    ReserveBuffers(*this, allocation, true);
+    m_scatterPlanes.resize(allocation.planeCount);
+    m_smallResizeCount = 0;
+    return DEPTHOFFIELDFX_RETURN_CODE_SUCCESS;
+}
+
+DEPTHOFFIELDFX_RETURN_CODE DEPTHOFFIELDFX_CPU_OPAQUE_DESC::render(const DEPTHOFFIELDFX_CPU_DESC& desc) { return render_passes(desc, SETUP_MODE_BARTLETT); }
+
+DEPTHOFFIELDFX_RETURN_CODE DEPTHOFFIELDFX_CPU_OPAQUE_DESC::render_quarter_res(const DEPTHOFFIELDFX_CPU_DESC& desc) { return render_passes(desc, SETUP_MODE_BARTLETT_QUARTER_RES); }
+
+DEPTHOFFIELDFX_RETURN_CODE DEPTHOFFIELDFX_CPU_OPAQUE_DESC::render_box(const DEPTHOFFIELDFX_CPU_DESC& desc) { return render_passes(desc, SETUP_MODE_BOX); }
+
+// The levels are rendered coarsest first, each one adds the sums of the one below to its own.
+DEPTHOFFIELDFX_RETURN_CODE DEPTHOFFIELDFX_CPU_OPAQUE_DESC::render_pyramid(const DEPTHOFFIELDFX_CPU_DESC& desc)
+{
+    DEPTHOFFIELDFX_RETURN_CODE result = validate(desc, SETUP_MODE_PYRAMID);
+    if (result != DEPTHOFFIELDFX_RETURN_CODE_SUCCESS)
+    {
+        return result;
+    }
+
+    const int width      = static_cast<int>(desc.m_screenSize.x);
+    const int height     = static_cast<int>(desc.m_screenSize.y);
+    const int levelCount = PyramidLevelCount(static_cast<int>(desc.m_maxBlurRadius));
+
+    // the levels use the bands of the full resolution one, the planes are sized for it
+    m_planeBandHeight = PlaneBandHeight(GetMaxTileLayout(desc, width, height, PyramidLevelRadius(static_cast<int>(desc.m_maxBlurRadius)), m_tileSize, false, false).bufferRegion.height, m_threadPool.thread_count());
+    memset(m_passMilliseconds, 0, sizeof(m_passMilliseconds));
+    set_coc_params(desc);
+
+    // the averages of the levels are no brighter than the frame and cover at most a pixel, so they share its scale factor
+    m_frameScaleFactor = desc.m_scaleFactor;
+    if (desc.m_autoScaleFactor)
+    {
+        PASS_TIMER                       timer(m_passMilliseconds[DEPTHOFFIELDFX_PASS_FAST_FILTER_SETUP]);
+        DEPTHOFFIELDFX_SCALE_FACTOR_INFO info;
+        get_scale_factor_info(desc, SETUP_MODE_PYRAMID, measure_peak_color(desc), 32, info);
+        m_frameScaleFactor = info.m_scaleFactor;
+    }
+
+    if (levelCount > 1)
+    {
+        PASS_TIMER timer(m_passMilliseconds[DEPTHOFFIELDFX_PASS_FAST_FILTER_SETUP]);
+        build_pyramid(desc, levelCount);
+    }
+
+    for (int level = levelCount - 1; level >= 0; --level)
+    {
+        render_pyramid_level(desc, level, levelCount);
+    }
+    return result;
+}
+
+DEPTHOFFIELDFX_RETURN_CODE DEPTHOFFIELDFX_CPU_OPAQUE_DESC::release()
+{
+    m_threadPool.release();
+    std::vector<uint4>().swap(m_intermediateBuffer);
+    std::vector<uint4>().swap(m_intermediateBufferTransposed);
+    std::vector<std::vector<uint4> >().swap(m_scatterPlanes);
+    std::vector<float>().swap(m_quadCoc);
+    std::vector<uint8>().swap(m_cocTileClasses);
+    std::vector<uint64>().swap(m_reuseHashes);
+    std::vector<uint8>().swap(m_reuseDirtyTiles);
+    std::vector<PYRAMID_LEVEL>().swap(m_pyramidLevels);
+    m_smallResizeCount = 0;
+    m_tileSize         = 0;
+    m_planeBandHeight  = 0;
+    m_bufferWidth      = 0;
+    m_bufferHeight     = 0;
+    return DEPTHOFFIELDFX_RETURN_CODE_SUCCESS;
+}
+
+DEPTHOFFIELDFX_RETURN_CODE DEPTHOFFIELDFX_CPU_OPAQUE_DESC::validate(const DEPTHOFFIELDFX_CPU_DESC& desc, SETUP_MODE mode) const
+{
+    if (m_pIntegrateKernel == nullptr)
+    {
+        return DEPTHOFFIELDFX_RETURN_CODE_FAIL;
+    }
+    if ((desc.m_color.m_pData == nullptr) || (desc.m_result.m_pData == nullptr) || ((desc.m_circleOfConfusion.m_pData == nullptr) && (desc.m_depth.m_pData == nullptr)))
+    {
+        return DEPTHOFFIELDFX_RETURN_CODE_INVALID_SURFACE;
+    }
+    if ((desc.m_depth.m_pData != nullptr) && !IsValidLens(desc.m_lens))
+    {
+        return DEPTHOFFIELDFX_RETURN_CODE_INVALID_PARAMS;
+    }
+    if (!IsColorFormat(desc.m_color.m_format) || !IsColorFormat(desc.m_result.m_format))
+    {
+        return DEPTHOFFIELDFX_RETURN_CODE_INVALID_SURFACE;
+    }
+    if ((desc.m_transposeMode != DEPTHOFFIELDFX_CPU_TRANSPOSE_MODE_IN_PLACE) && m_intermediateBufferTransposed.empty())
+    {
+        return DEPTHOFFIELDFX_RETURN_CODE_INVALID_SURFACE;
+    }
+    if ((desc.m_intermediateFormat == DEPTHOFFIELDFX_CPU_INTERMEDIATE_FORMAT_INT16) && (desc.m_transposeMode != DEPTHOFFIELDFX_CPU_TRANSPOSE_MODE_IN_PLACE))
+    {
+        return DEPTHOFFIELDFX_RETURN_CODE_INVALID_PARAMS;
+    }
+    if (desc.m_maxBlurRadius > ((mode == SETUP_MODE_PYRAMID) ? DEPTHOFFIELDFX_CPU_PYRAMID_MAX_BLUR_RADIUS : 64))
+    {
+        return DEPTHOFFIELDFX_RETURN_CODE_INVALID_PARAMS;
+    }
+    if (!(desc.m_anamorphicSqueeze >= 1.0f) || (desc.m_bokehOrientation > DEPTHOFFIELDFX_CPU_BOKEH_ORIENTATION_TANGENTIAL))
+    {
+        return DEPTHOFFIELDFX_RETURN_CODE_INVALID_PARAMS;
+    }
+    if (desc.m_layered && !IsLayered(desc, mode))
+    {
+        return DEPTHOFFIELDFX_RETURN_CODE_INVALID_PARAMS;
+    }
+    if ((mode == SETUP_MODE_BARTLETT) && (desc.m_kernel == DEPTHOFFIELDFX_CPU_KERNEL_QUADRATIC_BSPLINE) && (desc.m_maxBlurRadius > DEPTHOFFIELDFX_CPU_QUADRATIC_BSPLINE_MAX_BLUR_RADIUS))
+    {
+        return DEPTHOFFIELDFX_RETURN_CODE_INVALID_PARAMS;
+    }
+    if ((mode != SETUP_MODE_PYRAMID) && desc.m_useCocStatistics && (m_cocTileClasses.empty() || (m_cocStatisticsScreenSize.x != desc.m_screenSize.x) || (m_cocStatisticsScreenSize.y != desc.m_screenSize.y)))
+    {
+        return DEPTHOFFIELDFX_RETURN_CODE_INVALID_PARAMS;
+    }
+    if ((desc.m_screenSize.x == 0) || (desc.m_screenSize.y == 0) || (m_tileSize == 0))
+    {
+        return DEPTHOFFIELDFX_RETURN_CODE_INVALID_SURFACE;
+    }
+
+    // the buffers have to hold the layout of the largest tile of the mode at the screen size and blur
+    // radius of the frame, the full resolution one does not fit the buffers sized for the quarter res mode alone
+    const int         width         = static_cast<int>(desc.m_screenSize.x);
+    const int         height        = static_cast<int>(desc.m_screenSize.y);
+    const int         maxBlurRadius = (mode == SETUP_MODE_PYRAMID) ? PyramidLevelRadius(static_cast<int>(desc.m_maxBlurRadius)) : static_cast<int>(desc.m_maxBlurRadius);
+    const TILE_LAYOUT layout        = GetMaxTileLayout(desc, width, height, maxBlurRadius, m_tileSize, mode == SETUP_MODE_BARTLETT_QUARTER_RES, IsLayered(desc, mode));
+    const size_t      elementCount = static_cast<size_t>(BufferWidth(layout)) * BufferHeight(layout);
+    if ((elementCount > m_intermediateBuffer.size()) || (!m_intermediateBufferTransposed.empty() && (elementCount > m_intermediateBufferTransposed.size())))
+    {
+        return DEPTHOFFIELDFX_RETURN_CODE_INVALID_SURFACE;
+    }
+    if (layout.halfRes && (static_cast<size_t>(layout.bufferRegion.width) * layout.bufferRegion.height > m_quadCoc.size()))
+    {
+        return DEPTHOFFIELDFX_RETURN_CODE_INVALID_SURFACE;
+    }
+    if (desc.m_scatterMode == DEPTHOFFIELDFX_CPU_SCATTER_MODE_PRIVATE_PLANES)
+    {
+        const int bandHeight = PlaneBandHeight(layout.bufferRegion.height, m_threadPool.thread_count());
+        if (m_scatterPlanes.empty() || (static_cast<size_t>(PlaneCount(layout, bandHeight)) > m_scatterPlanes.size()) || (PlaneElements(layout, bandHeight) > m_scatterPlanes[0].size()))
+        {
+            return DEPTHOFFIELDFX_RETURN_CODE_INVALID_SURFACE;
+        }
+    }
+
+    // the levels of the pyramid are only allocated with m_pyramid, for the screen size of the resize
+    const int levelCount = (mode == SETUP_MODE_PYRAMID) ? PyramidLevelCount(static_cast<int>(desc.m_maxBlurRadius)) : 0;
+    for (int level = 1; level < levelCount; ++level)
+    {
+        const int levelWidth  = PyramidLevelSize(width, level);
+        const int levelHeight = PyramidLevelSize(height, level);
+        if ((static_cast<size_t>(level) >= m_pyramidLevels.size()) || (m_pyramidLevels[level].width != levelWidth) || (m_pyramidLevels[level].height != levelHeight)
+            || (m_pyramidLevels[level].source.size() != static_cast<size_t>(levelWidth) * levelHeight * 4))
+        {
+            return DEPTHOFFIELDFX_RETURN_CODE_INVALID_SURFACE;
+        }
+    }
+    return DEPTHOFFIELDFX_RETURN_CODE_SUCCESS;
+}
+
+// the footprint of resize() for a tile size
+uint64 DEPTHOFFIELDFX_CPU_OPAQUE_DESC::tile_bytes(const DEPTHOFFIELDFX_CPU_DESC& desc, uint threadCount, int tileSize)
+{
+    return AllocationBytes(GetAllocation(desc, threadCount, tileSize));
+}
+
+// largest square tile whose intermediate buffers fit in the memory budget, 0 if none does
+int DEPTHOFFIELDFX_CPU_OPAQUE_DESC::choose_tile_size(const DEPTHOFFIELDFX_CPU_DESC& desc, uint threadCount)
+{
+    const int width  = static_cast<int>(desc.m_screenSize.x);
+    const int height = static_cast<int>(desc.m_screenSize.y);
+
+    int low  = 0;
+    int high = MAX(width, height);
+    while (low < high)
+    {
+        const int tileSize = (low + high + 1) / 2;
+        if (tile_bytes(desc, threadCount, tileSize) <= desc.m_memoryBudget)
+        {
+            low = tileSize;
+        }
+        else
+        {
+            high = tileSize - 1;
+        }
+    }
+
+    // tiny tiles spend most of their time on the halo, refuse them unless they cover the frame
+    return ((low >= s_minTileSize) || (low >= MAX(width, height))) ? low : 0;
+}
+
+void DEPTHOFFIELDFX_CPU_OPAQUE_DESC::get_memory_requirements(const DEPTHOFFIELDFX_CPU_DESC& desc, DEPTHOFFIELDFX_MEMORY_REQUIREMENTS& info)
+{
+    const uint threadCount   = DEPTHOFFIELDFX_THREAD_POOL::resolve_thread_count(desc.m_numThreads);
+    const int  width         = static_cast<int>(desc.m_screenSize.x);
+    const int  height        = static_cast<int>(desc.m_screenSize.y);
+    const int  maxBlurRadius = static_cast<int>(desc.m_maxBlurRadius);
+    const int  tileSize      = (desc.m_memoryBudget != 0) ? choose_tile_size(desc, threadCount) : MAX(width, height);
+
+    memset(&info, 0, sizeof(info));
+    if (tileSize == 0)
+    {
+        return;
+    }
+
+    // the same allocation as resize()
+    const DEPTHOFFIELDFX_CPU_ALLOCATION allocation = GetAllocation(desc, threadCount, tileSize);
+
+    info.m_intermediateBufferBytes = allocation.bufferElements * sizeof(uint4) + PyramidBytes(allocation);
+    info.m_transposedBufferBytes   = allocation.transposedElements * sizeof(uint4);
+
+    for (uint mode = 0; mode < DEPTHOFFIELDFX_MODE_COUNT; ++mode)
+    {
+        info.m_modeSurfaceBytes[mode] = allocation.planeCount * allocation.planeElements * sizeof(uint4) + allocation.quadCocElements * sizeof(float);
+        info.m_totalBytes[mode]       = info.m_intermediateBufferBytes + info.m_transposedBufferBytes + info.m_modeSurfaceBytes[mode];
+    }
+
+    const REGION frame = { 0, 0, width, height };
+    for (uint mode = 0; mode < DEPTHOFFIELDFX_MODE_COUNT; ++mode)
+    {
+        const bool halfRes = (mode == DEPTHOFFIELDFX_MODE_RENDER_QUARTER_RES);
+        if ((!halfRes && desc.m_quarterResOnly) || (halfRes && desc.m_layered) || (maxBlurRadius > 64))
+        {
+            continue;
+        }
+
+        get_pass_traffic(desc, mode, threadCount, tileSize, maxBlurRadius, frame, info.m_passTraffic[mode]);
+    }
+}
+
+// The traffic of the passes of a mode over the tiles of the active region, the halo is scattered and
+// integrated once per tile. The pixels outside the region are read from the color and written to the result.
+void DEPTHOFFIELDFX_CPU_OPAQUE_DESC::get_pass_traffic(const DEPTHOFFIELDFX_CPU_DESC& desc, uint mode, uint threadCount, int tileSize, int maxBlurRadius, const REGION& active, DEPTHOFFIELDFX_PASS_TRAFFIC* pPasses)
+{
+    const bool        halfRes    = (mode == DEPTHOFFIELDFX_MODE_RENDER_QUARTER_RES);
+    const int         width      = static_cast<int>(desc.m_screenSize.x);
+    const int         height     = static_cast<int>(desc.m_screenSize.y);
+    const int         activeX1   = active.x + active.width;
+    const int         activeY1   = active.y + active.height;
+    const uint64      deltas     = GetKernel((mode == DEPTHOFFIELDFX_MODE_RENDER_BOX) ? DEPTHOFFIELDFX_KERNEL_TYPE_BOX : (mode == DEPTHOFFIELDFX_MODE_RENDER) ? RenderKernelType(desc) : DEPTHOFFIELDFX_KERNEL_TYPE_BARTLETT).m_tapCount;
+    const TILE_LAYOUT maxLayout  = GetMaxTileLayout(desc, width, height, maxBlurRadius, tileSize, halfRes, desc.m_layered && !halfRes);
+    const int         bandHeight = PlaneBandHeight(maxLayout.bufferRegion.height, threadCount);
+
+    for (int tileY = active.y; tileY < activeY1; tileY += tileSize)
+    {
+        for (int tileX = active.x; tileX < activeX1; tileX += tileSize)
+        {
+            const REGION      tile   = { tileX, tileY, MIN(tileSize, activeX1 - tileX), MIN(tileSize, activeY1 - tileY) };
+            const TILE_LAYOUT layout = GetTileLayout(desc, tile, width, height, maxBlurRadius, halfRes, maxLayout.layered);
+
+            const uint64 tileBytes    = static_cast<uint64>(BufferWidth(layout)) * BufferHeight(layout) * sizeof(uint4);
+            const uint64 splats       = static_cast<uint64>(layout.bufferRegion.width) * static_cast<uint64>(layout.bufferRegion.height);
+            const uint64 sourcePixels = static_cast<uint64>(layout.source.width) * static_cast<uint64>(layout.source.height);
+            const uint64 tilePixels   = static_cast<uint64>(tile.width) * static_cast<uint64>(tile.height);
+            uint64       planeBytes   = 0;
+            if (desc.m_scatterMode == DEPTHOFFIELDFX_CPU_SCATTER_MODE_PRIVATE_PLANES)
+            {
+                planeBytes = static_cast<uint64>(PlaneCount(layout, bandHeight)) * PlaneElements(layout, bandHeight) * sizeof(uint4);
+            }
+
+            // the private planes are cleared, then reduced into the buffer instead of clearing it
+            pPasses[DEPTHOFFIELDFX_PASS_CLEAR].m_bufferBytesRead += planeBytes;
+            pPasses[DEPTHOFFIELDFX_PASS_CLEAR].m_bufferBytesWritten += tileBytes + planeBytes;
+
+            pPasses[DEPTHOFFIELDFX_PASS_FAST_FILTER_SETUP].m_bufferBytesRead += splats * deltas * sizeof(uint4);
+            pPasses[DEPTHOFFIELDFX_PASS_FAST_FILTER_SETUP].m_bufferBytesWritten += splats * deltas * sizeof(uint4);
+            pPasses[DEPTHOFFIELDFX_PASS_FAST_FILTER_SETUP].m_texelsRead += sourcePixels * 2;
+
+            pPasses[DEPTHOFFIELDFX_PASS_VERTICAL_INTEGRATE].m_bufferBytesRead += tileBytes;
+            pPasses[DEPTHOFFIELDFX_PASS_VERTICAL_INTEGRATE].m_bufferBytesWritten += tileBytes;
+            pPasses[DEPTHOFFIELDFX_PASS_HORIZONTAL_INTEGRATE].m_bufferBytesRead += tileBytes;
+            pPasses[DEPTHOFFIELDFX_PASS_HORIZONTAL_INTEGRATE].m_bufferBytesWritten += tileBytes;
+
+            if (halfRes)
+            {
+                // the setup writes the circle of confusion of every quad, the upsample reads 2x2 half
+                // resolution pixels with theirs and composites them with the full resolution color
+                pPasses[DEPTHOFFIELDFX_PASS_FAST_FILTER_SETUP].m_bufferBytesWritten += splats * sizeof(float);
+                pPasses[DEPTHOFFIELDFX_PASS_READ_FINAL_RESULT].m_bufferBytesRead += tilePixels * 4 * (sizeof(uint4) + sizeof(float));
+                pPasses[DEPTHOFFIELDFX_PASS_READ_FINAL_RESULT].m_texelsRead += tilePixels * 2;
+            }
+            else
+            {
+                // a layered buffer is read in both layers
+                pPasses[DEPTHOFFIELDFX_PASS_READ_FINAL_RESULT].m_bufferBytesRead += tilePixels * sizeof(uint4) * (layout.layered ? 2 : 1);
+            }
+            pPasses[DEPTHOFFIELDFX_PASS_READ_FINAL_RESULT].m_texelsWritten += tilePixels;
+        }
+    }
+
+    const uint64 sharpPixels = static_cast<uint64>(width) * static_cast<uint64>(height) - static_cast<uint64>(active.width) * static_cast<uint64>(active.height);
+    pPasses[DEPTHOFFIELDFX_PASS_READ_FINAL_RESULT].m_texelsRead += sharpPixels;
+    pPasses[DEPTHOFFIELDFX_PASS_READ_FINAL_RESULT].m_texelsWritten += sharpPixels;
+}
+
+// The traffic of the frame the render calls run for desc, at the blur radius of the statistics if
+// they are used and over the bounds of the caller or of the statistics. Bounds the render calls
+// measure themselves are unknown beforehand, the whole frame is counted for them.
+DEPTHOFFIELDFX_RETURN_CODE DEPTHOFFIELDFX_CPU_OPAQUE_DESC::get_frame_traffic(const DEPTHOFFIELDFX_CPU_DESC& desc, DEPTHOFFIELDFX_MEMORY_REQUIREMENTS& info) const
+{
+    memset(&info, 0, sizeof(info));
+    if (m_tileSize == 0)
+    {
+        return DEPTHOFFIELDFX_RETURN_CODE_INVALID_SURFACE;
+    }
+    if ((desc.m_maxBlurRadius > 64) || (desc.m_useCocStatistics && (m_cocTileClasses.empty() || (m_cocStatisticsScreenSize.x != desc.m_screenSize.x) || (m_cocStatisticsScreenSize.y != desc.m_screenSize.y))))
+    {
+        return DEPTHOFFIELDFX_RETURN_CODE_INVALID_PARAMS;
+    }
+
+    const int maxBlurRadius = frame_blur_radius(desc);
+    for (uint mode = 0; mode < DEPTHOFFIELDFX_MODE_COUNT; ++mode)
+    {
+        const bool halfRes = (mode == DEPTHOFFIELDFX_MODE_RENDER_QUARTER_RES);
+        if ((!halfRes && desc.m_quarterResOnly) || (halfRes && desc.m_layered))
+        {
+            continue;
+        }
+
+        REGION active = { 0, 0, static_cast<int>(desc.m_screenSize.x), static_cast<int>(desc.m_screenSize.y) };
+        if (desc.m_defocusMode == DEPTHOFFIELDFX_CPU_DEFOCUS_MODE_CALLER)
+        {
+            active = DilateBounds(desc, ClampBounds(desc, desc.m_defocusBounds), maxBlurRadius, halfRes);
+        }
+        else if ((desc.m_defocusMode == DEPTHOFFIELDFX_CPU_DEFOCUS_MODE_MEASURED) && desc.m_useCocStatistics)
+        {
+            active = DilateBounds(desc, ClampBounds(desc, m_cocStatistics.m_defocusBounds), maxBlurRadius, halfRes);
+        }
+        get_pass_traffic(desc, mode, m_threadPool.thread_count(), m_tileSize, maxBlurRadius, active, info.m_passTraffic[mode]);
+    }
+    return DEPTHOFFIELDFX_RETURN_CODE_SUCCESS;
+}
+
+DEPTHOFFIELDFX_RETURN_CODE DEPTHOFFIELDFX_CPU_OPAQUE_DESC::render_passes(const DEPTHOFFIELDFX_CPU_DESC& desc, SETUP_MODE mode)
+{
+    DEPTHOFFIELDFX_RETURN_CODE result = validate(desc, mode);
+    if (result != DEPTHOFFIELDFX_RETURN_CODE_SUCCESS)
+    {
+        return result;
+    }
+
+    const bool halfRes       = (mode == SETUP_MODE_BARTLETT_QUARTER_RES);
+    const int  width         = static_cast<int>(desc.m_screenSize.x);
+    const int  height        = static_cast<int>(desc.m_screenSize.y);
+    const int  maxBlurRadius = frame_blur_radius(desc);
+    const bool layered       = IsLayered(desc, mode);
+
+    m_planeBandHeight = PlaneBandHeight(GetMaxTileLayout(desc, width, height, maxBlurRadius, m_tileSize, halfRes, layered).bufferRegion.height, m_threadPool.thread_count());
+    memset(m_passMilliseconds, 0, sizeof(m_passMilliseconds));
+    set_coc_params(desc);
+
+    // the 32 bit tiles share a scale factor, so the peak is measured over the whole frame
+    m_frameScaleFactor = desc.m_scaleFactor;
+    if (desc.m_autoScaleFactor)
+    {
+        PASS_TIMER                       timer(m_passMilliseconds[DEPTHOFFIELDFX_PASS_FAST_FILTER_SETUP]);
+        DEPTHOFFIELDFX_SCALE_FACTOR_INFO info;
+        get_scale_factor_info(desc, mode, measure_peak_color(desc), 32, info);
+        m_frameScaleFactor = info.m_scaleFactor;
+    }
+
+    // the pixels out of reach of every blurred one are written from the color, the passes cover the rest
+    REGION active = { 0, 0, width, height };
+    if (desc.m_defocusMode != DEPTHOFFIELDFX_CPU_DEFOCUS_MODE_FULL_FRAME)
+    {
+        PASS_TIMER timer(m_passMilliseconds[DEPTHOFFIELDFX_PASS_FAST_FILTER_SETUP]);
+        active = defocus_region(desc, maxBlurRadius, halfRes);
+    }
+
+    // the previous result is kept where no source within the halo changed
+    if (desc.m_reuseUnchangedTiles)
+    {
+        PASS_TIMER timer(m_passMilliseconds[DEPTHOFFIELDFX_PASS_FAST_FILTER_SETUP]);
+        find_dirty_tiles(desc, mode, maxBlurRadius, active);
+    }
+    else
+    {
+        m_reuseHashes.clear();
+    }
+
+    if (desc.m_defocusMode != DEPTHOFFIELDFX_CPU_DEFOCUS_MODE_FULL_FRAME)
+    {
+        PASS_TIMER timer(m_passMilliseconds[DEPTHOFFIELDFX_PASS_READ_FINAL_RESULT]);
+        write_sharp_result(desc, active, halfRes);
+    }
+
+    // without a memory budget the single tile covers the whole region, the reused parts are left out
+    std::vector<REGION> tiles;
+    const int           activeX1 = active.x + active.width;
+    const int           activeY1 = active.y + active.height;
+    for (int tileY = active.y; tileY < activeY1; tileY += m_tileSize)
+    {
+        for (int tileX = active.x; tileX < activeX1; tileX += m_tileSize)
+        {
+            const REGION tile = { tileX, tileY, MIN(m_tileSize, activeX1 - tileX), MIN(m_tileSize, activeY1 - tileY) };
+            if (desc.m_reuseUnchangedTiles)
+            {
+                dirty_regions(tile, TileHalo(desc, maxBlurRadius, halfRes), tiles);
+            }
+            else
+            {
+                tiles.push_back(tile);
+            }
+        }
+    }
+
+    for (size_t t = 0; t < tiles.size(); ++t)
+    {
+        const REGION&     tile   = tiles[t];
+        const TILE_LAYOUT layout = GetTileLayout(desc, tile, width, height, maxBlurRadius, halfRes, layered);
+
+        m_bufferWidth     = BufferWidth(layout);
+        m_bufferHeight    = BufferHeight(layout);
+        m_tileScaleFactor = m_frameScaleFactor;
+        m_compactTile     = false;
+        if (desc.m_intermediateFormat == DEPTHOFFIELDFX_CPU_INTERMEDIATE_FORMAT_INT16)
+        {
+            PASS_TIMER timer(m_passMilliseconds[DEPTHOFFIELDFX_PASS_FAST_FILTER_SETUP]);
+            choose_tile_format(desc, layout, mode);
+        }
+
+        scatter_and_integrate(desc, layout, mode);
+
+        PASS_TIMER timer(m_passMilliseconds[DEPTHOFFIELDFX_PASS_READ_FINAL_RESULT]);
+        if (halfRes)
+        {
+            upsample_final_result(desc, layout, tile);
+        }
+        else
+        {
+            read_final_result(desc, layout, tile);
+        }
+    }
+
+    return result;
+}
+
+void DEPTHOFFIELDFX_CPU_OPAQUE_DESC::get_scale_factor_info(const DEPTHOFFIELDFX_CPU_DESC& desc, SETUP_MODE mode, float peakColor, uint laneBits, DEPTHOFFIELDFX_SCALE_FACTOR_INFO& info)
+{
+    // the quarter res mode scatters averaged quads with half the radius into its half resolution buffer,
+    // the pyramid every level with the level radius
+    int maxBlurRadius = LayoutBlurRadius(static_cast<int>(desc.m_maxBlurRadius), mode == SETUP_MODE_BARTLETT_QUARTER_RES);
+    if (mode == SETUP_MODE_PYRAMID)
+    {
+        maxBlurRadius = PyramidLevelRadius(static_cast<int>(desc.m_maxBlurRadius));
+    }
+    GetScaleFactorInfo(desc.m_scaleFactor, static_cast<uint>(maxBlurRadius), SetupKernelType(desc, mode), IsAnamorphic(desc), peakColor, laneBits, info);
+}
+
+// The lens constants clamp the circle of confusion to m_maxBlurRadius, a smaller blur radius
+// from the statistics only shrinks the layout.
+void DEPTHOFFIELDFX_CPU_OPAQUE_DESC::set_coc_params(const DEPTHOFFIELDFX_CPU_DESC& desc)
+{
+    m_pCocParams = nullptr;
+    if (desc.m_depth.m_pData != nullptr)
+    {
+        GetCocParams(desc.m_lens, desc.m_screenSize.x, desc.m_maxBlurRadius, m_cocParams);
+        m_pCocParams = &m_cocParams;
+    }
+}
+
+// No pixel of the frame blurs further than the largest radius of its statistics, the kernels and
+// tiles laid out for it are the ones of m_maxBlurRadius.
+int DEPTHOFFIELDFX_CPU_OPAQUE_DESC::frame_blur_radius(const DEPTHOFFIELDFX_CPU_DESC& desc) const
+{
+    const uint maxBlurRadius = desc.m_useCocStatistics ? MIN(m_cocStatistics.m_maxBlurRadius, desc.m_maxBlurRadius) : desc.m_maxBlurRadius;
+    return static_cast<int>(maxBlurRadius);
+}
+
+// largest absolute color channel of the frame, NaNs are ignored
+float DEPTHOFFIELDFX_CPU_OPAQUE_DESC::measure_peak_color(const DEPTHOFFIELDFX_CPU_DESC& desc)
+{
+    const REGION frame = { 0, 0, static_cast<int>(desc.m_screenSize.x), static_cast<int>(desc.m_screenSize.y) };
+    float        peakColor;
+    measure_source(desc, frame, peakColor, nullptr);
+    return peakColor;
+}
+
+// whole depth rows per task, the conversion streams at memory bandwidth
+DEPTHOFFIELDFX_RETURN_CODE DEPTHOFFIELDFX_CPU_OPAQUE_DESC::compute_coc(const DEPTHOFFIELDFX_CPU_DESC& desc)
+{
+    if (m_pIntegrateKernel == nullptr)
+    {
+        return DEPTHOFFIELDFX_RETURN_CODE_FAIL;
+    }
+    if ((desc.m_depth.m_pData == nullptr) || (desc.m_circleOfConfusion.m_pData == nullptr) || (desc.m_screenSize.x == 0) || (desc.m_screenSize.y == 0))
+    {
+        return DEPTHOFFIELDFX_RETURN_CODE_INVALID_SURFACE;
+    }
+    if (!IsValidLens(desc.m_lens))
+    {
+        return DEPTHOFFIELDFX_RETURN_CODE_INVALID_PARAMS;
+    }
+
+    const DEPTHOFFIELDFX_CPU_COC_FN pKernel = GetCocKernel(desc.m_instructionSet, desc.m_depth.m_format, desc.m_circleOfConfusion.m_format);
+    if (pKernel == nullptr)
+    {
+        return DEPTHOFFIELDFX_RETURN_CODE_INVALID_SURFACE;
+    }
+
+    DEPTHOFFIELDFX_COC_PARAMS params;
+    GetCocParams(desc.m_lens, desc.m_screenSize.x, desc.m_maxBlurRadius, params);
+
+    const uint rowsPerTask = 16;
+    const uint height      = desc.m_screenSize.y;
+    m_threadPool.dispatch((height + rowsPerTask - 1) / rowsPerTask, [&](uint taskIndex, uint) {
+        const uint y1 = MIN((taskIndex + 1) * rowsPerTask, height);
+        for (uint y = taskIndex * rowsPerTask; y < y1; ++y)
+        {
+            const void* pDepth = static_cast<const uint8*>(desc.m_depth.m_pData) + static_cast<size_t>(y) * desc.m_depth.m_pitch;
+            void*       pCoc   = static_cast<uint8*>(desc.m_circleOfConfusion.m_pData) + static_cast<size_t>(y) * desc.m_circleOfConfusion.m_pitch;
+            pKernel(params, pDepth, pCoc, desc.m_screenSize.x);
+        }
+    });
+    return DEPTHOFFIELDFX_RETURN_CODE_SUCCESS;
+}
+
+// A task per row of tiles, the tiles of a row are classified by its task. The histograms,
+// peaks and bounds are reduced per thread.
+DEPTHOFFIELDFX_RETURN_CODE DEPTHOFFIELDFX_CPU_OPAQUE_DESC::compute_coc_statistics(const DEPTHOFFIELDFX_CPU_DESC& desc)
+{
+    if (m_pIntegrateKernel == nullptr)
+    {
+        return DEPTHOFFIELDFX_RETURN_CODE_FAIL;
+    }
+    if (((desc.m_circleOfConfusion.m_pData == nullptr) && (desc.m_depth.m_pData == nullptr)) || (desc.m_screenSize.x == 0) || (desc.m_screenSize.y == 0))
+    {
+        return DEPTHOFFIELDFX_RETURN_CODE_INVALID_SURFACE;
+    }
+    if (((desc.m_depth.m_pData != nullptr) && !IsValidLens(desc.m_lens)) || (desc.m_maxBlurRadius > 64))
+    {
+        return DEPTHOFFIELDFX_RETURN_CODE_INVALID_PARAMS;
+    }
+
+    set_coc_params(desc);
+
+    const int  tileSize      = static_cast<int>(DEPTHOFFIELDFX_CPU_COC_TILE_SIZE);
+    const int  width         = static_cast<int>(desc.m_screenSize.x);
+    const int  height        = static_cast<int>(desc.m_screenSize.y);
+    const int  maxBlurRadius = static_cast<int>(desc.m_maxBlurRadius);
+    const uint tileCountX    = (desc.m_screenSize.x + DEPTHOFFIELDFX_CPU_COC_TILE_SIZE - 1) / DEPTHOFFIELDFX_CPU_COC_TILE_SIZE;
+    const uint tileCountY    = (desc.m_screenSize.y + DEPTHOFFIELDFX_CPU_COC_TILE_SIZE - 1) / DEPTHOFFIELDFX_CPU_COC_TILE_SIZE;
+    const uint threadCount   = m_threadPool.thread_count();
+
+    // radius histogram, peak circle of confusion and first and last column and row of at least 1 of every thread
+    std::vector<uint64> threadHistograms(threadCount * DEPTHOFFIELDFX_CPU_COC_RADIUS_HISTOGRAM_SIZE, 0);
+    std::vector<float>  threadPeaks(threadCount, 0.0f);
+    std::vector<int>    threadBounds(4 * threadCount);
+    for (size_t i = 0; i < threadBounds.size(); i += 4)
+    {
+        threadBounds[i]     = width;
+        threadBounds[i + 1] = height;
+        threadBounds[i + 2] = -1;
+        threadBounds[i + 3] = -1;
+    }
+
+    m_cocTileClasses.resize(static_cast<size_t>(tileCountX) * tileCountY);
+    m_threadPool.dispatch(tileCountY, [&](uint taskIndex, uint threadIndex) {
+        uint64*   pHistogram = &threadHistograms[threadIndex * DEPTHOFFIELDFX_CPU_COC_RADIUS_HISTOGRAM_SIZE];
+        int*      pBounds    = &threadBounds[4 * threadIndex];
+        float     peak       = threadPeaks[threadIndex];
+        const int y0         = static_cast<int>(taskIndex) * tileSize;
+        const int y1         = MIN(y0 + tileSize, height);
+        for (uint tileX = 0; tileX < tileCountX; ++tileX)
+        {
+            const int x0         = static_cast<int>(tileX) * tileSize;
+            const int x1         = MIN(x0 + tileSize, width);
+            int       tileRadius = 0;
+            for (int y = y0; y < y1; ++y)
+            {
+                for (int x = x0; x < x1; ++x)
+                {
+                    const float coc    = fabsf(SampleCoc(desc, m_pCocParams, x, y));
+                    const int   radius = StatisticsBlurRadius(coc, maxBlurRadius);
+                    pHistogram[radius] += 1;
+                    tileRadius = MAX(tileRadius, radius);
+                    peak       = (coc > peak) ? coc : peak;
+                    if (coc >= 1.0f)
+                    {
+                        pBounds[0] = MIN(pBounds[0], x);
+                        pBounds[1] = MIN(pBounds[1], y);
+                        pBounds[2] = MAX(pBounds[2], x);
+                        pBounds[3] = MAX(pBounds[3], y);
+                    }
+                }
+            }
+            m_cocTileClasses[taskIndex * tileCountX + tileX] = static_cast<uint8>(CocTileClass(tileRadius));
+        }
+        threadPeaks[threadIndex] = peak;
+    });
+
+    memset(&m_cocStatistics, 0, sizeof(m_cocStatistics));
+    int bounds[4] = { width, height, -1, -1 };
+    for (uint i = 0; i < threadCount; ++i)
+    {
+        for (uint radius = 0; radius < DEPTHOFFIELDFX_CPU_COC_RADIUS_HISTOGRAM_SIZE; ++radius)
+        {
+            m_cocStatistics.m_radiusHistogram[radius] += threadHistograms[i * DEPTHOFFIELDFX_CPU_COC_RADIUS_HISTOGRAM_SIZE + radius];
+        }
+        m_cocStatistics.m_maxCoc = MAX(m_cocStatistics.m_maxCoc, threadPeaks[i]);
+        bounds[0]                = MIN(bounds[0], threadBounds[4 * i]);
+        bounds[1]                = MIN(bounds[1], threadBounds[4 * i + 1]);
+        bounds[2]                = MAX(bounds[2], threadBounds[4 * i + 2]);
+        bounds[3]                = MAX(bounds[3], threadBounds[4 * i + 3]);
+    }
+    for (uint radius = 0; radius < DEPTHOFFIELDFX_CPU_COC_RADIUS_HISTOGRAM_SIZE; ++radius)
+    {
+        m_cocStatistics.m_maxBlurRadius = (m_cocStatistics.m_radiusHistogram[radius] != 0) ? radius : m_cocStatistics.m_maxBlurRadius;
+    }
+    if (bounds[2] >= 0)
+    {
+        m_cocStatistics.m_defocusBounds.x = static_cast<uint>(bounds[0]);
+        m_cocStatistics.m_defocusBounds.y = static_cast<uint>(bounds[1]);
+        m_cocStatistics.m_defocusBounds.z = static_cast<uint>(bounds[2] + 1 - bounds[0]);
+        m_cocStatistics.m_defocusBounds.w = static_cast<uint>(bounds[3] + 1 - bounds[1]);
+    }
+    m_cocStatistics.m_tileCount.x = tileCountX;
+    m_cocStatistics.m_tileCount.y = tileCountY;
+    for (size_t i = 0; i < m_cocTileClasses.size(); ++i)
+    {
+        m_cocStatistics.m_tileClassCounts[m_cocTileClasses[i]] += 1;
+    }
+
+    m_cocStatisticsScreenSize.x = desc.m_screenSize.x;
+    m_cocStatisticsScreenSize.y = desc.m_screenSize.y;
+    return DEPTHOFFIELDFX_RETURN_CODE_SUCCESS;
+}
+
+// largest absolute color channel and, if pPeakCoc is set, circle of confusion of a source region
+void DEPTHOFFIELDFX_CPU_OPAQUE_DESC::measure_source(const DEPTHOFFIELDFX_CPU_DESC& desc, const REGION& source, float& peakColor, float* pPeakCoc)
+{
+    const int rowsPerTask = 16;
+
+    std::vector<float> threadPeaks(2 * m_threadPool.thread_count(), 0.0f);
+    m_threadPool.dispatch(static_cast<uint>((source.height + rowsPerTask - 1) / rowsPerTask), [&](uint taskIndex, uint threadIndex) {
+        const int y0   = source.y + static_cast<int>(taskIndex) * rowsPerTask;
+        const int y1   = MIN(y0 + rowsPerTask, source.y + source.height);
+        float     peak = threadPeaks[2 * threadIndex];
+        float     coc  = threadPeaks[2 * threadIndex + 1];
+        for (int y = y0; y < y1; ++y)
+        {
+            for (int x = source.x; x < source.x + source.width; ++x)
+            {
+                float color[3];
+                LoadColor(desc.m_color, x, y, color);
+                for (int i = 0; i < 3; ++i)
+                {
+                    const float value = fabsf(color[i]);
+                    peak              = (value > peak) ? value : peak;
+                }
+                if (pPeakCoc != nullptr)
+                {
+                    const float value = fabsf(SampleCoc(desc, m_pCocParams, x, y));
+                    coc               = (value > coc) ? value : coc;
+                }
+            }
+        }
+        threadPeaks[2 * threadIndex]     = peak;
+        threadPeaks[2 * threadIndex + 1] = coc;
+    });
+
+    float peakCoc = 0.0f;
+    peakColor     = 0.0f;
+    for (size_t i = 0; i < threadPeaks.size(); i += 2)
+    {
+        peakColor = MAX(peakColor, threadPeaks[i]);
+        peakCoc   = MAX(peakCoc, threadPeaks[i + 1]);
+    }
+    if (pPeakCoc != nullptr)
+    {
+        *pPeakCoc = peakCoc;
+    }
+}
+
+// Bounding rectangle of the blurred pixels, empty if the frame is in focus. Each row is searched
+// from the left for its first blurred pixel and from the right for its last one.
+DEPTHOFFIELDFX_CPU_OPAQUE_DESC::REGION DEPTHOFFIELDFX_CPU_OPAQUE_DESC::measure_defocus_bounds(const DEPTHOFFIELDFX_CPU_DESC& desc, bool halfRes)
+{
+    const int rowsPerTask   = 16;
+    const int width         = static_cast<int>(desc.m_screenSize.x);
+    const int height        = static_cast<int>(desc.m_screenSize.y);
+    const int maxBlurRadius = LayoutBlurRadius(static_cast<int>(desc.m_maxBlurRadius), halfRes);
+
+    // first and last blurred column and row of every thread
+    std::vector<int> threadBounds(4 * m_threadPool.thread_count());
+    for (size_t i = 0; i < threadBounds.size(); i += 4)
+    {
+        threadBounds[i]     = width;
+        threadBounds[i + 1] = height;
+        threadBounds[i + 2] = -1;
+        threadBounds[i + 3] = -1;
+    }
+
+    m_threadPool.dispatch(static_cast<uint>((height + rowsPerTask - 1) / rowsPerTask), [&](uint taskIndex, uint threadIndex) {
+        int*      pBounds = &threadBounds[4 * threadIndex];
+        const int y0      = static_cast<int>(taskIndex) * rowsPerTask;
+        const int y1      = MIN(y0 + rowsPerTask, height);
+        for (int y = y0; y < y1; ++y)
+        {
+            int x0 = 0;
+            while ((x0 < width) && !IsDefocused(SampleCoc(desc, m_pCocParams, x0, y), maxBlurRadius, halfRes))
+            {
+                ++x0;
+            }
+            if (x0 == width)
+            {
+                continue;
+            }
+
+            int x1 = width - 1;
+            while ((x1 > x0) && !IsDefocused(SampleCoc(desc, m_pCocParams, x1, y), maxBlurRadius, halfRes))
+            {
+                --x1;
+            }
+
+            pBounds[0] = MIN(pBounds[0], x0);
+            pBounds[1] = MIN(pBounds[1], y);
+            pBounds[2] = MAX(pBounds[2], x1);
+            pBounds[3] = MAX(pBounds[3], y);
+        }
+    });
+
+    int bounds[4] = { width, height, -1, -1 };
+    for (size_t i = 0; i < threadBounds.size(); i += 4)
+    {
+        bounds[0] = MIN(bounds[0], threadBounds[i]);
+        bounds[1] = MIN(bounds[1], threadBounds[i + 1]);
+        bounds[2] = MAX(bounds[2], threadBounds[i + 2]);
+        bounds[3] = MAX(bounds[3], threadBounds[i + 3]);
+    }
+
+    const REGION empty  = { 0, 0, 0, 0 };
+    const REGION region = { bounds[0], bounds[1], bounds[2] + 1 - bounds[0], bounds[3] + 1 - bounds[1] };
+    return (bounds[2] < 0) ? empty : region;
+}
+
+// The blurred pixels plus the halo of pixels their kernels reach, empty if no pixel is blurred.
+// The pixels outside only see their own in focus kernel. The bounds of the statistics hold every
+// pixel blurred in any mode.
+DEPTHOFFIELDFX_CPU_OPAQUE_DESC::REGION DEPTHOFFIELDFX_CPU_OPAQUE_DESC::defocus_region(const DEPTHOFFIELDFX_CPU_DESC& desc, int maxBlurRadius, bool halfRes)
+{
+    REGION bounds = ClampBounds(desc, desc.m_defocusBounds);
+    if (desc.m_defocusMode == DEPTHOFFIELDFX_CPU_DEFOCUS_MODE_MEASURED)
+    {
+        bounds = desc.m_useCocStatistics ? ClampBounds(desc, m_cocStatistics.m_defocusBounds) : measure_defocus_bounds(desc, halfRes);
+    }
+
+    return DilateBounds(desc, bounds, maxBlurRadius, halfRes);
+}
+
+// Writes the pixels of the frame outside the active region. An in focus pixel scatters a single
+// delta with a weight of 1, the passes would read back its color quantized to the 32 bit scale
+// factor of the frame. The quarter res upsample takes the full resolution color of in focus pixels.
+void DEPTHOFFIELDFX_CPU_OPAQUE_DESC::write_sharp_result(const DEPTHOFFIELDFX_CPU_DESC& desc, const REGION& active, bool halfRes)
+{
+    const int   width     = static_cast<int>(desc.m_screenSize.x);
+    const int   height    = static_cast<int>(desc.m_screenSize.y);
+    const float scale     = static_cast<float>(1u << m_frameScaleFactor);
+    const float weight    = static_cast<float>(FloatToInt(scale));
+    const uint  taskCount = (static_cast<uint>(height) + s_readResultRows - 1) / s_readResultRows;
+    const int   tileSize  = static_cast<int>(DEPTHOFFIELDFX_CPU_REUSE_TILE_SIZE);
+
+    m_threadPool.dispatch(taskCount, [&](uint taskIndex, uint) {
+        const int y0 = static_cast<int>(taskIndex * s_readResultRows);
+        const int y1 = MIN(y0 + static_cast<int>(s_readResultRows), height);
+        for (int y = y0; y < y1; ++y)
+        {
+            // the rows of the active region skip its columns, reused tiles keep the previous result
+            const bool activeRow = (y >= active.y) && (y < active.y + active.height);
+            for (int x = 0; x < width; ++x)
+            {
+                if (activeRow && (x >= active.x) && (x < active.x + active.width))
+                {
+                    x = active.x + active.width - 1;
+                    continue;
+                }
+                if (desc.m_reuseUnchangedTiles && reused_tile(x, y))
+                {
+                    x = MIN(x - x % tileSize + tileSize, width) - 1;
+                    continue;
+                }
+
+                float color[3];
+                LoadColor(desc.m_color, x, y, color);
+
+                float result[4];
+                for (int i = 0; i < 3; ++i)
+                {
+                    result[i] = halfRes ? color[i] : static_cast<float>(FloatToInt(color[i] * scale)) / weight;
+                    result[i] = desc.m_convertToSRGB ? LinearToSRGB(result[i]) : result[i];
+                }
+                result[3] = 1.0f;
+
+                StoreColor(desc.m_result, x, y, result);
+            }
+        }
+    });
+}
+
+// Hashes the sources of every reuse tile and marks the tiles dirty that have a changed source within
+// the reach of their kernels or a changed part of the active region. Without a previous result of the
+// same other inputs every tile is dirty. Keeping the sources to compare them on a matching hash would
+// double their memory, so a colliding hash reuses a changed tile, see m_reuseUnchangedTiles.
+void DEPTHOFFIELDFX_CPU_OPAQUE_DESC::find_dirty_tiles(const DEPTHOFFIELDFX_CPU_DESC& desc, SETUP_MODE mode, int maxBlurRadius, const REGION& active)
+{
+    const int    tileSize   = static_cast<int>(DEPTHOFFIELDFX_CPU_REUSE_TILE_SIZE);
+    const int    width      = static_cast<int>(desc.m_screenSize.x);
+    const int    height     = static_cast<int>(desc.m_screenSize.y);
+    const int    tileCountX = (width + tileSize - 1) / tileSize;
+    const int    tileCountY = (height + tileSize - 1) / tileSize;
+    const size_t tileCount  = static_cast<size_t>(tileCountX) * tileCountY;
+
+    // everything but the sources the result depends on
+    const DEPTHOFFIELDFX_CPU_IMAGE& source    = (m_pCocParams != nullptr) ? desc.m_depth : desc.m_circleOfConfusion;
+    const uint                      keyData[] = {
+        static_cast<uint>(mode), m_frameScaleFactor, static_cast<uint>(maxBlurRadius), desc.m_maxBlurRadius, desc.m_screenSize.x, desc.m_screenSize.y,
+        desc.m_convertToSRGB ? 1u : 0u, desc.m_layered ? 1u : 0u, static_cast<uint>(desc.m_kernel), static_cast<uint>(desc.m_bokehOrientation), static_cast<uint>(desc.m_intermediateFormat), static_cast<uint>(desc.m_color.m_format), static_cast<uint>(source.m_format),
+        (m_pCocParams != nullptr) ? 1u : 0u, desc.m_result.m_pitch, static_cast<uint>(desc.m_result.m_format),
+    };
+    uint64 key = HashBytes(0, keyData, sizeof(keyData));
+    key        = HashBytes(key, &desc.m_result.m_pData, sizeof(desc.m_result.m_pData));
+    key        = HashBytes(key, &desc.m_anamorphicSqueeze, sizeof(desc.m_anamorphicSqueeze));
+    key        = FinishHash((m_pCocParams != nullptr) ? HashBytes(key, m_pCocParams, sizeof(*m_pCocParams)) : key);
+
+    const bool          history = (m_reuseHashes.size() == tileCount) && (key == m_reuseKey);
+    std::vector<uint64> hashes(tileCount);
+    m_threadPool.dispatch(static_cast<uint>(tileCountY), [&](uint taskIndex, uint) {
+        const int tileY = static_cast<int>(taskIndex);
+        for (int tileX = 0; tileX < tileCountX; ++tileX)
+        {
+            const REGION tile = { tileX * tileSize, tileY * tileSize, MIN(tileSize, width - tileX * tileSize), MIN(tileSize, height - tileY * tileSize) };
+            hashes[static_cast<size_t>(tileY) * tileCountX + tileX] = FinishHash(HashImage(HashImage(0, desc.m_color, tile), source, tile));
+        }
+    });
+
+    // a tile reads the sources up to its halo plus the quad alignment away, dilated by rows then columns
+    const int          reach        = (TileHalo(desc, maxBlurRadius, mode == SETUP_MODE_BARTLETT_QUARTER_RES) + tileSize) / tileSize;
+    uint               changedTiles = 0;
+    std::vector<uint8> changedRows(tileCount, 0);
+    for (int tileY = 0; tileY < tileCountY; ++tileY)
+    {
+        for (int tileX = 0; tileX < tileCountX; ++tileX)
+        {
+            const size_t index = static_cast<size_t>(tileY) * tileCountX + tileX;
+            if (history && (hashes[index] == m_reuseHashes[index]))
+            {
+                continue;
+            }
+
+            ++changedTiles;
+            for (int x = MAX(tileX - reach, 0); x <= MIN(tileX + reach, tileCountX - 1); ++x)
+            {
+                changedRows[static_cast<size_t>(tileY) * tileCountX + x] = 1;
+            }
+        }
+    }
+
+    m_reuseDirtyTiles.assign(tileCount, 0);
+    uint reusedTiles = 0;
+    for (int tileY = 0; tileY < tileCountY; ++tileY)
+    {
+        for (int tileX = 0; tileX < tileCountX; ++tileX)
+        {
+            // the pixels that enter or leave the active region switch between the passes and the sharp color
+            const REGION tile  = { tileX * tileSize, tileY * tileSize, tileSize, tileSize };
+            bool         dirty = !SameRegion(IntersectRegions(tile, m_reuseActive), IntersectRegions(tile, active));
+            for (int y = MAX(tileY - reach, 0); !dirty && (y <= MIN(tileY + reach, tileCountY - 1)); ++y)
+            {
+                dirty = (changedRows[static_cast<size_t>(y) * tileCountX + tileX] != 0);
+            }
+
+            m_reuseDirtyTiles[static_cast<size_t>(tileY) * tileCountX + tileX] = dirty ? 1 : 0;
+            reusedTiles += dirty ? 0 : 1;
+        }
+    }
+
+    m_reuseStatistics.m_tileCount.x  = static_cast<uint>(tileCountX);
+    m_reuseStatistics.m_tileCount.y  = static_cast<uint>(tileCountY);
+    m_reuseStatistics.m_changedTiles = changedTiles;
+    m_reuseStatistics.m_reusedTiles  = reusedTiles;
+    m_reuseStatistics.m_frameCount += 1;
+    m_reuseStatistics.m_totalTiles += tileCount;
+    m_reuseStatistics.m_totalChangedTiles += changedTiles;
+    m_reuseStatistics.m_totalReusedTiles += reusedTiles;
+
+    m_reuseHashes.swap(hashes);
+    m_reuseKey    = key;
+    m_reuseActive = active;
+}
+
+// Splits a tile into squares of about four halos and adds the bounding rectangle of the dirty reuse
+// tiles of every square. One rectangle around all of them replaces the squares when it reads fewer
+// source pixels than they do with their halos.
+void DEPTHOFFIELDFX_CPU_OPAQUE_DESC::dirty_regions(const REGION& tile, int halo, std::vector<REGION>& regions) const
+{
+    const int tileSize   = static_cast<int>(DEPTHOFFIELDFX_CPU_REUSE_TILE_SIZE);
+    const int tileCountX = static_cast<int>(m_reuseStatistics.m_tileCount.x);
+    const int step       = MAX((4 * halo + tileSize - 1) / tileSize, 2) * tileSize;
+
+    const size_t first  = regions.size();
+    REGION       bounds = { 0, 0, 0, 0 };
+    uint64       cost   = 0;
+    for (int squareY = tile.y; squareY < tile.y + tile.height; squareY += step)
+    {
+        for (int squareX = tile.x; squareX < tile.x + tile.width; squareX += step)
+        {
+            const REGION square = { squareX, squareY, MIN(step, tile.x + tile.width - squareX), MIN(step, tile.y + tile.height - squareY) };
+            REGION       dirty  = { 0, 0, 0, 0 };
+            for (int y = square.y / tileSize; y <= (square.y + square.height - 1) / tileSize; ++y)
+            {
+                for (int x = square.x / tileSize; x <= (square.x + square.width - 1) / tileSize; ++x)
+                {
+                    const REGION reuseTile = { x * tileSize, y * tileSize, tileSize, tileSize };
+                    dirty                  = (m_reuseDirtyTiles[static_cast<size_t>(y) * tileCountX + x] != 0) ? UniteRegions(dirty, IntersectRegions(reuseTile, square)) : dirty;
+                }
+            }
+
+            if (dirty.width > 0)
+            {
+                regions.push_back(dirty);
+                bounds = UniteRegions(bounds, dirty);
+                cost += RenderCost(dirty, halo);
+            }
+        }
+    }
+
+    if ((regions.size() > first + 1) && (RenderCost(bounds, halo) <= cost))
+    {
+        regions.resize(first);
+        regions.push_back(bounds);
+    }
+}
+
+bool DEPTHOFFIELDFX_CPU_OPAQUE_DESC::reused_tile(int x, int y) const
+{
+    const uint tileSize = DEPTHOFFIELDFX_CPU_REUSE_TILE_SIZE;
+    return m_reuseDirtyTiles[(static_cast<uint>(y) / tileSize) * m_reuseStatistics.m_tileCount.x + static_cast<uint>(x) / tileSize] == 0;
+}
+
+void DEPTHOFFIELDFX_CPU_OPAQUE_DESC::reset_reuse()
+{
+    m_reuseHashes.clear();
+    memset(&m_reuseStatistics, 0, sizeof(m_reuseStatistics));
+}
+
+// Picks the 16 bit lanes and the largest scale factor they allow for the tile if that keeps
+// enough precision. A scale that cancels out per tile acts as the exponent shared by its elements.
+void DEPTHOFFIELDFX_CPU_OPAQUE_DESC::choose_tile_format(const DEPTHOFFIELDFX_CPU_DESC& desc, const TILE_LAYOUT& layout, SETUP_MODE mode)
+{
+    const float minPrecisionBits = 8.0f;
+
+    float peakColor;
+    float peakCoc;
+    measure_source(desc, layout.source, peakColor, &peakCoc);
+
+    const int                        blurRadius = CocToBlurRadius(layout.halfRes ? 0.5f * peakCoc : peakCoc, layout.maxBlurRadius);
+    const DEPTHOFFIELDFX_KERNEL_TYPE kernel     = SetupKernelType(desc, mode);
+
+    DEPTHOFFIELDFX_SCALE_FACTOR_INFO info;
+    GetScaleFactorInfo(0, static_cast<uint>(blurRadius), kernel, IsAnamorphic(desc), peakColor, 16, info);
+    GetScaleFactorInfo(info.m_scaleFactor, static_cast<uint>(blurRadius), kernel, IsAnamorphic(desc), peakColor, 16, info);
+    if (info.m_precisionBits >= minPrecisionBits)
+    {
+        m_tileScaleFactor = info.m_scaleFactor;
+        m_compactTile     = true;
+    }
+}
+
+// A task per row of squares of the coarsest level sums the color, the number and the blur radius of the
+// pixels of every level in one pass over its rows of the frame, then turns the sums of its rows of every
+// level into averages and coverage.
+void DEPTHOFFIELDFX_CPU_OPAQUE_DESC::build_pyramid(const DEPTHOFFIELDFX_CPU_DESC& desc, int levelCount)
+{
+    const int width         = static_cast<int>(desc.m_screenSize.x);
+    const int height        = static_cast<int>(desc.m_screenSize.y);
+    const int maxBlurRadius = static_cast<int>(desc.m_maxBlurRadius);
+    const int levelRadius   = PyramidLevelRadius(maxBlurRadius);
+    const int coarsest      = levelCount - 1;
+
+    m_threadPool.dispatch(static_cast<uint>(m_pyramidLevels[coarsest].height), [&](uint taskIndex, uint) {
+        const int band = static_cast<int>(taskIndex);
+        for (int level = 1; level < levelCount; ++level)
+        {
+            PYRAMID_LEVEL& pyramidLevel = m_pyramidLevels[level];
+            const size_t   y0           = static_cast<size_t>(band << (coarsest - level));
+            const size_t   y1           = static_cast<size_t>(MIN((band + 1) << (coarsest - level), pyramidLevel.height));
+            memset(&pyramidLevel.source[y0 * pyramidLevel.width * 4], 0, (y1 - y0) * pyramidLevel.width * 4 * sizeof(float));
+            memset(&pyramidLevel.accumulation[y0 * pyramidLevel.width * 4], 0, (y1 - y0) * pyramidLevel.width * 4 * sizeof(float));
+        }
+
+        // the first lane of the accumulation sums the blur radius
+        const int y1 = MIN((band + 1) << coarsest, height);
+        for (int y = band << coarsest; y < y1; ++y)
+        {
+            for (int x = 0; x < width; ++x)
+            {
+                const int blurRadius = CocToBlurRadius(SampleCoc(desc, m_pCocParams, x, y), maxBlurRadius);
+                const int level      = PyramidLevel(blurRadius);
+                if (level == 0)
+                {
+                    continue;
+                }
+
+                PYRAMID_LEVEL& pyramidLevel = m_pyramidLevels[level];
+                const size_t   texel        = static_cast<size_t>(y >> level) * pyramidLevel.width + (x >> level);
+
+                float color[3];
+                LoadColor(desc.m_color, x, y, color);
+                pyramidLevel.source[texel * 4 + 0] += color[0];
+                pyramidLevel.source[texel * 4 + 1] += color[1];
+                pyramidLevel.source[texel * 4 + 2] += color[2];
+                pyramidLevel.source[texel * 4 + 3] += 1.0f;
+                pyramidLevel.accumulation[texel * 4] += static_cast<float>(blurRadius);
+            }
+        }
+
+        for (int level = 1; level < levelCount; ++level)
+        {
+            PYRAMID_LEVEL& pyramidLevel = m_pyramidLevels[level];
+            const size_t   texel0       = static_cast<size_t>(band << (coarsest - level)) * pyramidLevel.width;
+            const size_t   texel1       = static_cast<size_t>(MIN((band + 1) << (coarsest - level), pyramidLevel.height)) * pyramidLevel.width;
+            for (size_t texel = texel0; texel < texel1; ++texel)
+            {
+                float*      pSource = &pyramidLevel.source[texel * 4];
+                const float count   = pSource[3];
+                if (count > 0.0f)
+                {
+                    pSource[0] /= count;
+                    pSource[1] /= count;
+                    pSource[2] /= count;
+                    pSource[3] = count / static_cast<float>(1 << (2 * level));
+                }
+
+                // the radius is in pixels of the level
+                pyramidLevel.blurRadius[texel] = static_cast<uint8>((count > 0.0f) ? CocToBlurRadius(pyramidLevel.accumulation[texel * 4] / (count * static_cast<float>(1 << level)), levelRadius) : 0);
+            }
+        }
+    });
+}
+
+// The tiles of the frame cover a level, the coarser levels take fewer of them.
+void DEPTHOFFIELDFX_CPU_OPAQUE_DESC::render_pyramid_level(const DEPTHOFFIELDFX_CPU_DESC& desc, int level, int levelCount)
+{
+    const int width       = PyramidLevelSize(static_cast<int>(desc.m_screenSize.x), level);
+    const int height      = PyramidLevelSize(static_cast<int>(desc.m_screenSize.y), level);
+    const int levelRadius = PyramidLevelRadius(static_cast<int>(desc.m_maxBlurRadius));
+
+    m_pyramidLevel = level;
+    for (int tileY = 0; tileY < height; tileY += m_tileSize)
+    {
+        for (int tileX = 0; tileX < width; tileX += m_tileSize)
+        {
+            const REGION      tile   = { tileX, tileY, MIN(m_tileSize, width - tileX), MIN(m_tileSize, height - tileY) };
+            const TILE_LAYOUT layout = GetTileLayout(desc, tile, width, height, levelRadius, false, false);
+
+            m_bufferWidth     = BufferWidth(layout);
+            m_bufferHeight    = BufferHeight(layout);
+            m_tileScaleFactor = m_frameScaleFactor;
+            m_compactTile     = false;
+            scatter_and_integrate(desc, layout, SETUP_MODE_PYRAMID);
+
+            PASS_TIMER timer(m_passMilliseconds[DEPTHOFFIELDFX_PASS_READ_FINAL_RESULT]);
+            read_pyramid_result(desc, layout, tile, level, levelCount);
+        }
+    }
+    m_pyramidLevel = 0;
+}
+
+// clears, scatters and integrates the intermediate buffer of a tile
+void DEPTHOFFIELDFX_CPU_OPAQUE_DESC::scatter_and_integrate(const DEPTHOFFIELDFX_CPU_DESC& desc, const TILE_LAYOUT& layout, SETUP_MODE mode)
+{
+    // the private plane reduction overwrites the whole buffer
+    if (desc.m_scatterMode != DEPTHOFFIELDFX_CPU_SCATTER_MODE_PRIVATE_PLANES)
+    {
+        PASS_TIMER timer(m_passMilliseconds[DEPTHOFFIELDFX_PASS_CLEAR]);
+        clear_intermediate();
+    }
+
+    {
+        PASS_TIMER timer(m_passMilliseconds[DEPTHOFFIELDFX_PASS_FAST_FILTER_SETUP]);
+        fast_filter_setup(desc, layout, mode);
+    }
+
+    if (desc.m_scatterMode == DEPTHOFFIELDFX_CPU_SCATTER_MODE_PRIVATE_PLANES)
+    {
+        PASS_TIMER timer(m_passMilliseconds[DEPTHOFFIELDFX_PASS_CLEAR]);
+        reduce_scatter_planes(layout);
+    }
+
+    integrate(desc.m_transposeMode, SetupKernel(desc, mode).m_desc.m_order);
+}
+
+void DEPTHOFFIELDFX_CPU_OPAQUE_DESC::clear_intermediate()
+{
+    const uint rowsPerTask = 64;
+    const uint taskCount   = (m_bufferHeight + rowsPerTask - 1) / rowsPerTask;
+
+    m_threadPool.dispatch(taskCount, [&](uint taskIndex, uint) {
+        const uint y0 = taskIndex * rowsPerTask;
+        const uint y1 = MIN(y0 + rowsPerTask, m_bufferHeight);
+        memset(ElementAt(&m_intermediateBuffer[0], static_cast<size_t>(y0) * m_bufferWidth, m_compactTile), 0, static_cast<size_t>(y1 - y0) * m_bufferWidth * ElementBytes(m_compactTile));
+    });
+}
+
+void DEPTHOFFIELDFX_CPU_OPAQUE_DESC::fast_filter_setup(const DEPTHOFFIELDFX_CPU_DESC& desc, const TILE_LAYOUT& layout, SETUP_MODE mode)
+{
+    SETUP_TARGET target;
+    target.pBuffer         = &m_intermediateBuffer[0];
+    target.firstRow        = 0;
+    target.region          = layout.bufferRegion;
+    target.bufferWidth     = static_cast<int>(m_bufferWidth);
+    target.padding         = layout.padding;
+    target.maxBlurRadius   = layout.maxBlurRadius;
+    target.scaleFactor     = static_cast<float>(1u << m_tileScaleFactor);
+    target.atomic          = false;
+    target.compact         = m_compactTile;
+    target.pQuadCoc        = layout.halfRes ? &m_quadCoc[0] : nullptr;
+    target.frameBlurRadius = static_cast<int>(desc.m_maxBlurRadius);
+    target.nearLayerColumn = layout.layered ? static_cast<int>(LayerWidth(layout)) : 0;
+    target.pKernel         = &SetupKernel(desc, mode);
+    target.pCocParams      = m_pCocParams;
+    target.pPyramidLevel   = ((mode == SETUP_MODE_PYRAMID) && (m_pyramidLevel > 0)) ? &m_pyramidLevels[m_pyramidLevel] : nullptr;
+    target.anamorphic      = IsAnamorphic(desc);
+    target.orientation     = desc.m_bokehOrientation;
+    target.gridWidth       = static_cast<int>(desc.m_screenSize.x);
+    target.gridHeight      = static_cast<int>(desc.m_screenSize.y);
+    if (target.pPyramidLevel != nullptr)
+    {
+        target.gridWidth  = target.pPyramidLevel->width;
+        target.gridHeight = target.pPyramidLevel->height;
+    }
+    else if (layout.halfRes)
+    {
+        target.gridWidth  = (target.gridWidth + 1) / 2;
+        target.gridHeight = (target.gridHeight + 1) / 2;
+    }
+    for (int blurRadius = 0; blurRadius <= s_maxKernelTableRadius; ++blurRadius)
+    {
+        target.squeezedRadii[blurRadius] = static_cast<int>(static_cast<float>(blurRadius) / desc.m_anamorphicSqueeze + 0.5f);
+    }
+
+    switch (desc.m_scatterMode)
+    {
+    case DEPTHOFFIELDFX_CPU_SCATTER_MODE_PRIVATE_PLANES:
+        scatter_private_planes(desc, target, mode);
+        break;
+    case DEPTHOFFIELDFX_CPU_SCATTER_MODE_SHARDED_ATOMICS:
+        scatter_sharded_atomics(desc, target, mode);
+        break;
+    case DEPTHOFFIELDFX_CPU_SCATTER_MODE_BANDED:
+        scatter_banded(desc, target, mode);
+        break;
+    }
+}
+
+void DEPTHOFFIELDFX_CPU_OPAQUE_DESC::scatter_banded(const DEPTHOFFIELDFX_CPU_DESC& desc, const SETUP_TARGET& target, SETUP_MODE mode)
+{
+    // Bands at least as high as the halo only overlap their direct neighbours,
+    // so all even bands and then all odd bands can be scattered in parallel without atomics.
+    const int height     = target.region.height;
+    const int bandHeight = MAX(ScatterHaloRows(target.padding), 16);
+    const int bandCount  = (height + bandHeight - 1) / bandHeight;
+
+    for (int parity = 0; parity < 2; ++parity)
+    {
+        m_threadPool.dispatch(static_cast<uint>((bandCount + 1 - parity) / 2), [&](uint taskIndex, uint) {
+            const int band = static_cast<int>(taskIndex) * 2 + parity;
+            ScatterRows(desc, target, mode, band * bandHeight, MIN((band + 1) * bandHeight, height));
+        });
+    }
+}
+
+void DEPTHOFFIELDFX_CPU_OPAQUE_DESC::scatter_sharded_atomics(const DEPTHOFFIELDFX_CPU_DESC& desc, const SETUP_TARGET& target, SETUP_MODE mode)
+{
+    // Each task owns a contiguous shard of source rows, only the halo rows shared with
+    // the neighbouring shards see contention. Several shards per thread balance the load.
+    const int height     = target.region.height;
+    const int shardCount = MIN(static_cast<int>(m_threadPool.thread_count()) * 4, MAX(height / 2, 1));
+    const int shardRows  = EvenBandHeight(height, shardCount);
+
+    SETUP_TARGET atomicTarget = target;
+    atomicTarget.atomic       = true;
+
+    m_threadPool.dispatch(static_cast<uint>((height + shardRows - 1) / shardRows), [&](uint taskIndex, uint) {
+        const int shard = static_cast<int>(taskIndex);
+        ScatterRows(desc, atomicTarget, mode, shard * shardRows, MIN((shard + 1) * shardRows, height));
+    });
+}
+
+void DEPTHOFFIELDFX_CPU_OPAQUE_DESC::scatter_private_planes(const DEPTHOFFIELDFX_CPU_DESC& desc, const SETUP_TARGET& target, SETUP_MODE mode)
+{
+    // One band of source rows per thread. Each band scatters into a private plane that covers
+    // its rows plus the halo, reduce_scatter_planes() then sums them into the intermediate buffer.
+    const int height     = target.region.height;
+    const int bandHeight = m_planeBandHeight;
+    const int usedBands  = (height + bandHeight - 1) / bandHeight;
+    const int planeRows  = bandHeight + ScatterHaloRows(target.padding);
+    const int firstRow   = s_scatterFirstRow;
+
+    m_threadPool.dispatch(static_cast<uint>(usedBands), [&](uint taskIndex, uint) {
+        const int band   = static_cast<int>(taskIndex);
+        uint4*    pPlane = &m_scatterPlanes[taskIndex][0];
+        memset(pPlane, 0, static_cast<size_t>(planeRows) * m_bufferWidth * ElementBytes(m_compactTile));
+
+        SETUP_TARGET planeTarget = target;
+        planeTarget.pBuffer      = pPlane;
+        planeTarget.firstRow     = band * bandHeight + firstRow;
+        ScatterRows(desc, planeTarget, mode, band * bandHeight, MIN((band + 1) * bandHeight, height));
+    });
+}
+
+// Parallel reduction over rows of the buffer, planes are added in band order.
+// The reduction writes every row of the buffer, so it doubles as the clear.
+void DEPTHOFFIELDFX_CPU_OPAQUE_DESC::reduce_scatter_planes(const TILE_LAYOUT& layout)
+{
+    const int  bandHeight  = m_planeBandHeight;
+    const int  usedBands   = (layout.bufferRegion.height + bandHeight - 1) / bandHeight;
+    const int  planeRows   = bandHeight + ScatterHaloRows(layout.padding);
+    const int  firstRow    = s_scatterFirstRow;
+    const uint rowsPerTask = 16;
+
+    m_threadPool.dispatch((m_bufferHeight + rowsPerTask - 1) / rowsPerTask, [&](uint taskIndex, uint) {
+        const uint y0 = taskIndex * rowsPerTask;
+        const uint y1 = MIN(y0 + rowsPerTask, m_bufferHeight);
+        for (uint y = y0; y < y1; ++y)
+        {
+            uint* pDst = ElementAt(&m_intermediateBuffer[0], static_cast<size_t>(y) * m_bufferWidth, m_compactTile);
+            memset(pDst, 0, m_bufferWidth * ElementBytes(m_compactTile));
+
+            for (int band = 0; band < usedBands; ++band)
+            {
+                const int planeRow = static_cast<int>(y) - (band * bandHeight + firstRow);
+                if ((planeRow < 0) || (planeRow >= planeRows))
+                {
+                    continue;
+                }
+
+                const uint* pSrc = ElementAt(&m_scatterPlanes[band][0], static_cast<size_t>(planeRow) * m_bufferWidth, m_compactTile);
+                if (m_compactTile)
+                {
+                    uint16*       pDstLanes = reinterpret_cast<uint16*>(pDst);
+                    const uint16* pSrcLanes = reinterpret_cast<const uint16*>(pSrc);
+                    for (uint i = 0; i < m_bufferWidth * 4; ++i)
+                    {
+                        pDstLanes[i] = static_cast<uint16>(pDstLanes[i] + pSrcLanes[i]);
+                    }
+                }
+                else
+                {
+                    for (uint i = 0; i < m_bufferWidth * 4; ++i)
+                    {
+                        pDst[i] += pSrc[i];
+                    }
+                }
+            }
+        }
+    });
+}
+
+void DEPTHOFFIELDFX_CPU_OPAQUE_DESC::integrate(DEPTHOFFIELDFX_CPU_TRANSPOSE_MODE transposeMode, uint order)
+{
+    uint4* pBuffer           = &m_intermediateBuffer[0];
+    uint4* pBufferTransposed = m_intermediateBufferTransposed.empty() ? nullptr : &m_intermediateBufferTransposed[0];
+
+    switch (transposeMode)
+    {
+    case DEPTHOFFIELDFX_CPU_TRANSPOSE_MODE_DIRECT:
+    {
+        // do Vertical integration
+        {
+            PASS_TIMER timer(m_passMilliseconds[DEPTHOFFIELDFX_PASS_VERTICAL_INTEGRATE]);
+            vertical_integrate(pBuffer, pBufferTransposed, m_bufferWidth, m_bufferHeight, order);
+        }
+        // do vertical integration by transposing the image and doing horizontal integration again
+        PASS_TIMER timer(m_passMilliseconds[DEPTHOFFIELDFX_PASS_HORIZONTAL_INTEGRATE]);
+        vertical_integrate(pBufferTransposed, pBuffer, m_bufferHeight, m_bufferWidth, order);
+        break;
+    }
+    case DEPTHOFFIELDFX_CPU_TRANSPOSE_MODE_TILED:
+    case DEPTHOFFIELDFX_CPU_TRANSPOSE_MODE_TILED_NON_TEMPORAL:
+    {
+        const bool nonTemporal = (transposeMode == DEPTHOFFIELDFX_CPU_TRANSPOSE_MODE_TILED_NON_TEMPORAL);
+        {
+            PASS_TIMER timer(m_passMilliseconds[DEPTHOFFIELDFX_PASS_VERTICAL_INTEGRATE]);
+            vertical_integrate_tiled(pBuffer, pBufferTransposed, m_bufferWidth, m_bufferHeight, order, nonTemporal);
+        }
+        PASS_TIMER timer(m_passMilliseconds[DEPTHOFFIELDFX_PASS_HORIZONTAL_INTEGRATE]);
+        vertical_integrate_tiled(pBufferTransposed, pBuffer, m_bufferHeight, m_bufferWidth, order, nonTemporal);
+        break;
+    }
+    case DEPTHOFFIELDFX_CPU_TRANSPOSE_MODE_IN_PLACE:
+    {
+        // every element is read before it is overwritten, so both passes can integrate in place
+        {
+            PASS_TIMER timer(m_passMilliseconds[DEPTHOFFIELDFX_PASS_VERTICAL_INTEGRATE]);
+            vertical_integrate(pBuffer, nullptr, m_bufferWidth, m_bufferHeight, order);
+        }
+        PASS_TIMER timer(m_passMilliseconds[DEPTHOFFIELDFX_PASS_HORIZONTAL_INTEGRATE]);
+        horizontal_integrate_in_place(order);
+        break;
+    }
+    }
+}
+
+// pDst of nullptr integrates in place instead of writing the result transposed
+void DEPTHOFFIELDFX_CPU_OPAQUE_DESC::vertical_integrate(const uint4* pSrc, uint4* pDst, uint width, uint height, uint order)
+{
+    const uint stripWidth = DEPTHOFFIELDFX_CPU_INTEGRATE_MAX_STRIP_WIDTH;
+    const uint taskCount  = (width + stripWidth - 1) / stripWidth;
+
+    // compact tiles are only integrated in place
+    const DEPTHOFFIELDFX_CPU_INTEGRATE_FN pIntegrateKernel = m_compactTile ? m_pCompactIntegrateKernel : m_pIntegrateKernel;
+
+    m_threadPool.dispatch(taskCount, [&](uint taskIndex, uint) {
+        const uint x0 = taskIndex * stripWidth;
+
+        DEPTHOFFIELDFX_CPU_INTEGRATE_STRIP strip;
+        strip.pSrc            = ElementAt(pSrc, x0, m_compactTile);
+        strip.pState          = nullptr;
+        strip.srcRowPitch     = width;
+        strip.srcColumnPitch  = 1;
+        strip.columnCount     = MIN(stripWidth, width - x0);
+        strip.rowCount        = height;
+        strip.order           = order;
+        strip.resume          = false;
+        if (pDst != nullptr)
+        {
+            strip.pDst           = pDst[static_cast<size_t>(x0) * height].v;
+            strip.dstRowPitch    = 1;
+            strip.dstColumnPitch = height;
+        }
+        else
+        {
+            strip.pDst           = const_cast<uint*>(strip.pSrc);
+            strip.dstRowPitch    = width;
+            strip.dstColumnPitch = 1;
+        }
+        pIntegrateKernel(strip);
+    });
+}
+
+void DEPTHOFFIELDFX_CPU_OPAQUE_DESC::vertical_integrate_tiled(const uint4* pSrc, uint4* pDst, uint width, uint height, uint order, bool nonTemporal)
+{
+    const uint tileSize  = DEPTHOFFIELDFX_CPU_TRANSPOSE_TILE_SIZE;
+    const uint taskCount = (width + tileSize - 1) / tileSize;
+
+    m_threadPool.dispatch(taskCount, [&](uint taskIndex, uint) {
+        uint4 tile[DEPTHOFFIELDFX_CPU_TRANSPOSE_TILE_SIZE * DEPTHOFFIELDFX_CPU_TRANSPOSE_TILE_SIZE];
+        uint4 state[3 * DEPTHOFFIELDFX_CPU_INTEGRATE_MAX_STRIP_WIDTH];
+
+        const uint x0 = taskIndex * tileSize;
+
+        // integrate a column of tiles top to bottom, carrying the running sums from tile to tile
+        DEPTHOFFIELDFX_CPU_INTEGRATE_STRIP strip;
+        strip.pDst            = tile[0].v;
+        strip.pState          = state[0].v;
+        strip.srcRowPitch     = width;
+        strip.srcColumnPitch  = 1;
+        strip.dstRowPitch     = tileSize;
+        strip.dstColumnPitch  = 1;
+        strip.columnCount     = MIN(tileSize, width - x0);
+        strip.order           = order;
+
+        for (uint y0 = 0; y0 < height; y0 += tileSize)
+        {
+            strip.pSrc     = pSrc[static_cast<size_t>(y0) * width + x0].v;
+            strip.rowCount = MIN(tileSize, height - y0);
+            strip.resume   = (y0 != 0);
+            m_pIntegrateKernel(strip);
+
+            TransposeTile(tile[0].v, tileSize, pDst[static_cast<size_t>(x0) * height + y0].v, height, strip.columnCount, strip.rowCount, nonTemporal);
+        }
+    });
+}
+
+void DEPTHOFFIELDFX_CPU_OPAQUE_DESC::horizontal_integrate_in_place(uint order)
+{
+    const uint                            taskCount        = (m_bufferHeight + s_horizontalIntegrateRows - 1) / s_horizontalIntegrateRows;
+    const DEPTHOFFIELDFX_CPU_INTEGRATE_FN pIntegrateKernel = m_compactTile ? m_pCompactIntegrateKernel : m_pIntegrateKernel;
+
+    m_threadPool.dispatch(taskCount, [&](uint taskIndex, uint) {
+        const uint y0 = taskIndex * s_horizontalIntegrateRows;
+
+        // the rows of the strip are the "columns" of the kernel
+        DEPTHOFFIELDFX_CPU_INTEGRATE_STRIP strip;
+        strip.pSrc            = ElementAt(&m_intermediateBuffer[0], static_cast<size_t>(y0) * m_bufferWidth, m_compactTile);
+        strip.pDst            = ElementAt(&m_intermediateBuffer[0], static_cast<size_t>(y0) * m_bufferWidth, m_compactTile);
+        strip.pState          = nullptr;
+        strip.srcRowPitch     = 1;
+        strip.srcColumnPitch  = m_bufferWidth;
+        strip.dstRowPitch     = 1;
+        strip.dstColumnPitch  = m_bufferWidth;
+        strip.columnCount     = MIN(s_horizontalIntegrateRows, m_bufferHeight - y0);
+        strip.rowCount        = m_bufferWidth;
+        strip.order           = order;
+        strip.resume          = false;
+        pIntegrateKernel(strip);
+    });
+}
+
+// Blends the normalized near field over the far field by its coverage, leaving a result with a weight of 1.
+// Without a near field the far field is left for the caller to normalize, without a far field the near
+// field is taken as a whole.
+static void CompositeNearField(const float nearField[4], float invCoverage, float farField[4])
+{
+    if (nearField[3] == 0.0f)
+    {
+        return;
+    }
+
+    const float alpha     = (farField[3] != 0.0f) ? MIN(nearField[3] * invCoverage, 1.0f) : 1.0f;
+    const float farWeight = (alpha < 1.0f) ? (1.0f - alpha) / farField[3] : 0.0f;
+    for (int i = 0; i < 3; ++i)
+    {
+        farField[i] = alpha * nearField[i] / nearField[3] + farWeight * farField[i];
+    }
+    farField[3] = 1.0f;
+}
+
+// Writes the pixels of the tile, the buffer holds the source region. A layered buffer composites the
+// near field over the far one. The weight of the near field is its coverage times the scale factor,
+// a pixel fully covered by it hides the far field, one it does not reach keeps the far field alone.
+void DEPTHOFFIELDFX_CPU_OPAQUE_DESC::read_final_result(const DEPTHOFFIELDFX_CPU_DESC& desc, const TILE_LAYOUT& layout, const REGION& tile)
+{
+    const uint  width       = static_cast<uint>(tile.width);
+    const uint  height      = static_cast<uint>(tile.height);
+    const uint  offsetX     = static_cast<uint>(tile.x - layout.source.x + layout.padding);
+    const uint  offsetY     = static_cast<uint>(tile.y - layout.source.y + layout.padding);
+    const uint  taskCount   = (height + s_readResultRows - 1) / s_readResultRows;
+    const uint  nearColumn  = LayerWidth(layout);
+    const float invCoverage = 1.0f / static_cast<float>(1u << m_tileScaleFactor);
+
+    m_threadPool.dispatch(taskCount, [&](uint taskIndex, uint) {
+        const uint y0 = taskIndex * s_readResultRows;
+        const uint y1 = MIN(y0 + s_readResultRows, height);
+        for (uint y = y0; y < y1; ++y)
+        {
+            const size_t row = static_cast<size_t>(y + offsetY) * m_bufferWidth + offsetX;
+            for (uint x = 0; x < width; ++x)
+            {
+                // normalize the result
+                float result[4];
+                LoadElement(&m_intermediateBuffer[0], row + x, m_compactTile, result);
+                if (layout.layered)
+                {
+                    float nearField[4];
+                    LoadElement(&m_intermediateBuffer[0], row + nearColumn + x, m_compactTile, nearField);
+                    CompositeNearField(nearField, invCoverage, result);
+                }
+                result[0] /= result[3];
+                result[1] /= result[3];
+                result[2] /= result[3];
+                result[3] = 1.0f;
+
+                if (desc.m_convertToSRGB)
+                {
+                    result[0] = LinearToSRGB(result[0]);
+                    result[1] = LinearToSRGB(result[1]);
+                    result[2] = LinearToSRGB(result[2]);
+                }
+
+                StoreColor(desc.m_result, tile.x + static_cast<int>(x), tile.y + static_cast<int>(y), result);
+            }
+        }
+    });
+}
+
+// Upsamples the half resolution buffer to the pixels of the tile. The four half resolution pixels around
+// a pixel are weighted bilinearly and by how close the circle of confusion of their quad is to its own,
+// so blur does not leak across depth edges. Pixels in focus take the full resolution color instead.
+void DEPTHOFFIELDFX_CPU_OPAQUE_DESC::upsample_final_result(const DEPTHOFFIELDFX_CPU_DESC& desc, const TILE_LAYOUT& layout, const REGION& tile)
+{
+    const int    halfWidth  = (static_cast<int>(desc.m_screenSize.x) + 1) / 2;
+    const int    halfHeight = (static_cast<int>(desc.m_screenSize.y) + 1) / 2;
+    const REGION region     = layout.bufferRegion;
+    const uint   taskCount  = (static_cast<uint>(tile.height) + s_readResultRows - 1) / s_readResultRows;
+
+    m_threadPool.dispatch(taskCount, [&](uint taskIndex, uint) {
+        const int y0 = tile.y + static_cast<int>(taskIndex * s_readResultRows);
+        const int y1 = MIN(y0 + static_cast<int>(s_readResultRows), tile.y + tile.height);
+        for (int y = y0; y < y1; ++y)
+        {
+            // half resolution pixel centers sit between two full resolution pixels
+            const int   halfY0  = (y + 1) / 2 - 1;
+            const float weightY = (y & 1) ? 0.25f : 0.75f;
+
+            for (int x = tile.x; x < tile.x + tile.width; ++x)
+            {
+                const int   halfX0  = (x + 1) / 2 - 1;
+                const float weightX = (x & 1) ? 0.25f : 0.75f;
+                const float coc     = fabsf(SampleCoc(desc, m_pCocParams, x, y));
+
+                float blurred[3]  = { 0.0f, 0.0f, 0.0f };
+                float totalWeight = 0.0f;
+                for (int i = 0; i < 4; ++i)
+                {
+                    const int halfX = MIN(MAX(halfX0 + (i & 1), 0), halfWidth - 1) - region.x;
+                    const int halfY = MIN(MAX(halfY0 + (i >> 1), 0), halfHeight - 1) - region.y;
+
+                    const float quadCoc = m_quadCoc[static_cast<size_t>(halfY) * region.width + halfX];
+                    const float weight  = ((i & 1) ? weightX : 1.0f - weightX) * ((i >> 1) ? weightY : 1.0f - weightY) / (1.0f + fabsf(quadCoc - coc));
+
+                    float texel[4];
+                    LoadElement(&m_intermediateBuffer[0], static_cast<size_t>(halfY + layout.padding) * m_bufferWidth + halfX + layout.padding, m_compactTile, texel);
+
+                    // normalize the result
+                    const float normalization = weight / texel[3];
+                    blurred[0] += texel[0] * normalization;
+                    blurred[1] += texel[1] * normalization;
+                    blurred[2] += texel[2] * normalization;
+                    totalWeight += weight;
+                }
+
+                // blend from the sharp color at a circle of confusion of 1 to the blur at 2, where the setup stops scattering texels alone
+                float color[3];
+                LoadColor(desc.m_color, x, y, color);
+                const float blend = MIN(MAX(coc - 1.0f, 0.0f), 1.0f) / totalWeight;
+
+                float result[4];
+                result[0] = color[0] + (blurred[0] * blend - color[0] * blend * totalWeight);
+                result[1] = color[1] + (blurred[1] * blend - color[1] * blend * totalWeight);
+                result[2] = color[2] + (blurred[2] * blend - color[2] * blend * totalWeight);
+                result[3] = 1.0f;
+
+                if (desc.m_convertToSRGB)
+                {
+                    result[0] = LinearToSRGB(result[0]);
+                    result[1] = LinearToSRGB(result[1]);
+                    result[2] = LinearToSRGB(result[2]);
+                }
+
+                StoreColor(desc.m_result, x, y, result);
+            }
+        }
+    });
+}
+
+// Adds the bilinear upsample of the sums of the coarser level to the pixels of the tile of a level. The
+// coarser levels keep the unnormalized sums, the full resolution one normalizes them into the result.
+void DEPTHOFFIELDFX_CPU_OPAQUE_DESC::read_pyramid_result(const DEPTHOFFIELDFX_CPU_DESC& desc, const TILE_LAYOUT& layout, const REGION& tile, int level, int levelCount)
+{
+    const PYRAMID_LEVEL* pCoarser  = (level + 1 < levelCount) ? &m_pyramidLevels[level + 1] : nullptr;
+    PYRAMID_LEVEL&       current   = m_pyramidLevels[level];
+    const uint           offsetX   = static_cast<uint>(tile.x - layout.source.x + layout.padding);
+    const uint           offsetY   = static_cast<uint>(tile.y - layout.source.y + layout.padding);
+    const uint           taskCount = (static_cast<uint>(tile.height) + s_readResultRows - 1) / s_readResultRows;
+
+    m_threadPool.dispatch(taskCount, [&](uint taskIndex, uint) {
+        const uint y0 = taskIndex * s_readResultRows;
+        const uint y1 = MIN(y0 + s_readResultRows, static_cast<uint>(tile.height));
+        for (uint y = y0; y < y1; ++y)
+        {
+            const size_t row = static_cast<size_t>(y + offsetY) * m_bufferWidth + offsetX;
+            for (uint x = 0; x < static_cast<uint>(tile.width); ++x)
+            {
+                const int pixelX = tile.x + static_cast<int>(x);
+                const int pixelY = tile.y + static_cast<int>(y);
+
+                float result[4];
+                LoadElement(&m_intermediateBuffer[0], row + x, false, result);
+                if (pCoarser != nullptr)
+                {
+                    AddPyramidUpsample(*pCoarser, pixelX, pixelY, result);
+                }
+
+                if (level > 0)
+                {
+                    memcpy(&current.accumulation[(static_cast<size_t>(pixelY) * current.width + pixelX) * 4], result, sizeof(result));
+                    continue;
+                }
+
+                // normalize the result
+                result[0] /= result[3];
+                result[1] /= result[3];
+                result[2] /= result[3];
+                result[3] = 1.0f;
+
+                if (desc.m_convertToSRGB)
+                {
+                    result[0] = LinearToSRGB(result[0]);
+                    result[1] = LinearToSRGB(result[1]);
+                    result[2] = LinearToSRGB(result[2]);
+                }
+
+                StoreColor(desc.m_result, pixelX, pixelY, result);
+            }
+        }
+    });
+}
+}
@@ -0,0 +1,208 @@
+//
+// Copyright (c) 2017 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#ifndef AMD_DEPTHOFFIELDFX_CPU_OPAQUE_H
+#define AMD_DEPTHOFFIELDFX_CPU_OPAQUE_H
+
+#include <vector>
+
+#include "AMD_DepthOfFieldFX_CPU.h"
+#include "AMD_DepthOfFieldFX_CPU_Coc.h"
+#include "AMD_DepthOfFieldFX_CPU_Integrate.h"
+#include "AMD_DepthOfFieldFX_Lens.h"
+#include "AMD_DepthOfFieldFX_ThreadPool.h"
+
+#pragma warning(disable : 4127)  // disable conditional expression is constant warnings
+
+namespace AMD {
+struct SETUP_TARGET;
+
+struct DEPTHOFFIELDFX_CPU_OPAQUE_DESC
+{
+public:
+#pragma warning(push)
+#pragma warning(disable : 4201)  // suppress nameless struct/union level 4 warnings
+    AMD_DECLARE_BASIC_VECTOR_TYPE;
+#pragma warning(pop)
+
+    enum SETUP_MODE
+    {
+        SETUP_MODE_BARTLETT,
+        SETUP_MODE_BARTLETT_QUARTER_RES,
+        SETUP_MODE_BOX,
+        SETUP_MODE_PYRAMID,
+    };
+
+    // rectangle of pixels in screen space
+    struct REGION
+    {
+        int x;
+        int y;
+        int width;
+        int height;
+    };
+
+    // Where a tile is scattered. source is the region of screen pixels read by the setup,
+    // bufferRegion the same region in the resolution of the intermediate buffer, which is
+    // half of the screen in the quarter res mode. A layered buffer holds the far field and
+    // then the near field side by side, each as wide as the region plus its padding.
+    struct TILE_LAYOUT
+    {
+        REGION source;
+        REGION bufferRegion;
+        int    maxBlurRadius;
+        int    padding;
+        bool   halfRes;
+        bool   layered;
+    };
+
+    // A level of DepthOfFieldFX_RenderPyramid at 1 / 2^level of the resolution, level 0 is the frame
+    // itself and has no surfaces. source holds the average color and the coverage of the pixels of every
+    // square the level blurs, blurRadius their blur radius at the level. accumulation receives the
+    // integrated sums of the level plus the upsampled ones of the coarser levels, and the sums of the
+    // pixels of every square while the levels are built.
+    struct PYRAMID_LEVEL
+    {
+        int                width;
+        int                height;
+        std::vector<float> source;
+        std::vector<uint8> blurRadius;
+        std::vector<float> accumulation;
+    };
+
+    DEPTHOFFIELDFX_CPU_OPAQUE_DESC(const DEPTHOFFIELDFX_CPU_DESC& desc);
+
+    DEPTHOFFIELDFX_RETURN_CODE initalize(const DEPTHOFFIELDFX_CPU_DESC& desc);
+    DEPTHOFFIELDFX_RETURN_CODE resize(const DEPTHOFFIELDFX_CPU_DESC& desc);
+    DEPTHOFFIELDFX_RETURN_CODE render(const DEPTHOFFIELDFX_CPU_DESC& desc);
+    DEPTHOFFIELDFX_RETURN_CODE render_quarter_res(const DEPTHOFFIELDFX_CPU_DESC& desc);
+    DEPTHOFFIELDFX_RETURN_CODE render_box(const DEPTHOFFIELDFX_CPU_DESC& desc);
+    DEPTHOFFIELDFX_RETURN_CODE render_pyramid(const DEPTHOFFIELDFX_CPU_DESC& desc);
+    DEPTHOFFIELDFX_RETURN_CODE trim();
+    DEPTHOFFIELDFX_RETURN_CODE release();
+    DEPTHOFFIELDFX_RETURN_CODE compute_coc(const DEPTHOFFIELDFX_CPU_DESC& desc);
+    DEPTHOFFIELDFX_RETURN_CODE compute_coc_statistics(const DEPTHOFFIELDFX_CPU_DESC& desc);
+
+    DEPTHOFFIELDFX_RETURN_CODE validate(const DEPTHOFFIELDFX_CPU_DESC& desc, SETUP_MODE mode) const;
+    DEPTHOFFIELDFX_RETURN_CODE get_frame_traffic(const DEPTHOFFIELDFX_CPU_DESC& desc, DEPTHOFFIELDFX_MEMORY_REQUIREMENTS& info) const;
+    DEPTHOFFIELDFX_RETURN_CODE render_passes(const DEPTHOFFIELDFX_CPU_DESC& desc, SETUP_MODE mode);
+
+    static uint64 tile_bytes(const DEPTHOFFIELDFX_CPU_DESC& desc, uint threadCount, int tileSize);
+    static int    choose_tile_size(const DEPTHOFFIELDFX_CPU_DESC& desc, uint threadCount);
+    static void   get_memory_requirements(const DEPTHOFFIELDFX_CPU_DESC& desc, DEPTHOFFIELDFX_MEMORY_REQUIREMENTS& info);
+    static void   get_pass_traffic(const DEPTHOFFIELDFX_CPU_DESC& desc, uint mode, uint threadCount, int tileSize, int maxBlurRadius, const REGION& active, DEPTHOFFIELDFX_PASS_TRAFFIC* pPasses);
+    static void   get_scale_factor_info(const DEPTHOFFIELDFX_CPU_DESC& desc, SETUP_MODE mode, float peakColor, uint laneBits, DEPTHOFFIELDFX_SCALE_FACTOR_INFO& info);
+
+    void  set_coc_params(const DEPTHOFFIELDFX_CPU_DESC& desc);
+    int   frame_blur_radius(const DEPTHOFFIELDFX_CPU_DESC& desc) const;
+    float measure_peak_color(const DEPTHOFFIELDFX_CPU_DESC& desc);
+    void  measure_source(const DEPTHOFFIELDFX_CPU_DESC& desc, const REGION& source, float& peakColor, float* pPeakCoc);
+    void  choose_tile_format(const DEPTHOFFIELDFX_CPU_DESC& desc, const TILE_LAYOUT& layout, SETUP_MODE mode);
+
+    REGION measure_defocus_bounds(const DEPTHOFFIELDFX_CPU_DESC& desc, bool halfRes);
+    REGION defocus_region(const DEPTHOFFIELDFX_CPU_DESC& desc, int maxBlurRadius, bool halfRes);
+    void   write_sharp_result(const DEPTHOFFIELDFX_CPU_DESC& desc, const REGION& active, bool halfRes);
+
+    void find_dirty_tiles(const DEPTHOFFIELDFX_CPU_DESC& desc, SETUP_MODE mode, int maxBlurRadius, const REGION& active);
+    void dirty_regions(const REGION& tile, int halo, std::vector<REGION>& regions) const;
+    bool reused_tile(int x, int y) const;
+    void reset_reuse();
+
+    void build_pyramid(const DEPTHOFFIELDFX_CPU_DESC& desc, int levelCount);
+    void render_pyramid_level(const DEPTHOFFIELDFX_CPU_DESC& desc, int level, int levelCount);
+
+    void scatter_and_integrate(const DEPTHOFFIELDFX_CPU_DESC& desc, const TILE_LAYOUT& layout, SETUP_MODE mode);
+    void clear_intermediate();
+    void fast_filter_setup(const DEPTHOFFIELDFX_CPU_DESC& desc, const TILE_LAYOUT& layout, SETUP_MODE mode);
+    void scatter_banded(const DEPTHOFFIELDFX_CPU_DESC& desc, const SETUP_TARGET& target, SETUP_MODE mode);
+    void scatter_sharded_atomics(const DEPTHOFFIELDFX_CPU_DESC& desc, const SETUP_TARGET& target, SETUP_MODE mode);
+    void scatter_private_planes(const DEPTHOFFIELDFX_CPU_DESC& desc, const SETUP_TARGET& target, SETUP_MODE mode);
+    void reduce_scatter_planes(const TILE_LAYOUT& layout);
+    void integrate(DEPTHOFFIELDFX_CPU_TRANSPOSE_MODE transposeMode, uint order);
+    void vertical_integrate(const uint4* pSrc, uint4* pDst, uint width, uint height, uint order);
+    void vertical_integrate_tiled(const uint4* pSrc, uint4* pDst, uint width, uint height, uint order, bool nonTemporal);
+    void horizontal_integrate_in_place(uint order);
+    void read_final_result(const DEPTHOFFIELDFX_CPU_DESC& desc, const TILE_LAYOUT& layout, const REGION& tile);
+    void upsample_final_result(const DEPTHOFFIELDFX_CPU_DESC& desc, const TILE_LAYOUT& layout, const REGION& tile);
+    void read_pyramid_result(const DEPTHOFFIELDFX_CPU_DESC& desc, const TILE_LAYOUT& layout, const REGION& tile, int level, int levelCount);
+
+    // edge of the square tiles the frame is rendered in, covers the whole frame without a memory budget
+    int m_tileSize;
+
+    // layout of the intermediate buffer for the current tile
+    uint m_bufferWidth;
+    uint m_bufferHeight;
+
+    std::vector<uint4> m_intermediateBuffer;
+    std::vector<uint4> m_intermediateBufferTransposed;
+
+    // circle of confusion of every half resolution pixel of the quarter res mode, read by the upsample
+    std::vector<float> m_quadCoc;
+
+    // band local delta planes of the private plane scatter, sized for the largest tile
+    std::vector<std::vector<uint4> > m_scatterPlanes;
+    int                              m_planeBandHeight;
+
+    // resizes in a row that left more than half of the buffer capacity unused
+    uint m_smallResizeCount;
+
+    // scale factor of the current frame, measured with m_autoScaleFactor
+    uint m_frameScaleFactor;
+
+    // lens constants of the current frame, m_pCocParams is null when the circle of confusion is read
+    DEPTHOFFIELDFX_COC_PARAMS        m_cocParams;
+    const DEPTHOFFIELDFX_COC_PARAMS* m_pCocParams;
+
+    // circle of confusion statistics of the last DepthOfFieldFX_ComputeCocStatistics, a class per tile,
+    // and the screen size they were computed at. No tile classes means no statistics.
+    DEPTHOFFIELDFX_CPU_COC_STATISTICS m_cocStatistics;
+    std::vector<uint8>                m_cocTileClasses;
+    uint2                             m_cocStatisticsScreenSize;
+
+    // Hashes of the sources of every reuse tile at the last render with m_reuseUnchangedTiles, a hash of
+    // its other inputs and its active region. No hashes means there is no previous result to reuse.
+    // m_reuseDirtyTiles marks the tiles the current render recomputes.
+    std::vector<uint64>                 m_reuseHashes;
+    std::vector<uint8>                  m_reuseDirtyTiles;
+    uint64                              m_reuseKey;
+    REGION                              m_reuseActive;
+    DEPTHOFFIELDFX_CPU_REUSE_STATISTICS m_reuseStatistics;
+
+    // levels of DepthOfFieldFX_RenderPyramid, allocated with m_pyramid, and the one being rendered
+    std::vector<PYRAMID_LEVEL> m_pyramidLevels;
+    int                        m_pyramidLevel;
+
+    // scale factor and lanes of the current tile, 16 bit lanes hold two elements per uint4
+    uint m_tileScaleFactor;
+    bool m_compactTile;
+
+    // wall clock time of every pass of the last render, summed over the tiles
+    double m_passMilliseconds[DEPTHOFFIELDFX_PASS_COUNT];
+
+    DEPTHOFFIELDFX_CPU_INTEGRATE_FN m_pIntegrateKernel;
+    DEPTHOFFIELDFX_CPU_INTEGRATE_FN m_pCompactIntegrateKernel;
+    DEPTHOFFIELDFX_THREAD_POOL      m_threadPool;
+};
+};
+
+#endif  // ndef AMD_DEPTHOFFIELDFX_CPU_OPAQUE_H
@@ -0,0 +1,64 @@
+//
+// Copyright (c) 2017 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include <string.h>
+
+#include "AMD_DepthOfFieldFX_CPU_Transpose.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define AMD_DEPTHOFFIELDFX_CPU_X86 1
+#include <emmintrin.h>
+#endif
+
+namespace AMD {
+void TransposeTile(const uint* pTile, size_t tilePitch, uint* pDst, size_t dstPitch, uint columnCount, uint rowCount, bool nonTemporal)
+{
+#if AMD_DEPTHOFFIELDFX_CPU_X86
+    if (nonTemporal && ((reinterpret_cast<size_t>(pDst) & 15) == 0))
+    {
+        const __m128i* pSrc = reinterpret_cast<const __m128i*>(pTile);
+        for (uint x = 0; x < columnCount; ++x)
+        {
+            __m128i* pDstRow = reinterpret_cast<__m128i*>(pDst) + x * dstPitch;
+            for (uint y = 0; y < rowCount; ++y)
+            {
+                _mm_stream_si128(pDstRow + y, _mm_loadu_si128(pSrc + y * tilePitch + x));
+            }
+        }
+
+        // make the streamed stores visible before another thread reads them
+        _mm_sfence();
+        return;
+    }
+#endif
+
+    for (uint x = 0; x < columnCount; ++x)
+    {
+        uint* pDstRow = pDst + x * dstPitch * 4;
+        for (uint y = 0; y < rowCount; ++y)
+        {
+            memcpy(pDstRow + y * 4, pTile + (y * tilePitch + x) * 4, 4 * sizeof(uint));
+        }
+    }
+}
+}
@@ -0,0 +1,46 @@
+//
+// Copyright (c) 2017 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#ifndef AMD_DEPTHOFFIELDFX_CPU_TRANSPOSE_H
+#define AMD_DEPTHOFFIELDFX_CPU_TRANSPOSE_H
+
+#include <stddef.h>
+
+#include "AMD_Types.h"
+
+namespace AMD {
+// a tile of int4 elements, 64x64 tiles are 64KB and stay in L2
+static const uint DEPTHOFFIELDFX_CPU_TRANSPOSE_TILE_SIZE = 64;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Write a row major tile of columnCount x rowCount int4 elements to pDst transposed:
+// tile element (x, y) at pTile[y * tilePitch + x] goes to pDst[x * dstPitch + y].
+// Every row of the destination receives rowCount contiguous elements, so with 64 rows each
+// store touches whole cache lines and one page per column instead of one page per element.
+// nonTemporal streams the destination past the caches, it is only used where the destination
+// is 16 byte aligned.
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void TransposeTile(const uint* pTile, size_t tilePitch, uint* pDst, size_t dstPitch, uint columnCount, uint rowCount, bool nonTemporal);
+}
+
+#endif  // AMD_DEPTHOFFIELDFX_CPU_TRANSPOSE_H
@@ -0,0 +1,264 @@
+//
+// Copyright (c) 2017 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
+#include "AMD_DepthOfFieldFX_Kernel.h"
+
+namespace AMD {
+static const DEPTHOFFIELDFX_KERNEL_DESC s_kernelDescs[DEPTHOFFIELDFX_KERNEL_TYPE_COUNT] = {
+    // the tent of half width r + 1
+    { 2, { { 1, 1, 1, false }, { 1, 1, 1, false } }, 2 },
+    // the box of radius r
+    { 1, { { 2, 1, 1, false } }, 1 },
+    // The quadratic B-spline, three boxes of 2 * ceil(r / 3) + 1 pixels. Odd boxes keep it centered, it
+    // covers the pixels of the tent and up to 2 more on each side with a smooth edge. Its last taps
+    // land up to 5 pixels past r, where the deltas cancel out.
+    { 3, { { 1, 2, 3, true }, { 1, 2, 3, true }, { 1, 2, 3, true } }, 2 },
+};
+
+static int BoxWidth(const DEPTHOFFIELDFX_KERNEL_BOX& box, int blurRadius)
+{
+    const int width = (box.m_radiusScale * blurRadius + box.m_bias) / box.m_divisor;
+    return box.m_odd ? 2 * width + 1 : MAX(width, 1);
+}
+
+static bool SameBox(const DEPTHOFFIELDFX_KERNEL_BOX& a, const DEPTHOFFIELDFX_KERNEL_BOX& b)
+{
+    return (a.m_radiusScale == b.m_radiusScale) && (a.m_bias == b.m_bias) && (a.m_divisor == b.m_divisor) && (a.m_odd == b.m_odd);
+}
+
+// Value of the 1D kernel at an offset from its pixel, the integer the integration leaves there. A delta
+// integrated n times is C(d + n - 1, n - 1) at the distance d past it.
+static double KernelValue(const DEPTHOFFIELDFX_KERNEL& kernel, int blurRadius, int offset)
+{
+    const int order = static_cast<int>(kernel.m_desc.m_order);
+    double    value = 0.0;
+    for (uint tap = 0; tap < kernel.m_tap1DCount; ++tap)
+    {
+        const int distance = offset - kernel.m_offsets[blurRadius][tap];
+        if (distance >= 0)
+        {
+            double integrated = 1.0;
+            for (int i = 1; i < order; ++i)
+            {
+                integrated = integrated * (distance + i) / i;
+            }
+            value += kernel.m_taps1D[tap].m_weight * integrated;
+        }
+    }
+    return value;
+}
+
+// The largest normalized weight of every offset grows with the blur radius, m_maxKernelSums[r] sums the
+// weights of the offsets reached so far. With a radius per axis the largest weight of a kernel normalized
+// over both axes is the product of the largest ones of each axis. The box is normalized by the larger
+// radius, which only covers fewer pixels with the same weight when the other one shrinks.
+static void BuildMaxKernelSums(DEPTHOFFIELDFX_KERNEL& kernel)
+{
+    const int reach = kernel.m_reach[s_maxKernelTableRadius];
+    const int size  = 2 * reach + 1;
+
+    std::vector<double> profile(size);
+    std::vector<double> maxAxisWeights(size, 0.0);
+    std::vector<double> maxWeights(static_cast<size_t>(size) * size, 0.0);
+    for (int blurRadius = 0; blurRadius <= s_maxKernelTableRadius; ++blurRadius)
+    {
+        const double area   = GetKernelArea(kernel, blurRadius);
+        const double weight = (kernel.m_desc.m_normalizedAxes == 2) ? area * area : area;
+        double axisSum = 0.0;
+        for (int offset = -reach; offset <= reach; ++offset)
+        {
+            profile[offset + reach] = KernelValue(kernel, blurRadius, offset);
+
+            maxAxisWeights[offset + reach] = MAX(maxAxisWeights[offset + reach], profile[offset + reach] / area);
+            axisSum += maxAxisWeights[offset + reach];
+        }
+
+        double sum = 0.0;
+        for (int b = 0; b < size; ++b)
+        {
+            for (int a = 0; a < size; ++a)
+            {
+                double& maxWeight = maxWeights[static_cast<size_t>(b) * size + a];
+                maxWeight         = MAX(maxWeight, profile[a] * profile[b] / weight);
+                sum += maxWeight;
+            }
+        }
+        kernel.m_maxKernelSums[blurRadius]            = sum;
+        kernel.m_maxAnisotropicKernelSums[blurRadius] = (kernel.m_desc.m_normalizedAxes == 2) ? axisSum * axisSum : sum;
+    }
+}
+
+void BuildKernel(const DEPTHOFFIELDFX_KERNEL_DESC& desc, DEPTHOFFIELDFX_KERNEL& kernel)
+{
+    assert((desc.m_order > 0) && (desc.m_order <= s_maxKernelOrder));
+
+    memset(&kernel, 0, sizeof(kernel));
+    kernel.m_desc = desc;
+
+    for (uint subset = 0; subset < (1u << desc.m_order); ++subset)
+    {
+        // every box of the subset is counted against the first box alike to it
+        DEPTHOFFIELDFX_KERNEL_TAP_1D tap;
+        memset(&tap, 0, sizeof(tap));
+        for (uint i = 0; i < desc.m_order; ++i)
+        {
+            if (subset & (1u << i))
+            {
+                uint first = 0;
+                while (!SameBox(desc.m_boxes[first], desc.m_boxes[i]))
+                {
+                    ++first;
+                }
+                ++tap.m_boxCounts[first];
+                ++tap.m_boxCount;
+            }
+        }
+        tap.m_weight = (tap.m_boxCount & 1) ? -1 : 1;
+
+        uint index = 0;
+        while ((index < kernel.m_tap1DCount) && (memcmp(kernel.m_taps1D[index].m_boxCounts, tap.m_boxCounts, sizeof(tap.m_boxCounts)) != 0))
+        {
+            ++index;
+        }
+        if (index == kernel.m_tap1DCount)
+        {
+            kernel.m_taps1D[kernel.m_tap1DCount++] = tap;
+        }
+        else
+        {
+            kernel.m_taps1D[index].m_weight += tap.m_weight;
+        }
+    }
+
+    for (uint y = 0; y < kernel.m_tap1DCount; ++y)
+    {
+        for (uint x = 0; x < kernel.m_tap1DCount; ++x)
+        {
+            DEPTHOFFIELDFX_KERNEL_TAP& tap = kernel.m_taps[kernel.m_tapCount++];
+            tap.m_x                        = x;
+            tap.m_y                        = y;
+            tap.m_weight                   = kernel.m_taps1D[x].m_weight * kernel.m_taps1D[y].m_weight;
+        }
+    }
+
+    int reach = 0;
+    for (int blurRadius = 0; blurRadius <= s_maxKernelTableRadius; ++blurRadius)
+    {
+        GetKernelOffsets(kernel, blurRadius, kernel.m_offsets[blurRadius]);
+        kernel.m_weights[blurRadius]     = GetKernelWeight(kernel, blurRadius);
+        kernel.m_axisWeights[blurRadius] = static_cast<float>(GetKernelArea(kernel, blurRadius));
+        for (uint tap = 0; tap < kernel.m_tap1DCount; ++tap)
+        {
+            reach = MAX(reach, abs(kernel.m_offsets[blurRadius][tap]));
+        }
+        kernel.m_reach[blurRadius] = reach;
+    }
+
+    BuildMaxKernelSums(kernel);
+}
+
+// built on first use, so no static initializer depends on the order of the translation units
+struct KERNEL_TABLE
+{
+    KERNEL_TABLE()
+    {
+        for (int i = 0; i < DEPTHOFFIELDFX_KERNEL_TYPE_COUNT; ++i)
+        {
+            BuildKernel(s_kernelDescs[i], m_kernels[i]);
+        }
+    }
+
+    DEPTHOFFIELDFX_KERNEL m_kernels[DEPTHOFFIELDFX_KERNEL_TYPE_COUNT];
+};
+
+const DEPTHOFFIELDFX_KERNEL& GetKernel(DEPTHOFFIELDFX_KERNEL_TYPE type)
+{
+    static const KERNEL_TABLE s_table;
+    return s_table.m_kernels[type];
+}
+
+void GetKernelOffsets(const DEPTHOFFIELDFX_KERNEL& kernel, int blurRadius, int offsets[s_maxKernelTaps1D])
+{
+    int widths[s_maxKernelOrder];
+    int extent = 0;
+    for (uint i = 0; i < kernel.m_desc.m_order; ++i)
+    {
+        widths[i] = BoxWidth(kernel.m_desc.m_boxes[i], blurRadius);
+        extent += widths[i];
+    }
+
+    // the kernel covers the pixels [0, extent - order] after the last integration
+    const int center = (extent - static_cast<int>(kernel.m_desc.m_order)) / 2;
+    for (uint tap = 0; tap < kernel.m_tap1DCount; ++tap)
+    {
+        int offset = -center;
+        for (uint i = 0; i < kernel.m_desc.m_order; ++i)
+        {
+            offset += static_cast<int>(kernel.m_taps1D[tap].m_boxCounts[i]) * widths[i];
+        }
+        offsets[tap] = offset;
+    }
+}
+
+float GetKernelWeight(const DEPTHOFFIELDFX_KERNEL& kernel, int blurRadius)
+{
+    float weight = 1.0f;
+    for (uint axis = 0; axis < kernel.m_desc.m_normalizedAxes; ++axis)
+    {
+        for (uint i = 0; i < kernel.m_desc.m_order; ++i)
+        {
+            weight *= static_cast<float>(BoxWidth(kernel.m_desc.m_boxes[i], blurRadius));
+        }
+    }
+    return weight;
+}
+
+double GetKernelArea(const DEPTHOFFIELDFX_KERNEL& kernel, int blurRadius)
+{
+    double area = 1.0;
+    for (uint i = 0; i < kernel.m_desc.m_order; ++i)
+    {
+        area *= BoxWidth(kernel.m_desc.m_boxes[i], blurRadius);
+    }
+    return area;
+}
+
+void GetKernelShaderTaps(const DEPTHOFFIELDFX_KERNEL& kernel, int taps[][4])
+{
+    const int order = static_cast<int>(kernel.m_desc.m_order);
+    const int unit  = (order & 1) ? 1 : 2;
+    for (uint i = 0; i < kernel.m_tapCount; ++i)
+    {
+        const DEPTHOFFIELDFX_KERNEL_TAP& tap = kernel.m_taps[i];
+        taps[i][0]                           = (2 * static_cast<int>(kernel.m_taps1D[tap.m_x].m_boxCount) - order) / unit;
+        taps[i][1]                           = (2 * static_cast<int>(kernel.m_taps1D[tap.m_y].m_boxCount) - order) / unit;
+        taps[i][2]                           = tap.m_weight;
+        taps[i][3]                           = 0;
+    }
+}
+}
@@ -0,0 +1,135 @@
+//
+// Copyright (c) 2017 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef AMD_DEPTHOFFIELDFX_KERNEL_H
+#define AMD_DEPTHOFFIELDFX_KERNEL_H
+
+#include "AMD_DepthOfFieldFX.h"
+
+namespace AMD {
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Separable piecewise-polynomial spread kernels, shared by the D3D11 constant buffer and the CPU backend.
+// Along each axis a kernel is the convolution of boxes, and integrating the buffer once per box turns
+// the deltas of its derivative back into it. The deltas sit at the summed widths of every subset of
+// the boxes, negated for the odd subsets, and the kernel is centered on the pixel that scatters it.
+// The 2D taps are the outer product of the 1D deltas, so a kernel of order n costs (n + 1)^2 taps
+// per pixel when its boxes are all alike.
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static const uint s_maxKernelOrder  = 3;
+static const uint s_maxKernelTaps1D = 1 << s_maxKernelOrder;
+static const uint s_maxKernelTaps   = s_maxKernelTaps1D * s_maxKernelTaps1D;
+
+// the largest blur radius the kernels are tabulated for, the largest the render modes scatter with
+static const int s_maxKernelTableRadius = 64;
+
+enum DEPTHOFFIELDFX_KERNEL_TYPE
+{
+    DEPTHOFFIELDFX_KERNEL_TYPE_BARTLETT,
+    DEPTHOFFIELDFX_KERNEL_TYPE_BOX,
+    DEPTHOFFIELDFX_KERNEL_TYPE_QUADRATIC_BSPLINE,
+    DEPTHOFFIELDFX_KERNEL_TYPE_COUNT,
+};
+
+// A box (m_radiusScale * r + m_bias) / m_divisor pixels wide at the blur radius r, and at least 1.
+// With m_odd that is its half width, the box is twice that plus 1 wide and centered on a pixel.
+struct DEPTHOFFIELDFX_KERNEL_BOX
+{
+    int  m_radiusScale;
+    int  m_bias;
+    int  m_divisor;
+    bool m_odd;
+};
+
+struct DEPTHOFFIELDFX_KERNEL_DESC
+{
+    uint                      m_order;  // boxes per axis, the number of times the buffer is integrated
+    DEPTHOFFIELDFX_KERNEL_BOX m_boxes[s_maxKernelOrder];
+    uint                      m_normalizedAxes;  // axes the weight divides by the box widths, the box of the shaders only one
+};
+
+// a 1D delta at the sum of m_boxCounts[i] times the width of box i, minus the center of the kernel
+struct DEPTHOFFIELDFX_KERNEL_TAP_1D
+{
+    uint m_boxCounts[s_maxKernelOrder];
+    uint m_boxCount;
+    int  m_weight;
+};
+
+// a 2D delta, the product of the 1D taps m_x and m_y
+struct DEPTHOFFIELDFX_KERNEL_TAP
+{
+    uint m_x;
+    uint m_y;
+    int  m_weight;
+};
+
+struct DEPTHOFFIELDFX_KERNEL
+{
+    DEPTHOFFIELDFX_KERNEL_DESC   m_desc;
+    uint                         m_tap1DCount;
+    DEPTHOFFIELDFX_KERNEL_TAP_1D m_taps1D[s_maxKernelTaps1D];
+    uint                         m_tapCount;
+    DEPTHOFFIELDFX_KERNEL_TAP    m_taps[s_maxKernelTaps];
+
+    // GetKernelOffsets and GetKernelWeight of every tabulated blur radius, for the scatter loops
+    int   m_offsets[s_maxKernelTableRadius + 1][s_maxKernelTaps1D];
+    float m_weights[s_maxKernelTableRadius + 1];
+
+    // GetKernelArea of every tabulated blur radius, exact in a float. A kernel normalized over both axes
+    // with a radius per axis divides by the product of the two, rounded once like m_weights.
+    float m_axisWeights[s_maxKernelTableRadius + 1];
+
+    // the farthest a tap of any blur radius up to r lands from its pixel, which the padding has to cover
+    int m_reach[s_maxKernelTableRadius + 1];
+
+    // Upper bound of the sum of the normalized kernel weights that reach a single pixel, when every
+    // neighbour scatters with the blur radius up to r that puts the most weight on it.
+    double m_maxKernelSums[s_maxKernelTableRadius + 1];
+
+    // the same bound when every neighbour also picks the radius of each axis up to r independently
+    double m_maxAnisotropicKernelSums[s_maxKernelTableRadius + 1];
+};
+
+// The subsets using the same boxes land on the same pixel at every radius and share a tap.
+void BuildKernel(const DEPTHOFFIELDFX_KERNEL_DESC& desc, DEPTHOFFIELDFX_KERNEL& kernel);
+
+// the kernels the backends ship, built once
+const DEPTHOFFIELDFX_KERNEL& GetKernel(DEPTHOFFIELDFX_KERNEL_TYPE type);
+
+// Offsets of the 1D taps from the scattering pixel at a blur radius. The integrated kernel covers
+// the sum of the box widths minus the order, centered on the pixel when that is even.
+void GetKernelOffsets(const DEPTHOFFIELDFX_KERNEL& kernel, int blurRadius, int offsets[s_maxKernelTaps1D]);
+
+// The integer sum of the kernel is the product of the box widths squared, the weight a splat is
+// divided by is that product once per normalized axis.
+float GetKernelWeight(const DEPTHOFFIELDFX_KERNEL& kernel, int blurRadius);
+
+// the product of the box widths, the integer sum of the kernel along one axis
+double GetKernelArea(const DEPTHOFFIELDFX_KERNEL& kernel, int blurRadius);
+
+// The taps of the constant buffer, (x, y, weight, 0). The kernels with alike boxes keep the offset
+// from the center of the kernel in x and y, in box widths for even orders and in half box widths
+// for odd orders, the shader of the kernel adds the radius dependent rest.
+void GetKernelShaderTaps(const DEPTHOFFIELDFX_KERNEL& kernel, int taps[][4]);
+}
+
+#endif  // AMD_DEPTHOFFIELDFX_KERNEL_H
@@ -0,0 +1,55 @@
+//
+// Copyright (c) 2017 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <math.h>
+
+#include "AMD_DepthOfFieldFX_Lens.h"
+
+namespace AMD {
+// NaNs fail every comparison
+bool IsValidLens(const DEPTHOFFIELDFX_LENS& lens) { return (lens.m_fStop > 0.0f) && (lens.m_nearPlane > 0.0f) && (lens.m_farPlane > lens.m_nearPlane); }
+
+// A standard projection maps the camera depth z to d = f / (f - n) - f * n / ((f - n) * z),
+// a reversed one to 1 - d. Solved for z and divided by f both are n / (bias + scale * d).
+// An infinite far plane leaves n / z, 1 - n / z reversed, and depth 0 or 1 lands at infinity.
+void GetCocParams(const DEPTHOFFIELDFX_LENS& lens, uint screenWidth, uint maxBlurRadius, DEPTHOFFIELDFX_COC_PARAMS& params)
+{
+    const float nearOverFar = lens.m_nearPlane / lens.m_farPlane;
+
+    // the sample scales the circle of confusion to pixels by half the screen width
+    params.cocScale      = (lens.m_focalLength * lens.m_focalLength) / lens.m_fStop * (0.5f * static_cast<float>(screenWidth));
+    params.focalLength   = lens.m_focalLength;
+    params.focusDistance = lens.m_focusDistance;
+    params.minCoc        = -static_cast<float>(maxBlurRadius);
+    params.maxCoc        = static_cast<float>(maxBlurRadius);
+    params.nearPlane     = lens.m_nearPlane;
+    params.depthBias     = lens.m_reversedZ ? nearOverFar : 1.0f;
+    params.depthScale    = lens.m_reversedZ ? (1.0f - nearOverFar) : (nearOverFar - 1.0f);
+
+    // like the sample, a forced circle of confusion is not clamped to the blur radius
+    if (fabsf(lens.m_forceCoc) > 0.25f)
+    {
+        params.minCoc = -lens.m_forceCoc;
+        params.maxCoc = -lens.m_forceCoc;
+    }
+}
+}
@@ -0,0 +1,61 @@
+//
+// Copyright (c) 2017 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef AMD_DEPTHOFFIELDFX_LENS_H
+#define AMD_DEPTHOFFIELDFX_LENS_H
+
+#include "AMD_DepthOfFieldFX.h"
+
+namespace AMD {
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Circle of confusion from depth, shared by the D3D11 constant buffer and the CPU backend.
+// It is CameraDepth and CocFromDepth of the sample's DepthOfFieldFX_CsCalcDOF.hlsl with the
+// constants folded per frame and forceCoC folded into the clamp. The camera depth of a depth buffer value d is
+// nearPlane / (depthBias + depthScale * d), which keeps the precision of reversed Z.
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct DEPTHOFFIELDFX_COC_PARAMS
+{
+    float cocScale;  // focalLength^2 / fStop in pixels
+    float focalLength;
+    float focusDistance;
+    float minCoc;  // both -forceCoc when the circle of confusion is forced
+    float maxCoc;
+    float nearPlane;
+    float depthBias;
+    float depthScale;
+};
+
+bool IsValidLens(const DEPTHOFFIELDFX_LENS& lens);
+void GetCocParams(const DEPTHOFFIELDFX_LENS& lens, uint screenWidth, uint maxBlurRadius, DEPTHOFFIELDFX_COC_PARAMS& params);
+
+// Signed circle of confusion in pixels, negative in front of the focus plane.
+// Written as 1 - focus / distance so a depth at infinity gives cocScale instead of NaN.
+inline float CocFromDepth(const DEPTHOFFIELDFX_COC_PARAMS& params, float depth)
+{
+    const float sceneDepth      = params.nearPlane / (params.depthBias + params.depthScale * depth);
+    const float distanceToLense = sceneDepth - params.focalLength;
+    const float coc             = (distanceToLense > 0.0f) ? params.cocScale * (1.0f - params.focusDistance / distanceToLense) : 0.0f;
+    return MIN(MAX(coc, params.minCoc), params.maxCoc);
+}
+}
+
+#endif  // AMD_DEPTHOFFIELDFX_LENS_H
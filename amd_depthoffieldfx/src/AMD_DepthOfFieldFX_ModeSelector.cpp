@@ -0,0 +1,171 @@
+//
+// Copyright (c) 2017 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// if the library is being compiled with "DYNAMIC_LIB" option
+// it should do dclspec(dllexport)
+#if AMD_DEPTHOFFIELDFX_COMPILE_DYNAMIC_LIB
+#define AMD_DLL_EXPORT
+#endif
+
+#include <math.h>
+#include <string.h>
+
+#include "AMD_DepthOfFieldFX_ModeSelector.h"
+
+namespace AMD {
+// the modes from the best looking down
+static const DEPTHOFFIELDFX_MODE s_rankedModes[DEPTHOFFIELDFX_MODE_COUNT] = {
+    DEPTHOFFIELDFX_MODE_RENDER, DEPTHOFFIELDFX_MODE_RENDER_BOX, DEPTHOFFIELDFX_MODE_RENDER_QUARTER_RES,
+};
+
+static uint ModeRank(DEPTHOFFIELDFX_MODE mode)
+{
+    uint rank = 0;
+    while (s_rankedModes[rank] != mode)
+    {
+        ++rank;
+    }
+    return rank;
+}
+
+// best ranked mode predicted to take at most milliseconds, DEPTHOFFIELDFX_MODE_COUNT if none does
+static DEPTHOFFIELDFX_MODE BestFittingMode(const DEPTHOFFIELDFX_MODE_SELECTOR& selector, const uint64 work[DEPTHOFFIELDFX_MODE_COUNT], float milliseconds)
+{
+    for (uint rank = 0; rank < DEPTHOFFIELDFX_MODE_COUNT; ++rank)
+    {
+        const DEPTHOFFIELDFX_MODE mode = s_rankedModes[rank];
+        if ((work[mode] != 0) && (selector.m_predictedMilliseconds[mode] <= milliseconds))
+        {
+            return mode;
+        }
+    }
+    return DEPTHOFFIELDFX_MODE_COUNT;
+}
+
+AMD_DEPTHOFFIELDFX_DLL_API DEPTHOFFIELDFX_MODE_SELECTOR::DEPTHOFFIELDFX_MODE_SELECTOR()
+    : m_budgetMilliseconds(1.0f)
+    , m_hysteresis(0.15f)
+    , m_hysteresisFrames(30)
+    , m_calibrationWeight(0.1f)
+    , m_texelBytes(8)
+    , m_mode(DEPTHOFFIELDFX_MODE_RENDER)
+    , m_pendingMode(DEPTHOFFIELDFX_MODE_RENDER)
+    , m_pendingFrames(0)
+{
+    memset(m_millisecondsPerByte, 0, sizeof(m_millisecondsPerByte));
+    memset(m_predictedMilliseconds, 0, sizeof(m_predictedMilliseconds));
+}
+
+void GetModeWork(const DEPTHOFFIELDFX_MEMORY_REQUIREMENTS& info, uint texelBytes, uint64 work[DEPTHOFFIELDFX_MODE_COUNT])
+{
+    for (uint mode = 0; mode < DEPTHOFFIELDFX_MODE_COUNT; ++mode)
+    {
+        work[mode] = 0;
+        for (uint pass = 0; pass < DEPTHOFFIELDFX_PASS_COUNT; ++pass)
+        {
+            const DEPTHOFFIELDFX_PASS_TRAFFIC& traffic = info.m_passTraffic[mode][pass];
+            work[mode] += traffic.m_bufferBytesRead + traffic.m_bufferBytesWritten + (traffic.m_texelsRead + traffic.m_texelsWritten) * texelBytes;
+        }
+    }
+}
+
+// An exponential moving average of the cost per byte, the first timing of a mode sets it.
+// Load on the device slows every mode down alike, so the modes that are not rendered keep their
+// cost relative to the timed one. Otherwise a mode left during a spike would never come back.
+void CalibrateModeSelector(DEPTHOFFIELDFX_MODE_SELECTOR& selector, DEPTHOFFIELDFX_MODE mode, uint64 work, float milliseconds)
+{
+    const double millisecondsPerByte = static_cast<double>(milliseconds) / static_cast<double>(work);
+    const double calibration         = selector.m_millisecondsPerByte[mode];
+    if (!(calibration > 0.0) || !(millisecondsPerByte > 0.0))
+    {
+        selector.m_millisecondsPerByte[mode] = millisecondsPerByte;
+        return;
+    }
+
+    const double load = 1.0 + selector.m_calibrationWeight * (millisecondsPerByte / calibration - 1.0);
+    for (uint other = 0; other < DEPTHOFFIELDFX_MODE_COUNT; ++other)
+    {
+        selector.m_millisecondsPerByte[other] *= load;
+    }
+}
+
+DEPTHOFFIELDFX_MODE SelectMode(DEPTHOFFIELDFX_MODE_SELECTOR& selector, const uint64 work[DEPTHOFFIELDFX_MODE_COUNT])
+{
+    double calibrationSum   = 0.0;
+    uint   calibrationCount = 0;
+    for (uint mode = 0; mode < DEPTHOFFIELDFX_MODE_COUNT; ++mode)
+    {
+        calibrationSum += (work[mode] != 0) ? selector.m_millisecondsPerByte[mode] : 0.0;
+        calibrationCount += ((work[mode] != 0) && (selector.m_millisecondsPerByte[mode] > 0.0)) ? 1 : 0;
+    }
+
+    // the cheapest mode is the fallback when none fits the budget
+    DEPTHOFFIELDFX_MODE cheapest = DEPTHOFFIELDFX_MODE_COUNT;
+    for (uint rank = 0; rank < DEPTHOFFIELDFX_MODE_COUNT; ++rank)
+    {
+        const DEPTHOFFIELDFX_MODE mode                = s_rankedModes[rank];
+        const double              millisecondsPerByte = (selector.m_millisecondsPerByte[mode] > 0.0) ? selector.m_millisecondsPerByte[mode] : calibrationSum / MAX(calibrationCount, 1u);
+
+        selector.m_predictedMilliseconds[mode] = static_cast<float>(millisecondsPerByte * static_cast<double>(work[mode]));
+        if ((work[mode] != 0) && ((cheapest == DEPTHOFFIELDFX_MODE_COUNT) || (selector.m_predictedMilliseconds[mode] < selector.m_predictedMilliseconds[cheapest])))
+        {
+            cheapest = mode;
+        }
+    }
+
+    // nothing to predict with yet, a mode that cannot render the frame is left for the best one that can
+    const bool available = (work[selector.m_mode] != 0);
+    if ((calibrationCount == 0) || (cheapest == DEPTHOFFIELDFX_MODE_COUNT))
+    {
+        selector.m_mode          = (available || (cheapest == DEPTHOFFIELDFX_MODE_COUNT)) ? selector.m_mode : BestFittingMode(selector, work, HUGE_VALF);
+        selector.m_pendingFrames = 0;
+        return selector.m_mode;
+    }
+
+    if (!available || (selector.m_predictedMilliseconds[selector.m_mode] > selector.m_budgetMilliseconds))
+    {
+        // the current mode misses the budget, switch right away
+        const DEPTHOFFIELDFX_MODE fitting = BestFittingMode(selector, work, selector.m_budgetMilliseconds);
+
+        selector.m_mode          = (fitting != DEPTHOFFIELDFX_MODE_COUNT) ? fitting : cheapest;
+        selector.m_pendingFrames = 0;
+        return selector.m_mode;
+    }
+
+    // a better mode has to fit with the margin for several frames in a row
+    const DEPTHOFFIELDFX_MODE better = BestFittingMode(selector, work, selector.m_budgetMilliseconds * (1.0f - selector.m_hysteresis));
+    if ((better == DEPTHOFFIELDFX_MODE_COUNT) || (ModeRank(better) >= ModeRank(selector.m_mode)))
+    {
+        selector.m_pendingFrames = 0;
+        return selector.m_mode;
+    }
+
+    selector.m_pendingFrames = (better == selector.m_pendingMode) ? selector.m_pendingFrames + 1 : 1;
+    selector.m_pendingMode   = better;
+    if (selector.m_pendingFrames >= selector.m_hysteresisFrames)
+    {
+        selector.m_mode          = better;
+        selector.m_pendingFrames = 0;
+    }
+    return selector.m_mode;
+}
+}
@@ -0,0 +1,41 @@
+//
+// Copyright (c) 2017 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+
+#ifndef AMD_DEPTHOFFIELDFX_MODESELECTOR_H
+#define AMD_DEPTHOFFIELDFX_MODESELECTOR_H
+
+#include "AMD_DepthOfFieldFX.h"
+
+namespace AMD {
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Budgeted mode selection shared by the D3D11 and the CPU backend.
+// The work of a mode is the bytes of memory traffic of its passes for a frame, 0 if it cannot
+// render it. GetModeWork takes it from the traffic of DEPTHOFFIELDFX_MEMORY_REQUIREMENTS.
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void                GetModeWork(const DEPTHOFFIELDFX_MEMORY_REQUIREMENTS& info, uint texelBytes, uint64 work[DEPTHOFFIELDFX_MODE_COUNT]);
+void                CalibrateModeSelector(DEPTHOFFIELDFX_MODE_SELECTOR& selector, DEPTHOFFIELDFX_MODE mode, uint64 work, float milliseconds);
+DEPTHOFFIELDFX_MODE SelectMode(DEPTHOFFIELDFX_MODE_SELECTOR& selector, const uint64 work[DEPTHOFFIELDFX_MODE_COUNT]);
+}
+
+#endif  // AMD_DEPTHOFFIELDFX_MODESELECTOR_H
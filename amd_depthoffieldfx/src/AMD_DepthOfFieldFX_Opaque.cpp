@@ -23,12 +23,15 @@
 #include <assert.h>
 #include <d3d11_1.h>
 #include <fstream>
+#include <mutex>
 #include <string>
+#include <vector>
 
 #if AMD_DEPTHOFFEILDFX_COMPILE_DYNAMIC_LIB
 #define AMD_DLL_EXPORTS
 #endif
 
+#include "AMD_DepthOfFieldFX_Kernel.h"
 #include "AMD_DepthOfFieldFX_OPAQUE.h"
 #include "AMD_DepthOfFieldFX_Precompiled.h"
 
@@ -85,36 +88,57 @@ struct dofParams
     int4   boxBartlettData[4];
 };
 
-static const int4 s_bartlettData[9] = {
-    { -1, -1, 1, 0 }, { 0, -1, -2, 0 }, { 1, -1, 1, 0 }, { -1, 0, -2, 0 }, { 0, 0, 4, 0 }, { 1, 0, -2, 0 }, { -1, 1, 1, 0 }, { 0, 1, -2, 0 }, { 1, 1, 1, 0 },
-};
-
-static const int4 s_boxBartlettData[4] = {
-    { -1, -1, 1, 0 }, { 1, -1, -1, 0 }, { -1, 1, -1, 0 }, { 1, 1, 1, 0 },
-};
+static void fill_params(const DEPTHOFFIELDFX_DESC& desc, const DEPTHOFFIELDFX_DESC::uint2& screenSize, uint padding, uint padWidth, uint padHeight, dofParams* pParams)
+{
+    pParams->bufferResolution.x    = padWidth;
+    pParams->bufferResolution.y    = padHeight;
+    pParams->sourceResolution.x    = screenSize.x;
+    pParams->sourceResolution.y    = screenSize.y;
+    pParams->invSourceResolution.x = 1.0f / static_cast<float>(screenSize.x);
+    pParams->invSourceResolution.y = 1.0f / static_cast<float>(screenSize.y);
+    pParams->padding               = padding;
+    pParams->scale_factor          = float(1 << desc.m_scaleFactor);
+
+    // the shaders loop over as many taps as the constant buffer holds
+    const DEPTHOFFIELDFX_KERNEL& bartlett = GetKernel(DEPTHOFFIELDFX_KERNEL_TYPE_BARTLETT);
+    const DEPTHOFFIELDFX_KERNEL& box      = GetKernel(DEPTHOFFIELDFX_KERNEL_TYPE_BOX);
+    assert((bartlett.m_tapCount == ELEMENTS_OF(pParams->bartlettData)) && (box.m_tapCount == ELEMENTS_OF(pParams->boxBartlettData)));
+    GetKernelShaderTaps(bartlett, reinterpret_cast<int(*)[4]>(pParams->bartlettData));
+    GetKernelShaderTaps(box, reinterpret_cast<int(*)[4]>(pParams->boxBartlettData));
+}
 
 DEPTHOFFIELDFX_OPAQUE_DESC::DEPTHOFFIELDFX_OPAQUE_DESC(const DEPTHOFFIELDFX_DESC& desc)
-    : m_pIntermediateBuffer(nullptr)
+    : m_bufferCapacity(0)
+    , m_bufferFootprint(0)
+    , m_smallResizeCount(0)
+    , m_pIntermediateBuffer(nullptr)
     , m_pIntermediateBufferTransposed(nullptr)
     , m_pIntermediateUAV(nullptr)
     , m_pIntermediateTransposedUAV(nullptr)
     , m_pDofParamsCB(nullptr)
-    , m_pPointSampler(nullptr)
-    , m_pFastFilterSetupCS(nullptr)
-    , m_pFastFilterSetupQuarterResCS(nullptr)
-    , m_pBoxFastFilterSetupCS(nullptr)
-    , m_pReadFinalResultCS(nullptr)
-    , m_pVerticalIntegrateCS(nullptr)
-    , m_pDoubleVerticalIntegrateCS(nullptr)
-
+    , m_viewsPitch(0)
+    , m_viewsHeight(0)
+    , m_pViewsParamsCB(nullptr)
+    , m_pViewsTransposedParamsCB(nullptr)
+    , m_pShaders(nullptr)
 {
 }
 
 DEPTHOFFIELDFX_RETURN_CODE DEPTHOFFIELDFX_OPAQUE_DESC::initalize(const DEPTHOFFIELDFX_DESC& desc)
 {
-    DEPTHOFFIELDFX_RETURN_CODE result = create_shaders(desc);
+    DEPTHOFFIELDFX_RETURN_CODE result = DEPTHOFFIELDFX_RETURN_CODE_SUCCESS;
     ID3D11Device*              pDev   = desc.m_pDevice;
 
+    // initializing again must not leak the previous device objects
+    SAFE_RELEASE(&m_pDofParamsCB);
+    DEPTHOFFIELDFX_SHADER_POOL::release(m_pShaders);
+
+    m_pShaders = DEPTHOFFIELDFX_SHADER_POOL::acquire(pDev);
+    if (m_pShaders == nullptr)
+    {
+        result = DEPTHOFFIELDFX_RETURN_CODE_FAIL;
+    }
+
     if (result == DEPTHOFFIELDFX_RETURN_CODE_SUCCESS)
     {
         // initalize
@@ -128,18 +152,6 @@ DEPTHOFFIELDFX_RETURN_CODE DEPTHOFFIELDFX_OPAQUE_DESC::initalize(const DEPTHOFFI
         result     = convert_result(hr);
     }
 
-    if (result == DEPTHOFFIELDFX_RETURN_CODE_SUCCESS)
-    {
-        D3D11_SAMPLER_DESC sdesc = {};
-        sdesc.AddressU           = D3D11_TEXTURE_ADDRESS_CLAMP;
-        sdesc.AddressV           = D3D11_TEXTURE_ADDRESS_CLAMP;
-        sdesc.AddressW           = D3D11_TEXTURE_ADDRESS_CLAMP;
-        sdesc.ComparisonFunc     = D3D11_COMPARISON_ALWAYS;
-        sdesc.Filter             = D3D11_FILTER_MIN_LINEAR_MAG_MIP_POINT;
-        HRESULT hr               = pDev->CreateSamplerState(&sdesc, &m_pPointSampler);
-        result                   = convert_result(hr);
-    }
-
     return result;
 }
 
@@ -150,44 +162,324 @@ DEPTHOFFIELDFX_RETURN_CODE DEPTHOFFIELDFX_OPAQUE_DESC::resize(const DEPTHOFFIELD
 
     ID3D11Device* pDev = desc.m_pDevice;
 
-    int width      = desc.m_screenSize.x;
-    int height     = desc.m_screenSize.y;
+    // the wrapper checked the blur radius and the buffers are sized for the layout below
+    set_frame_layout(desc);
+
+    release_view_regions(0);
+    release_intermediate_views();
+
+    const uint elementCount = m_bufferWidth * m_bufferHeight;
+    result                  = reserve_intermediate_buffers(pDev, elementCount, count_resize(elementCount, desc.m_trimResizeCount));
+    if (result == S_OK)
+    {
+        result = create_intermediate_views(pDev);
+    }
+    if (result != S_OK)
+    {
+        release_intermediate_buffers();
+    }
+
+    return convert_result(result);
+}
+
+// The layout of the intermediate buffer follows the screen size and blur radius of every frame,
+// the buffers only have to hold it.
+DEPTHOFFIELDFX_RETURN_CODE DEPTHOFFIELDFX_OPAQUE_DESC::set_frame_layout(const DEPTHOFFIELDFX_DESC& desc)
+{
+    if (desc.m_maxBlurRadius > 64)
+    {
+        return DEPTHOFFIELDFX_RETURN_CODE_INVALID_PARAMS;
+    }
+
     m_padding      = desc.m_maxBlurRadius + 2;
-    m_bufferWidth  = width + 2 * m_padding;
-    m_bufferHeight = height + 2 * m_padding;
+    m_bufferWidth  = desc.m_screenSize.x + 2 * m_padding;
+    m_bufferHeight = desc.m_screenSize.y + 2 * m_padding;
+    if ((static_cast<uint64>(m_bufferWidth) * m_bufferHeight) > m_bufferFootprint)
+    {
+        return DEPTHOFFIELDFX_RETURN_CODE_INVALID_SURFACE;
+    }
+    return DEPTHOFFIELDFX_RETURN_CODE_SUCCESS;
+}
+
+DEPTHOFFIELDFX_RETURN_CODE DEPTHOFFIELDFX_OPAQUE_DESC::resize_views(const DEPTHOFFIELDFX_DESC& desc, const DEPTHOFFIELDFX_VIEW* pViews, uint viewCount)
+{
+    HRESULT result = S_OK;
+
+    ID3D11Device* pDev = desc.m_pDevice;
+
+    // the constant buffers of the views that remain are kept, the UAVs move with the packing
+    release_view_regions(viewCount);
+    release_intermediate_views();
+
+    // Stack the views at the pitch of the widest one, the regions never overlap so a single clear
+    // covers them all. Every kernel lies within the padding of its region, so both integrals are back
+    // to exactly 0 at the end of a region and one integration pass runs over all of them.
+    m_padding = desc.m_maxBlurRadius + 2;
+    m_viewRegions.resize(viewCount);
+
+    m_viewsPitch  = 0;
+    m_viewsHeight = 0;
+    for (uint i = 0; i < viewCount; ++i)
+    {
+        VIEW_REGION& region   = m_viewRegions[i];
+        region.m_bufferWidth  = pViews[i].m_screenSize.x + 2 * m_padding;
+        region.m_bufferHeight = pViews[i].m_screenSize.y + 2 * m_padding;
+        region.m_screenWidth  = 0;  // the pitch may have changed, write the constants on the next render
+        m_viewsPitch          = MAX(m_viewsPitch, region.m_bufferWidth);
+        m_viewsHeight += region.m_bufferHeight;
+    }
+    const uint elementCount = m_viewsPitch * m_viewsHeight;
+
+    // the unbatched render functions keep working for descs no larger than the first view
+    m_bufferWidth  = m_viewRegions[0].m_bufferWidth;
+    m_bufferHeight = m_viewRegions[0].m_bufferHeight;
+
+    result = reserve_intermediate_buffers(pDev, elementCount, count_resize(elementCount, desc.m_trimResizeCount));
+    if (result == S_OK)
+    {
+        result = create_intermediate_views(pDev);
+    }
+
+    D3D11_BUFFER_DESC cbDesc = { 0 };
+    cbDesc.BindFlags         = D3D11_BIND_CONSTANT_BUFFER;
+    cbDesc.Usage             = D3D11_USAGE_DYNAMIC;
+    cbDesc.CPUAccessFlags    = D3D11_CPU_ACCESS_WRITE;
+    cbDesc.ByteWidth         = sizeof(dofParams);
+
+    for (uint i = 0; (i < viewCount) && (result == S_OK); ++i)
+    {
+        VIEW_REGION& region = m_viewRegions[i];
+        if (region.m_pParamsCB == nullptr)
+        {
+            result = pDev->CreateBuffer(&cbDesc, nullptr, &region.m_pParamsCB);
+        }
+    }
+
+    // the integration passes only read the layout, which is fixed until the next resize
+    dofParams              params;
+    D3D11_SUBRESOURCE_DATA initData = { &params, 0, 0 };
+    memset(&params, 0, sizeof(params));
+    cbDesc.Usage          = D3D11_USAGE_IMMUTABLE;
+    cbDesc.CPUAccessFlags = 0;
+    DEPTHOFFIELDFX_DESC::uint2 size;
+    if (result == S_OK)
+    {
+        size.x = m_viewsPitch;
+        size.y = m_viewsHeight;
+        fill_params(desc, size, m_padding, m_viewsPitch, m_viewsHeight, &params);
+        result = pDev->CreateBuffer(&cbDesc, &initData, &m_pViewsParamsCB);
+    }
+    if (result == S_OK)
+    {
+        size.x = m_viewsHeight;
+        size.y = m_viewsPitch;
+        fill_params(desc, size, m_padding, m_viewsHeight, m_viewsPitch, &params);
+        result = pDev->CreateBuffer(&cbDesc, &initData, &m_pViewsTransposedParamsCB);
+    }
+
+    if (result != S_OK)
+    {
+        release_intermediate_buffers();
+    }
+
+    return convert_result(result);
+}
+
+// Trims the buffers to the footprint once m_trimResizeCount resizes in a row used less than half of them.
+bool DEPTHOFFIELDFX_OPAQUE_DESC::count_resize(uint elementCount, uint trimResizeCount)
+{
+    m_smallResizeCount = (elementCount < m_bufferCapacity / 2) ? m_smallResizeCount + 1 : 0;
+    return (trimResizeCount != 0) && (m_smallResizeCount >= trimResizeCount);
+}
+
+// keeps the buffers if the footprint fits and they are not trimmed, otherwise allocates them at the footprint
+HRESULT DEPTHOFFIELDFX_OPAQUE_DESC::reserve_intermediate_buffers(ID3D11Device* pDev, uint elementCount, bool trim)
+{
+    HRESULT result    = S_OK;
+    m_bufferFootprint = elementCount;
+
+    if ((elementCount > m_bufferCapacity) || (trim && (elementCount < m_bufferCapacity)))
+    {
+        // release the old buffers first so the peak footprint does not double
+        SAFE_RELEASE(&m_pIntermediateBuffer);
+        SAFE_RELEASE(&m_pIntermediateBufferTransposed);
+        m_bufferCapacity   = 0;
+        m_smallResizeCount = 0;
+
+        result = create_intermediate_buffers(pDev, elementCount);
+        if (result == S_OK)
+        {
+            m_bufferCapacity = elementCount;
+        }
+    }
+
+    return result;
+}
+
+HRESULT DEPTHOFFIELDFX_OPAQUE_DESC::create_intermediate_buffers(ID3D11Device* pDev, uint elementCount)
+{
+    HRESULT result = S_OK;
+
+    D3D11_BUFFER_DESC bdesc   = { 0 };
+    bdesc.BindFlags           = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS;
+    bdesc.Usage               = D3D11_USAGE_DEFAULT;
+    bdesc.ByteWidth           = elementCount * sizeof(uint4);
+    bdesc.StructureByteStride = sizeof(uint4);
+    bdesc.MiscFlags           = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+
+    result = pDev->CreateBuffer(&bdesc, nullptr, &m_pIntermediateBuffer);
+    if (result == S_OK)
+    {
+        result = pDev->CreateBuffer(&bdesc, nullptr, &m_pIntermediateBufferTransposed);
+    }
+
+    return result;
+}
+
+// views over the footprint, so the clears do not touch the unused capacity, and one pair per batched view
+HRESULT DEPTHOFFIELDFX_OPAQUE_DESC::create_intermediate_views(ID3D11Device* pDev)
+{
+    HRESULT result = S_OK;
+
+    D3D11_UNORDERED_ACCESS_VIEW_DESC uavDesc;
+    memset(&uavDesc, 0, sizeof(uavDesc));
+    uavDesc.ViewDimension       = D3D11_UAV_DIMENSION_BUFFER;
+    uavDesc.Format              = DXGI_FORMAT_UNKNOWN;
+    uavDesc.Buffer.FirstElement = 0;
+    uavDesc.Buffer.NumElements  = m_bufferFootprint;
+    // uavDesc.Buffer.Flags = D3D11_BUFFER_UAV_FLAG_RAW;
+
+    result = pDev->CreateUnorderedAccessView(m_pIntermediateBuffer, &uavDesc, &m_pIntermediateUAV);
+    if (result == S_OK)
+    {
+        result = pDev->CreateUnorderedAccessView(m_pIntermediateBufferTransposed, &uavDesc, &m_pIntermediateTransposedUAV);
+    }
+
+    // the setup and read of a view address its rows at the common pitch, the integration passes
+    // use the UAVs over the whole footprint
+    uint firstElement = 0;
+    for (size_t i = 0; (i < m_viewRegions.size()) && (result == S_OK); ++i)
+    {
+        VIEW_REGION& region = m_viewRegions[i];
+
+        uavDesc.Buffer.FirstElement = firstElement;
+        uavDesc.Buffer.NumElements  = m_viewsPitch * region.m_bufferHeight;
+        firstElement += uavDesc.Buffer.NumElements;
+
+        result = pDev->CreateUnorderedAccessView(m_pIntermediateBuffer, &uavDesc, &region.m_pUAV);
+    }
+
+    return result;
+}
+
+void DEPTHOFFIELDFX_OPAQUE_DESC::release_intermediate_views()
+{
+    for (size_t i = 0; i < m_viewRegions.size(); ++i)
+    {
+        SAFE_RELEASE(&m_viewRegions[i].m_pUAV);
+    }
 
     SAFE_RELEASE(&m_pIntermediateUAV);
     SAFE_RELEASE(&m_pIntermediateTransposedUAV);
+}
+
+// releases the batched views from firstRegion on and the layout constants of the batch
+void DEPTHOFFIELDFX_OPAQUE_DESC::release_view_regions(size_t firstRegion)
+{
+    SAFE_RELEASE(&m_pViewsParamsCB);
+    SAFE_RELEASE(&m_pViewsTransposedParamsCB);
+
+    for (size_t i = firstRegion; i < m_viewRegions.size(); ++i)
+    {
+        SAFE_RELEASE(&m_viewRegions[i].m_pUAV);
+        SAFE_RELEASE(&m_viewRegions[i].m_pParamsCB);
+    }
+    if (firstRegion < m_viewRegions.size())
+    {
+        m_viewRegions.resize(firstRegion);
+    }
+}
+
+void DEPTHOFFIELDFX_OPAQUE_DESC::release_intermediate_buffers()
+{
+    release_view_regions(0);
+    release_intermediate_views();
+
     SAFE_RELEASE(&m_pIntermediateBuffer);
     SAFE_RELEASE(&m_pIntermediateBufferTransposed);
+    m_bufferCapacity   = 0;
+    m_bufferFootprint  = 0;
+    m_smallResizeCount = 0;
+}
 
-    if (result == S_OK)
+DEPTHOFFIELDFX_RETURN_CODE DEPTHOFFIELDFX_OPAQUE_DESC::trim(const DEPTHOFFIELDFX_DESC& desc)
+{
+    HRESULT result = S_OK;
+
+    if (m_bufferCapacity > m_bufferFootprint)
     {
-        const uint elementCount = m_bufferWidth * m_bufferHeight;
-
-        D3D11_BUFFER_DESC bdesc   = { 0 };
-        bdesc.BindFlags           = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS;
-        bdesc.Usage               = D3D11_USAGE_DEFAULT;
-        bdesc.ByteWidth           = elementCount * sizeof(uint4);
-        bdesc.StructureByteStride = sizeof(uint4);
-        bdesc.MiscFlags           = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
-        D3D11_UNORDERED_ACCESS_VIEW_DESC uavDesc;
-        memset(&uavDesc, 0, sizeof(uavDesc));
-        uavDesc.ViewDimension       = D3D11_UAV_DIMENSION_BUFFER;
-        uavDesc.Format              = DXGI_FORMAT_UNKNOWN;
-        uavDesc.Buffer.FirstElement = 0;
-        uavDesc.Buffer.NumElements  = elementCount;
-        // uavDesc.Buffer.Flags = D3D11_BUFFER_UAV_FLAG_RAW;
-
-        result = pDev->CreateBuffer(&bdesc, nullptr, &m_pIntermediateBuffer);
-        pDev->CreateUnorderedAccessView(m_pIntermediateBuffer, &uavDesc, &m_pIntermediateUAV);
-        result = pDev->CreateBuffer(&bdesc, nullptr, &m_pIntermediateBufferTransposed);
-        pDev->CreateUnorderedAccessView(m_pIntermediateBufferTransposed, &uavDesc, &m_pIntermediateTransposedUAV);
+        release_intermediate_views();
+
+        result = reserve_intermediate_buffers(desc.m_pDevice, m_bufferFootprint, true);
+        if (result == S_OK)
+        {
+            result = create_intermediate_views(desc.m_pDevice);
+        }
+        if (result != S_OK)
+        {
+            release_intermediate_buffers();
+        }
     }
 
     return convert_result(result);
 }
 
+void DEPTHOFFIELDFX_OPAQUE_DESC::get_memory_requirements(const DEPTHOFFIELDFX_DESC& desc, DEPTHOFFIELDFX_MEMORY_REQUIREMENTS& info)
+{
+    // the same layout as resize()
+    const uint64 width        = desc.m_screenSize.x;
+    const uint64 height       = desc.m_screenSize.y;
+    const uint64 padding      = desc.m_maxBlurRadius + 2;
+    const uint64 bufferWidth  = width + 2 * padding;
+    const uint64 bufferHeight = height + 2 * padding;
+    const uint64 elementSize  = sizeof(uint4);
+    const uint64 bufferBytes  = bufferWidth * bufferHeight * elementSize;
+
+    memset(&info, 0, sizeof(info));
+    info.m_intermediateBufferBytes = bufferBytes;
+    info.m_transposedBufferBytes   = bufferBytes;
+    info.m_constantBufferBytes     = sizeof(dofParams);
+
+    // every pixel of the quarter res setup is a 2x2 quad read with Gather, odd edges are not dispatched
+    const uint64 setupPixels[DEPTHOFFIELDFX_MODE_COUNT]  = { width * height, (width / 2) * (height / 2) * 4, width * height };
+    const uint64 bartlettTaps                              = GetKernel(DEPTHOFFIELDFX_KERNEL_TYPE_BARTLETT).m_tapCount;
+    const uint64 deltasPerPixel[DEPTHOFFIELDFX_MODE_COUNT] = { bartlettTaps, bartlettTaps, GetKernel(DEPTHOFFIELDFX_KERNEL_TYPE_BOX).m_tapCount };
+
+    for (uint mode = 0; mode < DEPTHOFFIELDFX_MODE_COUNT; ++mode)
+    {
+        DEPTHOFFIELDFX_PASS_TRAFFIC* pPasses = info.m_passTraffic[mode];
+
+        info.m_modeSurfaceBytes[mode] = 0;
+        info.m_totalBytes[mode]       = info.m_intermediateBufferBytes + info.m_transposedBufferBytes + info.m_constantBufferBytes + info.m_modeSurfaceBytes[mode];
+
+        pPasses[DEPTHOFFIELDFX_PASS_CLEAR].m_bufferBytesWritten = bufferBytes;
+
+        pPasses[DEPTHOFFIELDFX_PASS_FAST_FILTER_SETUP].m_bufferBytesRead    = setupPixels[mode] * deltasPerPixel[mode] * elementSize;
+        pPasses[DEPTHOFFIELDFX_PASS_FAST_FILTER_SETUP].m_bufferBytesWritten = setupPixels[mode] * deltasPerPixel[mode] * elementSize;
+        pPasses[DEPTHOFFIELDFX_PASS_FAST_FILTER_SETUP].m_texelsRead         = setupPixels[mode] * 2;
+
+        // the first row of every column is only read
+        pPasses[DEPTHOFFIELDFX_PASS_VERTICAL_INTEGRATE].m_bufferBytesRead      = bufferBytes;
+        pPasses[DEPTHOFFIELDFX_PASS_VERTICAL_INTEGRATE].m_bufferBytesWritten   = bufferWidth * (bufferHeight - 1) * elementSize;
+        pPasses[DEPTHOFFIELDFX_PASS_HORIZONTAL_INTEGRATE].m_bufferBytesRead    = bufferBytes;
+        pPasses[DEPTHOFFIELDFX_PASS_HORIZONTAL_INTEGRATE].m_bufferBytesWritten = bufferHeight * (bufferWidth - 1) * elementSize;
+
+        pPasses[DEPTHOFFIELDFX_PASS_READ_FINAL_RESULT].m_bufferBytesRead = width * height * elementSize;
+        pPasses[DEPTHOFFIELDFX_PASS_READ_FINAL_RESULT].m_texelsRead      = width * height;
+        pPasses[DEPTHOFFIELDFX_PASS_READ_FINAL_RESULT].m_texelsWritten   = width * height;
+    }
+}
+
 void DEPTHOFFIELDFX_OPAQUE_DESC::Bind_UAVs(const DEPTHOFFIELDFX_DESC& desc, ID3D11UnorderedAccessView* pUAV0, ID3D11UnorderedAccessView* pUAV1, ID3D11UnorderedAccessView* pUAV2)
 {
     ID3D11UnorderedAccessView* pUAVs[] = { pUAV0, pUAV1, pUAV2 };
@@ -198,10 +490,15 @@ DEPTHOFFIELDFX_RETURN_CODE DEPTHOFFIELDFX_OPAQUE_DESC::render(const DEPTHOFFIELD
 {
     HRESULT result = S_OK;
 
+    if (m_pShaders == nullptr)
+    {
+        return DEPTHOFFIELDFX_RETURN_CODE_FAIL;
+    }
 
-    if (((desc.m_screenSize.x + desc.m_maxBlurRadius * 2) * (desc.m_screenSize.y + desc.m_maxBlurRadius * 2)) > (m_bufferWidth * m_bufferHeight))
+    DEPTHOFFIELDFX_RETURN_CODE layoutResult = set_frame_layout(desc);
+    if (layoutResult != DEPTHOFFIELDFX_RETURN_CODE_SUCCESS)
     {
-        return DEPTHOFFIELDFX_RETURN_CODE_INVALID_SURFACE;
+        return layoutResult;
     }
 
     ID3D11DeviceContext* pCtx = desc.m_pDeviceContext;
@@ -210,7 +507,7 @@ DEPTHOFFIELDFX_RETURN_CODE DEPTHOFFIELDFX_OPAQUE_DESC::render(const DEPTHOFFIELD
     ID3D11ShaderResourceView*  pSRVs[] = { desc.m_pColorSRV, desc.m_pCircleOfConfusionSRV };
     ID3D11Buffer*              pCBs[]  = { m_pDofParamsCB };
 
-    pCtx->CSSetSamplers(0, 1, &m_pPointSampler);
+    pCtx->CSSetSamplers(0, 1, &m_pShaders->m_pPointSampler);
 
     update_constant_buffer(desc, m_bufferWidth, m_bufferHeight);
     pCtx->CSSetConstantBuffers(0, ELEMENTS_OF(pCBs), pCBs);
@@ -221,7 +518,7 @@ DEPTHOFFIELDFX_RETURN_CODE DEPTHOFFIELDFX_OPAQUE_DESC::render(const DEPTHOFFIELD
     pCtx->ClearUnorderedAccessViewUint(m_pIntermediateUAV, clearValues);
 
     // Fast Filter Setup
-    pCtx->CSSetShader(m_pFastFilterSetupCS, nullptr, 0);
+    pCtx->CSSetShader(m_pShaders->m_pFastFilterSetupCS, nullptr, 0);
 
     int tgX = (desc.m_screenSize.x + 7) / 8;
     int tgY = (desc.m_screenSize.y + 7) / 8;
@@ -233,7 +530,7 @@ DEPTHOFFIELDFX_RETURN_CODE DEPTHOFFIELDFX_OPAQUE_DESC::render(const DEPTHOFFIELD
     // do Vertical integration
     {
         update_constant_buffer(desc, m_bufferWidth, m_bufferHeight);
-        pCtx->CSSetShader(m_pDoubleVerticalIntegrateCS, nullptr, 0);
+        pCtx->CSSetShader(m_pShaders->m_pDoubleVerticalIntegrateCS, nullptr, 0);
         Bind_UAVs(desc, m_pIntermediateUAV, m_pIntermediateTransposedUAV, nullptr);
         pCtx->Dispatch((m_bufferWidth + 63) / 64, 1, 1);
     }
@@ -248,7 +545,7 @@ DEPTHOFFIELDFX_RETURN_CODE DEPTHOFFIELDFX_OPAQUE_DESC::render(const DEPTHOFFIELD
     // debug: Copy from intermediate results
     update_constant_buffer(desc, m_bufferWidth, m_bufferHeight);
 
-    pCtx->CSSetShader(m_pReadFinalResultCS, nullptr, 0);
+    pCtx->CSSetShader(m_pShaders->m_pReadFinalResultCS, nullptr, 0);
     Bind_UAVs(desc, m_pIntermediateUAV, nullptr, desc.m_pResultUAV);
     pCtx->Dispatch((desc.m_screenSize.x + 7) / 8, (desc.m_screenSize.y + 7) / 8, 1);
 
@@ -266,13 +563,24 @@ DEPTHOFFIELDFX_RETURN_CODE DEPTHOFFIELDFX_OPAQUE_DESC::render_quarter_res(const
 {
     HRESULT result = S_OK;
 
+    if (m_pShaders == nullptr)
+    {
+        return DEPTHOFFIELDFX_RETURN_CODE_FAIL;
+    }
+
+    DEPTHOFFIELDFX_RETURN_CODE layoutResult = set_frame_layout(desc);
+    if (layoutResult != DEPTHOFFIELDFX_RETURN_CODE_SUCCESS)
+    {
+        return layoutResult;
+    }
+
     ID3D11DeviceContext* pCtx = desc.m_pDeviceContext;
 
     ID3D11UnorderedAccessView* pUAVs[] = { m_pIntermediateUAV, nullptr, desc.m_pResultUAV };
     ID3D11ShaderResourceView*  pSRVs[] = { desc.m_pColorSRV, desc.m_pCircleOfConfusionSRV };
     ID3D11Buffer*              pCBs[]  = { m_pDofParamsCB };
 
-    pCtx->CSSetSamplers(0, 1, &m_pPointSampler);
+    pCtx->CSSetSamplers(0, 1, &m_pShaders->m_pPointSampler);
 
     update_constant_buffer(desc, m_bufferWidth, m_bufferHeight);
     pCtx->CSSetConstantBuffers(0, ELEMENTS_OF(pCBs), pCBs);
@@ -283,7 +591,7 @@ DEPTHOFFIELDFX_RETURN_CODE DEPTHOFFIELDFX_OPAQUE_DESC::render_quarter_res(const
     pCtx->ClearUnorderedAccessViewUint(m_pIntermediateUAV, clearValues);
 
     // Fast Filter Setup
-    pCtx->CSSetShader(m_pFastFilterSetupQuarterResCS, nullptr, 0);
+    pCtx->CSSetShader(m_pShaders->m_pFastFilterSetupQuarterResCS, nullptr, 0);
 
     int tgX = ((desc.m_screenSize.x / 2) + 7) / 8;
     int tgY = ((desc.m_screenSize.y / 2) + 7) / 8;
@@ -295,7 +603,7 @@ DEPTHOFFIELDFX_RETURN_CODE DEPTHOFFIELDFX_OPAQUE_DESC::render_quarter_res(const
     // do Vertical integration
     {
         update_constant_buffer(desc, m_bufferWidth, m_bufferHeight);
-        pCtx->CSSetShader(m_pDoubleVerticalIntegrateCS, nullptr, 0);
+        pCtx->CSSetShader(m_pShaders->m_pDoubleVerticalIntegrateCS, nullptr, 0);
         Bind_UAVs(desc, m_pIntermediateUAV, m_pIntermediateTransposedUAV, nullptr);
         pCtx->Dispatch((m_bufferWidth + 63) / 64, 1, 1);
     }
@@ -310,7 +618,7 @@ DEPTHOFFIELDFX_RETURN_CODE DEPTHOFFIELDFX_OPAQUE_DESC::render_quarter_res(const
     // debug: Copy from intermediate results
     update_constant_buffer(desc, m_bufferWidth, m_bufferHeight);
 
-    pCtx->CSSetShader(m_pReadFinalResultCS, nullptr, 0);
+    pCtx->CSSetShader(m_pShaders->m_pReadFinalResultCS, nullptr, 0);
     Bind_UAVs(desc, m_pIntermediateUAV, nullptr, desc.m_pResultUAV);
     pCtx->Dispatch((desc.m_screenSize.x + 7) / 8, (desc.m_screenSize.y + 7) / 8, 1);
 
@@ -328,13 +636,24 @@ DEPTHOFFIELDFX_RETURN_CODE DEPTHOFFIELDFX_OPAQUE_DESC::render_box(const DEPTHOFF
 {
     HRESULT result = S_OK;
 
+    if (m_pShaders == nullptr)
+    {
+        return DEPTHOFFIELDFX_RETURN_CODE_FAIL;
+    }
+
+    DEPTHOFFIELDFX_RETURN_CODE layoutResult = set_frame_layout(desc);
+    if (layoutResult != DEPTHOFFIELDFX_RETURN_CODE_SUCCESS)
+    {
+        return layoutResult;
+    }
+
     ID3D11DeviceContext* pCtx = desc.m_pDeviceContext;
 
     ID3D11UnorderedAccessView* pUAVs[] = { m_pIntermediateUAV, nullptr, desc.m_pResultUAV };
     ID3D11ShaderResourceView*  pSRVs[] = { desc.m_pColorSRV, desc.m_pCircleOfConfusionSRV };
     ID3D11Buffer*              pCBs[]  = { m_pDofParamsCB };
 
-    pCtx->CSSetSamplers(0, 1, &m_pPointSampler);
+    pCtx->CSSetSamplers(0, 1, &m_pShaders->m_pPointSampler);
 
     update_constant_buffer(desc, m_bufferWidth, m_bufferHeight);
     pCtx->CSSetConstantBuffers(0, ELEMENTS_OF(pCBs), pCBs);
@@ -345,7 +664,7 @@ DEPTHOFFIELDFX_RETURN_CODE DEPTHOFFIELDFX_OPAQUE_DESC::render_box(const DEPTHOFF
     pCtx->ClearUnorderedAccessViewUint(m_pIntermediateUAV, clearValues);
 
     // Fast Filter Setup
-    pCtx->CSSetShader(m_pBoxFastFilterSetupCS, nullptr, 0);
+    pCtx->CSSetShader(m_pShaders->m_pBoxFastFilterSetupCS, nullptr, 0);
 
     int tgX = (desc.m_screenSize.x + 7) / 8;
     int tgY = (desc.m_screenSize.y + 7) / 8;
@@ -357,7 +676,7 @@ DEPTHOFFIELDFX_RETURN_CODE DEPTHOFFIELDFX_OPAQUE_DESC::render_box(const DEPTHOFF
     // do Vertical integration
     {
         update_constant_buffer(desc, m_bufferWidth, m_bufferHeight);
-        pCtx->CSSetShader(m_pVerticalIntegrateCS, nullptr, 0);
+        pCtx->CSSetShader(m_pShaders->m_pVerticalIntegrateCS, nullptr, 0);
         Bind_UAVs(desc, m_pIntermediateUAV, m_pIntermediateTransposedUAV, nullptr);
         pCtx->Dispatch((m_bufferWidth + 63) / 64, 1, 1);
     }
@@ -372,7 +691,7 @@ DEPTHOFFIELDFX_RETURN_CODE DEPTHOFFIELDFX_OPAQUE_DESC::render_box(const DEPTHOFF
     // debug: Copy from intermediate results
     update_constant_buffer(desc, m_bufferWidth, m_bufferHeight);
 
-    pCtx->CSSetShader(m_pReadFinalResultCS, nullptr, 0);
+    pCtx->CSSetShader(m_pShaders->m_pReadFinalResultCS, nullptr, 0);
     Bind_UAVs(desc, m_pIntermediateUAV, nullptr, desc.m_pResultUAV);
     pCtx->Dispatch((desc.m_screenSize.x + 7) / 8, (desc.m_screenSize.y + 7) / 8, 1);
 
@@ -386,14 +705,199 @@ DEPTHOFFIELDFX_RETURN_CODE DEPTHOFFIELDFX_OPAQUE_DESC::render_box(const DEPTHOFF
     return convert_result(result);
 }
 
+DEPTHOFFIELDFX_RETURN_CODE DEPTHOFFIELDFX_OPAQUE_DESC::render_views(const DEPTHOFFIELDFX_DESC& desc, DEPTHOFFIELDFX_MODE mode, const DEPTHOFFIELDFX_VIEW* pViews, uint viewCount)
+{
+    HRESULT result = S_OK;
+
+    if (m_pShaders == nullptr)
+    {
+        return DEPTHOFFIELDFX_RETURN_CODE_FAIL;
+    }
+
+    if (viewCount > m_viewRegions.size())
+    {
+        return DEPTHOFFIELDFX_RETURN_CODE_INVALID_SURFACE;
+    }
+
+    // like the single view layout, the padding follows the blur radius of the batch
+    if (desc.m_maxBlurRadius > 64)
+    {
+        return DEPTHOFFIELDFX_RETURN_CODE_INVALID_PARAMS;
+    }
+    m_padding = desc.m_maxBlurRadius + 2;
+    for (uint i = 0; i < viewCount; ++i)
+    {
+        if (((pViews[i].m_screenSize.x + 2 * m_padding) > m_viewRegions[i].m_bufferWidth) || ((pViews[i].m_screenSize.y + 2 * m_padding) > m_viewRegions[i].m_bufferHeight))
+        {
+            return DEPTHOFFIELDFX_RETURN_CODE_INVALID_SURFACE;
+        }
+    }
+
+    ID3D11DeviceContext* pCtx = desc.m_pDeviceContext;
+
+    ID3D11ComputeShader* pSetupCS[DEPTHOFFIELDFX_MODE_COUNT]     = { m_pShaders->m_pFastFilterSetupCS, m_pShaders->m_pFastFilterSetupQuarterResCS, m_pShaders->m_pBoxFastFilterSetupCS };
+    ID3D11ComputeShader* pIntegrateCS[DEPTHOFFIELDFX_MODE_COUNT] = { m_pShaders->m_pDoubleVerticalIntegrateCS, m_pShaders->m_pDoubleVerticalIntegrateCS, m_pShaders->m_pVerticalIntegrateCS };
+
+    ID3D11UnorderedAccessView* pUAVs[] = { nullptr, nullptr, nullptr };
+    ID3D11ShaderResourceView*  pSRVs[] = { nullptr, nullptr };
+    ID3D11Buffer*              pCBs[]  = { nullptr };
+
+    pCtx->CSSetSamplers(0, 1, &m_pShaders->m_pPointSampler);
+
+    // the constants of a view only change with its screen size, the padding or the scale factor
+    for (uint i = 0; i < viewCount; ++i)
+    {
+        VIEW_REGION& region = m_viewRegions[i];
+        if ((region.m_screenWidth != pViews[i].m_screenSize.x) || (region.m_screenHeight != pViews[i].m_screenSize.y) || (region.m_padding != m_padding) ||
+            (region.m_scaleFactor != desc.m_scaleFactor))
+        {
+            update_constant_buffer(desc, region.m_pParamsCB, pViews[i].m_screenSize, m_viewsPitch, region.m_bufferHeight);
+            region.m_screenWidth  = pViews[i].m_screenSize.x;
+            region.m_screenHeight = pViews[i].m_screenSize.y;
+            region.m_padding      = m_padding;
+            region.m_scaleFactor  = desc.m_scaleFactor;
+        }
+    }
+
+    // clear the intermediate buffer of all views
+    UINT clearValues[4] = { 0 };
+    pCtx->ClearUnorderedAccessViewUint(m_pIntermediateUAV, clearValues);
+
+    // Fast Filter Setup, every view reads its own textures
+    pCtx->CSSetShader(pSetupCS[mode], nullptr, 0);
+    for (uint i = 0; i < viewCount; ++i)
+    {
+        const DEPTHOFFIELDFX_VIEW& view = pViews[i];
+
+        int tgX = (view.m_screenSize.x + 7) / 8;
+        int tgY = (view.m_screenSize.y + 7) / 8;
+        if (mode == DEPTHOFFIELDFX_MODE_RENDER_QUARTER_RES)
+        {
+            tgX = ((view.m_screenSize.x / 2) + 7) / 8;
+            tgY = ((view.m_screenSize.y / 2) + 7) / 8;
+        }
+
+        pSRVs[0] = view.m_pColorSRV;
+        pSRVs[1] = view.m_pCircleOfConfusionSRV;
+        pCtx->CSSetShaderResources(0, ELEMENTS_OF(pSRVs), pSRVs);
+        pCtx->CSSetConstantBuffers(0, 1, &m_viewRegions[i].m_pParamsCB);
+        Bind_UAVs(desc, m_viewRegions[i].m_pUAV, nullptr, nullptr);
+        pCtx->Dispatch(tgX, tgY, 1);
+    }
+
+    // do Vertical integration of all views at once
+    pCtx->CSSetShader(pIntegrateCS[mode], nullptr, 0);
+    pCtx->CSSetConstantBuffers(0, 1, &m_pViewsParamsCB);
+    Bind_UAVs(desc, m_pIntermediateUAV, m_pIntermediateTransposedUAV, nullptr);
+    pCtx->Dispatch((m_viewsPitch + 63) / 64, 1, 1);
+
+    // do vertical integration by transposing the image and doing horizontal integration again
+    pCtx->CSSetConstantBuffers(0, 1, &m_pViewsTransposedParamsCB);
+    Bind_UAVs(desc, m_pIntermediateTransposedUAV, m_pIntermediateUAV, nullptr);
+    pCtx->Dispatch((m_viewsHeight + 63) / 64, 1, 1);
+
+    pCtx->CSSetShader(m_pShaders->m_pReadFinalResultCS, nullptr, 0);
+    for (uint i = 0; i < viewCount; ++i)
+    {
+        const DEPTHOFFIELDFX_VIEW& view = pViews[i];
+
+        pSRVs[0] = view.m_pColorSRV;
+        pSRVs[1] = view.m_pCircleOfConfusionSRV;
+        pCtx->CSSetShaderResources(0, ELEMENTS_OF(pSRVs), pSRVs);
+        pCtx->CSSetConstantBuffers(0, 1, &m_viewRegions[i].m_pParamsCB);
+        Bind_UAVs(desc, m_viewRegions[i].m_pUAV, nullptr, view.m_pResultUAV);
+        pCtx->Dispatch((view.m_screenSize.x + 7) / 8, (view.m_screenSize.y + 7) / 8, 1);
+    }
+
+    memset(pSRVs, 0, sizeof(pSRVs));
+    pCtx->CSSetUnorderedAccessViews(0, ELEMENTS_OF(pUAVs), pUAVs, nullptr);
+    pCtx->CSSetShaderResources(0, ELEMENTS_OF(pSRVs), pSRVs);
+    pCtx->CSSetConstantBuffers(0, ELEMENTS_OF(pCBs), pCBs);
+
+    return convert_result(result);
+}
+
 DEPTHOFFIELDFX_RETURN_CODE DEPTHOFFIELDFX_OPAQUE_DESC::release()
 {
     DEPTHOFFIELDFX_RETURN_CODE result = DEPTHOFFIELDFX_RETURN_CODE_SUCCESS;
-    SAFE_RELEASE(&m_pIntermediateBuffer);
-    SAFE_RELEASE(&m_pIntermediateBufferTransposed);
-    SAFE_RELEASE(&m_pIntermediateUAV);
-    SAFE_RELEASE(&m_pIntermediateTransposedUAV);
+    release_intermediate_buffers();
     SAFE_RELEASE(&m_pDofParamsCB);
+    DEPTHOFFIELDFX_SHADER_POOL::release(m_pShaders);
+    m_pShaders = nullptr;
+    return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Shader pool
+///////////////////////////////////////////////////////////////////////////////////////////////////
+static std::mutex                                s_shaderPoolMutex;
+static std::vector<DEPTHOFFIELDFX_SHADER_POOL*> s_shaderPools;
+
+DEPTHOFFIELDFX_SHADER_POOL::DEPTHOFFIELDFX_SHADER_POOL(ID3D11Device* pDevice)
+    : m_pDevice(pDevice)
+    , m_refCount(0)
+    , m_pPointSampler(nullptr)
+    , m_pFastFilterSetupCS(nullptr)
+    , m_pFastFilterSetupQuarterResCS(nullptr)
+    , m_pBoxFastFilterSetupCS(nullptr)
+    , m_pReadFinalResultCS(nullptr)
+    , m_pVerticalIntegrateCS(nullptr)
+    , m_pDoubleVerticalIntegrateCS(nullptr)
+{
+}
+
+DEPTHOFFIELDFX_SHADER_POOL* DEPTHOFFIELDFX_SHADER_POOL::acquire(ID3D11Device* pDevice)
+{
+    std::lock_guard<std::mutex> lock(s_shaderPoolMutex);
+
+    for (size_t i = 0; i < s_shaderPools.size(); ++i)
+    {
+        if (s_shaderPools[i]->m_pDevice == pDevice)
+        {
+            s_shaderPools[i]->m_refCount++;
+            return s_shaderPools[i];
+        }
+    }
+
+    DEPTHOFFIELDFX_SHADER_POOL* pPool = new DEPTHOFFIELDFX_SHADER_POOL(pDevice);
+    if (pPool->create_shaders() != DEPTHOFFIELDFX_RETURN_CODE_SUCCESS)
+    {
+        pPool->release_shaders();
+        delete pPool;
+        return nullptr;
+    }
+
+    pPool->m_refCount = 1;
+    s_shaderPools.push_back(pPool);
+    return pPool;
+}
+
+void DEPTHOFFIELDFX_SHADER_POOL::release(DEPTHOFFIELDFX_SHADER_POOL* pPool)
+{
+    if (pPool == nullptr)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(s_shaderPoolMutex);
+
+    if (--pPool->m_refCount == 0)
+    {
+        for (size_t i = 0; i < s_shaderPools.size(); ++i)
+        {
+            if (s_shaderPools[i] == pPool)
+            {
+                s_shaderPools.erase(s_shaderPools.begin() + i);
+                break;
+            }
+        }
+        pPool->release_shaders();
+        delete pPool;
+    }
+}
+
+void DEPTHOFFIELDFX_SHADER_POOL::release_shaders()
+{
     SAFE_RELEASE(&m_pPointSampler);
     SAFE_RELEASE(&m_pFastFilterSetupCS);
     SAFE_RELEASE(&m_pFastFilterSetupQuarterResCS);
@@ -401,15 +905,13 @@ DEPTHOFFIELDFX_RETURN_CODE DEPTHOFFIELDFX_OPAQUE_DESC::release()
     SAFE_RELEASE(&m_pReadFinalResultCS);
     SAFE_RELEASE(&m_pVerticalIntegrateCS);
     SAFE_RELEASE(&m_pDoubleVerticalIntegrateCS);
-    return result;
 }
 
-DEPTHOFFIELDFX_RETURN_CODE DEPTHOFFIELDFX_OPAQUE_DESC::create_shaders(const DEPTHOFFIELDFX_DESC& desc)
+DEPTHOFFIELDFX_RETURN_CODE DEPTHOFFIELDFX_SHADER_POOL::create_shaders()
 {
-    // ID3D11Device* pDevice = desc.m_pDevice;
     HRESULT result = S_OK;
 
-    ID3D11Device* pDev = desc.m_pDevice;
+    ID3D11Device* pDev = m_pDevice;
 
     if (result == S_OK)
     {
@@ -435,9 +937,18 @@ DEPTHOFFIELDFX_RETURN_CODE DEPTHOFFIELDFX_OPAQUE_DESC::create_shaders(const DEPT
     {
         result = pDev->CreateComputeShader(g_csDoubleVerticalIntegrate, sizeof(g_csDoubleVerticalIntegrate), nullptr, &m_pDoubleVerticalIntegrateCS);
     }
+    if (result == S_OK)
+    {
+        D3D11_SAMPLER_DESC sdesc = {};
+        sdesc.AddressU           = D3D11_TEXTURE_ADDRESS_CLAMP;
+        sdesc.AddressV           = D3D11_TEXTURE_ADDRESS_CLAMP;
+        sdesc.AddressW           = D3D11_TEXTURE_ADDRESS_CLAMP;
+        sdesc.ComparisonFunc     = D3D11_COMPARISON_ALWAYS;
+        sdesc.Filter             = D3D11_FILTER_MIN_LINEAR_MAG_MIP_POINT;
+        result                   = pDev->CreateSamplerState(&sdesc, &m_pPointSampler);
+    }
 
-
-    return convert_result(result);
+    return DEPTHOFFIELDFX_OPAQUE_DESC::convert_result(result);
 }
 
 DEPTHOFFIELDFX_RETURN_CODE DEPTHOFFIELDFX_OPAQUE_DESC::convert_result(HRESULT hResult)
@@ -452,26 +963,20 @@ DEPTHOFFIELDFX_RETURN_CODE DEPTHOFFIELDFX_OPAQUE_DESC::convert_result(HRESULT hR
 }
 
 BOOL DEPTHOFFIELDFX_OPAQUE_DESC::update_constant_buffer(const DEPTHOFFIELDFX_DESC& desc, uint padWidth, uint padHeight)
+{
+    return update_constant_buffer(desc, m_pDofParamsCB, desc.m_screenSize, padWidth, padHeight);
+}
+
+BOOL DEPTHOFFIELDFX_OPAQUE_DESC::update_constant_buffer(const DEPTHOFFIELDFX_DESC& desc, ID3D11Buffer* pCB, const DEPTHOFFIELDFX_DESC::uint2& screenSize, uint padWidth, uint padHeight)
 {
     ID3D11DeviceContext*     pCtx = desc.m_pDeviceContext;
     D3D11_MAPPED_SUBRESOURCE data;
-    pCtx->Map(m_pDofParamsCB, 0, D3D11_MAP_WRITE_DISCARD, 0, &data);
+    pCtx->Map(pCB, 0, D3D11_MAP_WRITE_DISCARD, 0, &data);
 
     if (data.pData != nullptr)
     {
-        dofParams* pParams             = static_cast<dofParams*>(data.pData);
-        pParams->bufferResolution.x    = padWidth;
-        pParams->bufferResolution.y    = padHeight;
-        pParams->sourceResolution.x    = desc.m_screenSize.x;
-        pParams->sourceResolution.y    = desc.m_screenSize.y;
-        pParams->invSourceResolution.x = 1.0f / static_cast<float>(desc.m_screenSize.x);
-        pParams->invSourceResolution.y = 1.0f / static_cast<float>(desc.m_screenSize.y);
-        pParams->padding               = desc.m_pOpaque->m_padding;
-        pParams->scale_factor          = float(1 << desc.m_scaleFactor);
-        memcpy(pParams->bartlettData, s_bartlettData, sizeof(s_bartlettData));
-        memcpy(pParams->boxBartlettData, s_boxBartlettData, sizeof(s_boxBartlettData));
-
-        pCtx->Unmap(m_pDofParamsCB, 0);
+        fill_params(desc, screenSize, m_padding, padWidth, padHeight, static_cast<dofParams*>(data.pData));
+        pCtx->Unmap(pCB, 0);
     }
 
     return TRUE;
@@ -23,14 +23,63 @@
 #ifndef AMD_DEPTHOFFIELDFX_OPAQUE_H
 #define AMD_DEPTHOFFIELDFX_OPAQUE_H
 
+#include <vector>
+
 #include "AMD_DepthOfFieldFX.h"
 
 #pragma warning(disable : 4127)  // disable conditional expression is constant warnings
 
 namespace AMD {
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Compiled shaders and sampler of a device. They are immutable once created, so every context
+// on the same device shares one pool. The pool is released with the last context using it.
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct DEPTHOFFIELDFX_SHADER_POOL
+{
+public:
+    static DEPTHOFFIELDFX_SHADER_POOL* acquire(ID3D11Device* pDevice);
+    static void                        release(DEPTHOFFIELDFX_SHADER_POOL* pPool);
+
+    ID3D11Device* m_pDevice;
+    uint          m_refCount;
+
+    ID3D11SamplerState* m_pPointSampler;
+
+    ID3D11ComputeShader* m_pFastFilterSetupCS;
+    ID3D11ComputeShader* m_pFastFilterSetupQuarterResCS;
+    ID3D11ComputeShader* m_pBoxFastFilterSetupCS;
+    ID3D11ComputeShader* m_pReadFinalResultCS;
+    ID3D11ComputeShader* m_pVerticalIntegrateCS;
+    ID3D11ComputeShader* m_pDoubleVerticalIntegrateCS;
+
+private:
+    DEPTHOFFIELDFX_SHADER_POOL(ID3D11Device* pDevice);
+
+    DEPTHOFFIELDFX_RETURN_CODE create_shaders();
+    void                       release_shaders();
+};
+
 struct DEPTHOFFIELDFX_OPAQUE_DESC
 {
 public:
+    // Rows of the intermediate buffers holding one view of a batched render. The regions are stacked
+    // at the pitch of the widest one, m_pUAV starts at the first row of the region.
+    // m_pParamsCB holds the constants of the setup and read of the view for the screen size, padding
+    // and scale factor below, it is only written again when one of them changes.
+    struct VIEW_REGION
+    {
+        uint m_bufferWidth;
+        uint m_bufferHeight;
+
+        ID3D11UnorderedAccessView* m_pUAV;
+        ID3D11Buffer*              m_pParamsCB;
+
+        uint m_screenWidth;
+        uint m_screenHeight;
+        uint m_padding;
+        uint m_scaleFactor;
+    };
+
 #pragma warning(push)
 #pragma warning(disable : 4201)  // suppress nameless struct/union level 4 warnings
     AMD_DECLARE_BASIC_VECTOR_TYPE;
@@ -42,32 +91,55 @@ public:
     DEPTHOFFIELDFX_RETURN_CODE render(const DEPTHOFFIELDFX_DESC& desc);
     DEPTHOFFIELDFX_RETURN_CODE render_quarter_res(const DEPTHOFFIELDFX_DESC& desc);
     DEPTHOFFIELDFX_RETURN_CODE render_box(const DEPTHOFFIELDFX_DESC& desc);
+    DEPTHOFFIELDFX_RETURN_CODE resize_views(const DEPTHOFFIELDFX_DESC& desc, const DEPTHOFFIELDFX_VIEW* pViews, uint viewCount);
+    DEPTHOFFIELDFX_RETURN_CODE render_views(const DEPTHOFFIELDFX_DESC& desc, DEPTHOFFIELDFX_MODE mode, const DEPTHOFFIELDFX_VIEW* pViews, uint viewCount);
+    DEPTHOFFIELDFX_RETURN_CODE trim(const DEPTHOFFIELDFX_DESC& desc);
     DEPTHOFFIELDFX_RETURN_CODE release();
+    DEPTHOFFIELDFX_RETURN_CODE set_frame_layout(const DEPTHOFFIELDFX_DESC& desc);
 
-    DEPTHOFFIELDFX_RETURN_CODE create_shaders(const DEPTHOFFIELDFX_DESC& desc);
     static DEPTHOFFIELDFX_RETURN_CODE convert_result(HRESULT hResult);
+    static void                       get_memory_requirements(const DEPTHOFFIELDFX_DESC& desc, DEPTHOFFIELDFX_MEMORY_REQUIREMENTS& info);
+
+    bool    count_resize(uint elementCount, uint trimResizeCount);
+    HRESULT reserve_intermediate_buffers(ID3D11Device* pDev, uint elementCount, bool trim);
+    HRESULT create_intermediate_buffers(ID3D11Device* pDev, uint elementCount);
+    HRESULT create_intermediate_views(ID3D11Device* pDev);
+    void    release_intermediate_views();
+    void    release_view_regions(size_t firstRegion);
+    void    release_intermediate_buffers();
 
     BOOL update_constant_buffer(const DEPTHOFFIELDFX_DESC& desc, uint padWidth, uint padHeight);
+    BOOL update_constant_buffer(const DEPTHOFFIELDFX_DESC& desc, ID3D11Buffer* pCB, const DEPTHOFFIELDFX_DESC::uint2& screenSize, uint padWidth, uint padHeight);
     void Bind_UAVs(const DEPTHOFFIELDFX_DESC& desc, ID3D11UnorderedAccessView* pUAV0, ID3D11UnorderedAccessView* pUAV1, ID3D11UnorderedAccessView* pUAV2);
 
 
+    // layout of the intermediate buffer for the current frame
     uint m_padding;
     uint m_bufferWidth;
     uint m_bufferHeight;
 
+    // The intermediate buffers hold m_bufferCapacity elements and are kept while the layout of a
+    // resize, m_bufferFootprint elements, fits. The UAVs only cover the footprint.
+    // m_smallResizeCount counts the resizes in a row that left more than half of the capacity unused.
+    uint m_bufferCapacity;
+    uint m_bufferFootprint;
+    uint m_smallResizeCount;
+
     ID3D11Buffer*              m_pIntermediateBuffer;
     ID3D11Buffer*              m_pIntermediateBufferTransposed;
     ID3D11UnorderedAccessView* m_pIntermediateUAV;
     ID3D11UnorderedAccessView* m_pIntermediateTransposedUAV;
     ID3D11Buffer*              m_pDofParamsCB;
-    ID3D11SamplerState*        m_pPointSampler;
 
-    ID3D11ComputeShader* m_pFastFilterSetupCS;
-    ID3D11ComputeShader* m_pFastFilterSetupQuarterResCS;
-    ID3D11ComputeShader* m_pBoxFastFilterSetupCS;
-    ID3D11ComputeShader* m_pReadFinalResultCS;
-    ID3D11ComputeShader* m_pVerticalIntegrateCS;
-    ID3D11ComputeShader* m_pDoubleVerticalIntegrateCS;
+    // Batched views share the integration passes, which run over the stacked regions as one buffer
+    // of m_viewsPitch by m_viewsHeight elements with the immutable constants below.
+    std::vector<VIEW_REGION> m_viewRegions;
+    uint                     m_viewsPitch;
+    uint                     m_viewsHeight;
+    ID3D11Buffer*            m_pViewsParamsCB;
+    ID3D11Buffer*            m_pViewsTransposedParamsCB;
+
+    DEPTHOFFIELDFX_SHADER_POOL* m_pShaders;
 };
 };
 
@@ -0,0 +1,134 @@
+//
+// Copyright (c) 2017 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+
+#include <assert.h>
+#include <math.h>
+
+#include "AMD_DepthOfFieldFX_ScaleFactor.h"
+
+namespace AMD {
+// the shaders compute 1 << m_scaleFactor in a signed int
+static const uint s_maxScaleFactor = 30;
+
+// normalized Bartlett of half width t = r + 1 at the offset (a, b) from its center
+static double BartlettWeight(int t, int a, int b) { return static_cast<double>(t - a) * static_cast<double>(t - b) / (static_cast<double>(t) * t * t * t); }
+
+// Largest normalized weight any Bartlett up to maxBlurRadius puts at the offset (a, b).
+// The weight is unimodal in the half width t, the maximum of the continuous function is the
+// root of 2t^2 - 3(a + b)t + 4ab, so only the integers around it and the ends have to be tried.
+static double MaxBartlettWeight(int a, int b, int maxBlurRadius)
+{
+    const int tMin = MAX(a, b) + 1;
+    const int tMax = maxBlurRadius + 1;
+    if (tMin > tMax)
+    {
+        return 0.0;
+    }
+
+    const double root = (3.0 * (a + b) + sqrt(9.0 * (a + b) * (a + b) - 32.0 * a * b)) / 4.0;
+    const int    t0   = static_cast<int>(floor(root));
+
+    double weight = MAX(BartlettWeight(tMin, a, b), BartlettWeight(tMax, a, b));
+    for (int t = t0; t <= t0 + 1; ++t)
+    {
+        if ((t >= tMin) && (t <= tMax))
+        {
+            weight = MAX(weight, BartlettWeight(t, a, b));
+        }
+    }
+    return weight;
+}
+
+// Upper bound of the sum of the normalized kernel weights that reach a single pixel, when every
+// neighbour scatters with the radius that puts the most weight on it. A uniform radius sums to 1.
+// The Bartlett and the box have a closed form at any radius, the other kernels are tabulated.
+static double MaxKernelSum(int maxBlurRadius, DEPTHOFFIELDFX_KERNEL_TYPE kernel)
+{
+    double sum = 0.0;
+    if (kernel == DEPTHOFFIELDFX_KERNEL_TYPE_BOX)
+    {
+        // the box of radius r has a weight of 1 / (2r + 1) and covers the 8r pixels at distance r
+        for (int r = 0; r <= maxBlurRadius; ++r)
+        {
+            sum += ((r == 0) ? 1.0 : 8.0 * r) / (2.0 * r + 1.0);
+        }
+    }
+    else if (kernel == DEPTHOFFIELDFX_KERNEL_TYPE_BARTLETT)
+    {
+        for (int b = 0; b <= maxBlurRadius; ++b)
+        {
+            for (int a = 0; a <= maxBlurRadius; ++a)
+            {
+                // every offset but the axes appears in four quadrants
+                const double mirrors = ((a == 0) ? 1.0 : 2.0) * ((b == 0) ? 1.0 : 2.0);
+                sum += mirrors * MaxBartlettWeight(a, b, maxBlurRadius);
+            }
+        }
+    }
+    else
+    {
+        assert(maxBlurRadius <= s_maxKernelTableRadius);
+        sum = GetKernel(kernel).m_maxKernelSums[MIN(maxBlurRadius, s_maxKernelTableRadius)];
+    }
+    return sum;
+}
+
+// the kernel sums of the tabulated radii when the radius of each axis is picked independently
+static double MaxAnisotropicKernelSum(int maxBlurRadius, DEPTHOFFIELDFX_KERNEL_TYPE kernel)
+{
+    assert(maxBlurRadius <= s_maxKernelTableRadius);
+    return GetKernel(kernel).m_maxAnisotropicKernelSums[MIN(maxBlurRadius, s_maxKernelTableRadius)];
+}
+
+// The deltas are accumulated modulo 2^laneBits, so intermediate sums may wrap as long as every
+// integrated pixel fits in laneBits - 1 bits. That holds for every running sum of a kernel of higher
+// order too, only the last one is a color. The weight channel integrates a color of 1.
+void GetScaleFactorInfo(uint scaleFactor, uint maxBlurRadius, DEPTHOFFIELDFX_KERNEL_TYPE kernel, bool anisotropic, float peakColor, uint laneBits, DEPTHOFFIELDFX_SCALE_FACTOR_INFO& info)
+{
+    const int    radius   = static_cast<int>(maxBlurRadius);
+    const double limit    = ldexp(1.0, static_cast<int>(laneBits) - 1) - 1.0;
+    const double peak     = MAX(static_cast<double>(fabsf(peakColor)), 1.0);
+    const double sum      = anisotropic ? MaxAnisotropicKernelSum(radius, kernel) : MaxKernelSum(radius, kernel);
+
+    // Rounding the splats to integers adds at most half a unit per kernel times its unnormalized sum,
+    // for every neighbour scattering with the widest kernel.
+    const DEPTHOFFIELDFX_KERNEL& widest   = GetKernel(kernel);
+    const double                 area     = GetKernelArea(widest, radius);
+    const double                 rounding = 0.5 * area * area;
+    const double                 weight   = (widest.m_desc.m_normalizedAxes == 2) ? area * area : area;
+
+    const double safeScale = (limit - rounding) / (peak * sum);
+    info.m_scaleFactor     = (safeScale >= 1.0) ? MIN(static_cast<uint>(floor(log2(safeScale))), s_maxScaleFactor) : 0;
+
+    const double scale   = ldexp(1.0, static_cast<int>(scaleFactor));
+    info.m_headroomBits  = static_cast<float>(log2(limit / (scale * peak * sum + rounding)));
+    info.m_precisionBits = static_cast<float>(log2(scale / weight));
+
+    // Every splat rounds its colors and its weight by at most half a unit. The kernel weights a
+    // pixel receives sum to at least scale / weight units, so the normalized result is off by at
+    // most (1 + peak) / 2 of a unit relative to that sum.
+    const double splatUnits = scale / weight;
+    info.m_errorBound       = (splatUnits > 0.5) ? static_cast<float>(0.5 * (1.0 + peak) / (splatUnits - 0.5)) : HUGE_VALF;
+}
+}
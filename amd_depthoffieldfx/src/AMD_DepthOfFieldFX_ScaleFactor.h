@@ -0,0 +1,42 @@
+//
+// Copyright (c) 2017 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+
+#ifndef AMD_DEPTHOFFIELDFX_SCALEFACTOR_H
+#define AMD_DEPTHOFFIELDFX_SCALEFACTOR_H
+
+#include "AMD_DepthOfFieldFX.h"
+#include "AMD_DepthOfFieldFX_Kernel.h"
+
+namespace AMD {
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Fixed point analysis shared by the D3D11 and the CPU backend.
+// maxBlurRadius is the largest radius a splat is scattered with, in pixels of the intermediate
+// buffer. kernel is the kernel the splats are scattered with, anisotropic when each splat may pick
+// the radius of each axis up to maxBlurRadius.
+// laneBits is the width of the lanes of the intermediate buffer, 32 or 16.
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void GetScaleFactorInfo(uint scaleFactor, uint maxBlurRadius, DEPTHOFFIELDFX_KERNEL_TYPE kernel, bool anisotropic, float peakColor, uint laneBits, DEPTHOFFIELDFX_SCALE_FACTOR_INFO& info);
+}
+
+#endif  // AMD_DEPTHOFFIELDFX_SCALEFACTOR_H
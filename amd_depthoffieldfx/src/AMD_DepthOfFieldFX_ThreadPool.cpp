@@ -0,0 +1,141 @@
+//
+// Copyright (c) 2017 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "AMD_DepthOfFieldFX_ThreadPool.h"
+
+namespace AMD {
+DEPTHOFFIELDFX_THREAD_POOL::DEPTHOFFIELDFX_THREAD_POOL()
+    : m_pTask(nullptr)
+    , m_taskCount(0)
+    , m_nextTask(0)
+    , m_busyWorkers(0)
+    , m_generation(0)
+    , m_shutdown(false)
+{
+}
+
+DEPTHOFFIELDFX_THREAD_POOL::~DEPTHOFFIELDFX_THREAD_POOL() { release(); }
+
+uint DEPTHOFFIELDFX_THREAD_POOL::resolve_thread_count(uint numThreads) { return (numThreads == 0) ? MAX(1u, std::thread::hardware_concurrency()) : numThreads; }
+
+void DEPTHOFFIELDFX_THREAD_POOL::initialize(uint numThreads)
+{
+    release();
+
+    numThreads = resolve_thread_count(numThreads);
+
+    m_shutdown = false;
+    for (uint i = 1; i < numThreads; ++i)
+    {
+        m_workers.push_back(std::thread(&DEPTHOFFIELDFX_THREAD_POOL::worker_main, this, i));
+    }
+}
+
+void DEPTHOFFIELDFX_THREAD_POOL::release()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_shutdown = true;
+    }
+    m_wakeCondition.notify_all();
+
+    for (size_t i = 0; i < m_workers.size(); ++i)
+    {
+        m_workers[i].join();
+    }
+    m_workers.clear();
+    m_generation = 0;
+}
+
+void DEPTHOFFIELDFX_THREAD_POOL::dispatch(uint taskCount, const TASK& task)
+{
+    if (taskCount == 0)
+    {
+        return;
+    }
+
+    // not worth waking the workers for a single task
+    if (m_workers.empty() || taskCount == 1)
+    {
+        for (uint i = 0; i < taskCount; ++i)
+        {
+            task(i, 0);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pTask       = &task;
+        m_taskCount   = taskCount;
+        m_busyWorkers = static_cast<uint>(m_workers.size());
+        m_nextTask.store(0);
+        ++m_generation;
+    }
+    m_wakeCondition.notify_all();
+
+    run_tasks(0);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_doneCondition.wait(lock, [this] { return m_busyWorkers == 0; });
+    m_pTask = nullptr;
+}
+
+void DEPTHOFFIELDFX_THREAD_POOL::worker_main(uint threadIndex)
+{
+    uint64 seenGeneration = 0;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wakeCondition.wait(lock, [&] { return m_shutdown || m_generation != seenGeneration; });
+            if (m_shutdown)
+            {
+                return;
+            }
+            seenGeneration = m_generation;
+        }
+
+        run_tasks(threadIndex);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            --m_busyWorkers;
+        }
+        m_doneCondition.notify_one();
+    }
+}
+
+void DEPTHOFFIELDFX_THREAD_POOL::run_tasks(uint threadIndex)
+{
+    for (;;)
+    {
+        const uint taskIndex = m_nextTask.fetch_add(1);
+        if (taskIndex >= m_taskCount)
+        {
+            break;
+        }
+        (*m_pTask)(taskIndex, threadIndex);
+    }
+}
+}
@@ -0,0 +1,80 @@
+//
+// Copyright (c) 2017 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#ifndef AMD_DEPTHOFFIELDFX_THREADPOOL_H
+#define AMD_DEPTHOFFIELDFX_THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "AMD_Types.h"
+
+namespace AMD {
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Minimal fork/join pool used by the CPU backend.
+// dispatch() runs task(taskIndex, threadIndex) for every taskIndex in [0, taskCount) and
+// returns once all of them have completed. The calling thread takes part as thread 0.
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct DEPTHOFFIELDFX_THREAD_POOL
+{
+public:
+    typedef std::function<void(uint taskIndex, uint threadIndex)> TASK;
+
+    DEPTHOFFIELDFX_THREAD_POOL();
+    ~DEPTHOFFIELDFX_THREAD_POOL();
+
+    // number of threads initialize(numThreads) starts, including the calling thread
+    static uint resolve_thread_count(uint numThreads);
+
+    void initialize(uint numThreads);
+    void release();
+    uint thread_count() const { return static_cast<uint>(m_workers.size()) + 1; }
+
+    void dispatch(uint taskCount, const TASK& task);
+
+private:
+    DEPTHOFFIELDFX_THREAD_POOL(const DEPTHOFFIELDFX_THREAD_POOL&);
+    DEPTHOFFIELDFX_THREAD_POOL& operator=(const DEPTHOFFIELDFX_THREAD_POOL&);
+
+    void worker_main(uint threadIndex);
+    void run_tasks(uint threadIndex);
+
+    std::vector<std::thread> m_workers;
+    std::mutex               m_mutex;
+    std::condition_variable  m_wakeCondition;
+    std::condition_variable  m_doneCondition;
+
+    const TASK*       m_pTask;
+    uint              m_taskCount;
+    std::atomic<uint> m_nextTask;
+    uint              m_busyWorkers;
+    uint64            m_generation;
+    bool              m_shutdown;
+};
+}
+
+#endif  // AMD_DEPTHOFFIELDFX_THREADPOOL_H
@@ -28,6 +28,11 @@
 #define CONVERT_TO_SRGB 1
 #endif
 
+// tCoc holds depth and the setup computes the circle of confusion from it
+#ifndef COC_FROM_DEPTH
+#define COC_FROM_DEPTH 0
+#endif
+
 #define RWTexToUse RWStructuredBuffer<int4>
 
 Texture2D<float4> tColor : register(t0);
@@ -51,6 +56,8 @@ cbuffer Params : register(b0)
     int    padding;
     int4   bartlettData[9];
     int4   boxBartlettData[4];
+    float4 cocParams;    // cocScale, focalLength, focusDistance, maxCoc
+    float4 depthParams;  // nearPlane, depthBias, depthScale, minCoc
 };
 
 
@@ -109,6 +116,40 @@ void WriteToBufferTransposed(RWTexToUse buffer, int2 addr2d, int4 color)
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 int CocToBlurRadius(const in float fCoc, const in int BlurRadius) { return clamp(abs(int(fCoc)), 0, BlurRadius); }
 
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// compute the Circle of Confusion from depth, the CalcDOF pass of the sample with folded constants
+///////////////////////////////////////////////////////////////////////////////////////////////////
+float CocFromDepth(const in float depth)
+{
+    const float sceneDepth      = depthParams.x / (depthParams.y + depthParams.z * depth);
+    const float distanceToLense = sceneDepth - cocParams.y;
+    const float coc             = (distanceToLense > 0.0) ? (cocParams.x * (1.0 - cocParams.z / distanceToLense)) : 0.0;
+    return clamp(coc, depthParams.w, cocParams.w);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// read the Circle of Confusion of one texel or of the 2x2 quad around texCoord
+///////////////////////////////////////////////////////////////////////////////////////////////////
+float LoadCoc(const in int2 addr)
+{
+    const float value = tCoc.Load(int3(addr, 0));
+#if COC_FROM_DEPTH
+    return CocFromDepth(value);
+#else
+    return value;
+#endif
+}
+
+float4 GatherCoc(const in float2 texCoord)
+{
+    const float4 value = tCoc.Gather(pointSampler, texCoord);
+#if COC_FROM_DEPTH
+    return float4(CocFromDepth(value.x), CocFromDepth(value.y), CocFromDepth(value.z), CocFromDepth(value.w));
+#else
+    return value;
+#endif
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 // convert color from float to int and divide by kernel weight
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -175,7 +216,7 @@ void FastFilterSetup(uint3 ThreadID : SV_DispatchThreadID)
     if ((int(ThreadID.x) < sourceResolution.x) && (int(ThreadID.y) < sourceResolution.y))
     {
         // Read the coc from the coc\depth buffer
-        const float fcoc        = tCoc.Load(int3(ThreadID.xy, 0));
+        const float fcoc        = LoadCoc(ThreadID.xy);
         const int   blur_radius = CocToBlurRadius(fcoc, padding);
         float3      vColor      = tColor.Load(int3(ThreadID.xy, 0)).rgb;
 
@@ -194,7 +235,7 @@ void QuarterResFastFilterSetup(uint3 ThreadID : SV_DispatchThreadID)
         float2 texCoord = (loc + 1.0) * invSourceResolution;
 
         const int    maxRadius = padding;
-        const float4 fCoc4     = tCoc.Gather(pointSampler, texCoord);
+        const float4 fCoc4     = GatherCoc(texCoord);
         const float4 focusMask = 2.0 < abs(fCoc4);
         const float  weight    = dot(focusMask, focusMask);
 
@@ -231,7 +272,7 @@ void BoxFastFilterSetup(uint3 ThreadID : SV_DispatchThreadID)
     if ((int(ThreadID.x) < sourceResolution.x) && (int(ThreadID.y) < sourceResolution.y))
     {
         // Read the coc from the coc\depth buffer
-        const float fcoc        = tCoc.Load(int3(ThreadID.xy, 0));
+        const float fcoc        = LoadCoc(ThreadID.xy);
         const int   blur_radius = CocToBlurRadius(fcoc, padding);
         float3      vColor      = tColor.Load(int3(ThreadID.xy, 0)).rgb;
 
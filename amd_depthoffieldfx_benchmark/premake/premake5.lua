@@ -0,0 +1,56 @@
+_AMD_LIBRARY_NAME = "DepthOfFieldFX"
+_AMD_LIBRARY_NAME_ALL_CAPS = string.upper(_AMD_LIBRARY_NAME)
+
+-- Set _AMD_LIBRARY_NAME before including amd_premake_util.lua
+dofile ("../../premake/amd_premake_util.lua")
+
+-- The benchmark builds the CPU backend sources directly, so it needs neither D3D11 nor
+-- Windows. Generate Visual Studio files with "premake5 vs2017" and makefiles with "premake5 gmake2".
+workspace (_AMD_LIBRARY_NAME .. "_Benchmark")
+   configurations { "Debug", "Release" }
+   platforms { "x64" }
+   location "../build"
+   filename (_AMD_LIBRARY_NAME .. "_Benchmark" .. _AMD_VS_SUFFIX)
+   startproject (_AMD_LIBRARY_NAME .. "_Benchmark")
+
+   filter "platforms:x64"
+      architecture "x64"
+
+project (_AMD_LIBRARY_NAME .. "_Benchmark")
+   kind "ConsoleApp"
+   language "C++"
+   cppdialect "C++11"
+   location "../build"
+   filename (_AMD_LIBRARY_NAME .. "_Benchmark" .. _AMD_VS_SUFFIX)
+   targetdir "../bin"
+   objdir "../build/%{_AMD_SAMPLE_DIR_LAYOUT}"
+   warnings "Extra"
+   symbols "On"
+
+   files { "../src/**.h", "../src/**.cpp" }
+   files { "../../amd_depthoffieldfx/inc/AMD_DepthOfFieldFX.h", "../../amd_depthoffieldfx/inc/AMD_DepthOfFieldFX_CPU.h" }
+   files { "../../amd_depthoffieldfx/src/AMD_DepthOfFieldFX_CPU*.h", "../../amd_depthoffieldfx/src/AMD_DepthOfFieldFX_CPU*.cpp" }
+   files { "../../amd_depthoffieldfx/src/AMD_DepthOfFieldFX_ThreadPool.h", "../../amd_depthoffieldfx/src/AMD_DepthOfFieldFX_ThreadPool.cpp" }
+   files { "../../amd_depthoffieldfx/src/AMD_DepthOfFieldFX_ScaleFactor.h", "../../amd_depthoffieldfx/src/AMD_DepthOfFieldFX_ScaleFactor.cpp" }
+   files { "../../amd_depthoffieldfx/src/AMD_DepthOfFieldFX_Kernel.h", "../../amd_depthoffieldfx/src/AMD_DepthOfFieldFX_Kernel.cpp" }
+   files { "../../amd_depthoffieldfx/src/AMD_DepthOfFieldFX_Lens.h", "../../amd_depthoffieldfx/src/AMD_DepthOfFieldFX_Lens.cpp" }
+   files { "../../amd_depthoffieldfx/src/AMD_DepthOfFieldFX_ModeSelector.h", "../../amd_depthoffieldfx/src/AMD_DepthOfFieldFX_ModeSelector.cpp" }
+   includedirs { "../../amd_depthoffieldfx/inc", "../../amd_lib/shared/common/inc" }
+   defines { "AMD_%{_AMD_LIBRARY_NAME_ALL_CAPS}_COMPILE_DYNAMIC_LIB=0" }
+
+   filter "system:windows"
+      -- Specify WindowsTargetPlatformVersion here for VS2015
+      systemversion (_AMD_WIN_SDK_VERSION)
+      defines { "WIN32", "_CONSOLE", "_WIN32_WINNT=0x0601" }
+
+   filter "system:linux"
+      links { "pthread" }
+
+   filter "configurations:Debug"
+      defines { "_DEBUG" }
+      targetsuffix ("_Debug" .. _AMD_VS_SUFFIX)
+
+   filter "configurations:Release"
+      defines { "NDEBUG" }
+      targetsuffix ("_Release" .. _AMD_VS_SUFFIX)
+      optimize "On"
@@ -0,0 +1,967 @@
+//
+// Copyright (c) 2017 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// Headless benchmark of the CPU backend.
+// Runs every combination of resolution, max blur radius and render mode on synthetic
+// or recorded (PFM) inputs and reports the time and memory traffic of every pass as
+// JSON or CSV. Needs neither a window nor a GPU.
+//--------------------------------------------------------------------------------------
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "AMD_DepthOfFieldFX_CPU.h"
+
+#pragma warning(disable : 4996)  // disable fopen deprecation warnings
+
+using namespace AMD;
+
+typedef DEPTHOFFIELDFX_CPU_DESC::uint2 uint2;
+
+// the scale factors the sample uses for the Bartlett and the box filter
+static const uint g_scale_factor     = 30;
+static const uint g_box_scale_factor = 24;
+
+static const char* g_modeNames[DEPTHOFFIELDFX_MODE_COUNT] = { "render", "quarter_res", "box" };
+static const char* g_passNames[DEPTHOFFIELDFX_PASS_COUNT] = { "clear", "setup", "integrate", "transpose_integrate", "read_final_result" };
+
+struct NAMED_RESOLUTION
+{
+    const char* name;
+    uint        width;
+    uint        height;
+};
+
+static const NAMED_RESOLUTION g_namedResolutions[] = {
+    { "720p", 1280, 720 }, { "1080p", 1920, 1080 }, { "1440p", 2560, 1440 }, { "4k", 3840, 2160 }, { "8k", 7680, 4320 },
+};
+
+struct BENCHMARK_OPTIONS
+{
+    std::vector<uint2>                     resolutions;
+    std::vector<uint>                      radii;
+    std::vector<DEPTHOFFIELDFX_MODE>       modes;
+    uint                                   frames;
+    uint                                   warmupFrames;
+    uint                                   numThreads;
+    uint64                                 memoryBudget;
+    DEPTHOFFIELDFX_CPU_INSTRUCTION_SET     instructionSet;
+    DEPTHOFFIELDFX_CPU_TRANSPOSE_MODE      transposeMode;
+    DEPTHOFFIELDFX_CPU_SCATTER_MODE        scatterMode;
+    DEPTHOFFIELDFX_CPU_INTERMEDIATE_FORMAT intermediateFormat;
+    DEPTHOFFIELDFX_CPU_DEFOCUS_MODE        defocusMode;
+    DEPTHOFFIELDFX_CPU_KERNEL              kernel;
+    DEPTHOFFIELDFX_CPU_BOKEH_ORIENTATION   bokehOrientation;
+    float                                  anamorphicSqueeze;
+    bool                                   autoScaleFactor;
+    bool                                   cocStatistics;
+    uint                                   reuseSquare;
+    bool                                   pyramid;
+    bool                                   layered;
+    bool                                   csv;
+    std::string                            outputPath;
+    std::string                            colorPath;
+    std::string                            cocPath;
+};
+
+// RGBA color and single channel circle of confusion, top row first
+struct BENCHMARK_INPUT
+{
+    std::string        name;
+    uint               width;
+    uint               height;
+    std::vector<float> color;
+    std::vector<float> coc;
+};
+
+struct PASS_STATISTICS
+{
+    double                      meanMilliseconds;
+    double                      minMilliseconds;
+    DEPTHOFFIELDFX_PASS_TRAFFIC traffic;
+};
+
+struct BENCHMARK_RESULT
+{
+    std::string         input;
+    uint                width;
+    uint                height;
+    uint                maxBlurRadius;
+    DEPTHOFFIELDFX_MODE mode;
+    uint                scaleFactor;
+    float               headroomBits;
+    float               maxError;
+    double              meanMilliseconds;
+    double              minMilliseconds;
+    double              reuseHitRate;
+    bool                pyramid;
+    uint64              intermediateBytes;
+    PASS_STATISTICS     passes[DEPTHOFFIELDFX_PASS_COUNT];
+};
+
+//--------------------------------------------------------------------------------------
+// Command line
+//--------------------------------------------------------------------------------------
+static void PrintUsage()
+{
+    fprintf(stderr,
+            "usage: DepthOfFieldFX_Benchmark [options]\n"
+            "  --resolutions <list>  comma separated, 720p 1080p 1440p 4k 8k or WxH (default: all named ones)\n"
+            "  --radii <list>        comma separated max blur radii, 1 to 64, up to 1024 with --pyramid on (default: 1,4,16,32,64)\n"
+            "  --modes <list>        comma separated, render quarter_res box (default: all)\n"
+            "  --frames <n>          timed frames per configuration (default: 10)\n"
+            "  --warmup <n>          untimed frames per configuration (default: 2)\n"
+            "  --threads <n>         worker threads, 0 uses every hardware thread (default: 0)\n"
+            "  --budget <bytes>      memory budget of the intermediate buffers, 0 renders untiled (default: 0)\n"
+            "  --isa <set>           auto scalar sse2 avx2 neon, instruction set of the integration kernels (default: auto)\n"
+            "  --transpose <mode>    in_place tiled tiled_non_temporal direct (default: in_place)\n"
+            "  --scatter <mode>      private_planes sharded_atomics banded (default: private_planes)\n"
+            "  --intermediate <fmt>  int32 or int16 lanes, int16 reports its largest error against int32 (default: int32)\n"
+            "  --defocus <mode>      full_frame, or measured to only run the passes over the blurred pixels (default: full_frame)\n"
+            "  --statistics <mode>   none, or frame to reduce the circle of confusion every timed frame and render with it (default: none)\n"
+            "  --reuse <size>        0, or the edge of a square of the color that moves every frame to render with m_reuseUnchangedTiles (default: 0)\n"
+            "  --pyramid <mode>      off, or on to run the render mode with DepthOfFieldFX_RenderPyramid (default: off)\n"
+            "  --layers <mode>       off, or on to composite the near field over the far one, render and box only (default: off)\n"
+            "  --kernel <kernel>     bartlett, or quadratic_bspline for radii of 1 to 24, kernel of the render mode (default: bartlett)\n"
+            "  --squeeze <ratio>     anamorphic squeeze of the bokeh, 1 or more (default: 1)\n"
+            "  --orientation <mode>  vertical horizontal tangential, axis of the squeezed bokeh (default: vertical)\n"
+            "  --scale <mode>        sample uses the scale factors of the sample, auto measures the peak color (default: sample)\n"
+            "  --color <file.pfm>    recorded color, replaces the synthetic inputs and --resolutions\n"
+            "  --coc <file.pfm>      recorded circle of confusion in pixels, required with --color\n"
+            "  --format <format>     json or csv (default: json)\n"
+            "  --output <file>       write the report to a file instead of stdout\n");
+}
+
+static std::vector<std::string> SplitList(const char* list)
+{
+    std::vector<std::string> items;
+    std::string              item;
+    for (const char* p = list; *p != '\0'; ++p)
+    {
+        if (*p == ',')
+        {
+            items.push_back(item);
+            item.clear();
+        }
+        else
+        {
+            item += *p;
+        }
+    }
+    items.push_back(item);
+    return items;
+}
+
+static bool ParseResolution(const std::string& text, uint2& resolution)
+{
+    for (size_t i = 0; i < sizeof(g_namedResolutions) / sizeof(g_namedResolutions[0]); ++i)
+    {
+        if (text == g_namedResolutions[i].name)
+        {
+            resolution.x = g_namedResolutions[i].width;
+            resolution.y = g_namedResolutions[i].height;
+            return true;
+        }
+    }
+    return (sscanf(text.c_str(), "%ux%u", &resolution.x, &resolution.y) == 2) && (resolution.x > 0) && (resolution.y > 0);
+}
+
+static int FindName(const std::string& text, const char* const* pNames, int count)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        if (text == pNames[i])
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static bool ParseOptions(int argc, char** argv, BENCHMARK_OPTIONS& options)
+{
+    static const char* s_isaNames[]         = { "auto", "scalar", "sse2", "avx2", "neon" };
+    static const char* s_transposeNames[]   = { "in_place", "tiled", "tiled_non_temporal", "direct" };
+    static const char* s_scatterNames[]     = { "private_planes", "sharded_atomics", "banded" };
+    static const char* s_formatNames[]      = { "int32", "int16" };
+    static const char* s_defocusNames[]     = { "full_frame", "measured" };
+    static const char* s_kernelNames[]      = { "bartlett", "quadratic_bspline" };
+    static const char* s_orientationNames[] = { "vertical", "horizontal", "tangential" };
+
+    options.frames             = 10;
+    options.warmupFrames       = 2;
+    options.numThreads         = 0;
+    options.memoryBudget       = 0;
+    options.instructionSet     = DEPTHOFFIELDFX_CPU_INSTRUCTION_SET_AUTO;
+    options.transposeMode      = DEPTHOFFIELDFX_CPU_TRANSPOSE_MODE_IN_PLACE;
+    options.scatterMode        = DEPTHOFFIELDFX_CPU_SCATTER_MODE_PRIVATE_PLANES;
+    options.intermediateFormat = DEPTHOFFIELDFX_CPU_INTERMEDIATE_FORMAT_INT32;
+    options.defocusMode        = DEPTHOFFIELDFX_CPU_DEFOCUS_MODE_FULL_FRAME;
+    options.kernel             = DEPTHOFFIELDFX_CPU_KERNEL_BARTLETT;
+    options.bokehOrientation   = DEPTHOFFIELDFX_CPU_BOKEH_ORIENTATION_VERTICAL;
+    options.anamorphicSqueeze  = 1.0f;
+    options.autoScaleFactor    = false;
+    options.cocStatistics      = false;
+    options.reuseSquare        = 0;
+    options.pyramid            = false;
+    options.layered            = false;
+    options.csv                = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string option = argv[i];
+        if (i + 1 >= argc)
+        {
+            fprintf(stderr, "missing value for %s\n", option.c_str());
+            return false;
+        }
+        const char* value = argv[++i];
+
+        if (option == "--resolutions")
+        {
+            const std::vector<std::string> items = SplitList(value);
+            for (size_t j = 0; j < items.size(); ++j)
+            {
+                uint2 resolution;
+                if (!ParseResolution(items[j], resolution))
+                {
+                    fprintf(stderr, "invalid resolution %s\n", items[j].c_str());
+                    return false;
+                }
+                options.resolutions.push_back(resolution);
+            }
+        }
+        else if (option == "--radii")
+        {
+            const std::vector<std::string> items = SplitList(value);
+            for (size_t j = 0; j < items.size(); ++j)
+            {
+                const int radius = atoi(items[j].c_str());
+                if ((radius < 1) || (radius > static_cast<int>(DEPTHOFFIELDFX_CPU_PYRAMID_MAX_BLUR_RADIUS)))
+                {
+                    fprintf(stderr, "invalid max blur radius %s\n", items[j].c_str());
+                    return false;
+                }
+                options.radii.push_back(static_cast<uint>(radius));
+            }
+        }
+        else if (option == "--modes")
+        {
+            const std::vector<std::string> items = SplitList(value);
+            for (size_t j = 0; j < items.size(); ++j)
+            {
+                const int mode = FindName(items[j], g_modeNames, DEPTHOFFIELDFX_MODE_COUNT);
+                if (mode < 0)
+                {
+                    fprintf(stderr, "invalid mode %s\n", items[j].c_str());
+                    return false;
+                }
+                options.modes.push_back(static_cast<DEPTHOFFIELDFX_MODE>(mode));
+            }
+        }
+        else if (option == "--isa")
+        {
+            const int instructionSet = FindName(value, s_isaNames, 5);
+            if (instructionSet < 0)
+            {
+                fprintf(stderr, "invalid instruction set %s\n", value);
+                return false;
+            }
+            options.instructionSet = static_cast<DEPTHOFFIELDFX_CPU_INSTRUCTION_SET>(instructionSet);
+        }
+        else if (option == "--transpose")
+        {
+            const int mode = FindName(value, s_transposeNames, 4);
+            if (mode < 0)
+            {
+                fprintf(stderr, "invalid transpose mode %s\n", value);
+                return false;
+            }
+            options.transposeMode = static_cast<DEPTHOFFIELDFX_CPU_TRANSPOSE_MODE>(mode);
+        }
+        else if (option == "--scatter")
+        {
+            const int mode = FindName(value, s_scatterNames, 3);
+            if (mode < 0)
+            {
+                fprintf(stderr, "invalid scatter mode %s\n", value);
+                return false;
+            }
+            options.scatterMode = static_cast<DEPTHOFFIELDFX_CPU_SCATTER_MODE>(mode);
+        }
+        else if (option == "--intermediate")
+        {
+            const int format = FindName(value, s_formatNames, 2);
+            if (format < 0)
+            {
+                fprintf(stderr, "invalid intermediate format %s\n", value);
+                return false;
+            }
+            options.intermediateFormat = static_cast<DEPTHOFFIELDFX_CPU_INTERMEDIATE_FORMAT>(format);
+        }
+        else if (option == "--defocus")
+        {
+            const int mode = FindName(value, s_defocusNames, 2);
+            if (mode < 0)
+            {
+                fprintf(stderr, "invalid defocus mode %s\n", value);
+                return false;
+            }
+            options.defocusMode = static_cast<DEPTHOFFIELDFX_CPU_DEFOCUS_MODE>(mode);
+        }
+        else if (option == "--statistics")
+        {
+            options.cocStatistics = (strcmp(value, "frame") == 0);
+            if (!options.cocStatistics && (strcmp(value, "none") != 0))
+            {
+                fprintf(stderr, "invalid statistics mode %s\n", value);
+                return false;
+            }
+        }
+        else if (option == "--reuse")
+        {
+            options.reuseSquare = static_cast<uint>(MAX(atoi(value), 0));
+        }
+        else if (option == "--pyramid")
+        {
+            options.pyramid = (strcmp(value, "on") == 0);
+            if (!options.pyramid && (strcmp(value, "off") != 0))
+            {
+                fprintf(stderr, "invalid pyramid mode %s\n", value);
+                return false;
+            }
+        }
+        else if (option == "--layers")
+        {
+            options.layered = (strcmp(value, "on") == 0);
+            if (!options.layered && (strcmp(value, "off") != 0))
+            {
+                fprintf(stderr, "invalid layers mode %s\n", value);
+                return false;
+            }
+        }
+        else if (option == "--kernel")
+        {
+            const int kernel = FindName(value, s_kernelNames, 2);
+            if (kernel < 0)
+            {
+                fprintf(stderr, "invalid kernel %s\n", value);
+                return false;
+            }
+            options.kernel = static_cast<DEPTHOFFIELDFX_CPU_KERNEL>(kernel);
+        }
+        else if (option == "--squeeze")
+        {
+            options.anamorphicSqueeze = static_cast<float>(atof(value));
+            if (!(options.anamorphicSqueeze >= 1.0f))
+            {
+                fprintf(stderr, "invalid squeeze %s\n", value);
+                return false;
+            }
+        }
+        else if (option == "--orientation")
+        {
+            const int orientation = FindName(value, s_orientationNames, 3);
+            if (orientation < 0)
+            {
+                fprintf(stderr, "invalid orientation %s\n", value);
+                return false;
+            }
+            options.bokehOrientation = static_cast<DEPTHOFFIELDFX_CPU_BOKEH_ORIENTATION>(orientation);
+        }
+        else if (option == "--frames")
+        {
+            options.frames = static_cast<uint>(MAX(atoi(value), 1));
+        }
+        else if (option == "--warmup")
+        {
+            options.warmupFrames = static_cast<uint>(MAX(atoi(value), 0));
+        }
+        else if (option == "--threads")
+        {
+            options.numThreads = static_cast<uint>(MAX(atoi(value), 0));
+        }
+        else if (option == "--budget")
+        {
+            options.memoryBudget = strtoull(value, nullptr, 10);
+        }
+        else if (option == "--scale")
+        {
+            options.autoScaleFactor = (strcmp(value, "auto") == 0);
+            if (!options.autoScaleFactor && (strcmp(value, "sample") != 0))
+            {
+                fprintf(stderr, "invalid scale mode %s\n", value);
+                return false;
+            }
+        }
+        else if (option == "--format")
+        {
+            options.csv = (strcmp(value, "csv") == 0);
+            if (!options.csv && (strcmp(value, "json") != 0))
+            {
+                fprintf(stderr, "invalid format %s\n", value);
+                return false;
+            }
+        }
+        else if (option == "--output")
+        {
+            options.outputPath = value;
+        }
+        else if (option == "--color")
+        {
+            options.colorPath = value;
+        }
+        else if (option == "--coc")
+        {
+            options.cocPath = value;
+        }
+        else
+        {
+            fprintf(stderr, "unknown option %s\n", option.c_str());
+            return false;
+        }
+    }
+
+    if (options.colorPath.empty() != options.cocPath.empty())
+    {
+        fprintf(stderr, "--color and --coc have to be given together\n");
+        return false;
+    }
+
+    if (options.resolutions.empty())
+    {
+        for (size_t i = 0; i < sizeof(g_namedResolutions) / sizeof(g_namedResolutions[0]); ++i)
+        {
+            uint2 resolution;
+            resolution.x = g_namedResolutions[i].width;
+            resolution.y = g_namedResolutions[i].height;
+            options.resolutions.push_back(resolution);
+        }
+    }
+    if (options.radii.empty())
+    {
+        static const uint s_defaultRadii[] = { 1, 4, 16, 32, 64 };
+        options.radii.assign(s_defaultRadii, s_defaultRadii + sizeof(s_defaultRadii) / sizeof(s_defaultRadii[0]));
+    }
+    if (options.modes.empty())
+    {
+        for (int mode = 0; mode < DEPTHOFFIELDFX_MODE_COUNT; ++mode)
+        {
+            options.modes.push_back(static_cast<DEPTHOFFIELDFX_MODE>(mode));
+        }
+    }
+
+    // only the pyramid blurs further than the padding of the intermediate buffer
+    for (size_t r = 0; r < options.radii.size(); ++r)
+    {
+        for (size_t m = 0; (options.radii[r] > 64) && (m < options.modes.size()); ++m)
+        {
+            if (!options.pyramid || (options.modes[m] != DEPTHOFFIELDFX_MODE_RENDER))
+            {
+                fprintf(stderr, "max blur radii above 64 need --pyramid on and --modes render\n");
+                return false;
+            }
+        }
+    }
+
+    // the near and far field layers are composited by the full resolution Bartlett and box modes alone
+    for (size_t m = 0; options.layered && (m < options.modes.size()); ++m)
+    {
+        if (options.pyramid || (options.modes[m] == DEPTHOFFIELDFX_MODE_RENDER_QUARTER_RES))
+        {
+            fprintf(stderr, "--layers on needs --pyramid off and --modes render,box\n");
+            return false;
+        }
+    }
+
+    // the render mode scatters the quadratic B-spline unless the pyramid replaces it
+    for (size_t m = 0; (options.kernel == DEPTHOFFIELDFX_CPU_KERNEL_QUADRATIC_BSPLINE) && !options.pyramid && (m < options.modes.size()); ++m)
+    {
+        for (size_t r = 0; (options.modes[m] == DEPTHOFFIELDFX_MODE_RENDER) && (r < options.radii.size()); ++r)
+        {
+            if ((options.radii[r] < 1) || (options.radii[r] > DEPTHOFFIELDFX_CPU_QUADRATIC_BSPLINE_MAX_BLUR_RADIUS))
+            {
+                fprintf(stderr, "--kernel quadratic_bspline needs max blur radii of 1 to %u for the render mode\n", DEPTHOFFIELDFX_CPU_QUADRATIC_BSPLINE_MAX_BLUR_RADIUS);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+//--------------------------------------------------------------------------------------
+// Inputs
+//--------------------------------------------------------------------------------------
+
+// A scene like image: a smooth gradient with some texture for color, and a circle of confusion
+// that runs from a blurred foreground through an in focus band to a blurred background, with
+// a few blocks of the opposite sign to create depth edges.
+static void CreateSyntheticInput(uint width, uint height, BENCHMARK_INPUT& input)
+{
+    input.name   = "synthetic";
+    input.width  = width;
+    input.height = height;
+    input.color.resize(static_cast<size_t>(width) * height * 4);
+    input.coc.resize(static_cast<size_t>(width) * height);
+
+    for (uint y = 0; y < height; ++y)
+    {
+        for (uint x = 0; x < width; ++x)
+        {
+            const float  u     = static_cast<float>(x) / static_cast<float>(width);
+            const float  v     = static_cast<float>(y) / static_cast<float>(height);
+            const size_t index = static_cast<size_t>(y) * width + x;
+
+            const float texture        = 0.5f + 0.5f * sinf(static_cast<float>(x) * 0.37f) * cosf(static_cast<float>(y) * 0.23f);
+            input.color[index * 4 + 0] = u * texture;
+            input.color[index * 4 + 1] = v * texture;
+            input.color[index * 4 + 2] = (1.0f - u) * (1.0f - texture);
+            input.color[index * 4 + 3] = 1.0f;
+
+            // in pixels, the library clamps it to the max blur radius
+            float coc = (v - 0.45f) * 160.0f;
+            if (((x / 128) + (y / 128)) % 5 == 0)
+            {
+                coc = -coc;
+            }
+            input.coc[index] = coc;
+        }
+    }
+}
+
+// Portable float map, "PF" for RGB and "Pf" for a single channel. Rows are stored bottom up.
+static bool LoadPfm(const char* pPath, uint channels, uint& width, uint& height, std::vector<float>& pixels)
+{
+    FILE* pFile = fopen(pPath, "rb");
+    if (pFile == nullptr)
+    {
+        fprintf(stderr, "cannot open %s\n", pPath);
+        return false;
+    }
+
+    char  type[3] = { 0 };
+    float scale   = 0.0f;
+    bool  valid   = (fscanf(pFile, "%2s %u %u %f", type, &width, &height, &scale) == 4) && (fgetc(pFile) != EOF);
+    valid         = valid && (strcmp(type, (channels == 3) ? "PF" : "Pf") == 0) && (width > 0) && (height > 0);
+
+    std::vector<float> file;
+    if (valid)
+    {
+        file.resize(static_cast<size_t>(width) * height * channels);
+        valid = (fread(&file[0], sizeof(float), file.size(), pFile) == file.size());
+    }
+    fclose(pFile);
+
+    if (!valid)
+    {
+        fprintf(stderr, "%s is not a %s PFM file\n", pPath, (channels == 3) ? "color" : "grayscale");
+        return false;
+    }
+
+    // a positive scale marks big endian data
+    if (scale > 0.0f)
+    {
+        for (size_t i = 0; i < file.size(); ++i)
+        {
+            uint8* pBytes = reinterpret_cast<uint8*>(&file[i]);
+            std::swap(pBytes[0], pBytes[3]);
+            std::swap(pBytes[1], pBytes[2]);
+        }
+    }
+
+    const uint outChannels = (channels == 3) ? 4 : 1;
+    pixels.resize(static_cast<size_t>(width) * height * outChannels);
+    for (uint y = 0; y < height; ++y)
+    {
+        for (uint x = 0; x < width; ++x)
+        {
+            const float* pSrc = &file[(static_cast<size_t>(height - 1 - y) * width + x) * channels];
+            float*       pDst = &pixels[(static_cast<size_t>(y) * width + x) * outChannels];
+            for (uint c = 0; c < channels; ++c)
+            {
+                pDst[c] = pSrc[c];
+            }
+            if (outChannels == 4)
+            {
+                pDst[3] = 1.0f;
+            }
+        }
+    }
+    return true;
+}
+
+static bool LoadRecordedInput(const BENCHMARK_OPTIONS& options, BENCHMARK_INPUT& input)
+{
+    uint cocWidth  = 0;
+    uint cocHeight = 0;
+    if (!LoadPfm(options.colorPath.c_str(), 3, input.width, input.height, input.color) || !LoadPfm(options.cocPath.c_str(), 1, cocWidth, cocHeight, input.coc))
+    {
+        return false;
+    }
+    if ((cocWidth != input.width) || (cocHeight != input.height))
+    {
+        fprintf(stderr, "the color and circle of confusion images differ in size\n");
+        return false;
+    }
+    if ((input.width > 16384) || (input.height > 16384))
+    {
+        fprintf(stderr, "the recorded images are larger than 16384x16384\n");
+        return false;
+    }
+    input.name = options.colorPath;
+    return true;
+}
+
+//--------------------------------------------------------------------------------------
+// Benchmark
+//--------------------------------------------------------------------------------------
+static DEPTHOFFIELDFX_RETURN_CODE RenderMode(const DEPTHOFFIELDFX_CPU_DESC& desc, DEPTHOFFIELDFX_MODE mode)
+{
+    if (desc.m_pyramid && (mode == DEPTHOFFIELDFX_MODE_RENDER))
+    {
+        return DepthOfFieldFX_RenderPyramid(desc);
+    }
+
+    switch (mode)
+    {
+    case DEPTHOFFIELDFX_MODE_RENDER_QUARTER_RES:
+        return DepthOfFieldFX_RenderQuarterRes(desc);
+    case DEPTHOFFIELDFX_MODE_RENDER_BOX:
+        return DepthOfFieldFX_RenderBox(desc);
+    default:
+        return DepthOfFieldFX_Render(desc);
+    }
+}
+
+static const char* ResultModeName(const BENCHMARK_RESULT& result) { return result.pyramid ? "pyramid" : g_modeNames[result.mode]; }
+
+// Swaps the red and blue channels of a square of the color that moves diagonally from frame to frame,
+// swapping it again restores the input.
+static void SwapReuseSquare(BENCHMARK_INPUT& input, uint size, uint frame)
+{
+    const uint width  = MIN(size, input.width);
+    const uint height = MIN(size, input.height);
+    const uint x0     = (frame * 17) % (input.width - width + 1);
+    const uint y0     = (frame * 11) % (input.height - height + 1);
+    for (uint y = y0; y < y0 + height; ++y)
+    {
+        for (uint x = x0; x < x0 + width; ++x)
+        {
+            float* pTexel = &input.color[(static_cast<size_t>(y) * input.width + x) * 4];
+            std::swap(pTexel[0], pTexel[2]);
+        }
+    }
+}
+
+static bool BenchmarkInput(const BENCHMARK_OPTIONS& options, BENCHMARK_INPUT& input, std::vector<BENCHMARK_RESULT>& results)
+{
+    std::vector<float> result(static_cast<size_t>(input.width) * input.height * 4);
+
+    DEPTHOFFIELDFX_CPU_DESC desc;
+    desc.m_screenSize.x        = input.width;
+    desc.m_screenSize.y        = input.height;
+    desc.m_numThreads          = options.numThreads;
+    desc.m_memoryBudget        = options.memoryBudget;
+    desc.m_instructionSet      = options.instructionSet;
+    desc.m_transposeMode       = options.transposeMode;
+    desc.m_scatterMode         = options.scatterMode;
+    desc.m_autoScaleFactor     = options.autoScaleFactor;
+    desc.m_intermediateFormat  = options.intermediateFormat;
+    desc.m_defocusMode         = options.defocusMode;
+    desc.m_kernel              = options.kernel;
+    desc.m_bokehOrientation    = options.bokehOrientation;
+    desc.m_anamorphicSqueeze   = options.anamorphicSqueeze;
+    desc.m_useCocStatistics    = options.cocStatistics;
+    desc.m_reuseUnchangedTiles = (options.reuseSquare != 0);
+    desc.m_pyramid             = options.pyramid;
+    desc.m_layered             = options.layered;
+    desc.m_convertToSRGB       = true;
+    desc.m_color.m_pData       = &input.color[0];
+    desc.m_color.m_pitch       = input.width * 4 * sizeof(float);
+    desc.m_color.m_format      = DEPTHOFFIELDFX_CPU_FORMAT_R32G32B32A32_FLOAT;
+    desc.m_result.m_pData      = &result[0];
+    desc.m_result.m_pitch      = input.width * 4 * sizeof(float);
+    desc.m_result.m_format     = DEPTHOFFIELDFX_CPU_FORMAT_R32G32B32A32_FLOAT;
+
+    desc.m_circleOfConfusion.m_pData  = &input.coc[0];
+    desc.m_circleOfConfusion.m_pitch  = input.width * sizeof(float);
+    desc.m_circleOfConfusion.m_format = DEPTHOFFIELDFX_CPU_FORMAT_R32_FLOAT;
+
+    if (DepthOfFieldFX_CreateContext(desc) != DEPTHOFFIELDFX_RETURN_CODE_SUCCESS || DepthOfFieldFX_Initialize(desc) != DEPTHOFFIELDFX_RETURN_CODE_SUCCESS)
+    {
+        fprintf(stderr, "failed to initialize DepthOfFieldFX\n");
+        return false;
+    }
+
+    float peakColor = 0.0f;
+    if (DepthOfFieldFX_MeasurePeakColor(desc, &peakColor) != DEPTHOFFIELDFX_RETURN_CODE_SUCCESS)
+    {
+        fprintf(stderr, "failed to measure the peak color\n");
+        DepthOfFieldFX_DestroyContext(desc);
+        return false;
+    }
+
+    bool success = true;
+    for (size_t r = 0; success && (r < options.radii.size()); ++r)
+    {
+        desc.m_maxBlurRadius = options.radii[r];
+
+        DEPTHOFFIELDFX_MEMORY_REQUIREMENTS requirements;
+        if ((DepthOfFieldFX_Resize(desc) != DEPTHOFFIELDFX_RETURN_CODE_SUCCESS) || (DepthOfFieldFX_GetMemoryRequirements(desc, &requirements) != DEPTHOFFIELDFX_RETURN_CODE_SUCCESS))
+        {
+            fprintf(stderr, "failed to resize to %ux%u with a max blur radius of %u\n", input.width, input.height, desc.m_maxBlurRadius);
+            success = false;
+            break;
+        }
+
+        for (size_t m = 0; m < options.modes.size(); ++m)
+        {
+            const DEPTHOFFIELDFX_MODE mode = options.modes[m];
+            desc.m_scaleFactor             = (mode == DEPTHOFFIELDFX_MODE_RENDER_BOX) ? g_box_scale_factor : g_scale_factor;
+
+            // the auto scale factor is the one the library picks for the same peak color,
+            // the levels of the pyramid have the headroom of the render mode at the level radius
+            const bool pyramid   = options.pyramid && (mode == DEPTHOFFIELDFX_MODE_RENDER);
+            desc.m_maxBlurRadius = pyramid ? MIN(options.radii[r], DEPTHOFFIELDFX_CPU_PYRAMID_LEVEL_RADIUS) : options.radii[r];
+
+            DEPTHOFFIELDFX_SCALE_FACTOR_INFO scaleFactorInfo;
+            DepthOfFieldFX_GetScaleFactorInfo(desc, mode, peakColor, &scaleFactorInfo);
+            if (options.autoScaleFactor)
+            {
+                desc.m_scaleFactor = scaleFactorInfo.m_scaleFactor;
+                DepthOfFieldFX_GetScaleFactorInfo(desc, mode, peakColor, &scaleFactorInfo);
+            }
+            desc.m_maxBlurRadius = options.radii[r];
+
+            fprintf(stderr, "%s %ux%u radius %u %s\n", input.name.c_str(), input.width, input.height, desc.m_maxBlurRadius, pyramid ? "pyramid" : g_modeNames[mode]);
+
+            BENCHMARK_RESULT benchmark;
+            memset(&benchmark.passes, 0, sizeof(benchmark.passes));
+            benchmark.input             = input.name;
+            benchmark.width             = input.width;
+            benchmark.height            = input.height;
+            benchmark.maxBlurRadius     = desc.m_maxBlurRadius;
+            benchmark.mode              = mode;
+            benchmark.scaleFactor       = desc.m_scaleFactor;
+            benchmark.headroomBits      = scaleFactorInfo.m_headroomBits;
+            benchmark.maxError          = 0.0f;
+            benchmark.meanMilliseconds  = 0.0;
+            benchmark.minMilliseconds   = 0.0;
+            benchmark.reuseHitRate      = 0.0;
+            benchmark.pyramid           = pyramid;
+            benchmark.intermediateBytes = requirements.m_totalBytes[mode];
+
+            // the first frame of a configuration renders everything, then the moving square and its halo
+            DepthOfFieldFX_ResetReuse(desc);
+            for (uint frame = 0; frame < options.warmupFrames + options.frames; ++frame)
+            {
+                if (options.reuseSquare != 0)
+                {
+                    SwapReuseSquare(input, options.reuseSquare, frame);
+                }
+
+                const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                DEPTHOFFIELDFX_RETURN_CODE status = options.cocStatistics ? DepthOfFieldFX_ComputeCocStatistics(desc) : DEPTHOFFIELDFX_RETURN_CODE_SUCCESS;
+                status = (status == DEPTHOFFIELDFX_RETURN_CODE_SUCCESS) ? RenderMode(desc, mode) : status;
+                const double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+                if (options.reuseSquare != 0)
+                {
+                    SwapReuseSquare(input, options.reuseSquare, frame);
+                }
+
+                DEPTHOFFIELDFX_CPU_PASS_TIMINGS timings;
+                if ((status != DEPTHOFFIELDFX_RETURN_CODE_SUCCESS) || (DepthOfFieldFX_GetPassTimings(desc, &timings) != DEPTHOFFIELDFX_RETURN_CODE_SUCCESS))
+                {
+                    fprintf(stderr, "render failed with %d\n", static_cast<int>(status));
+                    success = false;
+                    break;
+                }
+                if (frame < options.warmupFrames)
+                {
+                    continue;
+                }
+
+                DEPTHOFFIELDFX_CPU_REUSE_STATISTICS reuse;
+                DepthOfFieldFX_GetReuseStatistics(desc, &reuse);
+
+                const bool first = (frame == options.warmupFrames);
+                benchmark.meanMilliseconds += milliseconds / options.frames;
+                benchmark.reuseHitRate += (options.reuseSquare != 0) ? static_cast<double>(reuse.m_reusedTiles) / (reuse.m_tileCount.x * reuse.m_tileCount.y) / options.frames : 0.0;
+                benchmark.minMilliseconds = first ? milliseconds : std::min(benchmark.minMilliseconds, milliseconds);
+                for (int pass = 0; pass < DEPTHOFFIELDFX_PASS_COUNT; ++pass)
+                {
+                    PASS_STATISTICS& statistics = benchmark.passes[pass];
+                    statistics.meanMilliseconds += timings.m_milliseconds[pass] / options.frames;
+                    statistics.minMilliseconds = first ? timings.m_milliseconds[pass] : std::min(statistics.minMilliseconds, timings.m_milliseconds[pass]);
+                }
+            }
+            if (!success)
+            {
+                break;
+            }
+
+            // compare the linear result of the last frame with the one of 32 bit lanes, the pyramid only has those
+            if (!pyramid && (options.intermediateFormat != DEPTHOFFIELDFX_CPU_INTERMEDIATE_FORMAT_INT32))
+            {
+                desc.m_intermediateFormat = DEPTHOFFIELDFX_CPU_INTERMEDIATE_FORMAT_INT32;
+                desc.m_convertToSRGB      = false;
+                RenderMode(desc, mode);
+                const std::vector<float> reference = result;
+                desc.m_intermediateFormat          = options.intermediateFormat;
+                RenderMode(desc, mode);
+                desc.m_convertToSRGB = true;
+
+                for (size_t i = 0; i < result.size(); ++i)
+                {
+                    benchmark.maxError = std::max(benchmark.maxError, fabsf(result[i] - reference[i]));
+                }
+            }
+
+            for (int pass = 0; pass < DEPTHOFFIELDFX_PASS_COUNT; ++pass)
+            {
+                benchmark.passes[pass].traffic = requirements.m_passTraffic[mode][pass];
+            }
+            results.push_back(benchmark);
+        }
+    }
+
+    DepthOfFieldFX_DestroyContext(desc);
+    return success;
+}
+
+//--------------------------------------------------------------------------------------
+// Reports
+//--------------------------------------------------------------------------------------
+static void WriteCsv(FILE* pFile, const std::vector<BENCHMARK_RESULT>& results)
+{
+    fprintf(pFile, "input,width,height,max_blur_radius,mode,scale_factor,headroom_bits,max_error,pass,mean_ms,min_ms,buffer_bytes_read,buffer_bytes_written,texels_read,texels_written,reuse_hit_rate\n");
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const BENCHMARK_RESULT& result = results[i];
+        for (int pass = 0; pass < DEPTHOFFIELDFX_PASS_COUNT; ++pass)
+        {
+            const PASS_STATISTICS& statistics = result.passes[pass];
+            fprintf(pFile, "%s,%u,%u,%u,%s,%u,%.2f,%g,%s,%.4f,%.4f,%llu,%llu,%llu,%llu,\n", result.input.c_str(), result.width, result.height, result.maxBlurRadius,
+                    ResultModeName(result), result.scaleFactor, result.headroomBits, result.maxError, g_passNames[pass], statistics.meanMilliseconds, statistics.minMilliseconds, static_cast<unsigned long long>(statistics.traffic.m_bufferBytesRead),
+                    static_cast<unsigned long long>(statistics.traffic.m_bufferBytesWritten), static_cast<unsigned long long>(statistics.traffic.m_texelsRead),
+                    static_cast<unsigned long long>(statistics.traffic.m_texelsWritten));
+        }
+        fprintf(pFile, "%s,%u,%u,%u,%s,%u,%.2f,%g,total,%.4f,%.4f,,,,,%.4f\n", result.input.c_str(), result.width, result.height, result.maxBlurRadius, ResultModeName(result),
+                result.scaleFactor, result.headroomBits, result.maxError, result.meanMilliseconds, result.minMilliseconds, result.reuseHitRate);
+    }
+}
+
+static void WriteJson(FILE* pFile, const BENCHMARK_OPTIONS& options, const std::vector<BENCHMARK_RESULT>& results)
+{
+    fprintf(pFile, "{\n  \"frames\": %u,\n  \"warmupFrames\": %u,\n  \"threads\": %u,\n  \"memoryBudget\": %llu,\n  \"results\": [\n", options.frames, options.warmupFrames,
+            options.numThreads, static_cast<unsigned long long>(options.memoryBudget));
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const BENCHMARK_RESULT& result = results[i];
+
+        std::string input;
+        for (size_t c = 0; c < result.input.size(); ++c)
+        {
+            if ((result.input[c] == '"') || (result.input[c] == '\\'))
+            {
+                input += '\\';
+            }
+            input += result.input[c];
+        }
+
+        fprintf(pFile, "    {\n      \"input\": \"%s\",\n      \"width\": %u,\n      \"height\": %u,\n      \"maxBlurRadius\": %u,\n      \"mode\": \"%s\",\n", input.c_str(), result.width,
+                result.height, result.maxBlurRadius, ResultModeName(result));
+        fprintf(pFile, "      \"scaleFactor\": %u,\n      \"headroomBits\": %.2f,\n      \"maxError\": %g,\n", result.scaleFactor, result.headroomBits, result.maxError);
+        fprintf(pFile, "      \"meanMs\": %.4f,\n      \"minMs\": %.4f,\n      \"reuseHitRate\": %.4f,\n      \"intermediateBytes\": %llu,\n      \"passes\": [\n", result.meanMilliseconds,
+                result.minMilliseconds, result.reuseHitRate, static_cast<unsigned long long>(result.intermediateBytes));
+        for (int pass = 0; pass < DEPTHOFFIELDFX_PASS_COUNT; ++pass)
+        {
+            const PASS_STATISTICS& statistics = result.passes[pass];
+            fprintf(pFile,
+                    "        { \"name\": \"%s\", \"meanMs\": %.4f, \"minMs\": %.4f, \"bufferBytesRead\": %llu, \"bufferBytesWritten\": %llu, \"texelsRead\": %llu, \"texelsWritten\": %llu }%s\n",
+                    g_passNames[pass], statistics.meanMilliseconds, statistics.minMilliseconds, static_cast<unsigned long long>(statistics.traffic.m_bufferBytesRead),
+                    static_cast<unsigned long long>(statistics.traffic.m_bufferBytesWritten), static_cast<unsigned long long>(statistics.traffic.m_texelsRead),
+                    static_cast<unsigned long long>(statistics.traffic.m_texelsWritten), (pass + 1 < DEPTHOFFIELDFX_PASS_COUNT) ? "," : "");
+        }
+        fprintf(pFile, "      ]\n    }%s\n", (i + 1 < results.size()) ? "," : "");
+    }
+    fprintf(pFile, "  ]\n}\n");
+}
+
+int main(int argc, char** argv)
+{
+    BENCHMARK_OPTIONS options;
+    if (!ParseOptions(argc, argv, options))
+    {
+        PrintUsage();
+        return 2;
+    }
+
+    std::vector<BENCHMARK_RESULT> results;
+    bool                          success = true;
+    if (!options.colorPath.empty())
+    {
+        BENCHMARK_INPUT input;
+        success = LoadRecordedInput(options, input) && BenchmarkInput(options, input, results);
+    }
+    else
+    {
+        for (size_t i = 0; success && (i < options.resolutions.size()); ++i)
+        {
+            BENCHMARK_INPUT input;
+            CreateSyntheticInput(options.resolutions[i].x, options.resolutions[i].y, input);
+            success = BenchmarkInput(options, input, results);
+        }
+    }
+
+    FILE* pFile = options.outputPath.empty() ? stdout : fopen(options.outputPath.c_str(), "w");
+    if (pFile == nullptr)
+    {
+        fprintf(stderr, "cannot open %s\n", options.outputPath.c_str());
+        return 1;
+    }
+
+    // report what completed, even after a failure
+    if (options.csv)
+    {
+        WriteCsv(pFile, results);
+    }
+    else
+    {
+        WriteJson(pFile, options, results);
+    }
+    if (pFile != stdout)
+    {
+        fclose(pFile);
+    }
+
+    return success ? 0 : 1;
+}
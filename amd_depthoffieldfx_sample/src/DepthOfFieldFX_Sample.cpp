@@ -71,10 +71,16 @@ enum DepthOfFieldMode
     DOF_BoxFastFilterSpread        = 1,
     DOF_FastFilterSpread           = 2,
     DOF_QuarterResFastFilterSpread = 3,
+    DOF_Auto                       = 4,
 };
 
 DepthOfFieldMode g_depthOfFieldMode = DOF_FastFilterSpread;
 
+// picks the fast filter spread mode of each frame under a 2 ms budget in DOF_Auto
+AMD::DEPTHOFFIELDFX_MODE_SELECTOR g_dofModeSelector;
+AMD::DEPTHOFFIELDFX_MODE          g_dofAutoMode         = AMD::DEPTHOFFIELDFX_MODE_COUNT;
+AMD::DEPTHOFFIELDFX_MODE          g_dofPreviousAutoMode = AMD::DEPTHOFFIELDFX_MODE_COUNT;
+
 //--------------------------------------------------------------------------------------
 // Mesh
 //--------------------------------------------------------------------------------------
@@ -331,6 +337,7 @@ void InitApp()
     pComboBox->AddItem(L"BoxFFS", nullptr);
     pComboBox->AddItem(L"FFS", nullptr);
     pComboBox->AddItem(L"QuarterResFFS", nullptr);
+    pComboBox->AddItem(L"Auto", nullptr);
 
     pComboBox->SetSelectedByIndex(g_depthOfFieldMode);
     g_HUD.m_GUI.AddCheckBox(IDC_CHECKBOX_DEBUG_CIRCLE_OF_CONFUSION, L"Debug Circle Of Conf", AMD::HUD::iElementOffset, iY += AMD::HUD::iElementDelta, 140, 24, g_bDebugCircleOfConfusion);
@@ -528,7 +535,7 @@ void CALLBACK OnKeyboard(UINT nChar, bool bKeyDown, bool bAltDown, void* pUserCo
             g_bRenderHUD ^= true;
             break;
         case VK_TAB:
-            g_depthOfFieldMode = static_cast<DepthOfFieldMode>(g_depthOfFieldMode ^ 1 | 2);
+            g_depthOfFieldMode = static_cast<DepthOfFieldMode>(((g_depthOfFieldMode & 1) ^ 1) | 2);
             g_HUD.m_GUI.GetComboBox(ID_COMBOBOX_DOF_METHOD)->SetSelectedByIndex(g_depthOfFieldMode);
             break;
         case VK_C:
@@ -612,6 +619,7 @@ HRESULT CALLBACK OnD3D11CreateDevice(ID3D11Device* pd3dDevice, const DXGI_SURFAC
         g_AMD_DofFX_Desc.m_pDeviceContext = pd3dContext;
         g_AMD_DofFX_Desc.m_screenSize.x   = g_ScreenWidth;
         g_AMD_DofFX_Desc.m_screenSize.y   = g_ScreenHeight;
+        g_dofModeSelector.m_budgetMilliseconds = 2.0f;
         AMD::DEPTHOFFIELDFX_RETURN_CODE amdResult = AMD::DepthOfFieldFX_Initialize(g_AMD_DofFX_Desc);
         if (amdResult != AMD::DEPTHOFFIELDFX_RETURN_CODE_SUCCESS)
         {
@@ -974,7 +982,16 @@ void CALLBACK OnD3D11FrameRender(ID3D11Device* pd3dDevice, ID3D11DeviceContext*
 
     g_AMD_DofFX_Desc.m_scaleFactor = g_scale_factor;
 
-    switch (g_depthOfFieldMode)
+    g_dofPreviousAutoMode = g_dofAutoMode;
+    g_dofAutoMode         = AMD::DEPTHOFFIELDFX_MODE_COUNT;
+    DepthOfFieldMode depthOfFieldMode = g_depthOfFieldMode;
+    if ((depthOfFieldMode == DOF_Auto) && (AMD::DepthOfFieldFX_SelectMode(g_AMD_DofFX_Desc, g_dofModeSelector, &g_dofAutoMode) == AMD::DEPTHOFFIELDFX_RETURN_CODE_SUCCESS))
+    {
+        const DepthOfFieldMode autoModes[AMD::DEPTHOFFIELDFX_MODE_COUNT] = { DOF_FastFilterSpread, DOF_QuarterResFastFilterSpread, DOF_BoxFastFilterSpread };
+        depthOfFieldMode = autoModes[g_dofAutoMode];
+    }
+
+    switch (depthOfFieldMode)
     {
     case DOF_BoxFastFilterSpread:
         g_AMD_DofFX_Desc.m_scaleFactor = g_box_scale_factor;
@@ -1031,6 +1048,12 @@ void CALLBACK OnD3D11FrameRender(ID3D11Device* pd3dDevice, ID3D11DeviceContext*
     fTimeSceneRendering += scene;
     fTimeDofRendering += dof;
 
+    // the GPU timings lag behind, only calibrate once the same mode rendered two frames in a row
+    if ((g_dofAutoMode != AMD::DEPTHOFFIELDFX_MODE_COUNT) && (g_dofAutoMode == g_dofPreviousAutoMode))
+    {
+        AMD::DepthOfFieldFX_CalibrateModeSelector(g_AMD_DofFX_Desc, g_dofModeSelector, g_dofAutoMode, dof);
+    }
+
     if (g_bRenderHUD)
     {
         DXUT_BeginPerfEvent(DXUT_PERFEVENTCOLOR, L"HUD / Stats");
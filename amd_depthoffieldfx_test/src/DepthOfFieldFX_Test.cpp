@@ -0,0 +1,1475 @@
+//
+// Copyright (c) 2017 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// Tests of the CPU backend.
+// Checks the render calls against a brute force spread of every pixel and the results
+// of the modes that have to match bit for bit against each other. Prints one line per
+// test and returns the number of failed tests.
+//--------------------------------------------------------------------------------------
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
+#include "AMD_DepthOfFieldFX_CPU.h"
+#include "AMD_DepthOfFieldFX_CPU_Coc.h"
+#include "AMD_DepthOfFieldFX_CPU_Opaque.h"
+#include "AMD_DepthOfFieldFX_Kernel.h"
+#include "AMD_DepthOfFieldFX_ModeSelector.h"
+
+using namespace AMD;
+
+// RGBA color, single channel circle of confusion and RGBA result, top row first
+struct TEST_FRAME
+{
+    uint               width;
+    uint               height;
+    std::vector<float> color;
+    std::vector<float> coc;
+};
+
+typedef bool (*TEST_FUNCTION)();
+
+struct TEST_CASE
+{
+    const char*   name;
+    TEST_FUNCTION function;
+};
+
+//--------------------------------------------------------------------------------------
+// Helpers
+//--------------------------------------------------------------------------------------
+
+// A checkerboard with some noise for color, and a circle of confusion that runs from a blurred
+// foreground through an in focus band to a blurred background, with blocks of the opposite
+// sign to create depth edges. The sizes are odd so the tiles and bands do not divide them.
+static void CreateTestFrame(uint width, uint height, float maxCoc, TEST_FRAME& frame)
+{
+    frame.width  = width;
+    frame.height = height;
+    frame.color.resize(static_cast<size_t>(width) * height * 4);
+    frame.coc.resize(static_cast<size_t>(width) * height);
+
+    uint seed = 11;
+    for (uint y = 0; y < height; ++y)
+    {
+        for (uint x = 0; x < width; ++x)
+        {
+            const size_t index = static_cast<size_t>(y) * width + x;
+            for (uint c = 0; c < 4; ++c)
+            {
+                seed                       = seed * 1103515245 + 12345;
+                frame.color[index * 4 + c] = static_cast<float>(((x / 13) + (y / 13) + c) & 1) * 0.8f + static_cast<float>((seed >> 16) % 200) * 0.001f;
+            }
+
+            const float u   = static_cast<float>(x) / static_cast<float>(width);
+            float       coc = (u < 0.4f) ? (u - 0.4f) * 2.5f * maxCoc : ((u < 0.55f) ? 0.3f : (u - 0.55f) * 2.2f * maxCoc);
+            if ((x > width / 8) && (x < width / 4) && (y > height / 3) && (y < height / 2))
+            {
+                coc = 0.6f * maxCoc;
+            }
+            if ((x > 2 * width / 3) && (x < 5 * width / 6) && (y > height / 4) && (y < 3 * height / 4))
+            {
+                coc = -0.9f * maxCoc;
+            }
+            frame.coc[index] = coc;
+        }
+    }
+}
+
+static DEPTHOFFIELDFX_RETURN_CODE RenderMode(const DEPTHOFFIELDFX_CPU_DESC& desc, DEPTHOFFIELDFX_MODE mode)
+{
+    switch (mode)
+    {
+    case DEPTHOFFIELDFX_MODE_RENDER_QUARTER_RES:
+        return DepthOfFieldFX_RenderQuarterRes(desc);
+    case DEPTHOFFIELDFX_MODE_RENDER_BOX:
+        return DepthOfFieldFX_RenderBox(desc);
+    default:
+        return DepthOfFieldFX_Render(desc);
+    }
+}
+
+// A context rendering the images of a frame into a result of its own, destroyed with desc. The tests
+// change the settings of desc before the first Render, which initializes and resizes the context, or
+// call Resize again after.
+struct TEST_CONTEXT
+{
+    DEPTHOFFIELDFX_CPU_DESC desc;
+    std::vector<float>      result;
+    bool                    resized;
+
+    TEST_CONTEXT(TEST_FRAME& frame, uint maxBlurRadius)
+        : result(static_cast<size_t>(frame.width) * frame.height * 4, -1.0f)
+        , resized(false)
+    {
+        DepthOfFieldFX_CreateContext(desc);
+        desc.m_maxBlurRadius   = maxBlurRadius;
+        desc.m_numThreads      = 3;
+        desc.m_scaleFactor     = 16;
+        desc.m_convertToSRGB   = false;
+        desc.m_autoScaleFactor = true;
+        desc.m_screenSize.x    = frame.width;
+        desc.m_screenSize.y    = frame.height;
+        desc.m_color.m_pData   = &frame.color[0];
+        desc.m_color.m_pitch   = frame.width * 4 * sizeof(float);
+        desc.m_color.m_format  = DEPTHOFFIELDFX_CPU_FORMAT_R32G32B32A32_FLOAT;
+        desc.m_result.m_pData  = &result[0];
+        desc.m_result.m_pitch  = frame.width * 4 * sizeof(float);
+        desc.m_result.m_format = DEPTHOFFIELDFX_CPU_FORMAT_R32G32B32A32_FLOAT;
+
+        desc.m_circleOfConfusion.m_pData  = &frame.coc[0];
+        desc.m_circleOfConfusion.m_pitch  = frame.width * sizeof(float);
+        desc.m_circleOfConfusion.m_format = DEPTHOFFIELDFX_CPU_FORMAT_R32_FLOAT;
+    }
+
+    bool Resize()
+    {
+        DEPTHOFFIELDFX_RETURN_CODE code = resized ? DEPTHOFFIELDFX_RETURN_CODE_SUCCESS : DepthOfFieldFX_Initialize(desc);
+        if (code == DEPTHOFFIELDFX_RETURN_CODE_SUCCESS)
+        {
+            code = DepthOfFieldFX_Resize(desc);
+        }
+        resized = true;
+        return Check(code, "resize");
+    }
+
+    bool Render(DEPTHOFFIELDFX_MODE mode)
+    {
+        if (!resized && !Resize())
+        {
+            return false;
+        }
+        return Check(RenderMode(desc, mode), "render");
+    }
+
+    static bool Check(DEPTHOFFIELDFX_RETURN_CODE code, const char* pWhat)
+    {
+        if (code != DEPTHOFFIELDFX_RETURN_CODE_SUCCESS)
+        {
+            printf("  %s failed with %d\n", pWhat, code);
+            return false;
+        }
+        return true;
+    }
+
+private:
+    TEST_CONTEXT(const TEST_CONTEXT&);
+    TEST_CONTEXT& operator=(const TEST_CONTEXT&);
+};
+
+static float MaxError(const std::vector<float>& a, const std::vector<float>& b)
+{
+    float error = 0.0f;
+    for (size_t i = 0; i < a.size(); i += 4)
+    {
+        for (size_t c = 0; c < 3; ++c)
+        {
+            error = fmaxf(error, fabsf(a[i + c] - b[i + c]));
+        }
+    }
+    return error;
+}
+
+static bool CheckMaxError(const std::vector<float>& a, const std::vector<float>& b, float tolerance, const char* pWhat)
+{
+    const float error = MaxError(a, b);
+    if (error > tolerance)
+    {
+        printf("  %s: max error %g above %g\n", pWhat, error, tolerance);
+        return false;
+    }
+    return true;
+}
+
+static bool CheckIdentical(const std::vector<float>& a, const std::vector<float>& b, const char* pWhat)
+{
+    if ((a.size() != b.size()) || (memcmp(&a[0], &b[0], a.size() * sizeof(float)) != 0))
+    {
+        printf("  %s: results differ, max error %g\n", pWhat, MaxError(a, b));
+        return false;
+    }
+    return true;
+}
+
+// Spreads every pixel over the square of its blur radius with the weights of the Bartlett, or of the
+// box, and divides the sum of the colors by the sum of the weights. Like the shaders the Bartlett is
+// normalized over its area and the box by its width.
+static void ReferenceSpread(const TEST_FRAME& frame, int maxBlurRadius, bool box, std::vector<float>& result)
+{
+    const int           width  = static_cast<int>(frame.width);
+    const int           height = static_cast<int>(frame.height);
+    std::vector<double> sums(static_cast<size_t>(width) * height * 4, 0.0);
+
+    for (int y = 0; y < height; ++y)
+    {
+        for (int x = 0; x < width; ++x)
+        {
+            const size_t index  = static_cast<size_t>(y) * width + x;
+            const int    radius = MIN(abs(static_cast<int>(frame.coc[index])), maxBlurRadius);
+            const double h      = radius + 1.0;
+            const double norm   = box ? 1.0 / (2.0 * radius + 1.0) : 1.0 / (h * h * h * h);
+
+            for (int dy = -radius; dy <= radius; ++dy)
+            {
+                if ((y + dy < 0) || (y + dy >= height))
+                {
+                    continue;
+                }
+                for (int dx = -radius; dx <= radius; ++dx)
+                {
+                    if ((x + dx < 0) || (x + dx >= width))
+                    {
+                        continue;
+                    }
+                    const double weight = box ? norm : (h - abs(dx)) * (h - abs(dy)) * norm;
+                    double*      pSum   = &sums[(static_cast<size_t>(y + dy) * width + x + dx) * 4];
+                    for (int c = 0; c < 3; ++c)
+                    {
+                        pSum[c] += weight * frame.color[index * 4 + c];
+                    }
+                    pSum[3] += weight;
+                }
+            }
+        }
+    }
+
+    result.resize(sums.size());
+    for (size_t i = 0; i < sums.size(); i += 4)
+    {
+        for (size_t c = 0; c < 3; ++c)
+        {
+            result[i + c] = static_cast<float>(sums[i + c] / sums[i + 3]);
+        }
+        result[i + 3] = 1.0f;
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// Tests
+//--------------------------------------------------------------------------------------
+
+// Render and RenderBox match the spread of every pixel over its kernel
+static bool TestReference()
+{
+    TEST_FRAME frame;
+    CreateTestFrame(157, 97, 20.0f, frame);
+
+    bool success = true;
+    for (uint maxBlurRadius : { 1u, 7u, 16u })
+    {
+        for (int box = 0; box < 2; ++box)
+        {
+            TEST_CONTEXT       context(frame, maxBlurRadius);
+            std::vector<float> reference;
+            ReferenceSpread(frame, maxBlurRadius, box != 0, reference);
+            success = context.Render(box ? DEPTHOFFIELDFX_MODE_RENDER_BOX : DEPTHOFFIELDFX_MODE_RENDER) && success;
+            success = CheckMaxError(context.result, reference, 4e-3f, box ? "box" : "bartlett") && success;
+        }
+    }
+    return success;
+}
+
+// the setup does not depend on the number of worker threads
+static bool TestThreadCount()
+{
+    TEST_FRAME frame;
+    CreateTestFrame(211, 67, 30.0f, frame);
+
+    bool success = true;
+    for (int mode = 0; mode < DEPTHOFFIELDFX_MODE_COUNT; ++mode)
+    {
+        TEST_CONTEXT expected(frame, 24);
+        expected.desc.m_numThreads = 1;
+        success                    = expected.Render(static_cast<DEPTHOFFIELDFX_MODE>(mode)) && success;
+        for (uint numThreads : { 2u, 5u, 0u })
+        {
+            TEST_CONTEXT context(frame, 24);
+            context.desc.m_numThreads = numThreads;
+            success                   = context.Render(static_cast<DEPTHOFFIELDFX_MODE>(mode)) && success;
+            success                   = CheckIdentical(context.result, expected.result, "thread count") && success;
+        }
+    }
+    return success;
+}
+
+// The instruction sets the CPU lacks fail to initialize
+static bool SupportsInstructionSet(DEPTHOFFIELDFX_CPU_INSTRUCTION_SET instructionSet)
+{
+    DEPTHOFFIELDFX_CPU_DESC desc;
+    desc.m_instructionSet = instructionSet;
+    DepthOfFieldFX_CreateContext(desc);
+    const bool supported = (DepthOfFieldFX_Initialize(desc) == DEPTHOFFIELDFX_RETURN_CODE_SUCCESS);
+    DepthOfFieldFX_DestroyContext(desc);
+    return supported;
+}
+
+// the vector integration kernels match the scalar one bit for bit, for every order of integration
+static bool TestInstructionSets()
+{
+    TEST_FRAME frame;
+    CreateTestFrame(203, 131, 30.0f, frame);
+
+    bool success = true;
+    for (int mode = 0; mode < DEPTHOFFIELDFX_MODE_COUNT + 1; ++mode)
+    {
+        // the last pass renders the quadratic B-spline, integrated three times
+        const bool                bspline    = (mode == DEPTHOFFIELDFX_MODE_COUNT);
+        const DEPTHOFFIELDFX_MODE renderMode = bspline ? DEPTHOFFIELDFX_MODE_RENDER : static_cast<DEPTHOFFIELDFX_MODE>(mode);
+        const uint                radius     = bspline ? DEPTHOFFIELDFX_CPU_QUADRATIC_BSPLINE_MAX_BLUR_RADIUS : 33;
+
+        TEST_CONTEXT expected(frame, radius);
+        expected.desc.m_instructionSet = DEPTHOFFIELDFX_CPU_INSTRUCTION_SET_SCALAR;
+        expected.desc.m_kernel         = bspline ? DEPTHOFFIELDFX_CPU_KERNEL_QUADRATIC_BSPLINE : DEPTHOFFIELDFX_CPU_KERNEL_BARTLETT;
+        success                        = expected.Render(renderMode) && success;
+        for (int instructionSet = DEPTHOFFIELDFX_CPU_INSTRUCTION_SET_AUTO; instructionSet <= DEPTHOFFIELDFX_CPU_INSTRUCTION_SET_NEON; ++instructionSet)
+        {
+            if ((instructionSet == DEPTHOFFIELDFX_CPU_INSTRUCTION_SET_SCALAR) || !SupportsInstructionSet(static_cast<DEPTHOFFIELDFX_CPU_INSTRUCTION_SET>(instructionSet)))
+            {
+                continue;
+            }
+            TEST_CONTEXT context(frame, radius);
+            context.desc.m_instructionSet = static_cast<DEPTHOFFIELDFX_CPU_INSTRUCTION_SET>(instructionSet);
+            context.desc.m_kernel         = expected.desc.m_kernel;
+            success                       = context.Render(renderMode) && success;
+            success                       = CheckIdentical(context.result, expected.result, "instruction set") && success;
+        }
+    }
+    return success;
+}
+
+// every transpose mode writes the same result as the in place one
+static bool TestTransposeModes()
+{
+    TEST_FRAME frame;
+    CreateTestFrame(189, 143, 40.0f, frame);
+
+    bool success = true;
+    for (int mode = 0; mode < DEPTHOFFIELDFX_MODE_COUNT; ++mode)
+    {
+        TEST_CONTEXT expected(frame, 40);
+        expected.desc.m_transposeMode = DEPTHOFFIELDFX_CPU_TRANSPOSE_MODE_IN_PLACE;
+        success                       = expected.Render(static_cast<DEPTHOFFIELDFX_MODE>(mode)) && success;
+        for (int transposeMode = DEPTHOFFIELDFX_CPU_TRANSPOSE_MODE_TILED; transposeMode <= DEPTHOFFIELDFX_CPU_TRANSPOSE_MODE_DIRECT; ++transposeMode)
+        {
+            TEST_CONTEXT context(frame, 40);
+            context.desc.m_transposeMode = static_cast<DEPTHOFFIELDFX_CPU_TRANSPOSE_MODE>(transposeMode);
+            success                      = context.Render(static_cast<DEPTHOFFIELDFX_MODE>(mode)) && success;
+            success                      = CheckIdentical(context.result, expected.result, "transpose mode") && success;
+        }
+    }
+    return success;
+}
+
+// the scatter modes only change how the threads share the buffer, not the sums in it
+static bool TestScatterModes()
+{
+    TEST_FRAME frame;
+    CreateTestFrame(167, 151, 40.0f, frame);
+
+    bool success = true;
+    for (int mode = 0; mode < DEPTHOFFIELDFX_MODE_COUNT; ++mode)
+    {
+        TEST_CONTEXT expected(frame, 40);
+        expected.desc.m_scatterMode = DEPTHOFFIELDFX_CPU_SCATTER_MODE_PRIVATE_PLANES;
+        success                     = expected.Render(static_cast<DEPTHOFFIELDFX_MODE>(mode)) && success;
+        for (int scatterMode = DEPTHOFFIELDFX_CPU_SCATTER_MODE_SHARDED_ATOMICS; scatterMode <= DEPTHOFFIELDFX_CPU_SCATTER_MODE_BANDED; ++scatterMode)
+        {
+            for (uint numThreads : { 1u, 4u })
+            {
+                TEST_CONTEXT context(frame, 40);
+                context.desc.m_scatterMode = static_cast<DEPTHOFFIELDFX_CPU_SCATTER_MODE>(scatterMode);
+                context.desc.m_numThreads  = numThreads;
+                success                    = context.Render(static_cast<DEPTHOFFIELDFX_MODE>(mode)) && success;
+                success                    = CheckIdentical(context.result, expected.result, "scatter mode") && success;
+            }
+        }
+    }
+    return success;
+}
+
+// the footprint of the mode that needs the most memory
+static uint64 TotalBytes(const DEPTHOFFIELDFX_CPU_DESC& desc)
+{
+    DEPTHOFFIELDFX_MEMORY_REQUIREMENTS requirements;
+    DepthOfFieldFX_GetMemoryRequirements(desc, &requirements);
+
+    uint64 bytes = 0;
+    for (int mode = 0; mode < DEPTHOFFIELDFX_MODE_COUNT; ++mode)
+    {
+        bytes = MAX(bytes, requirements.m_totalBytes[mode]);
+    }
+    return bytes;
+}
+
+// Rendering in tiles under a memory budget matches the untiled result, the halo of every tile covers
+// the kernels that reach into it.
+static bool TestMemoryBudget()
+{
+    TEST_FRAME frame;
+    CreateTestFrame(301, 187, 40.0f, frame);
+
+    bool success = true;
+    for (int mode = 0; mode < DEPTHOFFIELDFX_MODE_COUNT; ++mode)
+    {
+        TEST_CONTEXT expected(frame, 40);
+        success                   = expected.Render(static_cast<DEPTHOFFIELDFX_MODE>(mode)) && success;
+        const uint64 untiledBytes = TotalBytes(expected.desc);
+        for (uint64 percent : { 55u, 80u })
+        {
+            // the direct transpose keeps a transposed buffer next to the intermediate one
+            for (DEPTHOFFIELDFX_CPU_TRANSPOSE_MODE transposeMode : { DEPTHOFFIELDFX_CPU_TRANSPOSE_MODE_IN_PLACE, DEPTHOFFIELDFX_CPU_TRANSPOSE_MODE_DIRECT })
+            {
+                TEST_CONTEXT context(frame, 40);
+                context.desc.m_memoryBudget  = untiledBytes * percent / 100;
+                context.desc.m_transposeMode = transposeMode;
+                success                      = context.Render(static_cast<DEPTHOFFIELDFX_MODE>(mode)) && success;
+                success                      = CheckIdentical(context.result, expected.result, "memory budget") && success;
+                if (TotalBytes(context.desc) > context.desc.m_memoryBudget)
+                {
+                    printf("  %llu bytes above the budget of %llu\n", static_cast<unsigned long long>(TotalBytes(context.desc)), static_cast<unsigned long long>(context.desc.m_memoryBudget));
+                    success = false;
+                }
+            }
+        }
+    }
+    return success;
+}
+
+// the bytes the buffers of the context of desc hold
+template <class T> static uint64 VectorBytes(const std::vector<T>& buffer) { return static_cast<uint64>(buffer.size()) * sizeof(T); }
+
+static void GetAllocatedBytes(const DEPTHOFFIELDFX_CPU_DESC& desc, uint64& intermediateBytes, uint64& transposedBytes, uint64& modeSurfaceBytes)
+{
+    const DEPTHOFFIELDFX_CPU_OPAQUE_DESC& opaque = *desc.m_pOpaque;
+
+    intermediateBytes = VectorBytes(opaque.m_intermediateBuffer);
+    for (const DEPTHOFFIELDFX_CPU_OPAQUE_DESC::PYRAMID_LEVEL& level : opaque.m_pyramidLevels)
+    {
+        intermediateBytes += VectorBytes(level.source) + VectorBytes(level.blurRadius) + VectorBytes(level.accumulation);
+    }
+    transposedBytes  = VectorBytes(opaque.m_intermediateBufferTransposed);
+    modeSurfaceBytes = VectorBytes(opaque.m_quadCoc);
+    for (const std::vector<DEPTHOFFIELDFX_CPU_OPAQUE_DESC::uint4>& plane : opaque.m_scatterPlanes)
+    {
+        modeSurfaceBytes += VectorBytes(plane);
+    }
+}
+
+// GetMemoryRequirements reports the bytes Resize allocates, for every setting that changes them
+static bool TestMemoryRequirements()
+{
+    TEST_FRAME frame;
+    CreateTestFrame(239, 163, 40.0f, frame);
+
+    bool success = true;
+    for (int setting = 0; setting < 7; ++setting)
+    {
+        TEST_CONTEXT context(frame, 40);
+        switch (setting)
+        {
+        case 1:
+            context.desc.m_scatterMode = DEPTHOFFIELDFX_CPU_SCATTER_MODE_PRIVATE_PLANES;
+            break;
+        case 2:
+            context.desc.m_transposeMode = DEPTHOFFIELDFX_CPU_TRANSPOSE_MODE_DIRECT;
+            break;
+        case 3:
+            context.desc.m_quarterResOnly = true;
+            break;
+        case 4:
+            context.desc.m_layered = true;
+            break;
+        case 5:
+            context.desc.m_pyramid = true;
+            break;
+        case 6:
+            context.desc.m_memoryBudget = TotalBytes(context.desc) / 2;
+            break;
+        }
+
+        DEPTHOFFIELDFX_MEMORY_REQUIREMENTS requirements;
+        success = TEST_CONTEXT::Check(DepthOfFieldFX_GetMemoryRequirements(context.desc, &requirements), "get memory requirements") && success;
+        success = context.Resize() && success;
+
+        uint64 intermediateBytes = 0;
+        uint64 transposedBytes   = 0;
+        uint64 modeSurfaceBytes  = 0;
+        GetAllocatedBytes(context.desc, intermediateBytes, transposedBytes, modeSurfaceBytes);
+        if ((requirements.m_intermediateBufferBytes == 0) || (requirements.m_intermediateBufferBytes != intermediateBytes) || (requirements.m_transposedBufferBytes != transposedBytes)
+            || (requirements.m_modeSurfaceBytes[DEPTHOFFIELDFX_MODE_RENDER] != modeSurfaceBytes))
+        {
+            printf("  setting %d reports %llu, %llu and %llu bytes, resize allocated %llu, %llu and %llu\n", setting, static_cast<unsigned long long>(requirements.m_intermediateBufferBytes),
+                   static_cast<unsigned long long>(requirements.m_transposedBufferBytes), static_cast<unsigned long long>(requirements.m_modeSurfaceBytes[DEPTHOFFIELDFX_MODE_RENDER]),
+                   static_cast<unsigned long long>(intermediateBytes), static_cast<unsigned long long>(transposedBytes), static_cast<unsigned long long>(modeSurfaceBytes));
+            success = false;
+        }
+    }
+    return success;
+}
+
+// Every context keeps the buffers it was resized for. Two contexts resized for different frames and
+// rendering in turn match renders of their own, and one renders on after the other is destroyed.
+static bool TestContexts()
+{
+    TEST_FRAME small;
+    TEST_FRAME large;
+    CreateTestFrame(131, 89, 12.0f, small);
+    CreateTestFrame(223, 167, 30.0f, large);
+
+    TEST_CONTEXT expectedSmall(small, 12);
+    TEST_CONTEXT expectedLarge(large, 30);
+    bool         success = expectedSmall.Render(DEPTHOFFIELDFX_MODE_RENDER);
+    success              = expectedLarge.Render(DEPTHOFFIELDFX_MODE_RENDER_BOX) && success;
+
+    TEST_CONTEXT first(small, 12);
+    {
+        TEST_CONTEXT second(large, 30);
+        success = first.Resize() && second.Resize() && success;
+        for (uint frame = 0; frame < 2; ++frame)
+        {
+            success = first.Render(DEPTHOFFIELDFX_MODE_RENDER) && second.Render(DEPTHOFFIELDFX_MODE_RENDER_BOX) && success;
+            success = CheckIdentical(first.result, expectedSmall.result, "first context") && success;
+            success = CheckIdentical(second.result, expectedLarge.result, "second context") && success;
+        }
+    }
+    success = first.Render(DEPTHOFFIELDFX_MODE_RENDER) && success;
+    success = CheckIdentical(first.result, expectedSmall.result, "context after destroying the other") && success;
+
+    // the default context cannot be destroyed and a desc has at most one context of its own
+    DEPTHOFFIELDFX_CPU_DESC desc;
+    if ((DepthOfFieldFX_DestroyContext(desc) != DEPTHOFFIELDFX_RETURN_CODE_INVALID_PARAMS) || (DepthOfFieldFX_CreateContext(desc) != DEPTHOFFIELDFX_RETURN_CODE_SUCCESS) ||
+        (DepthOfFieldFX_CreateContext(desc) != DEPTHOFFIELDFX_RETURN_CODE_INVALID_PARAMS))
+    {
+        printf("  context calls did not fail on the wrong context\n");
+        success = false;
+    }
+    return success;
+}
+
+// A context sized for the quarter res mode alone renders it like one sized for every mode, with a quarter
+// of the memory, and fails the full resolution modes.
+static bool TestQuarterResOnly()
+{
+    TEST_FRAME frame;
+    CreateTestFrame(247, 139, 40.0f, frame);
+
+    TEST_CONTEXT expected(frame, 40);
+    bool         success = expected.Render(DEPTHOFFIELDFX_MODE_RENDER_QUARTER_RES);
+
+    TEST_CONTEXT context(frame, 40);
+    context.desc.m_quarterResOnly = true;
+    success                       = context.Render(DEPTHOFFIELDFX_MODE_RENDER_QUARTER_RES) && success;
+    success                       = CheckIdentical(context.result, expected.result, "quarter res only") && success;
+
+    if (TotalBytes(context.desc) * 3 > TotalBytes(expected.desc))
+    {
+        printf("  quarter res only takes %llu of %llu bytes\n", static_cast<unsigned long long>(TotalBytes(context.desc)), static_cast<unsigned long long>(TotalBytes(expected.desc)));
+        success = false;
+    }
+    if ((DepthOfFieldFX_Render(context.desc) == DEPTHOFFIELDFX_RETURN_CODE_SUCCESS) || (DepthOfFieldFX_RenderBox(context.desc) == DEPTHOFFIELDFX_RETURN_CODE_SUCCESS))
+    {
+        printf("  full resolution modes rendered with quarter res only\n");
+        success = false;
+    }
+    return success;
+}
+
+// m_autoScaleFactor renders every mode with the scale factor GetScaleFactorInfo picks for the peak color of
+// the frame, the largest one with headroom to spare.
+static bool TestAutoScaleFactor()
+{
+    TEST_FRAME frame;
+    CreateTestFrame(181, 127, 30.0f, frame);
+    for (float& color : frame.color)
+    {
+        color *= 37.0f;
+    }
+
+    bool success = true;
+    for (int mode = 0; mode < DEPTHOFFIELDFX_MODE_COUNT; ++mode)
+    {
+        TEST_CONTEXT expected(frame, 30);
+        success = expected.Render(static_cast<DEPTHOFFIELDFX_MODE>(mode)) && success;
+
+        float                            peakColor = 0.0f;
+        DEPTHOFFIELDFX_SCALE_FACTOR_INFO info;
+        success = TEST_CONTEXT::Check(DepthOfFieldFX_MeasurePeakColor(expected.desc, &peakColor), "measure peak color") && success;
+        success = TEST_CONTEXT::Check(DepthOfFieldFX_GetScaleFactorInfo(expected.desc, static_cast<DEPTHOFFIELDFX_MODE>(mode), peakColor, &info), "get scale factor info") && success;
+
+        TEST_CONTEXT context(frame, 30);
+        context.desc.m_autoScaleFactor = false;
+        context.desc.m_scaleFactor     = info.m_scaleFactor;
+        success                        = context.Render(static_cast<DEPTHOFFIELDFX_MODE>(mode)) && success;
+        success                        = CheckIdentical(context.result, expected.result, "auto scale factor") && success;
+
+        DEPTHOFFIELDFX_SCALE_FACTOR_INFO fits;
+        DEPTHOFFIELDFX_SCALE_FACTOR_INFO overflows;
+        DepthOfFieldFX_GetScaleFactorInfo(context.desc, static_cast<DEPTHOFFIELDFX_MODE>(mode), peakColor, &fits);
+        context.desc.m_scaleFactor = info.m_scaleFactor + 1;
+        DepthOfFieldFX_GetScaleFactorInfo(context.desc, static_cast<DEPTHOFFIELDFX_MODE>(mode), peakColor, &overflows);
+        if ((fits.m_headroomBits < 0.0f) || (overflows.m_headroomBits >= 0.0f))
+        {
+            printf("  scale factor %u of mode %d has %g bits of headroom, one more %g\n", info.m_scaleFactor, mode, fits.m_headroomBits, overflows.m_headroomBits);
+            success = false;
+        }
+    }
+    return success;
+}
+
+// Sets the blur radius of every pixel to radius, keeping the sign of its circle of confusion
+static void SetBlurRadius(TEST_FRAME& frame, float radius)
+{
+    for (float& coc : frame.coc)
+    {
+        coc = (coc < 0.0f) ? -radius : radius;
+    }
+}
+
+// An untiled frame of a single blur radius is one tile with the peak color and the radius of the frame,
+// its 16 bit lanes take the scale factor GetScaleFactorInfo picks for them. The INT16 result is the INT32
+// one at that scale factor bit for bit, and against INT32 at any other scale factor it is off by at most
+// the sum of the error bounds of both.
+static bool TestCompactLanes()
+{
+    TEST_FRAME frame;
+    CreateTestFrame(173, 119, 1.0f, frame);
+
+    // the Bartlett keeps the 8 bits of precision of 16 bit lanes up to a blur radius of 1
+    static const struct
+    {
+        DEPTHOFFIELDFX_MODE mode;
+        float               radius;
+    } s_cases[] = { { DEPTHOFFIELDFX_MODE_RENDER, 1.5f }, { DEPTHOFFIELDFX_MODE_RENDER_BOX, 1.5f }, { DEPTHOFFIELDFX_MODE_RENDER_BOX, 3.5f } };
+
+    bool success = true;
+    for (const auto& testCase : s_cases)
+    {
+        SetBlurRadius(frame, testCase.radius);
+
+        TEST_CONTEXT compact(frame, 8);
+        compact.desc.m_intermediateFormat = DEPTHOFFIELDFX_CPU_INTERMEDIATE_FORMAT_INT16;
+        success                           = compact.Render(testCase.mode) && success;
+
+        float peakColor = 0.0f;
+        DepthOfFieldFX_MeasurePeakColor(compact.desc, &peakColor);
+        DEPTHOFFIELDFX_SCALE_FACTOR_INFO compactInfo;
+        compact.desc.m_maxBlurRadius = static_cast<uint>(testCase.radius);
+        compact.desc.m_scaleFactor   = 0;
+        DepthOfFieldFX_GetScaleFactorInfo(compact.desc, testCase.mode, peakColor, &compactInfo);
+        compact.desc.m_scaleFactor = compactInfo.m_scaleFactor;
+        DepthOfFieldFX_GetScaleFactorInfo(compact.desc, testCase.mode, peakColor, &compactInfo);
+        if (compactInfo.m_precisionBits < 8.0f)
+        {
+            printf("  %g bits of precision fall back to 32 bit lanes\n", compactInfo.m_precisionBits);
+            success = false;
+        }
+
+        TEST_CONTEXT exact(frame, 8);
+        exact.desc.m_autoScaleFactor = false;
+        exact.desc.m_scaleFactor     = compactInfo.m_scaleFactor;
+        success                      = exact.Render(testCase.mode) && success;
+        success                      = CheckIdentical(compact.result, exact.result, "int16 against int32 at its scale factor") && success;
+
+        TEST_CONTEXT wide(frame, 8);
+        wide.desc.m_autoScaleFactor = false;
+        wide.desc.m_scaleFactor     = 28;
+        success                     = wide.Render(testCase.mode) && success;
+
+        DEPTHOFFIELDFX_SCALE_FACTOR_INFO wideInfo;
+        wide.desc.m_maxBlurRadius = static_cast<uint>(testCase.radius);
+        DepthOfFieldFX_GetScaleFactorInfo(wide.desc, testCase.mode, peakColor, &wideInfo);
+        success = CheckMaxError(compact.result, wide.result, compactInfo.m_errorBound + wideInfo.m_errorBound, "int16 against int32") && success;
+    }
+    return success;
+}
+
+// Rendering from depth matches rendering from the circle of confusion DepthOfFieldFX_ComputeCoc computes
+// from the same depth and lens, for standard and reversed depth, untiled and in tiles.
+static bool TestDepth()
+{
+    TEST_FRAME frame;
+    CreateTestFrame(257, 143, 16.0f, frame);
+
+    DEPTHOFFIELDFX_LENS lens;
+    lens.m_focalLength   = 0.19f;
+    lens.m_fStop         = 1.8f;
+    lens.m_focusDistance = 14.61f;
+    lens.m_nearPlane     = 0.1f;
+    lens.m_farPlane      = 1000.0f;
+    lens.m_forceCoc      = 0.0f;
+
+    // scene depths from 0.2 to 1000 through the focus distance
+    std::vector<float> depth(frame.coc.size());
+    bool               success = true;
+    for (bool reversedZ : { false, true })
+    {
+        lens.m_reversedZ = reversedZ;
+        for (size_t i = 0; i < depth.size(); ++i)
+        {
+            const double z = 0.2 * pow(5000.0, static_cast<double>(i) / static_cast<double>(depth.size()));
+            const double d = (lens.m_farPlane - lens.m_farPlane * lens.m_nearPlane / z) / (lens.m_farPlane - lens.m_nearPlane);
+            depth[i]       = static_cast<float>(reversedZ ? 1.0 - d : d);
+        }
+
+        for (int mode = 0; mode < DEPTHOFFIELDFX_MODE_COUNT; ++mode)
+        {
+            for (uint64 memoryBudget : { 0u, 900000u })
+            {
+                TEST_CONTEXT expected(frame, 16);
+                expected.desc.m_memoryBudget   = memoryBudget;
+                expected.desc.m_depth.m_pData  = &depth[0];
+                expected.desc.m_depth.m_pitch  = frame.width * sizeof(float);
+                expected.desc.m_depth.m_format = DEPTHOFFIELDFX_CPU_FORMAT_R32_FLOAT;
+                expected.desc.m_lens           = lens;
+                success = expected.Resize() && TEST_CONTEXT::Check(DepthOfFieldFX_ComputeCoc(expected.desc), "compute coc") && success;
+                expected.desc.m_depth.m_pData = nullptr;
+                success                       = expected.Render(static_cast<DEPTHOFFIELDFX_MODE>(mode)) && success;
+
+                TEST_CONTEXT context(frame, 16);
+                context.desc.m_memoryBudget  = memoryBudget;
+                context.desc.m_depth         = expected.desc.m_depth;
+                context.desc.m_depth.m_pData = &depth[0];
+                context.desc.m_lens          = lens;
+                success                      = context.Render(static_cast<DEPTHOFFIELDFX_MODE>(mode)) && success;
+                success                      = CheckIdentical(context.result, expected.result, "depth") && success;
+            }
+        }
+    }
+    return success;
+}
+
+// The vector kernels of GetCocKernel convert a row of random depths to the bits of the scalar kernel, for
+// every depth and circle of confusion format, standard and reversed depth and a finite and infinite far
+// plane. The row is not a multiple of any vector width and starts one texel into the allocation.
+static bool TestCocKernels()
+{
+    const uint count = 1021;
+
+    std::vector<float>  depth32(count + 1);
+    std::vector<uint16> depth16(count + 1);
+    std::vector<uint>   depth24(count + 1);
+    uint                seed = 5;
+    for (uint i = 0; i <= count; ++i)
+    {
+        seed        = seed * 1103515245 + 12345;
+        depth32[i]  = static_cast<float>(seed >> 8) / static_cast<float>(1 << 24);
+        depth16[i]  = static_cast<uint16>((seed >> 8) % 0x3c01);  // the halves from 0 to 1
+        depth24[i]  = seed;                                       // the stencil bits are ignored
+    }
+    depth32[1] = 0.0f;
+    depth32[2] = 1.0f;
+
+    const void* const               depthRows[]    = { &depth32[1], &depth16[1], &depth24[1] };
+    const DEPTHOFFIELDFX_CPU_FORMAT depthFormats[] = { DEPTHOFFIELDFX_CPU_FORMAT_R32_FLOAT, DEPTHOFFIELDFX_CPU_FORMAT_R16_FLOAT, DEPTHOFFIELDFX_CPU_FORMAT_D24_UNORM_S8_UINT };
+
+    DEPTHOFFIELDFX_LENS lens;
+    lens.m_focalLength   = 0.19f;
+    lens.m_fStop         = 1.8f;
+    lens.m_focusDistance = 14.61f;
+    lens.m_nearPlane     = 0.1f;
+    lens.m_forceCoc      = 0.0f;
+
+    bool success = true;
+    for (float farPlane : { 1000.0f, INFINITY })
+    {
+        for (bool reversedZ : { false, true })
+        {
+            lens.m_farPlane  = farPlane;
+            lens.m_reversedZ = reversedZ;
+            DEPTHOFFIELDFX_COC_PARAMS params;
+            GetCocParams(lens, 1920, 64, params);
+
+            for (size_t depthFormat = 0; depthFormat < 3; ++depthFormat)
+            {
+                for (DEPTHOFFIELDFX_CPU_FORMAT cocFormat : { DEPTHOFFIELDFX_CPU_FORMAT_R32_FLOAT, DEPTHOFFIELDFX_CPU_FORMAT_R16_FLOAT })
+                {
+                    std::vector<float> expected(count + 1, -1.0f);
+                    GetCocKernel(DEPTHOFFIELDFX_CPU_INSTRUCTION_SET_SCALAR, depthFormats[depthFormat], cocFormat)(params, depthRows[depthFormat], &expected[1], count);
+                    for (int instructionSet = DEPTHOFFIELDFX_CPU_INSTRUCTION_SET_SSE2; instructionSet <= DEPTHOFFIELDFX_CPU_INSTRUCTION_SET_NEON; ++instructionSet)
+                    {
+                        DEPTHOFFIELDFX_CPU_COC_FN kernel = GetCocKernel(static_cast<DEPTHOFFIELDFX_CPU_INSTRUCTION_SET>(instructionSet), depthFormats[depthFormat], cocFormat);
+                        if (kernel == nullptr)
+                        {
+                            continue;
+                        }
+                        std::vector<float> coc(count + 1, -1.0f);
+                        kernel(params, depthRows[depthFormat], &coc[1], count);
+                        if (memcmp(&coc[0], &expected[0], coc.size() * sizeof(float)) != 0)
+                        {
+                            printf("  instruction set %d differs for depth format %u and coc format %d, reversed %d, far plane %g\n", instructionSet,
+                                   static_cast<uint>(depthFormats[depthFormat]), cocFormat, reversedZ, farPlane);
+                            success = false;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return success;
+}
+
+// Points the images of a TEST_CONTEXT desc at another frame and result, with the blur radius of that frame
+static void SetFrame(DEPTHOFFIELDFX_CPU_DESC& desc, TEST_FRAME& frame, uint maxBlurRadius, std::vector<float>& result)
+{
+    result.assign(static_cast<size_t>(frame.width) * frame.height * 4, -1.0f);
+    desc.m_maxBlurRadius             = maxBlurRadius;
+    desc.m_screenSize.x              = frame.width;
+    desc.m_screenSize.y              = frame.height;
+    desc.m_color.m_pData             = &frame.color[0];
+    desc.m_color.m_pitch             = frame.width * 4 * sizeof(float);
+    desc.m_result.m_pData            = &result[0];
+    desc.m_result.m_pitch            = frame.width * 4 * sizeof(float);
+    desc.m_circleOfConfusion.m_pData = &frame.coc[0];
+    desc.m_circleOfConfusion.m_pitch = frame.width * sizeof(float);
+}
+
+// A resize to a smaller frame keeps the buffers of the larger one and renders like a fresh context.
+// Trim, or m_trimResizeCount small resizes in a row, shrink them to the smaller frame and the result
+// stays the same.
+static bool TestResizeReuse()
+{
+    TEST_FRAME large;
+    TEST_FRAME small;
+    CreateTestFrame(233, 171, 40.0f, large);
+    CreateTestFrame(131, 97, 12.0f, small);
+
+    TEST_CONTEXT expected(small, 12);
+    bool         success = expected.Render(DEPTHOFFIELDFX_MODE_RENDER);
+
+    for (uint trimResizeCount : { 0u, 2u })
+    {
+        TEST_CONTEXT context(large, 40);
+        context.desc.m_trimResizeCount = trimResizeCount;
+        success                        = context.Render(DEPTHOFFIELDFX_MODE_RENDER) && success;
+        const size_t largeCapacity     = context.desc.m_pOpaque->m_intermediateBuffer.capacity();
+
+        std::vector<float> result;
+        SetFrame(context.desc, small, 12, result);
+        for (uint resize = 1; resize <= 2; ++resize)
+        {
+            success = context.Resize() && context.Render(DEPTHOFFIELDFX_MODE_RENDER) && success;
+            success = CheckIdentical(result, expected.result, "resize to a smaller frame") && success;
+
+            // the second resize in a row trims with a m_trimResizeCount of 2
+            const size_t capacity = context.desc.m_pOpaque->m_intermediateBuffer.capacity();
+            if ((capacity == largeCapacity) == (resize == trimResizeCount))
+            {
+                printf("  resize %u with a trim resize count of %u kept %llu of %llu elements\n", resize, trimResizeCount, static_cast<unsigned long long>(capacity),
+                       static_cast<unsigned long long>(largeCapacity));
+                success = false;
+            }
+        }
+
+        success = TEST_CONTEXT::Check(DepthOfFieldFX_Trim(context.desc), "trim") && success;
+        if (context.desc.m_pOpaque->m_intermediateBuffer.capacity() >= largeCapacity)
+        {
+            printf("  trim kept the buffer of the larger frame\n");
+            success = false;
+        }
+        success = TEST_CONTEXT::Check(DepthOfFieldFX_Render(context.desc), "render after trim") && success;
+        success = CheckIdentical(result, expected.result, "render after trim") && success;
+    }
+    return success;
+}
+
+// Without a resize every mode renders a smaller frame and blur radius in the buffers of a larger one like
+// a context resized for it. The full resolution modes fail on a larger blur radius the buffers do not
+// hold, the quarter res mode scatters it at half resolution and still fits.
+static bool TestDynamicLayout()
+{
+    TEST_FRAME large;
+    TEST_FRAME small;
+    CreateTestFrame(233, 171, 40.0f, large);
+    CreateTestFrame(157, 113, 12.0f, small);
+
+    bool success = true;
+    for (int mode = 0; mode < DEPTHOFFIELDFX_MODE_COUNT; ++mode)
+    {
+        TEST_CONTEXT expected(small, 12);
+        success = expected.Render(static_cast<DEPTHOFFIELDFX_MODE>(mode)) && success;
+
+        TEST_CONTEXT       context(large, 40);
+        std::vector<float> result;
+        success = context.Resize() && success;
+        SetFrame(context.desc, small, 12, result);
+        success = TEST_CONTEXT::Check(RenderMode(context.desc, static_cast<DEPTHOFFIELDFX_MODE>(mode)), "render a smaller layout") && success;
+        success = CheckIdentical(result, expected.result, "smaller layout") && success;
+
+        SetFrame(context.desc, large, 64, result);
+        if ((mode != DEPTHOFFIELDFX_MODE_RENDER_QUARTER_RES) && (RenderMode(context.desc, static_cast<DEPTHOFFIELDFX_MODE>(mode)) == DEPTHOFFIELDFX_RETURN_CODE_SUCCESS))
+        {
+            printf("  mode %d rendered a layout larger than the buffers\n", mode);
+            success = false;
+        }
+    }
+    return success;
+}
+
+// The defocus modes match the full frame bit for bit, with the bounds measured from the frame and with
+// caller bounds that cover the blurred pixels, untiled and in tiles. Only a patch of the frame is blurred.
+static bool TestDefocusBounds()
+{
+    TEST_FRAME frame;
+    CreateTestFrame(263, 157, 20.0f, frame);
+    for (uint y = 0; y < frame.height; ++y)
+    {
+        for (uint x = 0; x < frame.width; ++x)
+        {
+            if ((x < 70) || (x > 190) || (y < 40) || (y > 110))
+            {
+                frame.coc[static_cast<size_t>(y) * frame.width + x] = 0.3f;
+            }
+        }
+    }
+
+    DEPTHOFFIELDFX_CPU_DESC::uint4 blurredBounds;
+    blurredBounds.x = 70;
+    blurredBounds.y = 40;
+    blurredBounds.z = 121;
+    blurredBounds.w = 71;
+
+    DEPTHOFFIELDFX_CPU_DESC::uint4 frameBounds;
+    frameBounds.x = 0;
+    frameBounds.y = 0;
+    frameBounds.z = frame.width;
+    frameBounds.w = frame.height;
+
+    bool success = true;
+    for (int mode = 0; mode < DEPTHOFFIELDFX_MODE_COUNT; ++mode)
+    {
+        TEST_CONTEXT expected(frame, 20);
+        expected.desc.m_defocusMode = DEPTHOFFIELDFX_CPU_DEFOCUS_MODE_FULL_FRAME;
+        success                     = expected.Render(static_cast<DEPTHOFFIELDFX_MODE>(mode)) && success;
+        for (uint64 memoryBudget : { 0u, 600000u })
+        {
+            TEST_CONTEXT measured(frame, 20);
+            measured.desc.m_defocusMode  = DEPTHOFFIELDFX_CPU_DEFOCUS_MODE_MEASURED;
+            measured.desc.m_memoryBudget = memoryBudget;
+            success                      = measured.Render(static_cast<DEPTHOFFIELDFX_MODE>(mode)) && success;
+            success                      = CheckIdentical(measured.result, expected.result, "measured bounds") && success;
+
+            for (const DEPTHOFFIELDFX_CPU_DESC::uint4& bounds : { blurredBounds, frameBounds })
+            {
+                TEST_CONTEXT caller(frame, 20);
+                caller.desc.m_defocusMode   = DEPTHOFFIELDFX_CPU_DEFOCUS_MODE_CALLER;
+                caller.desc.m_defocusBounds = bounds;
+                caller.desc.m_memoryBudget  = memoryBudget;
+                success                     = caller.Render(static_cast<DEPTHOFFIELDFX_MODE>(mode)) && success;
+                success                     = CheckIdentical(caller.result, expected.result, "caller bounds") && success;
+            }
+        }
+    }
+    return success;
+}
+
+// The blur radius and bounds of the circle of confusion statistics shrink the tiles to what the frame
+// needs without changing the result, which stays the one of m_maxBlurRadius and the full frame.
+static bool TestCocStatistics()
+{
+    TEST_FRAME frame;
+    CreateTestFrame(241, 139, 12.0f, frame);
+
+    bool success = true;
+    for (int mode = 0; mode < DEPTHOFFIELDFX_MODE_COUNT; ++mode)
+    {
+        TEST_CONTEXT expected(frame, 40);
+        success                   = expected.Render(static_cast<DEPTHOFFIELDFX_MODE>(mode)) && success;
+        const uint64 untiledBytes = TotalBytes(expected.desc);
+        for (DEPTHOFFIELDFX_CPU_DEFOCUS_MODE defocusMode : { DEPTHOFFIELDFX_CPU_DEFOCUS_MODE_FULL_FRAME, DEPTHOFFIELDFX_CPU_DEFOCUS_MODE_MEASURED })
+        {
+            for (uint64 memoryBudget : { static_cast<uint64>(0), untiledBytes * 6 / 10 })
+            {
+                TEST_CONTEXT context(frame, 40);
+                context.desc.m_defocusMode  = defocusMode;
+                context.desc.m_memoryBudget = memoryBudget;
+                success = context.Resize() && TEST_CONTEXT::Check(DepthOfFieldFX_ComputeCocStatistics(context.desc), "statistics") && success;
+                context.desc.m_useCocStatistics = true;
+                success                         = context.Render(static_cast<DEPTHOFFIELDFX_MODE>(mode)) && success;
+                success                         = CheckIdentical(context.result, expected.result, "coc statistics") && success;
+            }
+        }
+    }
+    return success;
+}
+
+// Selects a mode for count frames and times each at load times a millisecond per thousand bytes of its
+// work, alternating with the load of the odd frames. Returns the number of times the mode changed and
+// the first frame that selected mode in *pFrame.
+static uint RunModeSelector(DEPTHOFFIELDFX_MODE_SELECTOR& selector, const uint64 work[DEPTHOFFIELDFX_MODE_COUNT], uint count, float evenLoad, float oddLoad, DEPTHOFFIELDFX_MODE mode, uint* pFrame)
+{
+    uint switches = 0;
+    *pFrame       = count;
+    for (uint frame = 0; frame < count; ++frame)
+    {
+        const DEPTHOFFIELDFX_MODE previous = selector.m_mode;
+        const DEPTHOFFIELDFX_MODE selected = SelectMode(selector, work);
+        switches += (selected != previous) ? 1 : 0;
+        *pFrame = ((selected == mode) && (*pFrame == count)) ? frame : *pFrame;
+
+        const float load = ((frame & 1) != 0) ? oddLoad : evenLoad;
+        CalibrateModeSelector(selector, selected, work[selected], load * 1e-3f * static_cast<float>(work[selected]));
+    }
+    return switches;
+}
+
+// Timings that alternate around the budget or around its margin do not make the selector flap between
+// modes. It steps down once when the current mode misses the budget, and only steps back up after a
+// better mode has fit with the margin for m_hysteresisFrames frames in a row.
+static bool TestModeSelector()
+{
+    // Render, RenderQuarterRes and RenderBox predicted at 1, 0.25 and 0.5 ms under a load of 1
+    const uint64 work[DEPTHOFFIELDFX_MODE_COUNT] = { 1000, 250, 500 };
+
+    DEPTHOFFIELDFX_MODE_SELECTOR selector;
+    selector.m_budgetMilliseconds = 1.0f;
+    selector.m_hysteresis         = 0.15f;
+    selector.m_hysteresisFrames   = 10;
+    selector.m_calibrationWeight  = 1.0f;
+    for (uint mode = 0; mode < DEPTHOFFIELDFX_MODE_COUNT; ++mode)
+    {
+        CalibrateModeSelector(selector, static_cast<DEPTHOFFIELDFX_MODE>(mode), work[mode], 1e-3f * static_cast<float>(work[mode]));
+    }
+
+    // the first frame selects with the load of 1 of the calibration, the second one steps down
+    bool success  = true;
+    uint frame    = 0;
+    uint switches = RunModeSelector(selector, work, 100, 1.05f, 0.95f, DEPTHOFFIELDFX_MODE_RENDER_BOX, &frame);
+    if ((switches != 1) || (frame != 1) || (selector.m_mode != DEPTHOFFIELDFX_MODE_RENDER_BOX))
+    {
+        printf("  %u switches around the budget, box from frame %u\n", switches, frame);
+        success = false;
+    }
+
+    switches = RunModeSelector(selector, work, 100, 0.8f, 0.9f, DEPTHOFFIELDFX_MODE_RENDER, &frame);
+    if (switches != 0)
+    {
+        printf("  %u switches around the margin\n", switches);
+        success = false;
+    }
+
+    // the first frame still selects with the load of the last frame above, 0.9
+    switches = RunModeSelector(selector, work, 100, 0.8f, 0.8f, DEPTHOFFIELDFX_MODE_RENDER, &frame);
+    if ((switches != 1) || (frame != selector.m_hysteresisFrames))
+    {
+        printf("  %u switches within the margin, render from frame %u\n", switches, frame);
+        success = false;
+    }
+    return success;
+}
+
+// Every render of a context that reuses unchanged tiles matches a full render of the same frame, as
+// parts of the color and of the circle of confusion change between them.
+static bool TestTileReuse()
+{
+    TEST_FRAME frame;
+    CreateTestFrame(277, 163, 20.0f, frame);
+    const TEST_FRAME original = frame;
+
+    bool success = true;
+    for (int mode = 0; mode < DEPTHOFFIELDFX_MODE_COUNT; ++mode)
+    {
+        for (uint64 memoryBudget : { 0u, 700000u })
+        {
+            frame = original;
+            TEST_CONTEXT context(frame, 20);
+            context.desc.m_reuseUnchangedTiles = true;
+            context.desc.m_memoryBudget        = memoryBudget;
+
+            uint reusedTiles = 0;
+            for (uint change = 0; change < 4; ++change)
+            {
+                // the first render has no previous result, the later ones change a patch of one source
+                for (uint y = 20 + 30 * change; y < 50 + 30 * change; ++y)
+                {
+                    for (uint x = 40 + 50 * change; x < 70 + 50 * change; ++x)
+                    {
+                        const size_t index = static_cast<size_t>(y) * frame.width + x;
+                        if ((change & 1) != 0)
+                        {
+                            frame.color[index * 4 + 1] = 0.5f;
+                        }
+                        else if (change != 0)
+                        {
+                            frame.coc[index] = -frame.coc[index];
+                        }
+                    }
+                }
+
+                success = context.Render(static_cast<DEPTHOFFIELDFX_MODE>(mode)) && success;
+
+                DEPTHOFFIELDFX_CPU_REUSE_STATISTICS statistics;
+                DepthOfFieldFX_GetReuseStatistics(context.desc, &statistics);
+                reusedTiles += statistics.m_reusedTiles;
+
+                TEST_CONTEXT expected(frame, 20);
+                success = expected.Render(static_cast<DEPTHOFFIELDFX_MODE>(mode)) && success;
+                success = CheckIdentical(context.result, expected.result, "tile reuse") && success;
+            }
+            if (reusedTiles == 0)
+            {
+                printf("  no tile was reused\n");
+                success = false;
+            }
+        }
+    }
+    return success;
+}
+
+// Up to DEPTHOFFIELDFX_CPU_PYRAMID_LEVEL_RADIUS the pyramid scatters everything at full resolution and
+// matches Render bit for bit. Beyond it the coarser levels still keep a constant color constant.
+static bool TestPyramid()
+{
+    TEST_FRAME frame;
+    CreateTestFrame(251, 149, 40.0f, frame);
+
+    TEST_CONTEXT expected(frame, DEPTHOFFIELDFX_CPU_PYRAMID_LEVEL_RADIUS);
+    bool         success      = expected.Render(DEPTHOFFIELDFX_MODE_RENDER);
+    const uint64 untiledBytes = TotalBytes(expected.desc);
+    for (uint64 memoryBudget : { static_cast<uint64>(0), untiledBytes * 8 / 10 })
+    {
+        TEST_CONTEXT context(frame, DEPTHOFFIELDFX_CPU_PYRAMID_LEVEL_RADIUS);
+        context.desc.m_memoryBudget = memoryBudget;
+        context.desc.m_pyramid      = true;
+        success = context.Resize() && TEST_CONTEXT::Check(DepthOfFieldFX_RenderPyramid(context.desc), "render pyramid") && success;
+        success = CheckIdentical(context.result, expected.result, "pyramid") && success;
+    }
+
+    // blur radii up to 300 over a constant color, the alpha of the results is not compared
+    uint seed = 7;
+    for (size_t i = 0; i < frame.coc.size(); ++i)
+    {
+        seed         = seed * 1103515245 + 12345;
+        frame.coc[i] = static_cast<float>((seed >> 16) % 300);
+        for (size_t c = 0; c < 4; ++c)
+        {
+            frame.color[i * 4 + c] = 0.25f * static_cast<float>(c + 1);
+        }
+    }
+    const std::vector<float> constant = frame.color;
+
+    TEST_CONTEXT context(frame, 256);
+    context.desc.m_pyramid = true;
+    success                = context.Resize() && TEST_CONTEXT::Check(DepthOfFieldFX_RenderPyramid(context.desc), "render pyramid") && success;
+    success = CheckMaxError(context.result, constant, 1e-3f, "constant color") && success;
+    return success;
+}
+
+// The shader taps generated for the D3D11 Bartlett and box kernels are the constants the shaders shipped
+// with, and for every tabulated blur radius they land where the CPU scatter puts its taps.
+static bool TestKernelTaps()
+{
+    static const int s_bartlettData[9][4] = {
+        { -1, -1, 1, 0 }, { 0, -1, -2, 0 }, { 1, -1, 1, 0 }, { -1, 0, -2, 0 }, { 0, 0, 4, 0 },
+        { 1, 0, -2, 0 },  { -1, 1, 1, 0 },  { 0, 1, -2, 0 }, { 1, 1, 1, 0 },
+    };
+    static const int s_boxBartlettData[4][4] = { { -1, -1, 1, 0 }, { 1, -1, -1, 0 }, { -1, 1, -1, 0 }, { 1, 1, 1, 0 } };
+
+    struct KERNEL_TAPS
+    {
+        const char*                name;
+        DEPTHOFFIELDFX_KERNEL_TYPE type;
+        const int (*expected)[4];
+        uint tapCount;
+    };
+    const KERNEL_TAPS kernels[] = {
+        { "Bartlett", DEPTHOFFIELDFX_KERNEL_TYPE_BARTLETT, s_bartlettData, 9 },
+        { "box", DEPTHOFFIELDFX_KERNEL_TYPE_BOX, s_boxBartlettData, 4 },
+    };
+
+    bool success = true;
+    for (const KERNEL_TAPS& k : kernels)
+    {
+        const DEPTHOFFIELDFX_KERNEL& kernel = GetKernel(k.type);
+        int                          taps[s_maxKernelTaps][4];
+        GetKernelShaderTaps(kernel, taps);
+        if ((kernel.m_tapCount != k.tapCount) || (memcmp(taps, k.expected, sizeof(taps[0]) * k.tapCount) != 0))
+        {
+            printf("  %s shader taps differ from the original constants\n", k.name);
+            success = false;
+            continue;
+        }
+
+        for (int radius = 1; radius <= static_cast<int>(s_maxKernelTableRadius); ++radius)
+        {
+            int offsets[s_maxKernelTaps1D];
+            GetKernelOffsets(kernel, radius, offsets);
+            for (uint i = 0; i < kernel.m_tapCount; ++i)
+            {
+                // WriteDeltaBartlett and WriteBoxDeltaBartlett without the padding
+                int position[2];
+                for (int axis = 0; axis < 2; ++axis)
+                {
+                    const int unit = k.expected[i][axis];
+                    position[axis] = (k.type == DEPTHOFFIELDFX_KERNEL_TYPE_BARTLETT) ? unit * (radius + 1) + 1 : unit * radius + (unit > 0 ? 1 : 0);
+                }
+                const DEPTHOFFIELDFX_KERNEL_TAP& tap = kernel.m_taps[i];
+                if ((offsets[tap.m_x] != position[0]) || (offsets[tap.m_y] != position[1]) || (tap.m_weight != k.expected[i][2]))
+                {
+                    printf("  %s tap %u of blur radius %d is (%d, %d) x %d, the shader puts it at (%d, %d) x %d\n", k.name, i, radius,
+                           offsets[tap.m_x], offsets[tap.m_y], tap.m_weight, position[0], position[1], k.expected[i][2]);
+                    success = false;
+                }
+            }
+        }
+    }
+    return success;
+}
+
+// The quadratic B-spline of blur radius r is three centered boxes of 2 * ceil(r / 3) + 1 pixels. Spreading
+// a single pixel over a black frame of that radius gives the product of the convolved boxes along x and y,
+// which is mirror symmetric about the pixel and reaches from r to r + 2 pixels away from it.
+static bool TestBSplineProfile()
+{
+    const uint size   = 67;
+    const uint center = size / 2;
+
+    TEST_FRAME frame;
+    frame.width  = size;
+    frame.height = size;
+    frame.color.assign(static_cast<size_t>(size) * size * 4, 0.0f);
+    frame.coc.assign(static_cast<size_t>(size) * size, 0.0f);
+    for (uint c = 0; c < 4; ++c)
+    {
+        frame.color[(static_cast<size_t>(center) * size + center) * 4 + c] = 1.0f;
+    }
+
+    bool success = true;
+    for (uint radius = 1; radius <= DEPTHOFFIELDFX_CPU_QUADRATIC_BSPLINE_MAX_BLUR_RADIUS; ++radius)
+    {
+        const int halfWidth = static_cast<int>(radius + 2) / 3;
+        const int width     = 2 * halfWidth + 1;
+
+        // the profile runs from -3 * halfWidth to 3 * halfWidth
+        std::vector<double> profile(1, 1.0);
+        for (int box = 0; box < 3; ++box)
+        {
+            std::vector<double> convolved(profile.size() + width - 1, 0.0);
+            for (size_t i = 0; i < profile.size(); ++i)
+            {
+                for (int j = 0; j < width; ++j)
+                {
+                    convolved[i + j] += profile[i] / width;
+                }
+            }
+            profile.swap(convolved);
+        }
+        const int reach = 3 * halfWidth;
+        if ((reach < static_cast<int>(radius)) || (reach > static_cast<int>(radius) + 2))
+        {
+            printf("  blur radius %u reaches %d pixels\n", radius, reach);
+            success = false;
+        }
+
+        std::vector<float> expected(frame.color.size(), 0.0f);
+        for (int dy = -reach; dy <= reach; ++dy)
+        {
+            for (int dx = -reach; dx <= reach; ++dx)
+            {
+                const size_t index = static_cast<size_t>(static_cast<int>(center) + dy) * size + center + dx;
+                for (uint c = 0; c < 3; ++c)
+                {
+                    expected[index * 4 + c] = static_cast<float>(profile[dx + reach] * profile[dy + reach]);
+                }
+            }
+        }
+
+        SetBlurRadius(frame, static_cast<float>(radius));
+        TEST_CONTEXT context(frame, radius);
+        context.desc.m_kernel = DEPTHOFFIELDFX_CPU_KERNEL_QUADRATIC_BSPLINE;
+        success               = context.Render(DEPTHOFFIELDFX_MODE_RENDER) && success;
+        success               = CheckMaxError(context.result, expected, 1e-5f, "B-spline profile") && success;
+
+        bool symmetric = true;
+        for (uint y = 0; y < size; ++y)
+        {
+            for (uint x = 0; x < size; ++x)
+            {
+                const float value = context.result[(static_cast<size_t>(y) * size + x) * 4];
+                symmetric         = symmetric && (value == context.result[(static_cast<size_t>(y) * size + size - 1 - x) * 4]);
+                symmetric         = symmetric && (value == context.result[(static_cast<size_t>(size - 1 - y) * size + x) * 4]);
+                symmetric         = symmetric && (value == context.result[(static_cast<size_t>(x) * size + y) * 4]);
+            }
+        }
+        if (!symmetric)
+        {
+            printf("  B-spline of blur radius %u is not symmetric\n", radius);
+            success = false;
+        }
+    }
+    return success;
+}
+
+// Swaps the rows and columns of an RGBA image of width x height pixels
+static void TransposeImage(const std::vector<float>& image, uint width, uint height, std::vector<float>& transposed)
+{
+    transposed.resize(image.size());
+    for (uint y = 0; y < height; ++y)
+    {
+        for (uint x = 0; x < width; ++x)
+        {
+            memcpy(&transposed[(static_cast<size_t>(x) * height + y) * 4], &image[(static_cast<size_t>(y) * width + x) * 4], 4 * sizeof(float));
+        }
+    }
+}
+
+// Oval bokeh are the round ones of the other axis transposed: the tall ovals of a frame are the wide ovals
+// of the transposed frame, transposed, float rounding aside. Every splat keeps its weight, so a constant color stays constant
+// for every orientation.
+static bool TestAnamorphic()
+{
+    TEST_FRAME frame;
+    CreateTestFrame(173, 131, 24.0f, frame);
+
+    TEST_FRAME transposedFrame;
+    transposedFrame.width  = frame.height;
+    transposedFrame.height = frame.width;
+    TransposeImage(frame.color, frame.width, frame.height, transposedFrame.color);
+    transposedFrame.coc.resize(frame.coc.size());
+    for (uint y = 0; y < frame.height; ++y)
+    {
+        for (uint x = 0; x < frame.width; ++x)
+        {
+            transposedFrame.coc[static_cast<size_t>(x) * frame.height + y] = frame.coc[static_cast<size_t>(y) * frame.width + x];
+        }
+    }
+
+    bool success = true;
+    for (int mode = 0; mode < DEPTHOFFIELDFX_MODE_COUNT; ++mode)
+    {
+        TEST_CONTEXT tall(frame, 24);
+        tall.desc.m_anamorphicSqueeze = 2.0f;
+        tall.desc.m_bokehOrientation  = DEPTHOFFIELDFX_CPU_BOKEH_ORIENTATION_VERTICAL;
+        success                       = tall.Render(static_cast<DEPTHOFFIELDFX_MODE>(mode)) && success;
+
+        TEST_CONTEXT wide(transposedFrame, 24);
+        wide.desc.m_anamorphicSqueeze = 2.0f;
+        wide.desc.m_bokehOrientation  = DEPTHOFFIELDFX_CPU_BOKEH_ORIENTATION_HORIZONTAL;
+        success                       = wide.Render(static_cast<DEPTHOFFIELDFX_MODE>(mode)) && success;
+
+        std::vector<float> transposed;
+        TransposeImage(wide.result, transposedFrame.width, transposedFrame.height, transposed);
+        success = CheckMaxError(transposed, tall.result, 1e-5f, "transposed oval bokeh") && success;
+    }
+
+    for (float& color : frame.color)
+    {
+        color = 0.5f;
+    }
+    for (int orientation = DEPTHOFFIELDFX_CPU_BOKEH_ORIENTATION_VERTICAL; orientation <= DEPTHOFFIELDFX_CPU_BOKEH_ORIENTATION_TANGENTIAL; ++orientation)
+    {
+        for (int mode = 0; mode < DEPTHOFFIELDFX_MODE_COUNT; ++mode)
+        {
+            TEST_CONTEXT context(frame, 24);
+            context.desc.m_anamorphicSqueeze = 1.7f;
+            context.desc.m_bokehOrientation  = static_cast<DEPTHOFFIELDFX_CPU_BOKEH_ORIENTATION>(orientation);
+            success                          = context.Render(static_cast<DEPTHOFFIELDFX_MODE>(mode)) && success;
+            success                          = CheckMaxError(context.result, frame.color, 1e-3f, "constant color oval bokeh") && success;
+        }
+    }
+    return success;
+}
+
+// Without pixels in front of the focus plane the near field layer stays empty and the layered result is
+// the one of a single layer bit for bit. RenderQuarterRes and RenderPyramid have no layers.
+static bool TestLayered()
+{
+    TEST_FRAME frame;
+    CreateTestFrame(229, 151, 30.0f, frame);
+    for (float& coc : frame.coc)
+    {
+        coc = fabsf(coc);
+    }
+
+    TEST_CONTEXT layered(frame, 30);
+    layered.desc.m_layered = true;
+    layered.desc.m_pyramid = true;
+    bool         success      = layered.Resize();
+    const uint64 untiledBytes = TotalBytes(layered.desc);
+    if ((DepthOfFieldFX_RenderQuarterRes(layered.desc) != DEPTHOFFIELDFX_RETURN_CODE_INVALID_PARAMS) ||
+        (DepthOfFieldFX_RenderPyramid(layered.desc) != DEPTHOFFIELDFX_RETURN_CODE_INVALID_PARAMS))
+    {
+        printf("  layered quarter res or pyramid render did not fail\n");
+        success = false;
+    }
+
+    for (DEPTHOFFIELDFX_MODE mode : { DEPTHOFFIELDFX_MODE_RENDER, DEPTHOFFIELDFX_MODE_RENDER_BOX })
+    {
+        for (uint64 memoryBudget : { static_cast<uint64>(0), untiledBytes * 6 / 10 })
+        {
+            TEST_CONTEXT expected(frame, 30);
+            expected.desc.m_memoryBudget = memoryBudget;
+            success                      = expected.Render(mode) && success;
+
+            TEST_CONTEXT context(frame, 30);
+            context.desc.m_memoryBudget = memoryBudget;
+            context.desc.m_layered      = true;
+            success                     = context.Render(mode) && success;
+            success                     = CheckIdentical(context.result, expected.result, "layered") && success;
+        }
+    }
+    return success;
+}
+
+static const TEST_CASE g_tests[] = {
+    { "reference", TestReference },
+    { "thread_count", TestThreadCount },
+    { "instruction_sets", TestInstructionSets },
+    { "transpose_modes", TestTransposeModes },
+    { "scatter_modes", TestScatterModes },
+    { "memory_budget", TestMemoryBudget },
+    { "memory_requirements", TestMemoryRequirements },
+    { "contexts", TestContexts },
+    { "quarter_res_only", TestQuarterResOnly },
+    { "auto_scale_factor", TestAutoScaleFactor },
+    { "compact_lanes", TestCompactLanes },
+    { "depth", TestDepth },
+    { "coc_kernels", TestCocKernels },
+    { "resize_reuse", TestResizeReuse },
+    { "dynamic_layout", TestDynamicLayout },
+    { "defocus_bounds", TestDefocusBounds },
+    { "coc_statistics", TestCocStatistics },
+    { "mode_selector", TestModeSelector },
+    { "tile_reuse", TestTileReuse },
+    { "pyramid", TestPyramid },
+    { "kernel_taps", TestKernelTaps },
+    { "bspline_profile", TestBSplineProfile },
+    { "anamorphic", TestAnamorphic },
+    { "layered", TestLayered },
+};
+
+int main()
+{
+    int failures = 0;
+    for (const TEST_CASE& test : g_tests)
+    {
+        const bool success = test.function();
+        printf("%s %s\n", success ? "PASS" : "FAIL", test.name);
+        failures += success ? 0 : 1;
+    }
+    printf("%d of %d tests failed\n", failures, static_cast<int>(sizeof(g_tests) / sizeof(g_tests[0])));
+    return failures;
+}